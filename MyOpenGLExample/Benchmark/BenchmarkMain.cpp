@@ -0,0 +1,18 @@
+#include "MyApplication.h"
+
+/// <summary>
+/// Benchmark entry point: same options as the application, but always headless so it runs on
+/// machines without a display (CI boxes, render servers)
+/// </summary>
+/// <param name="argc"></param>
+/// <param name="argv"></param>
+/// <returns></returns>
+int main(int argc, char** argv)
+{
+    ApplicationOptions options;
+    if (!ParseCommandLine(argc, argv, options))
+        return -1;
+
+    options.headless = true;
+    return RunApplication(options);
+}
@@ -0,0 +1,176 @@
+#include <algorithm>
+#include <cfloat>
+#include <cstdint>
+#include <vector>
+
+#include "BoundingVolumeHierarchy.h"
+#include "FrustumCulling.h"
+#include "MicroBenchmark.h"
+#include "VectorMath.h"
+
+/// <summary>
+/// Objects in the tree, scattered around the camera as in the culling benchmarks
+/// </summary>
+static const size_t s_objectCount = 65536;
+
+/// <summary>
+/// Rays per call of the ray queries
+/// </summary>
+static const size_t s_rayCount = 256;
+
+static float NextSigned(uint32_t& _state)
+{
+    _state = _state * 1664525u + 1013904223u;
+    return (float)(_state >> 8) / 8388608.0f - 1.0f;
+}
+
+/// <summary>
+/// Boxes of spheres at random positions, and the same spheres moved a little (what a refit sees from one
+/// frame to the next)
+/// </summary>
+static void BuildBounds(std::vector<Aabb>& _bounds, std::vector<Aabb>& _moved)
+{
+    uint32_t seed = 4242u;
+    _bounds.resize(s_objectCount);
+    _moved.resize(s_objectCount);
+    for (size_t i = 0; i < s_objectCount; i++)
+    {
+        Vec3 center = { NextSigned(seed) * 100.0f, NextSigned(seed) * 100.0f, NextSigned(seed) * 100.0f };
+        float radius = 1.5f + NextSigned(seed);
+        _bounds[i] = AabbFromSphere(center, radius);
+
+        Vec3 offset = { NextSigned(seed) * 0.5f, NextSigned(seed) * 0.5f, NextSigned(seed) * 0.5f };
+        _moved[i] = AabbFromSphere(Vec3Add(center, offset), radius);
+    }
+}
+
+/// <summary>
+/// Every box against every plane: what the BVH query must return, in object order
+/// </summary>
+static void QueryFrustumLinear(const Frustum& _frustum, const std::vector<Aabb>& _bounds, std::vector<uint32_t>& _objects)
+{
+    for (size_t i = 0; i < _bounds.size(); i++)
+    {
+        const Aabb& box = _bounds[i];
+        bool inside = true;
+        for (int p = 0; p < 6 && inside; p++)
+        {
+            const Vec4& plane = _frustum.planes[p];
+            float outer = plane.x * ((plane.x >= 0.0f) ? box.max.x : box.min.x) + plane.y * ((plane.y >= 0.0f) ? box.max.y : box.min.y)
+                + plane.z * ((plane.z >= 0.0f) ? box.max.z : box.min.z) + plane.w;
+            inside = outer >= 0.0f;
+        }
+        if (inside)
+            _objects.push_back((uint32_t)i);
+    }
+}
+
+/// <summary>
+/// Closest box along the ray by testing all of them, FLT_MAX if none
+/// </summary>
+static float RaycastLinear(const std::vector<Aabb>& _bounds, const Vec3& _origin, const Vec3& _direction)
+{
+    Vec3 inverse = { 1.0f / _direction.x, 1.0f / _direction.y, 1.0f / _direction.z };
+    float closest = FLT_MAX;
+    for (const Aabb& box : _bounds)
+    {
+        float enter = 0.0f;
+        float exit = closest;
+        float t1 = (box.min.x - _origin.x) * inverse.x;
+        float t2 = (box.max.x - _origin.x) * inverse.x;
+        enter = std::max(enter, std::min(t1, t2));
+        exit = std::min(exit, std::max(t1, t2));
+        t1 = (box.min.y - _origin.y) * inverse.y;
+        t2 = (box.max.y - _origin.y) * inverse.y;
+        enter = std::max(enter, std::min(t1, t2));
+        exit = std::min(exit, std::max(t1, t2));
+        t1 = (box.min.z - _origin.z) * inverse.z;
+        t2 = (box.max.z - _origin.z) * inverse.z;
+        enter = std::max(enter, std::min(t1, t2));
+        exit = std::min(exit, std::max(t1, t2));
+
+        if (enter <= exit && enter < closest)
+            closest = enter;
+    }
+    return closest;
+}
+
+void RunBvhBenchmarks(MicroBenchmarkRunner& _runner)
+{
+    std::vector<Aabb> bounds, moved;
+    BuildBounds(bounds, moved);
+
+    BoundingVolumeHierarchy bvh;
+
+    /* Per object in the tree */
+    _runner.Run("bvh update/rebuild", s_objectCount,
+        [&]()
+        {
+            bvh.Build(bounds.data(), bounds.size());
+            KeepResult(bvh.GetCost());
+        });
+
+    bvh.Build(bounds.data(), bounds.size());
+    bool even = false;
+    _runner.Run("bvh update/refit", s_objectCount,
+        [&]()
+        {
+            even = !even;
+            bvh.Refit(even ? moved.data() : bounds.data());
+            KeepResult(bvh.GetCost());
+        });
+
+    bvh.Build(bounds.data(), bounds.size());
+
+    /* Per object in the scene, whether the query looks at it or not */
+    Mat4 projection = Mat4Perspective(45.0f * (3.141593f / 180.0f), 4.0f / 3.0f, 0.1f, 120.0f);
+    Mat4 view = Mat4Multiply(Mat4FromQuat(QuatFromAxisAngle({ 0.0f, 1.0f, 0.0f }, 0.4f)), Mat4Translation({ 0.0f, 0.0f, -20.0f }));
+    Frustum frustum = FrustumFromMatrix(Mat4Multiply(projection, view));
+
+    std::vector<uint32_t> linearObjects, bvhObjects;
+    linearObjects.reserve(s_objectCount);
+    bvhObjects.reserve(s_objectCount);
+    _runner.Run("frustum query/linear", s_objectCount,
+        [&]()
+        {
+            linearObjects.clear();
+            QueryFrustumLinear(frustum, bounds, linearObjects);
+            KeepResult((float)linearObjects.size());
+        });
+    _runner.Run("frustum query/bvh", s_objectCount,
+        [&]()
+        {
+            bvhObjects.clear();
+            bvh.QueryFrustum(frustum, bvhObjects);
+            KeepResult((float)bvhObjects.size());
+        });
+
+    /* Per ray, from the camera through random points of the scene */
+    std::vector<Vec3> directions(s_rayCount);
+    uint32_t seed = 99u;
+    Vec3 origin = { 0.0f, 0.0f, 110.0f };
+    for (size_t i = 0; i < s_rayCount; i++)
+    {
+        Vec3 target = { NextSigned(seed) * 100.0f, NextSigned(seed) * 100.0f, NextSigned(seed) * 100.0f };
+        directions[i] = Vec3Normalize(Vec3Sub(target, origin));
+    }
+
+    std::vector<float> linearDistances(s_rayCount), bvhDistances(s_rayCount);
+    _runner.Run("ray query/linear", s_rayCount,
+        [&]()
+        {
+            for (size_t i = 0; i < s_rayCount; i++)
+                linearDistances[i] = RaycastLinear(bounds, origin, directions[i]);
+            KeepResult(linearDistances[0]);
+        });
+    _runner.Run("ray query/bvh", s_rayCount,
+        [&]()
+        {
+            for (size_t i = 0; i < s_rayCount; i++)
+            {
+                RayHit hit;
+                bvhDistances[i] = bvh.Raycast(origin, directions[i], FLT_MAX, hit) ? hit.distance : FLT_MAX;
+            }
+            KeepResult(bvhDistances[0]);
+        });
+}
@@ -0,0 +1,84 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "EntityWorld.h"
+#include "FrustumCulling.h"
+#include "MicroBenchmark.h"
+#include "SceneSystems.h"
+#include "VectorMath.h"
+
+/// <summary>
+/// Objects per call, scattered around the camera: about a sixth of them end up in the frustum
+/// </summary>
+static const size_t s_objectCount = 16384;
+
+static float NextSigned(uint32_t& _state)
+{
+    _state = _state * 1664525u + 1013904223u;
+    return (float)(_state >> 8) / 8388608.0f - 1.0f;
+}
+
+/// <summary>
+/// Renderable entities in two groups (meshes) of different radius, at random positions and scales
+/// </summary>
+static void BuildObjects(EntityWorld& _world)
+{
+    uint32_t seed = 777u;
+    for (size_t i = 0; i < s_objectCount; i++)
+    {
+        Entity entity = _world.Create(kRenderableMask, (uint32_t)(i & 1));
+        Vec4 position = { NextSigned(seed) * 100.0f, NextSigned(seed) * 100.0f, NextSigned(seed) * 100.0f, 1.5f + NextSigned(seed) };
+        _world.Set(entity, kComponentPosition, &position);
+    }
+}
+
+/// <summary>
+/// Every chunk through the scalar kernel, as CullChunks does with the SIMD one
+/// </summary>
+static void CullChunksScalar(const std::vector<ChunkView>& _chunks, const Frustum& _frustum, const float* _groupRadii,
+    ChunkVisibility& _visibility)
+{
+    for (size_t i = 0; i < _chunks.size(); i++)
+    {
+        const ChunkView& chunk = _chunks[i];
+        SphereColumns spheres = { chunk.GetColumn(kComponentPosition, 0), chunk.GetColumn(kComponentPosition, 1),
+            chunk.GetColumn(kComponentPosition, 2), chunk.GetColumn(kComponentPosition, 3) };
+        _visibility.counts[i] = (uint32_t)CullSpheresScalar(_frustum, spheres, _groupRadii[chunk.group], chunk.count,
+            _visibility.rows.data() + chunk.first);
+    }
+}
+
+void RunCullingBenchmarks(MicroBenchmarkRunner& _runner)
+{
+    EntityWorld world;
+    BuildObjects(world);
+    std::vector<ChunkView> chunks;
+    size_t count = world.Query(kRenderableMask, chunks);
+
+    const float groupRadii[2] = { 1.7320508f, 1.0f };
+    Mat4 projection = Mat4Perspective(45.0f * (3.141593f / 180.0f), 4.0f / 3.0f, 0.1f, 120.0f);
+    Mat4 view = Mat4Multiply(Mat4FromQuat(QuatFromAxisAngle({ 0.0f, 1.0f, 0.0f }, 0.4f)), Mat4Translation({ 0.0f, 0.0f, -20.0f }));
+    Frustum frustum = FrustumFromMatrix(Mat4Multiply(projection, view));
+
+    ChunkVisibility scalar, simd;
+    ResizeVisibility(chunks, count, scalar);
+    ResizeVisibility(chunks, count, simd);
+
+    /* Cull and compact, per object tested */
+    _runner.Run("frustum culling/scalar", s_objectCount,
+        [&]()
+        {
+            CullChunksScalar(chunks, frustum, groupRadii, scalar);
+            KeepResult((float)CompactVisibility(scalar));
+        });
+
+#if MYOPENGL_SIMD_SSE
+    _runner.Run(std::string("frustum culling/") + GetSimdLevelName(), s_objectCount,
+        [&]()
+        {
+            CullChunks(chunks, 0, chunks.size(), frustum, groupRadii, simd);
+            KeepResult((float)CompactVisibility(simd));
+        });
+#endif
+}
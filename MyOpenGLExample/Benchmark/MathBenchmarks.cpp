@@ -0,0 +1,149 @@
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "MicroBenchmark.h"
+#include "VectorMath.h"
+
+/// <summary>
+/// Working set of each benchmark: small enough to stay in L2, so the kernels are measured, not memory
+/// </summary>
+static const size_t s_matrixCount = 1024;
+static const size_t s_pointCount = 4096;
+
+/// <summary>
+/// Same generator as the scene, every run sees the same data
+/// </summary>
+/// <param name="_state"></param>
+/// <returns>A value in [-1, 1)</returns>
+static float NextSigned(uint32_t& _state)
+{
+    _state = _state * 1664525u + 1013904223u;
+    return (float)(_state >> 8) / 8388608.0f - 1.0f;
+}
+
+static Quat RandomRotation(uint32_t& _state)
+{
+    Quat q = { NextSigned(_state), NextSigned(_state), NextSigned(_state), NextSigned(_state) + 2.0f };
+    return QuatNormalize(q);
+}
+
+/// <summary>
+/// Rotation, scale and translation: the kind of matrix we invert (well conditioned)
+/// </summary>
+static Mat4 RandomTransform(uint32_t& _state)
+{
+    Mat4 m = Mat4FromQuat(RandomRotation(_state));
+    float scale = 1.5f + NextSigned(_state);
+    for (int i = 0; i < 12; i++)
+        m.m[i] *= scale;
+    m.m[12] = NextSigned(_state) * 10.0f;
+    m.m[13] = NextSigned(_state) * 10.0f;
+    m.m[14] = NextSigned(_state) * 10.0f;
+    return m;
+}
+
+/// <summary>
+/// Time the scalar reference of a kernel, then the SIMD build of it (unless this is a scalar build, where they
+/// are the same code). The unit tests check that both give the same results
+/// </summary>
+static void RunVariants(MicroBenchmarkRunner& _runner, const std::string& _group, size_t _itemsPerCall,
+    const std::function<void()>& _scalar, const std::function<void()>& _simd)
+{
+    _runner.Run(_group + "/scalar", _itemsPerCall, _scalar);
+
+#if MYOPENGL_SIMD_SSE
+    _runner.Run(_group + "/" + GetSimdLevelName(), _itemsPerCall, _simd);
+#endif
+}
+
+void RunMathBenchmarks(MicroBenchmarkRunner& _runner)
+{
+    uint32_t seed = 12345u;
+
+    std::vector<Mat4> a(s_matrixCount), b(s_matrixCount), scalarOut(s_matrixCount), simdOut(s_matrixCount);
+    std::vector<Quat> qa(s_pointCount), qb(s_pointCount), qScalar(s_pointCount), qSimd(s_pointCount);
+    std::vector<Vec4> points(s_pointCount), pScalar(s_pointCount), pSimd(s_pointCount);
+
+    for (size_t i = 0; i < s_matrixCount; i++)
+    {
+        a[i] = RandomTransform(seed);
+        b[i] = RandomTransform(seed);
+    }
+    for (size_t i = 0; i < s_pointCount; i++)
+    {
+        qa[i] = RandomRotation(seed);
+        qb[i] = RandomRotation(seed);
+        points[i] = { NextSigned(seed) * 100.0f, NextSigned(seed) * 100.0f, NextSigned(seed) * 100.0f, 1.0f };
+    }
+
+    /* Matrix product */
+    RunVariants(_runner, "mat4 multiply", s_matrixCount,
+        [&]()
+        {
+            for (size_t i = 0; i < s_matrixCount; i++)
+                scalarOut[i] = Mat4MultiplyScalar(a[i], b[i]);
+            KeepResult(scalarOut[s_matrixCount - 1].m[0]);
+        },
+        [&]()
+        {
+            for (size_t i = 0; i < s_matrixCount; i++)
+                simdOut[i] = Mat4Multiply(a[i], b[i]);
+            KeepResult(simdOut[s_matrixCount - 1].m[0]);
+        });
+
+    /* General inverse */
+    RunVariants(_runner, "mat4 inverse", s_matrixCount,
+        [&]()
+        {
+            for (size_t i = 0; i < s_matrixCount; i++)
+                Mat4InverseScalar(a[i], scalarOut[i]);
+            KeepResult(scalarOut[s_matrixCount - 1].m[0]);
+        },
+        [&]()
+        {
+            for (size_t i = 0; i < s_matrixCount; i++)
+                Mat4Inverse(a[i], simdOut[i]);
+            KeepResult(simdOut[s_matrixCount - 1].m[0]);
+        });
+
+    /* Single quaternion products, then the batch kernels */
+    RunVariants(_runner, "quat multiply", s_pointCount,
+        [&]()
+        {
+            for (size_t i = 0; i < s_pointCount; i++)
+                qScalar[i] = QuatMultiplyScalar(qa[i], qb[i]);
+            KeepResult(qScalar[s_pointCount - 1].x);
+        },
+        [&]()
+        {
+            for (size_t i = 0; i < s_pointCount; i++)
+                qSimd[i] = QuatMultiply(qa[i], qb[i]);
+            KeepResult(qSimd[s_pointCount - 1].x);
+        });
+
+    RunVariants(_runner, "compose quats", s_pointCount,
+        [&]()
+        {
+            ComposeQuatsScalar(qa.data(), qb.data(), qScalar.data(), s_pointCount);
+            KeepResult(qScalar[s_pointCount - 1].x);
+        },
+        [&]()
+        {
+            ComposeQuats(qa.data(), qb.data(), qSimd.data(), s_pointCount);
+            KeepResult(qSimd[s_pointCount - 1].x);
+        });
+
+    RunVariants(_runner, "transform points", s_pointCount,
+        [&]()
+        {
+            TransformPointsScalar(a[0], points.data(), pScalar.data(), s_pointCount);
+            KeepResult(pScalar[s_pointCount - 1].x);
+        },
+        [&]()
+        {
+            TransformPoints(a[0], points.data(), pSimd.data(), s_pointCount);
+            KeepResult(pSimd[s_pointCount - 1].x);
+        });
+}
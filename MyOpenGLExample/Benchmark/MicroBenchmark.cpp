@@ -0,0 +1,78 @@
+#include "MicroBenchmark.h"
+
+#include <cstdio>
+
+#include "FrameStats.h"
+
+static volatile float s_sink = 0.0f;
+
+void KeepResult(float _value)
+{
+    s_sink = _value;
+}
+
+MicroBenchmarkRunner::MicroBenchmarkRunner(const std::string& _filter, double _minBatchMs)
+    : m_filter(_filter), m_minBatchMs(_minBatchMs)
+{
+}
+
+bool MicroBenchmarkRunner::IsSelected(const std::string& _name) const
+{
+    return m_filter.empty() || _name.find(m_filter) != std::string::npos;
+}
+
+double MicroBenchmarkRunner::Run(const std::string& _name, size_t _itemsPerCall, const std::function<void()>& _body)
+{
+    if (!IsSelected(_name))
+        return 0.0;
+
+    const int kBatchCount = 7;
+    const uint64_t minBatch = (uint64_t)(m_minBatchMs * 1000000.0);
+
+    /* Warm up (caches, page faults), then double the calls per batch until one is long enough */
+    _body();
+    uint64_t calls = 1;
+    for (;;)
+    {
+        StageClock clock;
+        for (uint64_t i = 0; i < calls; i++)
+            _body();
+        if (clock.Lap() >= minBatch || calls >= (1ull << 40))
+            break;
+        calls *= 2;
+    }
+
+    uint64_t best = ~0ull;
+    for (int batch = 0; batch < kBatchCount; batch++)
+    {
+        StageClock clock;
+        for (uint64_t i = 0; i < calls; i++)
+            _body();
+        uint64_t elapsed = clock.Lap();
+        best = (elapsed < best) ? elapsed : best;
+    }
+
+    double nanosecondsPerItem = (double)best / ((double)calls * (double)_itemsPerCall);
+    m_results.push_back({ _name, nanosecondsPerItem });
+    return nanosecondsPerItem;
+}
+
+void MicroBenchmarkRunner::PrintSummary() const
+{
+    std::printf("%-36s %12s %14s %9s\n", "Benchmark", "ns/item", "Mitems/s", "speedup");
+
+    std::string group;
+    double baseline = 0.0;
+    for (const Result& result : m_results)
+    {
+        std::string resultGroup = result.name.substr(0, result.name.find('/'));
+        if (resultGroup != group)
+        {
+            group = resultGroup;
+            baseline = result.nanosecondsPerItem;
+        }
+
+        std::printf("%-36s %12.3f %14.2f %8.2fx\n", result.name.c_str(), result.nanosecondsPerItem,
+            1000.0 / result.nanosecondsPerItem, baseline / result.nanosecondsPerItem);
+    }
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// Runs and reports CPU micro-benchmarks. A benchmark is a body processing a fixed number of items per
+/// call; it is repeated until a batch lasts long enough to time, and the best of several batches is kept
+/// (the least disturbed by the rest of the machine). Names are "group/variant": the first variant of a
+/// group is the baseline the others are compared to
+/// </summary>
+class MicroBenchmarkRunner
+{
+public:
+    /// <summary>
+    /// Only benchmarks whose name contains _filter run (all if empty). Each batch lasts at least _minBatchMs
+    /// </summary>
+    /// <param name="_filter"></param>
+    /// <param name="_minBatchMs"></param>
+    MicroBenchmarkRunner(const std::string& _filter, double _minBatchMs);
+
+    bool IsSelected(const std::string& _name) const;
+
+    /// <summary>
+    /// Time _body, which handles _itemsPerCall items per call. Returns nanoseconds per item, 0 if filtered out
+    /// </summary>
+    /// <param name="_name"></param>
+    /// <param name="_itemsPerCall"></param>
+    /// <param name="_body"></param>
+    /// <returns></returns>
+    double Run(const std::string& _name, size_t _itemsPerCall, const std::function<void()>& _body);
+
+    /// <summary>
+    /// Print the table: ns per item, items per second and the speedup over the group baseline
+    /// </summary>
+    void PrintSummary() const;
+
+private:
+    struct Result
+    {
+        std::string name;
+        double nanosecondsPerItem;
+    };
+
+    std::string m_filter;
+    double m_minBatchMs;
+    std::vector<Result> m_results;
+};
+
+/// <summary>
+/// Keep _value alive so the optimizer can't remove the work producing it
+/// </summary>
+/// <param name="_value"></param>
+void KeepResult(float _value);
+
+/// <summary>
+/// Benchmark suites, one per file
+/// </summary>
+/// <param name="_runner"></param>
+void RunBvhBenchmarks(MicroBenchmarkRunner& _runner);
+void RunCullingBenchmarks(MicroBenchmarkRunner& _runner);
+void RunMathBenchmarks(MicroBenchmarkRunner& _runner);
+void RunOcclusionBenchmarks(MicroBenchmarkRunner& _runner);
+void RunTransformBenchmarks(MicroBenchmarkRunner& _runner);
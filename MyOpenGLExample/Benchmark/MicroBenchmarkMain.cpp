@@ -0,0 +1,50 @@
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "MicroBenchmark.h"
+#include "VectorMath.h"
+
+/// <summary>
+/// Micro-benchmark entry point: CPU only, no window or GL context
+/// </summary>
+/// <param name="argc"></param>
+/// <param name="argv"></param>
+/// <returns></returns>
+int main(int argc, char** argv)
+{
+    std::string filter;
+    double minBatchMs = 20.0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+        {
+            filter = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--min-time") == 0 && i + 1 < argc && std::atof(argv[i + 1]) > 0.0)
+        {
+            minBatchMs = std::atof(argv[++i]);
+        }
+        else
+        {
+            std::cout << "Usage: " << argv[0] << " [options]" << std::endl
+                << "  --filter <text>     Run only the benchmarks whose name contains <text>" << std::endl
+                << "  --min-time <ms>     Minimum duration of a timed batch (default 20)" << std::endl;
+            return -1;
+        }
+    }
+
+    std::cout << "SIMD level: " << GetSimdLevelName() << std::endl;
+
+    MicroBenchmarkRunner runner(filter, minBatchMs);
+    RunMathBenchmarks(runner);
+    RunTransformBenchmarks(runner);
+    RunCullingBenchmarks(runner);
+    RunBvhBenchmarks(runner);
+    RunOcclusionBenchmarks(runner);
+    runner.PrintSummary();
+
+    return 0;
+}
@@ -0,0 +1,123 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "FrustumCulling.h"
+#include "MicroBenchmark.h"
+#include "OcclusionBuffer.h"
+#include "VectorMath.h"
+
+/// <summary>
+/// Cubes drawn as occluders, and spheres tested against them, per call
+/// </summary>
+static const size_t s_occluderCount = 256;
+static const size_t s_sphereCount = 16384;
+
+/// <summary>
+/// The buffer the application uses for a 640x480 window
+/// </summary>
+static const int s_bufferWidth = 320;
+static const int s_bufferHeight = 240;
+
+static float NextSigned(uint32_t& _state)
+{
+    _state = _state * 1664525u + 1013904223u;
+    return (float)(_state >> 8) / 8388608.0f - 1.0f;
+}
+
+/// <summary>
+/// Corners of randomly turned cubes of half-side 1 to 3, spread over the view between 10 and 40 units away
+/// (the camera looks down -z from the origin), 8 points each
+/// </summary>
+static void BuildOccluders(std::vector<Vec3>& _points)
+{
+    uint32_t seed = 31337u;
+    for (size_t i = 0; i < s_occluderCount; i++)
+    {
+        float depth = 25.0f + NextSigned(seed) * 15.0f;
+        Vec3 center = { NextSigned(seed) * depth * 0.5f, NextSigned(seed) * depth * 0.4f, -depth };
+        float halfSide = 2.0f + NextSigned(seed);
+        Quat rotation = QuatFromAxisAngle(Vec3Normalize({ NextSigned(seed), NextSigned(seed), NextSigned(seed) + 1.5f }), NextSigned(seed) * 3.0f);
+
+        for (int corner = 0; corner < 8; corner++)
+        {
+            Vec3 offset = { (corner & 1) ? halfSide : -halfSide, (corner & 2) ? halfSide : -halfSide, (corner & 4) ? halfSide : -halfSide };
+            _points.push_back(Vec3Add(center, QuatRotate(rotation, offset)));
+        }
+    }
+}
+
+/// <summary>
+/// Spheres behind and among the occluders, 20 to 80 units away, as columns (_columns[0..3]: x, y, z, radius)
+/// </summary>
+static void BuildSpheres(std::vector<float> (&_columns)[4])
+{
+    uint32_t seed = 4711u;
+    for (size_t i = 0; i < s_sphereCount; i++)
+    {
+        float depth = 50.0f + NextSigned(seed) * 30.0f;
+        _columns[0].push_back(NextSigned(seed) * depth * 0.5f);
+        _columns[1].push_back(NextSigned(seed) * depth * 0.4f);
+        _columns[2].push_back(-depth);
+        _columns[3].push_back(1.0f + 0.5f * NextSigned(seed));
+    }
+}
+
+void RunOcclusionBenchmarks(MicroBenchmarkRunner& _runner)
+{
+    std::vector<Vec3> points;
+    std::vector<float> sphereColumns[4];
+    BuildOccluders(points);
+    BuildSpheres(sphereColumns);
+    SphereColumns spheres = { sphereColumns[0].data(), sphereColumns[1].data(), sphereColumns[2].data(), sphereColumns[3].data() };
+    std::vector<uint32_t> rows(s_sphereCount), scalarVisible(s_sphereCount), simdVisible(s_sphereCount);
+    for (size_t i = 0; i < s_sphereCount; i++)
+        rows[i] = (uint32_t)i;
+
+    Mat4 projection = Mat4Perspective(45.0f * (3.141593f / 180.0f), 4.0f / 3.0f, 0.1f, 120.0f);
+    Mat4 view = Mat4Identity();
+
+    OcclusionBuffer scalar, simd;
+    scalar.Resize(s_bufferWidth, s_bufferHeight);
+    simd.Resize(s_bufferWidth, s_bufferHeight);
+    scalar.BeginFrame(view, projection);
+    simd.BeginFrame(view, projection);
+    for (size_t i = 0; i < s_occluderCount; i++)
+    {
+        scalar.AddOccluder(points.data() + i * 8, 8);
+        simd.AddOccluder(points.data() + i * 8, 8);
+    }
+
+    /* Clear and draw every tile, per occluder */
+    _runner.Run("occlusion raster/scalar", s_occluderCount,
+        [&]()
+        {
+            scalar.RasterizeTilesScalar(0, scalar.GetTileCount());
+            KeepResult(scalar.GetDepth()[0]);
+        });
+
+#if MYOPENGL_SIMD_SSE
+    _runner.Run(std::string("occlusion raster/") + GetSimdLevelName(), s_occluderCount,
+        [&]()
+        {
+            simd.RasterizeTiles(0, simd.GetTileCount());
+            KeepResult(simd.GetDepth()[0]);
+        });
+#endif
+
+    /* Per sphere tested */
+    scalar.RasterizeTilesScalar(0, scalar.GetTileCount());
+    _runner.Run("occlusion test/scalar", s_sphereCount,
+        [&]()
+        {
+            KeepResult((float)scalar.CullOccludedSpheresScalar(spheres, 1.0f, rows.data(), s_sphereCount, scalarVisible.data()));
+        });
+
+#if MYOPENGL_SIMD_SSE
+    _runner.Run(std::string("occlusion test/") + GetSimdLevelName(), s_sphereCount,
+        [&]()
+        {
+            KeepResult((float)scalar.CullOccludedSpheres(spheres, 1.0f, rows.data(), s_sphereCount, simdVisible.data()));
+        });
+#endif
+}
@@ -0,0 +1,152 @@
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "EntityWorld.h"
+#include "MicroBenchmark.h"
+#include "SceneSystems.h"
+#include "VectorMath.h"
+
+/// <summary>
+/// Animated objects per call: a large scene, the chunks (~1 MB) no longer fit in L2
+/// </summary>
+static const size_t s_objectCount = 16384;
+
+/// <summary>
+/// Entities created and destroyed per call of the structural benchmark
+/// </summary>
+static const size_t s_churnCount = 100000;
+
+static const ComponentMask s_objectMask = kRenderableMask | kAnimatedMask;
+static const float s_step = 1.0f / 60.0f;
+
+/// <summary>
+/// Per-object animation as the renderer used to evaluate it: resting orientation and a spin (world axis, rad/s)
+/// </summary>
+struct SpinningObject
+{
+    Quat orientation;
+    Vec3 axis;
+    float speed;
+};
+
+static float NextSigned(uint32_t& _state)
+{
+    _state = _state * 1664525u + 1013904223u;
+    return (float)(_state >> 8) / 8388608.0f - 1.0f;
+}
+
+/// <summary>
+/// The objects, and the same objects as entities of one archetype: with no entity destroyed, queries return
+/// them in creation order
+/// </summary>
+static void BuildObjects(std::vector<SpinningObject>& _objects, EntityWorld& _world)
+{
+    uint32_t seed = 4242u;
+    _objects.resize(s_objectCount);
+    _world.Clear();
+
+    for (size_t i = 0; i < s_objectCount; i++)
+    {
+        SpinningObject& object = _objects[i];
+        object.orientation = QuatNormalize({ NextSigned(seed), NextSigned(seed), NextSigned(seed), NextSigned(seed) + 2.0f });
+        object.axis = Vec3Normalize({ NextSigned(seed), NextSigned(seed), NextSigned(seed) + 0.1f });
+        object.speed = 0.72f * NextSigned(seed);
+
+        Vec4 position = { NextSigned(seed) * 100.0f, NextSigned(seed) * 100.0f, NextSigned(seed) * 100.0f, 1.0f };
+        Vec3 angularVelocity = Vec3Scale(object.axis, object.speed);
+
+        Entity entity = _world.Create(s_objectMask, 0);
+        _world.Set(entity, kComponentPosition, &position);
+        _world.Set(entity, kComponentRotation, &object.orientation);
+        _world.Set(entity, kComponentPreviousRotation, &object.orientation);
+        _world.Set(entity, kComponentAngularVelocity, &angularVelocity);
+    }
+}
+
+static void AnimateRotationsScalar(const std::vector<ChunkView>& _chunks, float _dt)
+{
+    for (const ChunkView& chunk : _chunks)
+    {
+        IntegrateRotationsScalar(GetQuatColumns(chunk, kComponentRotation), GetQuatColumns(chunk, kComponentPreviousRotation),
+            GetVec3Columns(chunk, kComponentAngularVelocity), _dt, chunk.count);
+    }
+}
+
+static void ExtractRotationsScalar(const std::vector<ChunkView>& _chunks, float _alpha, float* _rotations)
+{
+    for (const ChunkView& chunk : _chunks)
+    {
+        WriteInterpolatedRotationsScalar(GetQuatColumns(chunk, kComponentPreviousRotation), GetQuatColumns(chunk, kComponentRotation),
+            _alpha, chunk.count, _rotations + chunk.first * 4);
+    }
+}
+
+/// <summary>
+/// The per-object path: trig and a quaternion product for every object, from the elapsed time
+/// </summary>
+static void WriteAnalyticRotations(const std::vector<SpinningObject>& _objects, float _time, float* _rotations)
+{
+    for (size_t i = 0; i < _objects.size(); i++)
+    {
+        const SpinningObject& object = _objects[i];
+        Quat spin = QuatFromAxisAngle(object.axis, std::fmod(object.speed * _time, 6.283185f));
+        Quat rotation = QuatMultiply(spin, object.orientation);
+        _rotations[i * 4 + 0] = rotation.x;
+        _rotations[i * 4 + 1] = rotation.y;
+        _rotations[i * 4 + 2] = rotation.z;
+        _rotations[i * 4 + 3] = rotation.w;
+    }
+}
+
+void RunTransformBenchmarks(MicroBenchmarkRunner& _runner)
+{
+    std::vector<SpinningObject> objects;
+    EntityWorld world;
+    BuildObjects(objects, world);
+    std::vector<ChunkView> chunks;
+    world.Query(s_objectMask, chunks);
+    std::vector<float> rotations(s_objectCount * 4);
+    float time = 0.0f;
+
+    /* One simulation step and one frame's rotations written out, per object */
+    _runner.Run("instance rotations/aos analytic", s_objectCount,
+        [&]()
+        {
+            time += s_step;
+            WriteAnalyticRotations(objects, time, rotations.data());
+            KeepResult(rotations[0]);
+        });
+
+    _runner.Run("instance rotations/chunks scalar", s_objectCount,
+        [&]()
+        {
+            AnimateRotationsScalar(chunks, s_step);
+            ExtractRotationsScalar(chunks, 0.5f, rotations.data());
+            KeepResult(rotations[0]);
+        });
+
+#if MYOPENGL_SIMD_SSE
+    _runner.Run(std::string("instance rotations/chunks ") + GetSimdLevelName(), s_objectCount,
+        [&]()
+        {
+            AnimateRotations(chunks, 0, chunks.size(), s_step);
+            ExtractRotations(chunks, 0, chunks.size(), 0.5f, rotations.data());
+            KeepResult(rotations[0]);
+        });
+#endif
+
+    /* Structural changes: a scene's worth of entities created, then destroyed in an order unrelated to their rows */
+    EntityWorld churnWorld;
+    std::vector<Entity> entities(s_churnCount);
+    _runner.Run("entities/create destroy", s_churnCount,
+        [&]()
+        {
+            for (size_t i = 0; i < s_churnCount; i++)
+                entities[i] = churnWorld.Create(s_objectMask, (uint32_t)(i & 3));
+            for (size_t i = 0; i < s_churnCount; i++)
+                churnWorld.Destroy(entities[(i * 7919) % s_churnCount]);
+            KeepResult((float)churnWorld.GetEntityCount());
+        });
+}
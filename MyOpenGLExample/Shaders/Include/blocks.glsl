@@ -0,0 +1,25 @@
+// Uniform blocks shared by every program, see UniformBlocks.h
+#pragma once
+
+// Must match kMaxBatchMeshes in MeshBatch.h
+#define MAX_MESHES 8
+
+layout(std140) uniform Camera
+{
+    mat4 proy;
+    mat4 view;
+};
+
+layout(std140) uniform Frame
+{
+    vec4 rot;
+    float transparency;
+    // Same rotation as rot, as a matrix (columns in xyz)
+    mat4 model;
+};
+
+layout(std140) uniform Scene
+{
+    // Per mesh: scale then bias of its 16-bit positions
+    vec4 meshQuantization[2 * MAX_MESHES];
+};
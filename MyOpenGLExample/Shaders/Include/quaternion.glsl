@@ -0,0 +1,7 @@
+// Quaternion helpers
+#pragma once
+
+vec3 qtransform( in vec4 q, in vec3 v )
+{
+    return v + 2.0*cross(cross(v, q.xyz) + q.w*v, q.xyz);
+}
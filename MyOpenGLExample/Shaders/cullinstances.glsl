@@ -0,0 +1,112 @@
+#version 430 core
+
+// GPU culling (see GpuCulling.h), one invocation per instance: an instance whose bounding sphere touches the
+// frustum and isn't behind the depth pyramid of the previous frame is appended to its mesh's draw command, its
+// attributes and rotation copied to the visible instances the draw reads
+layout(local_size_x = 64) in;
+
+#include "Include/blocks.glsl"
+
+// InstanceData (SceneInstances.h), 6 words each: position and scale, RGBA8 color, mesh
+layout(std430, binding = 0) readonly buffer Instances
+{
+    uint instanceWords[];
+};
+
+layout(std430, binding = 1) readonly buffer Rotations
+{
+    vec4 rotations[];
+};
+
+layout(std430, binding = 2) writeonly buffer VisibleInstances
+{
+    uint visibleWords[];
+};
+
+layout(std430, binding = 3) writeonly buffer VisibleRotations
+{
+    vec4 visibleRotations[];
+};
+
+// DrawElementsIndirectCommand (MeshBatch.h), 5 words per mesh: count, instanceCount, firstIndex, baseVertex,
+// baseInstance. They come with no instance, baseInstance where the mesh's visible instances start
+layout(std430, binding = 4) buffer DrawCommands
+{
+    uint commandWords[];
+};
+
+layout(binding = 0) uniform sampler2D depthPyramid;
+
+uniform uint instanceCount;
+uniform vec4 frustumPlanes[6];
+uniform float meshRadii[MAX_MESHES];
+
+// Pixels of the depth buffer the pyramid was built from, 0 when it can't be used (no previous frame, the camera moved)
+uniform ivec2 depthSize;
+
+// Whether the sphere is entirely behind what the previous frame drew: the depth of its nearest point against the
+// farthest depth of the pyramid texels covering its screen rectangle, at the level where that is 2x2 texels at most
+bool IsOccluded(vec3 _center, float _radius)
+{
+     vec3 center = (view * vec4(_center, 1.0)).xyz;
+     float nearDistance = -center.z - _radius;
+     float farDistance = -center.z + _radius;
+     if (nearDistance <= proy[3][2] / (proy[2][2] - 1.0))
+          return false;
+
+     // The box around the sphere projects inside the extremes of its corners: x / d at the nearest and farthest d
+     vec2 scale = vec2(proy[0][0], proy[1][1]);
+     vec2 minBound = min((center.xy - _radius) / nearDistance, (center.xy - _radius) / farDistance) * scale;
+     vec2 maxBound = max((center.xy + _radius) / nearDistance, (center.xy + _radius) / farDistance) * scale;
+     ivec2 minPixel = ivec2(floor(clamp(minBound * 0.5 + 0.5, 0.0, 1.0) * vec2(depthSize)));
+     ivec2 maxPixel = ivec2(ceil(clamp(maxBound * 0.5 + 0.5, 0.0, 1.0) * vec2(depthSize)));
+     if (minPixel.x >= maxPixel.x || minPixel.y >= maxPixel.y)
+          return false;
+
+     // A texel of level l covers 2^(l + 1) pixels: the rectangle spans 2 of them at most once it is that wide
+     int extent = max(maxPixel.x - minPixel.x, maxPixel.y - minPixel.y);
+     int level = min(max(findMSB(extent - 1), 0), textureQueryLevels(depthPyramid) - 1);
+
+     // Each level is half the previous one rounded down, from the size of the first: the level differs between
+     // invocations, which some implementations don't handle in textureSize
+     ivec2 last = max(textureSize(depthPyramid, 0) >> level, 1) - 1;
+     ivec2 first = min(minPixel >> (level + 1), last);
+     ivec2 end = min((maxPixel - 1) >> (level + 1), last);
+
+     float depth = 0.0;
+     for (int y = first.y; y <= end.y; y++)
+     {
+          for (int x = first.x; x <= end.x; x++)
+               depth = max(depth, texelFetch(depthPyramid, ivec2(x, y), level).r);
+     }
+
+     // NDC z of the nearest point, to window depth as the depth buffer holds it
+     float nearestDepth = (-proy[2][2] + proy[3][2] / nearDistance) * 0.5 + 0.5;
+     return nearestDepth > depth;
+}
+
+void main()
+{
+     uint index = gl_GlobalInvocationID.x;
+     if (index >= instanceCount)
+          return;
+
+     uint word = index * 6u;
+     vec4 position = uintBitsToFloat(uvec4(instanceWords[word], instanceWords[word + 1u], instanceWords[word + 2u], instanceWords[word + 3u]));
+     uint mesh = instanceWords[word + 5u];
+     float radius = meshRadii[mesh] * position.w;
+
+     for (int plane = 0; plane < 6; plane++)
+     {
+          if (dot(frustumPlanes[plane].xyz, position.xyz) + frustumPlanes[plane].w < -radius)
+               return;
+     }
+
+     if (depthSize.x > 0 && IsOccluded(position.xyz, radius))
+          return;
+
+     uint slot = commandWords[mesh * 5u + 4u] + atomicAdd(commandWords[mesh * 5u + 1u], 1u);
+     for (uint i = 0u; i < 6u; i++)
+          visibleWords[slot * 6u + i] = instanceWords[word + i];
+     visibleRotations[slot] = rotations[index];
+}
@@ -0,0 +1,33 @@
+#version 430 core
+
+// One level of the depth pyramid (see GpuCulling.h): each texel is the farthest of the source texels under it.
+// A level is half the size of its source, rounded down: the last texel of a row or column of odd size also takes
+// the one left over, so no source texel is missed and no texel is nearer than any pixel it covers
+layout(local_size_x = 8, local_size_y = 8) in;
+
+// The depth texture for the first level, the pyramid itself (at sourceLevel) for the others
+layout(binding = 0) uniform sampler2D source;
+layout(binding = 0, r32f) writeonly uniform image2D destination;
+
+uniform int sourceLevel;
+
+void main()
+{
+     ivec2 size = imageSize(destination);
+     ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+     if (texel.x >= size.x || texel.y >= size.y)
+          return;
+
+     ivec2 last = textureSize(source, sourceLevel) - 1;
+     ivec2 first = min(texel * 2, last);
+     ivec2 end = min(ivec2((texel.x == size.x - 1) ? last.x : first.x + 1, (texel.y == size.y - 1) ? last.y : first.y + 1), last);
+
+     float depth = 0.0;
+     for (int y = first.y; y <= end.y; y++)
+     {
+          for (int x = first.x; x <= end.x; x++)
+               depth = max(depth, texelFetch(source, ivec2(x, y), sourceLevel).r);
+     }
+
+     imageStore(destination, texel, vec4(depth));
+}
@@ -1,7 +1,9 @@
 #version 330 core
 
+#include "Include/blocks.glsl"
+
 in vec3 vcolor;
-uniform float transparency;
+
 out vec4 outColor;
 
 void main()
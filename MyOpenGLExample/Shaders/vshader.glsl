@@ -1,19 +1,52 @@
 #version 330 core
 
-in vec3 inColor;
+// Permutations, injected by ShaderPreprocessor (defaults for a plain compile)
+#ifndef INSTANCED
+#define INSTANCED 1
+#endif
+#ifndef TRANSFORM_MATRIX
+#define TRANSFORM_MATRIX 0
+#endif
+
+#include "Include/blocks.glsl"
+#include "Include/quaternion.glsl"
+
+in vec4 inColor;
 in vec3 inVertex;
+#if INSTANCED
+in vec4 inInstanceRotation;
+in vec4 inInstancePosition;
+in vec4 inInstanceColor;
+in uint inInstanceMesh;
+#endif
 out vec3 vcolor;
-uniform mat4 proy;
-uniform vec4 rot;
-uniform mat4 view;
-
-vec3 qtransform( in vec4 q, in vec3 v )
-{
-    return v + 2.0*cross(cross(v, q.xyz) + q.w*v, q.xyz);
-}
 
 void main()
 {
-     vcolor = inColor;
-     gl_Position= proy * view * vec4(qtransform(rot,inVertex).xyz,1);
+#if INSTANCED
+     int mesh = 2 * int(inInstanceMesh);
+     vec3 vertex = inVertex * meshQuantization[mesh].xyz + meshQuantization[mesh + 1].xyz;
+
+     // Every instance spins around its own center: global rotation on top of the instance orientation
+     vec3 local = qtransform(inInstanceRotation, vertex);
+#else
+     // A single object at the origin, drawing the first mesh
+     vec3 local = inVertex * meshQuantization[0].xyz + meshQuantization[1].xyz;
+#endif
+
+#if TRANSFORM_MATRIX
+     local = mat3(model) * local;
+#else
+     local = qtransform(rot, local);
+#endif
+
+#if INSTANCED
+     vec3 world = local * inInstancePosition.w + inInstancePosition.xyz;
+     vcolor = inColor.rgb * inInstanceColor.rgb;
+#else
+     vec3 world = local;
+     vcolor = inColor.rgb;
+#endif
+
+     gl_Position= proy * view * vec4(world,1);
 }
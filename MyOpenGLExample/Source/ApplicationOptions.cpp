@@ -0,0 +1,177 @@
+#include "ApplicationOptions.h"
+
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+
+/// <summary>
+/// Print the accepted arguments
+/// </summary>
+/// <param name="_program"></param>
+static void PrintUsage(const char* _program)
+{
+    std::cout << "Usage: " << _program << " [options]" << std::endl
+        << "  --headless          Render offscreen (no window) and exit after --frames frames" << std::endl
+        << "  --frames <n>        Frames rendered in headless mode (default 1000)" << std::endl
+        << "  --width <px>        Window / framebuffer width (default 640)" << std::endl
+        << "  --height <px>       Window / framebuffer height (default 480)" << std::endl
+        << "  --instances <n>     Objects in the scene, drawn instanced (default 1)" << std::endl
+        << "  --meshes <n>        Different meshes among the objects, up to 4 (default 1, cubes only)" << std::endl
+        << "  --stats-out <file>  Write the frame-time report (p50/p90/p99/max per stage) as JSON" << std::endl
+        << "  --trace-out <file>  Record the CPU profiling zones and write them as a Chrome trace (Perfetto)" << std::endl
+        << "  --shader-cache <dir>" << std::endl
+        << "                      Directory of the linked program cache (default ShaderCache)" << std::endl
+        << "  --no-shader-cache   Always compile the shaders from source" << std::endl
+        << "  --matrix-transform  Rotate with a matrix instead of a quaternion (shader variant)" << std::endl
+        << "  --shader-dir <dir>  Read the shaders from <dir> instead of the embedded copies" << std::endl
+        << "  --sim-rate <hz>     Simulation steps per second, whatever the frame rate (default 60)" << std::endl
+        << "  --render-rate <hz>  Each frame advances the simulation by 1/hz s instead of the real time" << std::endl
+        << "                      (deterministic; headless default: one simulation step per frame)" << std::endl
+        << "  --culling <mode>    Instances submitted: none (all of them), frustum (default), bvh," << std::endl
+        << "                      occlusion (frustum, then a CPU depth buffer of the nearest instances)" << std::endl
+        << "                      or gpu (frustum and previous frame's depth pyramid, by compute shaders)" << std::endl
+        << "  --threads <n>       Threads of the frame systems, the main one included (default: one per core)" << std::endl;
+}
+
+/// <summary>
+/// Read a culling mode name
+/// </summary>
+/// <param name="_value"></param>
+/// <param name="_result"></param>
+/// <returns></returns>
+static bool ParseCullingMode(const char* _value, CullingMode& _result)
+{
+    if (std::strcmp(_value, "none") == 0)
+        _result = kCullingNone;
+    else if (std::strcmp(_value, "frustum") == 0)
+        _result = kCullingFrustum;
+    else if (std::strcmp(_value, "bvh") == 0)
+        _result = kCullingBvh;
+    else if (std::strcmp(_value, "occlusion") == 0)
+        _result = kCullingOcclusion;
+    else if (std::strcmp(_value, "gpu") == 0)
+        _result = kCullingGpu;
+    else
+        return false;
+
+    return true;
+}
+
+/// <summary>
+/// Read a strictly positive integer argument
+/// </summary>
+/// <param name="_value"></param>
+/// <param name="_result"></param>
+/// <returns></returns>
+static bool ParsePositiveInt(const char* _value, int& _result)
+{
+    char* end = NULL;
+    long value = std::strtol(_value, &end, 10);
+
+    if (end == _value || *end != '\0' || value <= 0)
+        return false;
+
+    _result = (int)value;
+    return true;
+}
+
+bool ParseCommandLine(int _argc, char** _argv, ApplicationOptions& _options)
+{
+    for (int i = 1; i < _argc; i++)
+    {
+        const char* arg = _argv[i];
+        const char* value = (i + 1 < _argc) ? _argv[i + 1] : NULL;
+        bool valid = true;
+
+        if (std::strcmp(arg, "--headless") == 0)
+        {
+            _options.headless = true;
+        }
+        else if (std::strcmp(arg, "--frames") == 0 && value != NULL)
+        {
+            valid = ParsePositiveInt(value, _options.frameCount);
+            i++;
+        }
+        else if (std::strcmp(arg, "--width") == 0 && value != NULL)
+        {
+            valid = ParsePositiveInt(value, _options.width);
+            i++;
+        }
+        else if (std::strcmp(arg, "--height") == 0 && value != NULL)
+        {
+            valid = ParsePositiveInt(value, _options.height);
+            i++;
+        }
+        else if (std::strcmp(arg, "--instances") == 0 && value != NULL)
+        {
+            valid = ParsePositiveInt(value, _options.instanceCount);
+            i++;
+        }
+        else if (std::strcmp(arg, "--meshes") == 0 && value != NULL)
+        {
+            valid = ParsePositiveInt(value, _options.meshCount);
+            i++;
+        }
+        else if (std::strcmp(arg, "--stats-out") == 0 && value != NULL)
+        {
+            _options.statsOutPath = value;
+            i++;
+        }
+        else if (std::strcmp(arg, "--trace-out") == 0 && value != NULL)
+        {
+            _options.traceOutPath = value;
+            i++;
+        }
+        else if (std::strcmp(arg, "--shader-cache") == 0 && value != NULL)
+        {
+            _options.shaderCachePath = value;
+            i++;
+        }
+        else if (std::strcmp(arg, "--no-shader-cache") == 0)
+        {
+            _options.shaderCachePath.clear();
+        }
+        else if (std::strcmp(arg, "--matrix-transform") == 0)
+        {
+            _options.matrixTransform = true;
+        }
+        else if (std::strcmp(arg, "--shader-dir") == 0 && value != NULL)
+        {
+            _options.shaderDirectory = value;
+            i++;
+        }
+        else if (std::strcmp(arg, "--sim-rate") == 0 && value != NULL)
+        {
+            valid = ParsePositiveInt(value, _options.simulationRate);
+            i++;
+        }
+        else if (std::strcmp(arg, "--render-rate") == 0 && value != NULL)
+        {
+            valid = ParsePositiveInt(value, _options.renderRate);
+            i++;
+        }
+        else if (std::strcmp(arg, "--culling") == 0 && value != NULL)
+        {
+            valid = ParseCullingMode(value, _options.culling);
+            i++;
+        }
+        else if (std::strcmp(arg, "--threads") == 0 && value != NULL)
+        {
+            valid = ParsePositiveInt(value, _options.threadCount);
+            i++;
+        }
+        else
+        {
+            valid = false;
+        }
+
+        if (!valid)
+        {
+            std::cout << "Invalid argument: " << arg << std::endl;
+            PrintUsage(_argv[0]);
+            return false;
+        }
+    }
+
+    return true;
+}
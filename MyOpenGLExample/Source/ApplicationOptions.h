@@ -0,0 +1,103 @@
+#pragma once
+
+#include <string>
+
+/// <summary>
+/// How the renderer decides which instances to submit
+/// </summary>
+enum CullingMode
+{
+    kCullingNone,       // every instance, every frame
+    kCullingFrustum,    // the instances whose bounding sphere touches the view frustum (SIMD, on the worker threads)
+    kCullingBvh,        // the instances whose bounding box touches the view frustum, found walking a BVH of the scene
+    kCullingOcclusion,  // frustum culling, then the instances a coarse CPU depth buffer of the largest ones doesn't hide
+    kCullingGpu,        // every instance sent once, culled on the GPU against the frustum and the previous frame's depth
+};
+
+/// <summary>
+/// Runtime configuration of the application, filled from the command line
+/// </summary>
+struct ApplicationOptions
+{
+    /// <summary>
+    /// Render offscreen without a window, a fixed number of frames, and print the frame-time stats at exit
+    /// </summary>
+    bool headless = false;
+
+    /// <summary>
+    /// Number of frames rendered in headless mode
+    /// </summary>
+    int frameCount = 1000;
+
+    /// <summary>
+    /// Size of the window or of the offscreen framebuffer
+    /// </summary>
+    int width = 640;
+    int height = 480;
+
+    /// <summary>
+    /// Cubes in the scene, all drawn by the same instanced draw calls. 1 is the classic single cube
+    /// </summary>
+    int instanceCount = 1;
+
+    /// <summary>
+    /// Different meshes used by the instances (cube, pyramid, octahedron, tetrahedron), all submitted together
+    /// </summary>
+    int meshCount = 1;
+
+    /// <summary>
+    /// If set, the frame-time report (per-stage percentiles) is written there as JSON at exit
+    /// </summary>
+    std::string statsOutPath;
+
+    /// <summary>
+    /// If set, the CPU profiling zones are recorded and written there as Chrome trace_event JSON at exit
+    /// </summary>
+    std::string traceOutPath;
+
+    /// <summary>
+    /// Directory of the program binary cache. Empty disables it (shaders always compiled from source)
+    /// </summary>
+    std::string shaderCachePath = "ShaderCache";
+
+    /// <summary>
+    /// Use the shader variant rotating with a 3x3 matrix instead of the quaternion
+    /// </summary>
+    bool matrixTransform = false;
+
+    /// <summary>
+    /// If set, the shaders are read from this directory instead of the copies embedded in the executable,
+    /// to edit them without rebuilding
+    /// </summary>
+    std::string shaderDirectory;
+
+    /// <summary>
+    /// Simulation steps per second, independent of how fast frames are rendered
+    /// </summary>
+    int simulationRate = 60;
+
+    /// <summary>
+    /// If set, every rendered frame advances the simulation by 1/renderRate seconds instead of the real time
+    /// it took, so runs are deterministic. Headless runs default to one simulation step per frame
+    /// </summary>
+    int renderRate = 0;
+
+    /// <summary>
+    /// Visibility test run before the instances are extracted for drawing
+    /// </summary>
+    CullingMode culling = kCullingFrustum;
+
+    /// <summary>
+    /// Threads running the frame systems (culling, extraction, animation), the main one included. 0 is one per core
+    /// </summary>
+    int threadCount = 0;
+};
+
+/// <summary>
+/// Parse the command line arguments into _options. Returns false (after printing the usage) on a bad argument
+/// </summary>
+/// <param name="_argc"></param>
+/// <param name="_argv"></param>
+/// <param name="_options"></param>
+/// <returns></returns>
+bool ParseCommandLine(int _argc, char** _argv, ApplicationOptions& _options);
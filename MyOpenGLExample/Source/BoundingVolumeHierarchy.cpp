@@ -0,0 +1,446 @@
+#include "BoundingVolumeHierarchy.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <utility>
+
+static inline float GetAxis(const Vec3& _v, int _axis)
+{
+    return (_axis == 0) ? _v.x : ((_axis == 1) ? _v.y : _v.z);
+}
+
+/* Written as selects rather than std::min/max, which the compiler turns into branches in the binning loop:
+   mispredicted on every other object */
+static inline Vec3 Minimum(const Vec3& _a, const Vec3& _b)
+{
+    return { (_a.x < _b.x) ? _a.x : _b.x, (_a.y < _b.y) ? _a.y : _b.y, (_a.z < _b.z) ? _a.z : _b.z };
+}
+
+static inline Vec3 Maximum(const Vec3& _a, const Vec3& _b)
+{
+    return { (_a.x > _b.x) ? _a.x : _b.x, (_a.y > _b.y) ? _a.y : _b.y, (_a.z > _b.z) ? _a.z : _b.z };
+}
+
+/// <summary>
+/// Half the surface area of a box: the SAH only compares areas
+/// </summary>
+static inline float HalfArea(const Vec3& _min, const Vec3& _max)
+{
+    Vec3 extent = Vec3Sub(_max, _min);
+    if (extent.x < 0.0f || extent.y < 0.0f || extent.z < 0.0f)
+        return 0.0f;
+    return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+}
+
+static const Vec3 s_emptyMin = { FLT_MAX, FLT_MAX, FLT_MAX };
+static const Vec3 s_emptyMax = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+void BoundingVolumeHierarchy::Clear()
+{
+    m_nodes.clear();
+    m_objects.clear();
+    m_bounds.clear();
+    m_cost = 0.0f;
+    m_builtCost = 0.0f;
+}
+
+void BoundingVolumeHierarchy::UpdateLeafBounds(Node& _node) const
+{
+    _node.min = s_emptyMin;
+    _node.max = s_emptyMax;
+    for (uint32_t i = 0; i < _node.count; i++)
+    {
+        const Aabb& bounds = m_bounds[_node.first + i];
+        _node.min = Minimum(_node.min, bounds.min);
+        _node.max = Maximum(_node.max, bounds.max);
+    }
+}
+
+void BoundingVolumeHierarchy::Build(const Aabb* _bounds, size_t _count)
+{
+    Clear();
+    if (_count == 0)
+        return;
+
+    std::vector<BuildItem> items(_count);
+    for (size_t i = 0; i < _count; i++)
+    {
+        items[i].bounds = _bounds[i];
+        items[i].centroid = Vec3Scale(Vec3Add(_bounds[i].min, _bounds[i].max), 0.5f);
+        items[i].object = (uint32_t)i;
+    }
+
+    /* At most 2n - 1 nodes: reserving keeps the node references valid while splitting */
+    m_nodes.reserve(_count * 2);
+    Node root;
+    root.min = s_emptyMin;
+    root.max = s_emptyMax;
+    root.first = 0;
+    root.count = (uint32_t)_count;
+    for (const BuildItem& item : items)
+    {
+        root.min = Minimum(root.min, item.bounds.min);
+        root.max = Maximum(root.max, item.bounds.max);
+    }
+    m_nodes.push_back(root);
+
+    /* Node and depth */
+    std::vector<std::pair<uint32_t, int>> stack(1, std::make_pair(0u, 0));
+    while (!stack.empty())
+    {
+        std::pair<uint32_t, int> entry = stack.back();
+        stack.pop_back();
+
+        if (entry.second < kMaxDepth && Split(entry.first, items))
+        {
+            stack.push_back(std::make_pair(m_nodes[entry.first].first, entry.second + 1));
+            stack.push_back(std::make_pair(m_nodes[entry.first].first + 1, entry.second + 1));
+        }
+    }
+
+    m_objects.resize(_count);
+    m_bounds.resize(_count);
+    for (size_t i = 0; i < _count; i++)
+    {
+        m_objects[i] = items[i].object;
+        m_bounds[i] = items[i].bounds;
+    }
+
+    m_cost = ComputeCost();
+    m_builtCost = m_cost;
+}
+
+bool BoundingVolumeHierarchy::Split(uint32_t _node, std::vector<BuildItem>& _items)
+{
+    Node& node = m_nodes[_node];
+    if (node.count <= 1)
+        return false;
+    BuildItem* items = _items.data() + node.first;
+
+    /* Bins over the extent of the centroids, on the three axes in one pass over the objects. Small nodes, most
+       of them, need no more bins than objects */
+    int binCount = std::min(kBinCount, (int)node.count);
+    Vec3 centroidMin = s_emptyMin;
+    Vec3 centroidMax = s_emptyMax;
+    for (uint32_t i = 0; i < node.count; i++)
+    {
+        const Vec3& centroid = items[i].centroid;
+        centroidMin = Minimum(centroidMin, centroid);
+        centroidMax = Maximum(centroidMax, centroid);
+    }
+
+    struct Bin
+    {
+        Vec3 min;
+        Vec3 max;
+        uint32_t count;
+    };
+
+    Bin bins[3][kBinCount];
+    float low[3] = { centroidMin.x, centroidMin.y, centroidMin.z };
+    float scale[3];
+    for (int axis = 0; axis < 3; axis++)
+    {
+        float extent = GetAxis(centroidMax, axis) - low[axis];
+        scale[axis] = (extent > 0.0f) ? binCount / extent : 0.0f;
+        for (int bin = 0; bin < binCount; bin++)
+            bins[axis][bin] = { s_emptyMin, s_emptyMax, 0 };
+    }
+
+    for (uint32_t i = 0; i < node.count; i++)
+    {
+        const Vec3& centroid = items[i].centroid;
+        const Aabb& bounds = items[i].bounds;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            Bin& bin = bins[axis][std::min(binCount - 1, (int)((GetAxis(centroid, axis) - low[axis]) * scale[axis]))];
+            bin.min = Minimum(bin.min, bounds.min);
+            bin.max = Maximum(bin.max, bounds.max);
+            bin.count++;
+        }
+    }
+
+    /* Sweep from the right, then from the left: the cost of splitting after each bin. The boxes of the best
+       split are the children's */
+    int bestAxis = -1;
+    int bestSplit = 0;
+    float bestCost = FLT_MAX;
+    Aabb bestLeft = {};
+    Aabb bestRight = {};
+
+    for (int axis = 0; axis < 3; axis++)
+    {
+        if (scale[axis] == 0.0f)
+            continue;
+
+        Aabb right[kBinCount];
+        float rightCost[kBinCount];
+        Vec3 sweepMin = s_emptyMin;
+        Vec3 sweepMax = s_emptyMax;
+        uint32_t sweepCount = 0;
+        for (int bin = binCount - 1; bin > 0; bin--)
+        {
+            sweepMin = Minimum(sweepMin, bins[axis][bin].min);
+            sweepMax = Maximum(sweepMax, bins[axis][bin].max);
+            sweepCount += bins[axis][bin].count;
+            right[bin] = { sweepMin, sweepMax };
+            rightCost[bin] = sweepCount * HalfArea(sweepMin, sweepMax);
+        }
+
+        sweepMin = s_emptyMin;
+        sweepMax = s_emptyMax;
+        sweepCount = 0;
+        for (int bin = 0; bin < binCount - 1; bin++)
+        {
+            sweepMin = Minimum(sweepMin, bins[axis][bin].min);
+            sweepMax = Maximum(sweepMax, bins[axis][bin].max);
+            sweepCount += bins[axis][bin].count;
+            float cost = sweepCount * HalfArea(sweepMin, sweepMax) + rightCost[bin + 1];
+            if (sweepCount > 0 && sweepCount < node.count && cost < bestCost)
+            {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = bin + 1;
+                bestLeft = { sweepMin, sweepMax };
+                bestRight = right[bin + 1];
+            }
+        }
+    }
+
+    /* Costs in box tests: traversing the node, then testing the objects of each side as often as it is hit */
+    if (bestAxis < 0)
+        return false;
+    float splitCost = 1.0f + bestCost / std::max(HalfArea(node.min, node.max), FLT_MIN);
+    if (node.count <= kMaxLeafSize && splitCost >= (float)node.count)
+        return false;
+
+    BuildItem* middle = std::partition(items, items + node.count,
+        [&](const BuildItem& _item)
+        {
+            return std::min(binCount - 1, (int)((GetAxis(_item.centroid, bestAxis) - low[bestAxis]) * scale[bestAxis])) < bestSplit;
+        });
+    uint32_t leftCount = (uint32_t)(middle - items);
+
+    Node left;
+    left.min = bestLeft.min;
+    left.max = bestLeft.max;
+    left.first = node.first;
+    left.count = leftCount;
+
+    Node right;
+    right.min = bestRight.min;
+    right.max = bestRight.max;
+    right.first = node.first + leftCount;
+    right.count = node.count - leftCount;
+
+    node.first = (uint32_t)m_nodes.size();
+    node.count = 0;
+    m_nodes.push_back(left);
+    m_nodes.push_back(right);
+    return true;
+}
+
+void BoundingVolumeHierarchy::Refit(const Aabb* _bounds)
+{
+    if (m_nodes.empty())
+        return;
+
+    for (size_t i = 0; i < m_objects.size(); i++)
+        m_bounds[i] = _bounds[m_objects[i]];
+
+    /* Children always come after their parent */
+    for (size_t i = m_nodes.size(); i-- > 0;)
+    {
+        Node& node = m_nodes[i];
+        if (node.count > 0)
+        {
+            UpdateLeafBounds(node);
+        }
+        else
+        {
+            const Node& left = m_nodes[node.first];
+            const Node& right = m_nodes[node.first + 1];
+            node.min = Minimum(left.min, right.min);
+            node.max = Maximum(left.max, right.max);
+        }
+    }
+
+    m_cost = ComputeCost();
+}
+
+float BoundingVolumeHierarchy::ComputeCost() const
+{
+    if (m_nodes.empty())
+        return 0.0f;
+
+    float cost = 0.0f;
+    for (const Node& node : m_nodes)
+        cost += HalfArea(node.min, node.max) * ((node.count > 0) ? (float)node.count : 1.0f);
+
+    return cost / std::max(HalfArea(m_nodes[0].min, m_nodes[0].max), FLT_MIN);
+}
+
+/// <summary>
+/// Frustum test of a box against the planes of _mask: -1 outside one of them, otherwise the planes it
+/// still crosses (the others it is entirely inside of)
+/// </summary>
+static inline int ClassifyBox(const Frustum& _frustum, const Vec3& _min, const Vec3& _max, int _mask)
+{
+    int crossing = 0;
+    for (int p = 0; p < 6; p++)
+    {
+        if ((_mask & (1 << p)) == 0)
+            continue;
+
+        const Vec4& plane = _frustum.planes[p];
+        /* The corner furthest along the normal, and the one furthest against it */
+        float outer = plane.x * ((plane.x >= 0.0f) ? _max.x : _min.x) + plane.y * ((plane.y >= 0.0f) ? _max.y : _min.y)
+            + plane.z * ((plane.z >= 0.0f) ? _max.z : _min.z) + plane.w;
+        if (outer < 0.0f)
+            return -1;
+
+        float inner = plane.x * ((plane.x >= 0.0f) ? _min.x : _max.x) + plane.y * ((plane.y >= 0.0f) ? _min.y : _max.y)
+            + plane.z * ((plane.z >= 0.0f) ? _min.z : _max.z) + plane.w;
+        if (inner < 0.0f)
+            crossing |= 1 << p;
+    }
+    return crossing;
+}
+
+void BoundingVolumeHierarchy::QueryFrustum(const Frustum& _frustum, std::vector<uint32_t>& _objects) const
+{
+    if (m_nodes.empty())
+        return;
+
+    struct Entry
+    {
+        uint32_t node;
+        int mask;
+    };
+
+    Entry stack[kMaxDepth + 2];
+    int depth = 0;
+    stack[depth++] = { 0, 0x3F };
+
+    while (depth > 0)
+    {
+        Entry entry = stack[--depth];
+        const Node& node = m_nodes[entry.node];
+
+        int mask = ClassifyBox(_frustum, node.min, node.max, entry.mask);
+        if (mask < 0)
+            continue;
+
+        if (mask == 0)
+        {
+            /* Entirely inside: a subtree's objects are contiguous, from its leftmost leaf to its rightmost one */
+            const Node* leftmost = &node;
+            while (leftmost->count == 0)
+                leftmost = &m_nodes[leftmost->first];
+            const Node* rightmost = &node;
+            while (rightmost->count == 0)
+                rightmost = &m_nodes[rightmost->first + 1];
+            _objects.insert(_objects.end(), m_objects.begin() + leftmost->first, m_objects.begin() + rightmost->first + rightmost->count);
+            continue;
+        }
+
+        if (node.count == 0)
+        {
+            stack[depth++] = { node.first + 1, mask };
+            stack[depth++] = { node.first, mask };
+            continue;
+        }
+
+        for (uint32_t i = 0; i < node.count; i++)
+        {
+            const Aabb& bounds = m_bounds[node.first + i];
+            if (ClassifyBox(_frustum, bounds.min, bounds.max, mask) >= 0)
+                _objects.push_back(m_objects[node.first + i]);
+        }
+    }
+}
+
+/// <summary>
+/// Distance along the ray where it enters the box (0 if it starts inside), or FLT_MAX if it misses it
+/// before _maxDistance
+/// </summary>
+static inline float IntersectBox(const Vec3& _origin, const Vec3& _inverseDirection, const Vec3& _min, const Vec3& _max, float _maxDistance)
+{
+    /* A NaN slab distance (0 * infinity: the origin on the plane of a slab the ray is parallel to) is the second
+       argument of std::min/max, which then return the first: the slab is ignored */
+    float enter = 0.0f;
+    float exit = _maxDistance;
+
+    float t1 = (_min.x - _origin.x) * _inverseDirection.x;
+    float t2 = (_max.x - _origin.x) * _inverseDirection.x;
+    enter = std::max(enter, std::min(t1, t2));
+    exit = std::min(exit, std::max(t1, t2));
+
+    t1 = (_min.y - _origin.y) * _inverseDirection.y;
+    t2 = (_max.y - _origin.y) * _inverseDirection.y;
+    enter = std::max(enter, std::min(t1, t2));
+    exit = std::min(exit, std::max(t1, t2));
+
+    t1 = (_min.z - _origin.z) * _inverseDirection.z;
+    t2 = (_max.z - _origin.z) * _inverseDirection.z;
+    enter = std::max(enter, std::min(t1, t2));
+    exit = std::min(exit, std::max(t1, t2));
+
+    return (enter <= exit && enter < _maxDistance) ? enter : FLT_MAX;
+}
+
+bool BoundingVolumeHierarchy::Raycast(const Vec3& _origin, const Vec3& _direction, float _maxDistance, RayHit& _hit) const
+{
+    if (m_nodes.empty())
+        return false;
+
+    /* A zero component gives an infinite inverse: the slab is then never or always crossed, as it should */
+    Vec3 inverse = { 1.0f / _direction.x, 1.0f / _direction.y, 1.0f / _direction.z };
+    float closest = _maxDistance;
+    bool found = false;
+
+    uint32_t stack[kMaxDepth + 2];
+    int depth = 0;
+    if (IntersectBox(_origin, inverse, m_nodes[0].min, m_nodes[0].max, closest) != FLT_MAX)
+        stack[depth++] = 0;
+
+    while (depth > 0)
+    {
+        const Node& node = m_nodes[stack[--depth]];
+
+        if (node.count > 0)
+        {
+            for (uint32_t i = 0; i < node.count; i++)
+            {
+                const Aabb& bounds = m_bounds[node.first + i];
+                float distance = IntersectBox(_origin, inverse, bounds.min, bounds.max, closest);
+                if (distance != FLT_MAX)
+                {
+                    closest = distance;
+                    _hit.object = m_objects[node.first + i];
+                    _hit.distance = distance;
+                    found = true;
+                }
+            }
+            continue;
+        }
+
+        /* Nearer child on top of the stack, children beyond the closest hit so far skipped */
+        uint32_t nearChild = node.first;
+        uint32_t farChild = node.first + 1;
+        float nearDistance = IntersectBox(_origin, inverse, m_nodes[nearChild].min, m_nodes[nearChild].max, closest);
+        float farDistance = IntersectBox(_origin, inverse, m_nodes[farChild].min, m_nodes[farChild].max, closest);
+        if (farDistance < nearDistance)
+        {
+            std::swap(nearChild, farChild);
+            std::swap(nearDistance, farDistance);
+        }
+
+        if (farDistance != FLT_MAX)
+            stack[depth++] = farChild;
+        if (nearDistance != FLT_MAX)
+            stack[depth++] = nearChild;
+    }
+
+    return found;
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "FrustumCulling.h"
+#include "VectorMath.h"
+
+/// <summary>
+/// Axis-aligned bounding box
+/// </summary>
+struct Aabb
+{
+    Vec3 min;
+    Vec3 max;
+};
+
+inline Aabb AabbFromSphere(const Vec3& _center, float _radius)
+{
+    return { { _center.x - _radius, _center.y - _radius, _center.z - _radius }, { _center.x + _radius, _center.y + _radius, _center.z + _radius } };
+}
+
+/// <summary>
+/// Closest object a ray enters: its index and the distance along the ray (0 if the origin is inside)
+/// </summary>
+struct RayHit
+{
+    uint32_t object;
+    float distance;
+};
+
+/// <summary>
+/// Bounding volume hierarchy over the boxes of a set of objects (indices 0..count-1, in the order of the
+/// bounds array), for queries that don't scale linearly with the object count: frustum culling and ray picking.
+/// Built top-down with the surface area heuristic (binned). When the objects move, Refit recomputes the boxes
+/// bottom-up keeping the tree; the tree degrades as objects drift from where it was built, so NeedsRebuild
+/// compares its SAH cost with the cost it had when built.
+/// Nodes are 32 bytes, children are allocated in pairs after their parent: a refit is one reverse pass
+/// </summary>
+class BoundingVolumeHierarchy
+{
+public:
+    static const uint32_t kMaxLeafSize = 4;
+    static const int kBinCount = 16;
+
+    /// <summary>
+    /// Deepest level a node can be split at: the traversals keep their stack on the stack, one entry per level
+    /// </summary>
+    static const int kMaxDepth = 48;
+
+    /// <summary>
+    /// How much worse than at build time (in SAH cost) the refitted tree may get before NeedsRebuild
+    /// </summary>
+    static constexpr float kRebuildCostRatio = 1.3f;
+
+    /// <summary>
+    /// Build the tree over _count objects
+    /// </summary>
+    /// <param name="_bounds"></param>
+    /// <param name="_count"></param>
+    void Build(const Aabb* _bounds, size_t _count);
+
+    /// <summary>
+    /// Update the boxes for new bounds of the same objects, keeping the tree
+    /// </summary>
+    /// <param name="_bounds">As many as given to Build</param>
+    void Refit(const Aabb* _bounds);
+
+    bool NeedsRebuild() const { return m_cost > m_builtCost * kRebuildCostRatio; }
+
+    /// <summary>
+    /// Append to _objects the objects whose box touches _frustum, in no particular order. Subtrees entirely
+    /// inside are taken whole (their objects are contiguous), planes a node is entirely inside are not tested below it
+    /// </summary>
+    /// <param name="_frustum"></param>
+    /// <param name="_objects"></param>
+    void QueryFrustum(const Frustum& _frustum, std::vector<uint32_t>& _objects) const;
+
+    /// <summary>
+    /// Closest object box the ray from _origin along _direction (not necessarily unit: distances are in its
+    /// units) enters before _maxDistance
+    /// </summary>
+    /// <param name="_origin"></param>
+    /// <param name="_direction"></param>
+    /// <param name="_maxDistance"></param>
+    /// <param name="_hit"></param>
+    /// <returns>False if there is none</returns>
+    bool Raycast(const Vec3& _origin, const Vec3& _direction, float _maxDistance, RayHit& _hit) const;
+
+    size_t GetObjectCount() const { return m_objects.size(); }
+    size_t GetNodeCount() const { return m_nodes.size(); }
+
+    /// <summary>
+    /// SAH cost of the tree: expected box tests of a random query, now and right after the last Build
+    /// </summary>
+    /// <returns></returns>
+    float GetCost() const { return m_cost; }
+    float GetBuiltCost() const { return m_builtCost; }
+
+    void Clear();
+
+private:
+    /// <summary>
+    /// A leaf holds count objects from m_objects[first] (boxes from m_bounds[first]); an inner node (count 0) has its children at first, first + 1
+    /// </summary>
+    struct Node
+    {
+        Vec3 min;
+        uint32_t first;
+        Vec3 max;
+        uint32_t count;
+    };
+
+    /// <summary>
+    /// An object while building: what the splits read, moved with it so each node's objects stay contiguous
+    /// </summary>
+    struct BuildItem
+    {
+        Aabb bounds;
+        Vec3 centroid;
+        uint32_t object;
+    };
+
+    void UpdateLeafBounds(Node& _node) const;
+
+    /// <summary>
+    /// Split _node (a leaf) in two children if the SAH says it is worth it, or if it holds too many objects
+    /// </summary>
+    /// <returns>True if it was split</returns>
+    bool Split(uint32_t _node, std::vector<BuildItem>& _items);
+
+    float ComputeCost() const;
+
+    /* The objects of the leaves, one leaf after the other, and their boxes in the same order (the leaves read them
+       contiguously rather than one cache miss each) */
+    std::vector<Node> m_nodes;
+    std::vector<uint32_t> m_objects;
+    std::vector<Aabb> m_bounds;
+    float m_cost = 0.0f;
+    float m_builtCost = 0.0f;
+};
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+
+/// <summary>
+/// A shader file compiled into the executable: its path as the application loads it
+/// (e.g. "Shaders/vshader.glsl") and its bytes, NUL-terminated but size excludes the NUL
+/// </summary>
+struct EmbeddedShader
+{
+    const char* path;
+    const char* data;
+    size_t size;
+};
+
+/// <summary>
+/// Every file of the Shaders directory, generated at build time by cmake/EmbedShaders.cmake
+/// </summary>
+extern const EmbeddedShader m_embeddedShaders[];
+extern const size_t m_embeddedShaderCount;
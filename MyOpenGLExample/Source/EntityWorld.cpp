@@ -0,0 +1,288 @@
+#include "EntityWorld.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <new>
+
+/// <summary>
+/// Value (as bits) of each column of new components, and of the unused lanes of a chunk, which the SIMD
+/// kernels process too: no offset and unit scale, identity rotations, still, opaque white
+/// </summary>
+static const uint32_t s_componentDefaults[kComponentCount][4] =
+{
+    { 0u, 0u, 0u, 0x3F800000u },
+    { 0u, 0u, 0u, 0x3F800000u },
+    { 0u, 0u, 0u, 0x3F800000u },
+    { 0u, 0u, 0u, 0u },
+    { 0xFFFFFFFFu, 0u, 0u, 0u },
+};
+
+static const uint32_t s_invalidRow = 0xFFFFFFFFu;
+
+EntityWorld::EntityWorld()
+{
+}
+
+EntityWorld::~EntityWorld()
+{
+    Clear();
+}
+
+void EntityWorld::Clear()
+{
+    for (std::unique_ptr<Archetype>& archetype : m_archetypes)
+    {
+        for (Chunk& chunk : archetype->chunks)
+            ::operator delete[](chunk.data, std::align_val_t(32));
+    }
+
+    m_archetypes.clear();
+    m_records.clear();
+    m_freeIndices.clear();
+    m_entityCount = 0;
+    m_structureVersion++;
+}
+
+EntityWorld::Archetype* EntityWorld::GetArchetype(ComponentMask _mask, uint32_t _group)
+{
+    for (std::unique_ptr<Archetype>& archetype : m_archetypes)
+    {
+        if (archetype->mask == _mask && archetype->group == _group)
+            return archetype.get();
+    }
+
+    std::unique_ptr<Archetype> archetype(new Archetype());
+    archetype->mask = _mask;
+    archetype->group = _group;
+
+    /* The entity indices first, then the columns of each component; as many rows as fit, whole SIMD lanes */
+    size_t columns = 1;
+    for (uint32_t component = 0; component < kComponentCount; component++)
+    {
+        if (_mask & ComponentBit((ComponentId)component))
+            columns += kComponentColumns[component];
+    }
+
+    archetype->capacity = (kChunkBytes / sizeof(uint32_t) / columns) / kLaneCount * kLaneCount;
+
+    uint32_t offset = (uint32_t)archetype->capacity;
+    for (uint32_t component = 0; component < kComponentCount; component++)
+    {
+        archetype->columnOffsets[component] = offset;
+        if (_mask & ComponentBit((ComponentId)component))
+            offset += (uint32_t)(kComponentColumns[component] * archetype->capacity);
+    }
+    archetype->columnOffsets[kComponentCount] = (uint32_t)archetype->capacity;
+
+    /* Queries come out by group: keep the archetypes sorted, new ones after the others of their group */
+    auto position = std::upper_bound(m_archetypes.begin(), m_archetypes.end(), _group,
+        [](uint32_t _value, const std::unique_ptr<Archetype>& _other) { return _value < _other->group; });
+    return m_archetypes.insert(position, std::move(archetype))->get();
+}
+
+void EntityWorld::ResetRow(const Archetype* _archetype, uint32_t* _data, size_t _row)
+{
+    _data[_row] = s_invalidRow;
+
+    for (uint32_t component = 0; component < kComponentCount; component++)
+    {
+        if ((_archetype->mask & ComponentBit((ComponentId)component)) == 0)
+            continue;
+
+        for (int column = 0; column < kComponentColumns[component]; column++)
+            _data[_archetype->columnOffsets[component] + column * _archetype->capacity + _row] = s_componentDefaults[component][column];
+    }
+}
+
+void EntityWorld::AddRow(Archetype* _archetype, uint32_t _index)
+{
+    if (_archetype->chunks.empty() || _archetype->chunks.back().count == _archetype->capacity)
+    {
+        Chunk chunk;
+        chunk.data = static_cast<uint32_t*>(::operator new[](kChunkBytes, std::align_val_t(32)));
+        chunk.count = 0;
+        for (size_t row = 0; row < _archetype->capacity; row++)
+            ResetRow(_archetype, chunk.data, row);
+        _archetype->chunks.push_back(chunk);
+    }
+
+    Chunk& chunk = _archetype->chunks.back();
+    EntityRecord& record = m_records[_index];
+    record.archetype = _archetype;
+    record.chunk = (uint32_t)(_archetype->chunks.size() - 1);
+    record.row = (uint32_t)chunk.count;
+
+    chunk.data[chunk.count] = _index;
+    chunk.count++;
+}
+
+void EntityWorld::RemoveRow(Archetype* _archetype, uint32_t _chunk, uint32_t _row)
+{
+    Chunk& last = _archetype->chunks.back();
+    size_t lastRow = last.count - 1;
+    uint32_t* target = _archetype->chunks[_chunk].data;
+
+    /* The archetype's last entity fills the hole */
+    if (target != last.data || _row != lastRow)
+    {
+        target[_row] = last.data[lastRow];
+        for (uint32_t component = 0; component < kComponentCount; component++)
+        {
+            if ((_archetype->mask & ComponentBit((ComponentId)component)) == 0)
+                continue;
+
+            for (int column = 0; column < kComponentColumns[component]; column++)
+            {
+                size_t offset = _archetype->columnOffsets[component] + column * _archetype->capacity;
+                target[offset + _row] = last.data[offset + lastRow];
+            }
+        }
+
+        EntityRecord& moved = m_records[target[_row]];
+        moved.chunk = _chunk;
+        moved.row = _row;
+    }
+
+    ResetRow(_archetype, last.data, lastRow);
+    last.count--;
+
+    if (last.count == 0)
+    {
+        ::operator delete[](last.data, std::align_val_t(32));
+        _archetype->chunks.pop_back();
+    }
+}
+
+Entity EntityWorld::Create(ComponentMask _mask, uint32_t _group)
+{
+    uint32_t index;
+    if (!m_freeIndices.empty())
+    {
+        index = m_freeIndices.back();
+        m_freeIndices.pop_back();
+    }
+    else
+    {
+        index = (uint32_t)m_records.size();
+        m_records.push_back({ nullptr, 0, 0, 0 });
+    }
+
+    AddRow(GetArchetype(_mask, _group), index);
+    m_entityCount++;
+    m_structureVersion++;
+
+    return { index, m_records[index].generation };
+}
+
+bool EntityWorld::IsAlive(Entity _entity) const
+{
+    return _entity.index < m_records.size() && m_records[_entity.index].generation == _entity.generation
+        && m_records[_entity.index].archetype != nullptr;
+}
+
+void EntityWorld::Destroy(Entity _entity)
+{
+    if (!IsAlive(_entity))
+        return;
+
+    EntityRecord& record = m_records[_entity.index];
+    RemoveRow(record.archetype, record.chunk, record.row);
+
+    record.archetype = nullptr;
+    record.generation++;
+    m_freeIndices.push_back(_entity.index);
+    m_entityCount--;
+    m_structureVersion++;
+}
+
+void EntityWorld::SetArchetype(Entity _entity, ComponentMask _mask, uint32_t _group)
+{
+    assert(IsAlive(_entity));
+    EntityRecord& record = m_records[_entity.index];
+    Archetype* source = record.archetype;
+    if (source->mask == _mask && source->group == _group)
+        return;
+
+    Archetype* target = GetArchetype(_mask, _group);
+    uint32_t sourceChunk = record.chunk;
+    uint32_t sourceRow = record.row;
+    AddRow(target, _entity.index);
+
+    /* Copy the components both archetypes have, then free the old row */
+    const uint32_t* from = source->chunks[sourceChunk].data;
+    uint32_t* to = target->chunks[record.chunk].data;
+    for (uint32_t component = 0; component < kComponentCount; component++)
+    {
+        if ((source->mask & _mask & ComponentBit((ComponentId)component)) == 0)
+            continue;
+
+        for (int column = 0; column < kComponentColumns[component]; column++)
+        {
+            to[target->columnOffsets[component] + column * target->capacity + record.row] =
+                from[source->columnOffsets[component] + column * source->capacity + sourceRow];
+        }
+    }
+
+    RemoveRow(source, sourceChunk, sourceRow);
+    m_structureVersion++;
+}
+
+ComponentMask EntityWorld::GetMask(Entity _entity) const
+{
+    assert(IsAlive(_entity));
+    return m_records[_entity.index].archetype->mask;
+}
+
+uint32_t EntityWorld::GetGroup(Entity _entity) const
+{
+    assert(IsAlive(_entity));
+    return m_records[_entity.index].archetype->group;
+}
+
+void EntityWorld::Set(Entity _entity, ComponentId _component, const void* _value)
+{
+    assert(IsAlive(_entity) && (GetMask(_entity) & ComponentBit(_component)));
+    const EntityRecord& record = m_records[_entity.index];
+    const Archetype* archetype = record.archetype;
+    uint32_t* data = archetype->chunks[record.chunk].data + archetype->columnOffsets[_component] + record.row;
+
+    uint32_t values[4];
+    memcpy(values, _value, kComponentColumns[_component] * sizeof(uint32_t));
+    for (int column = 0; column < kComponentColumns[_component]; column++)
+        data[column * archetype->capacity] = values[column];
+    m_componentVersions[_component]++;
+}
+
+void EntityWorld::Get(Entity _entity, ComponentId _component, void* _value) const
+{
+    assert(IsAlive(_entity) && (GetMask(_entity) & ComponentBit(_component)));
+    const EntityRecord& record = m_records[_entity.index];
+    const Archetype* archetype = record.archetype;
+    const uint32_t* data = archetype->chunks[record.chunk].data + archetype->columnOffsets[_component] + record.row;
+
+    uint32_t values[4];
+    for (int column = 0; column < kComponentColumns[_component]; column++)
+        values[column] = data[column * archetype->capacity];
+    memcpy(_value, values, kComponentColumns[_component] * sizeof(uint32_t));
+}
+
+size_t EntityWorld::Query(ComponentMask _required, std::vector<ChunkView>& _chunks) const
+{
+    _chunks.clear();
+    size_t first = 0;
+
+    for (const std::unique_ptr<Archetype>& archetype : m_archetypes)
+    {
+        if ((archetype->mask & _required) != _required)
+            continue;
+
+        for (const Chunk& chunk : archetype->chunks)
+        {
+            _chunks.push_back({ chunk.data, archetype->columnOffsets, archetype->group, chunk.count, first });
+            first += chunk.count;
+        }
+    }
+
+    return first;
+}
@@ -0,0 +1,186 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/// <summary>
+/// Components an entity can have. Every component is 1 to 4 columns of 4-byte values (floats, or packed
+/// bits like the RGBA8 color); inside a chunk each column is its own contiguous array, so systems read
+/// and write them with full SIMD registers
+/// </summary>
+enum ComponentId : uint32_t
+{
+    kComponentPosition,          // x, y, z and the uniform scale
+    kComponentRotation,          // quaternion x, y, z, w
+    kComponentPreviousRotation,  // the rotation one simulation step earlier, frames draw in between
+    kComponentAngularVelocity,   // x, y, z, radians per second around the world axes
+    kComponentColor,             // RGBA8 tint
+    kComponentCount
+};
+
+typedef uint32_t ComponentMask;
+
+inline ComponentMask ComponentBit(ComponentId _component) { return 1u << _component; }
+
+/// <summary>
+/// Number of columns of each component
+/// </summary>
+static const int kComponentColumns[kComponentCount] = { 4, 4, 4, 3, 1 };
+
+/// <summary>
+/// Handle to an entity: its slot and the generation of the slot, so a stale handle is detected after the
+/// slot is reused
+/// </summary>
+struct Entity
+{
+    uint32_t index;
+    uint32_t generation;
+};
+
+/// <summary>
+/// A chunk as seen by a system: count entities (plus padding lanes up to the next multiple of 8, holding
+/// default values) whose components are columns of capacity values. first is the position of the chunk's
+/// first entity in the query, where a system writing one output per entity writes it
+/// </summary>
+struct ChunkView
+{
+    uint32_t* data;
+    const uint32_t* columnOffsets;
+    uint32_t group;
+    size_t count;
+    size_t first;
+
+    float* GetColumn(ComponentId _component, int _column) const { return reinterpret_cast<float*>(GetBits(_component, _column)); }
+    uint32_t* GetBits(ComponentId _component, int _column) const { return data + columnOffsets[_component] + (size_t)_column * GetCapacity(); }
+    size_t GetCapacity() const { return columnOffsets[kComponentCount]; }
+    const uint32_t* GetEntityIndices() const { return data; }
+};
+
+/// <summary>
+/// Archetype entity component system. Entities with the same components and the same group (an integer the
+/// owner gives a meaning to, the scene uses the mesh) share an archetype, whose data lives in fixed size
+/// chunks: each chunk holds the components of up to GetCapacity entities as columns (structure of arrays
+/// inside, array of chunks outside). Systems query the chunks having some components and walk linear memory;
+/// a query is a list of chunks, so it can be split in ranges across threads.
+/// Destroying an entity moves the archetype's last entity into its row: chunks stay full, except the last one
+/// </summary>
+class EntityWorld
+{
+public:
+    static const size_t kChunkBytes = 16384;
+    static const size_t kLaneCount = 8;
+
+    EntityWorld();
+    ~EntityWorld();
+
+    EntityWorld(const EntityWorld&) = delete;
+    EntityWorld& operator=(const EntityWorld&) = delete;
+
+    /// <summary>
+    /// New entity with the components of _mask, in _group. The components hold their default values
+    /// </summary>
+    /// <param name="_mask"></param>
+    /// <param name="_group"></param>
+    /// <returns></returns>
+    Entity Create(ComponentMask _mask, uint32_t _group);
+
+    void Destroy(Entity _entity);
+    bool IsAlive(Entity _entity) const;
+
+    /// <summary>
+    /// Move _entity to another set of components or group: the components it keeps keep their values,
+    /// the new ones start with their defaults
+    /// </summary>
+    /// <param name="_entity"></param>
+    /// <param name="_mask"></param>
+    /// <param name="_group"></param>
+    void SetArchetype(Entity _entity, ComponentMask _mask, uint32_t _group);
+
+    ComponentMask GetMask(Entity _entity) const;
+    uint32_t GetGroup(Entity _entity) const;
+
+    /// <summary>
+    /// Copy a component of _entity from / to _value, kComponentColumns[_component] 4-byte values
+    /// (a Vec4, a Quat, a Vec3, a packed color). The entity must have the component
+    /// </summary>
+    /// <param name="_entity"></param>
+    /// <param name="_component"></param>
+    /// <param name="_value"></param>
+    void Set(Entity _entity, ComponentId _component, const void* _value);
+    void Get(Entity _entity, ComponentId _component, void* _value) const;
+
+    /// <summary>
+    /// Every chunk whose archetype has (at least) the components of _required, ordered by group, then by
+    /// archetype creation order. Replaces the content of _chunks
+    /// </summary>
+    /// <param name="_required"></param>
+    /// <param name="_chunks"></param>
+    /// <returns>The number of entities in those chunks</returns>
+    size_t Query(ComponentMask _required, std::vector<ChunkView>& _chunks) const;
+
+    size_t GetEntityCount() const { return m_entityCount; }
+
+    /// <summary>
+    /// Changes whenever an entity is created, destroyed or changes archetype: the order of a query
+    /// (and what was extracted from it) is valid while this stays the same
+    /// </summary>
+    /// <returns></returns>
+    uint64_t GetStructureVersion() const { return m_structureVersion; }
+
+    /// <summary>
+    /// Changes whenever Set writes _component, or a system writing its columns in place calls MarkChanged:
+    /// what is derived from the component (the bounds derived from the positions) is valid while this stays the same
+    /// </summary>
+    /// <param name="_component"></param>
+    /// <returns></returns>
+    uint64_t GetComponentVersion(ComponentId _component) const { return m_componentVersions[_component]; }
+    void MarkChanged(ComponentId _component) { m_componentVersions[_component]++; }
+
+    /// <summary>
+    /// Destroy every entity and release the chunks
+    /// </summary>
+    void Clear();
+
+private:
+    struct Chunk
+    {
+        uint32_t* data;
+        size_t count;
+    };
+
+    struct Archetype
+    {
+        ComponentMask mask;
+        uint32_t group;
+        size_t capacity;
+
+        /// <summary>
+        /// Offset of each component's first column in a chunk (in 4-byte values), the capacity last
+        /// </summary>
+        uint32_t columnOffsets[kComponentCount + 1];
+
+        std::vector<Chunk> chunks;
+    };
+
+    struct EntityRecord
+    {
+        Archetype* archetype;
+        uint32_t chunk;
+        uint32_t row;
+        uint32_t generation;
+    };
+
+    Archetype* GetArchetype(ComponentMask _mask, uint32_t _group);
+    void AddRow(Archetype* _archetype, uint32_t _index);
+    void RemoveRow(Archetype* _archetype, uint32_t _chunk, uint32_t _row);
+    void ResetRow(const Archetype* _archetype, uint32_t* _data, size_t _row);
+
+    std::vector<std::unique_ptr<Archetype>> m_archetypes;
+    std::vector<EntityRecord> m_records;
+    std::vector<uint32_t> m_freeIndices;
+    size_t m_entityCount = 0;
+    uint64_t m_structureVersion = 0;
+    uint64_t m_componentVersions[kComponentCount] = {};
+};
@@ -0,0 +1,30 @@
+#include "FixedTimestep.h"
+
+void FixedTimestep::Initialize(int _rate, int _maxStepsPerFrame)
+{
+    m_rate = _rate;
+    m_maxStepsPerFrame = _maxStepsPerFrame;
+    m_step = (1000000000ull + (uint64_t)_rate / 2) / (uint64_t)_rate;
+    m_stepSeconds = 1.0f / (float)_rate;
+    m_accumulator = 0;
+    m_stepCount = 0;
+    m_droppedSteps = 0;
+}
+
+int FixedTimestep::Advance(uint64_t _nanoseconds)
+{
+    m_accumulator += _nanoseconds;
+
+    uint64_t steps = m_accumulator / m_step;
+    m_accumulator -= steps * m_step;
+
+    /* Too far behind (a stall, a breakpoint): drop the extra steps, keep the fraction for interpolation */
+    if (steps > (uint64_t)m_maxStepsPerFrame)
+    {
+        m_droppedSteps += steps - (uint64_t)m_maxStepsPerFrame;
+        steps = (uint64_t)m_maxStepsPerFrame;
+    }
+
+    m_stepCount += steps;
+    return (int)steps;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+
+/// <summary>
+/// Fixed-step simulation clock. Every frame gives it the time it stands for, it answers how many
+/// whole simulation steps to run, and how far (alpha, 0..1) the frame is between the last two steps,
+/// to interpolate what is drawn. Time is counted in integer nanoseconds, so the same frame times
+/// always give the same steps
+/// </summary>
+class FixedTimestep
+{
+public:
+    /// <summary>
+    /// Simulation at _rate steps per second. No more than _maxStepsPerFrame steps are run for one
+    /// frame: after a long stall the simulation slows down instead of never catching up
+    /// </summary>
+    /// <param name="_rate"></param>
+    /// <param name="_maxStepsPerFrame"></param>
+    void Initialize(int _rate, int _maxStepsPerFrame);
+
+    /// <summary>
+    /// Add the time of one frame and return the number of steps to run now
+    /// </summary>
+    /// <param name="_nanoseconds"></param>
+    /// <returns></returns>
+    int Advance(uint64_t _nanoseconds);
+
+    /// <summary>
+    /// Position of the frame between the previous step (0) and the last one (1)
+    /// </summary>
+    /// <returns></returns>
+    float GetAlpha() const { return (float)((double)m_accumulator / (double)m_step); }
+
+    /// <summary>
+    /// Simulated time of one step, in seconds
+    /// </summary>
+    /// <returns></returns>
+    float GetStepSeconds() const { return m_stepSeconds; }
+
+    int GetRate() const { return m_rate; }
+    uint64_t GetStepCount() const { return m_stepCount; }
+    uint64_t GetDroppedSteps() const { return m_droppedSteps; }
+
+private:
+    int m_rate = 60;
+    int m_maxStepsPerFrame = 8;
+    uint64_t m_step = 16666667;
+    float m_stepSeconds = 1.0f / 60.0f;
+    uint64_t m_accumulator = 0;
+    uint64_t m_stepCount = 0;
+    uint64_t m_droppedSteps = 0;
+};
@@ -0,0 +1,241 @@
+#include "FrameStats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+/// <summary>
+/// Index of the most significant set bit (_value must not be 0)
+/// </summary>
+/// <param name="_value"></param>
+/// <returns></returns>
+static int HighestBit(uint64_t _value)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse64(&index, _value);
+    return (int)index;
+#else
+    return 63 - __builtin_clzll(_value);
+#endif
+}
+
+LatencyHistogram::LatencyHistogram()
+    : m_buckets(kBucketCount, 0)
+{
+    Reset();
+}
+
+int LatencyHistogram::GetBucketIndex(uint64_t _value)
+{
+    if (_value < (uint64_t)kLinearCount)
+        return (int)_value;
+
+    /* Keep the leading 1 plus kSubBucketBits bits of mantissa */
+    int msb = HighestBit(_value);
+    int shift = msb - kSubBucketBits;
+    int mantissa = (int)((_value >> shift) & (kSubBucketCount - 1));
+    return kLinearCount + (msb - kSubBucketBits - 1) * kSubBucketCount + mantissa;
+}
+
+uint64_t LatencyHistogram::GetBucketUpperBound(int _index)
+{
+    if (_index < kLinearCount)
+        return (uint64_t)_index;
+
+    int octave = (_index - kLinearCount) / kSubBucketCount;
+    int mantissa = (_index - kLinearCount) % kSubBucketCount;
+    int shift = octave + 1;
+    uint64_t lower = (uint64_t)(kSubBucketCount + mantissa) << shift;
+    return lower + ((uint64_t)1 << shift) - 1;
+}
+
+void LatencyHistogram::Record(uint64_t _nanoseconds)
+{
+    m_buckets[GetBucketIndex(_nanoseconds)]++;
+    m_count++;
+    m_sum += _nanoseconds;
+    m_min = (_nanoseconds < m_min) ? _nanoseconds : m_min;
+    m_max = (_nanoseconds > m_max) ? _nanoseconds : m_max;
+}
+
+void LatencyHistogram::Reset()
+{
+    std::fill(m_buckets.begin(), m_buckets.end(), 0);
+    m_count = 0;
+    m_sum = 0;
+    m_min = UINT64_MAX;
+    m_max = 0;
+}
+
+uint64_t LatencyHistogram::GetPercentile(double _percentile) const
+{
+    if (m_count == 0)
+        return 0;
+
+    uint64_t rank = (uint64_t)std::ceil((_percentile / 100.0) * (double)m_count);
+    rank = (rank < 1) ? 1 : rank;
+
+    uint64_t seen = 0;
+    for (int i = 0; i < kBucketCount; i++)
+    {
+        seen += m_buckets[i];
+        if (seen >= rank)
+        {
+            /* The bucket bound can overshoot the real extremes, clamp it */
+            uint64_t value = GetBucketUpperBound(i);
+            value = (value > m_max) ? m_max : value;
+            return (value < m_min) ? m_min : value;
+        }
+    }
+
+    return m_max;
+}
+
+int FrameStats::AddStage(const std::string& _name)
+{
+    Stage stage;
+    stage.name = _name;
+    m_stages.push_back(stage);
+    return (int)m_stages.size() - 1;
+}
+
+void FrameStats::RecordFrame(uint64_t _nanoseconds)
+{
+    m_frame.Record(_nanoseconds);
+    m_totalNanoseconds += _nanoseconds;
+}
+
+/// <summary>
+/// Nanoseconds to milliseconds
+/// </summary>
+/// <param name="_nanoseconds"></param>
+/// <returns></returns>
+static double ToMs(double _nanoseconds)
+{
+    return _nanoseconds / 1000000.0;
+}
+
+/// <summary>
+/// One line of the summary table
+/// </summary>
+/// <param name="_name"></param>
+/// <param name="_histogram"></param>
+static void PrintHistogram(const std::string& _name, const LatencyHistogram& _histogram)
+{
+    printf("%-20s %10.4f %10.4f %10.4f %10.4f %10.4f\n", _name.c_str(),
+        ToMs(_histogram.GetMean()),
+        ToMs((double)_histogram.GetPercentile(50.0)),
+        ToMs((double)_histogram.GetPercentile(90.0)),
+        ToMs((double)_histogram.GetPercentile(99.0)),
+        ToMs((double)_histogram.GetMax()));
+}
+
+void FrameStats::PrintSummary() const
+{
+    double seconds = (double)m_totalNanoseconds / 1000000000.0;
+
+    printf("Frames: %llu in %.3f s (%.1f FPS)\n", (unsigned long long)m_frame.GetCount(), seconds,
+        seconds > 0.0 ? (double)m_frame.GetCount() / seconds : 0.0);
+    printf("%-20s %10s %10s %10s %10s %10s\n", "Stage (ms)", "mean", "p50", "p90", "p99", "max");
+
+    for (const Stage& stage : m_stages)
+    {
+        if (stage.histogram.GetCount() > 0)
+            PrintHistogram(stage.name, stage.histogram);
+    }
+
+    PrintHistogram("Frame", m_frame);
+    fflush(stdout);
+}
+
+/// <summary>
+/// Quote a string for JSON
+/// </summary>
+/// <param name="_value"></param>
+/// <returns></returns>
+static std::string JsonString(const std::string& _value)
+{
+    std::string result = "\"";
+    for (char c : _value)
+    {
+        if (c == '"' || c == '\\')
+        {
+            result += '\\';
+            result += c;
+        }
+        else if ((unsigned char)c < 0x20)
+        {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned int)c);
+            result += escaped;
+        }
+        else
+        {
+            result += c;
+        }
+    }
+    return result + "\"";
+}
+
+/// <summary>
+/// Write one histogram as a JSON object (times in milliseconds)
+/// </summary>
+/// <param name="_file"></param>
+/// <param name="_histogram"></param>
+static void WriteHistogramJson(std::ofstream& _file, const LatencyHistogram& _histogram)
+{
+    char buffer[512];
+    snprintf(buffer, sizeof(buffer),
+        "{ \"count\": %llu, \"mean_ms\": %.6f, \"min_ms\": %.6f, \"p50_ms\": %.6f, \"p90_ms\": %.6f, \"p99_ms\": %.6f, \"max_ms\": %.6f }",
+        (unsigned long long)_histogram.GetCount(),
+        ToMs(_histogram.GetMean()),
+        ToMs((double)_histogram.GetMin()),
+        ToMs((double)_histogram.GetPercentile(50.0)),
+        ToMs((double)_histogram.GetPercentile(90.0)),
+        ToMs((double)_histogram.GetPercentile(99.0)),
+        ToMs((double)_histogram.GetMax()));
+    _file << buffer;
+}
+
+bool FrameStats::WriteJson(const char* _fileName, const std::string& _renderer) const
+{
+    std::ofstream file(_fileName, std::ios::out | std::ios::trunc);
+
+    if (!file)
+    {
+        std::cout << "Unable to write the stats report " << _fileName << std::endl;
+        return false;
+    }
+
+    double seconds = (double)m_totalNanoseconds / 1000000000.0;
+
+    file << "{\n";
+    file << "  \"renderer\": " << JsonString(_renderer) << ",\n";
+    file << "  \"frames\": " << m_frame.GetCount() << ",\n";
+    file << "  \"duration_s\": " << seconds << ",\n";
+    file << "  \"fps\": " << (seconds > 0.0 ? (double)m_frame.GetCount() / seconds : 0.0) << ",\n";
+    file << "  \"frame\": ";
+    WriteHistogramJson(file, m_frame);
+    file << ",\n  \"stages\": {";
+
+    bool first = true;
+    for (const Stage& stage : m_stages)
+    {
+        if (stage.histogram.GetCount() == 0)
+            continue;
+
+        file << (first ? "\n" : ",\n") << "    " << JsonString(stage.name) << ": ";
+        WriteHistogramJson(file, stage.histogram);
+        first = false;
+    }
+
+    file << "\n  }\n}\n";
+    return file.good();
+}
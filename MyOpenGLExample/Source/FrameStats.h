@@ -0,0 +1,117 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// Log-linear latency histogram (HDR style): values below 128 ns are exact, above that every power
+/// of two is split in 64 buckets, so any percentile is within ~1.6% of the real value.
+/// Fixed size, no allocation while recording
+/// </summary>
+class LatencyHistogram
+{
+public:
+    LatencyHistogram();
+
+    void Record(uint64_t _nanoseconds);
+    void Reset();
+
+    /// <summary>
+    /// Value (ns) below which _percentile (0..100) of the samples fall
+    /// </summary>
+    /// <param name="_percentile"></param>
+    /// <returns></returns>
+    uint64_t GetPercentile(double _percentile) const;
+
+    uint64_t GetCount() const { return m_count; }
+    uint64_t GetMin() const { return m_count > 0 ? m_min : 0; }
+    uint64_t GetMax() const { return m_max; }
+    double GetMean() const { return m_count > 0 ? (double)m_sum / (double)m_count : 0.0; }
+
+private:
+    static const int kSubBucketBits = 6;
+    static const int kSubBucketCount = 1 << kSubBucketBits;
+    static const int kLinearCount = kSubBucketCount * 2;
+    static const int kBucketCount = kLinearCount + (63 - kSubBucketBits) * kSubBucketCount;
+
+    static int GetBucketIndex(uint64_t _value);
+    static uint64_t GetBucketUpperBound(int _index);
+
+    std::vector<uint32_t> m_buckets;
+    uint64_t m_count;
+    uint64_t m_sum;
+    uint64_t m_min;
+    uint64_t m_max;
+};
+
+/// <summary>
+/// Per-stage frame timings. Stages are registered once at startup and recorded by index every frame
+/// </summary>
+class FrameStats
+{
+public:
+    /// <summary>
+    /// Register a stage and return the index used by Record
+    /// </summary>
+    /// <param name="_name"></param>
+    /// <returns></returns>
+    int AddStage(const std::string& _name);
+
+    void Record(int _stage, uint64_t _nanoseconds) { m_stages[_stage].histogram.Record(_nanoseconds); }
+
+    /// <summary>
+    /// Count one full frame (its time goes to the "Frame" stage)
+    /// </summary>
+    /// <param name="_nanoseconds"></param>
+    void RecordFrame(uint64_t _nanoseconds);
+
+    uint64_t GetFrameCount() const { return m_frame.GetCount(); }
+
+    /// <summary>
+    /// Print one line per stage: mean, p50, p90, p99 and max in milliseconds
+    /// </summary>
+    void PrintSummary() const;
+
+    /// <summary>
+    /// Write the whole report as JSON. _renderer identifies the GL driver the numbers come from
+    /// </summary>
+    /// <param name="_fileName"></param>
+    /// <param name="_renderer"></param>
+    /// <returns></returns>
+    bool WriteJson(const char* _fileName, const std::string& _renderer) const;
+
+private:
+    struct Stage
+    {
+        std::string name;
+        LatencyHistogram histogram;
+    };
+
+    std::vector<Stage> m_stages;
+    LatencyHistogram m_frame;
+    uint64_t m_totalNanoseconds = 0;
+};
+
+/// <summary>
+/// Steady clock stopwatch: Lap returns the nanoseconds since the previous lap (or since construction)
+/// </summary>
+class StageClock
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    StageClock() : m_last(Clock::now()) {}
+
+    uint64_t Lap()
+    {
+        Clock::time_point now = Clock::now();
+        uint64_t elapsed = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(now - m_last).count();
+        m_last = now;
+        return elapsed;
+    }
+
+private:
+    Clock::time_point m_last;
+};
@@ -0,0 +1,134 @@
+#include "FrustumCulling.h"
+
+#include <cmath>
+
+Frustum FrustumFromMatrix(const Mat4& _viewProjection)
+{
+    /* Row r of the matrix (column-major storage) */
+    const float* m = _viewProjection.m;
+    Vec4 rows[4];
+    for (int r = 0; r < 4; r++)
+        rows[r] = { m[r], m[4 + r], m[8 + r], m[12 + r] };
+
+    /* -w <= x, y, z <= w: row3 + row i >= 0 and row3 - row i >= 0 */
+    Frustum frustum;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        frustum.planes[axis * 2] = Vec4Add(rows[3], rows[axis]);
+        frustum.planes[axis * 2 + 1] = Vec4Sub(rows[3], rows[axis]);
+    }
+
+    for (Vec4& plane : frustum.planes)
+    {
+        float length = std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+        plane = Vec4Scale(plane, (length > 0.0f) ? 1.0f / length : 0.0f);
+    }
+
+    return frustum;
+}
+
+/// <summary>
+/// Append the indices _first + lane of the set bits of _visibleBits, for the first _lanes lanes. Branchless:
+/// every lane is stored and the output only advances past the visible ones, so it never writes past the last
+/// valid lane's slot
+/// </summary>
+static inline size_t AppendVisible(unsigned int _visibleBits, uint32_t _first, size_t _lanes, uint32_t* _visible)
+{
+    size_t written = 0;
+    for (size_t lane = 0; lane < _lanes; lane++)
+    {
+        _visible[written] = _first + (uint32_t)lane;
+        written += (_visibleBits >> lane) & 1u;
+    }
+    return written;
+}
+
+size_t CullSpheresScalar(const Frustum& _frustum, const SphereColumns& _spheres, float _radiusScale, size_t _count, uint32_t* _visible)
+{
+    size_t written = 0;
+    for (size_t i = 0; i < _count; i++)
+    {
+        float radius = _spheres.radius[i] * _radiusScale;
+        bool inside = true;
+        for (const Vec4& plane : _frustum.planes)
+        {
+            float distance = plane.x * _spheres.x[i] + plane.y * _spheres.y[i] + plane.z * _spheres.z[i] + plane.w;
+            inside = inside && (distance >= -radius);
+        }
+
+        _visible[written] = (uint32_t)i;
+        written += inside ? 1 : 0;
+    }
+    return written;
+}
+
+size_t CullSpheres(const Frustum& _frustum, const SphereColumns& _spheres, float _radiusScale, size_t _count, uint32_t* _visible)
+{
+#if MYOPENGL_SIMD_AVX2
+    __m256 planes[6][4];
+    for (int p = 0; p < 6; p++)
+    {
+        planes[p][0] = _mm256_set1_ps(_frustum.planes[p].x);
+        planes[p][1] = _mm256_set1_ps(_frustum.planes[p].y);
+        planes[p][2] = _mm256_set1_ps(_frustum.planes[p].z);
+        planes[p][3] = _mm256_set1_ps(_frustum.planes[p].w);
+    }
+    const __m256 radiusScale = _mm256_set1_ps(_radiusScale);
+
+    size_t written = 0;
+    for (size_t i = 0; i < _count; i += 8)
+    {
+        __m256 x = _mm256_load_ps(_spheres.x + i);
+        __m256 y = _mm256_load_ps(_spheres.y + i);
+        __m256 z = _mm256_load_ps(_spheres.z + i);
+        __m256 radius = _mm256_mul_ps(_mm256_load_ps(_spheres.radius + i), radiusScale);
+
+        /* Distance to the closest plane, plus the radius: negative when the sphere is behind that plane */
+        __m256 nearest = MulAdd(planes[0][0], x, MulAdd(planes[0][1], y, MulAdd(planes[0][2], z, planes[0][3])));
+        for (int p = 1; p < 6; p++)
+            nearest = _mm256_min_ps(nearest, MulAdd(planes[p][0], x, MulAdd(planes[p][1], y, MulAdd(planes[p][2], z, planes[p][3]))));
+
+        __m256 inside = _mm256_cmp_ps(_mm256_add_ps(nearest, radius), _mm256_setzero_ps(), _CMP_GE_OQ);
+        size_t lanes = (_count - i < 8) ? _count - i : 8;
+        written += AppendVisible((unsigned int)_mm256_movemask_ps(inside), (uint32_t)i, lanes, _visible + written);
+    }
+    return written;
+#elif MYOPENGL_SIMD_SSE
+    __m128 planes[6][4];
+    for (int p = 0; p < 6; p++)
+    {
+        planes[p][0] = _mm_set1_ps(_frustum.planes[p].x);
+        planes[p][1] = _mm_set1_ps(_frustum.planes[p].y);
+        planes[p][2] = _mm_set1_ps(_frustum.planes[p].z);
+        planes[p][3] = _mm_set1_ps(_frustum.planes[p].w);
+    }
+    const __m128 radiusScale = _mm_set1_ps(_radiusScale);
+
+    size_t written = 0;
+    for (size_t i = 0; i < _count; i += 8)
+    {
+        /* Two registers of 4, so the visibility of 8 spheres comes out as one byte as with AVX2 */
+        unsigned int visibleBits = 0;
+        for (size_t half = 0; half < 8; half += 4)
+        {
+            __m128 x = _mm_load_ps(_spheres.x + i + half);
+            __m128 y = _mm_load_ps(_spheres.y + i + half);
+            __m128 z = _mm_load_ps(_spheres.z + i + half);
+            __m128 radius = _mm_mul_ps(_mm_load_ps(_spheres.radius + i + half), radiusScale);
+
+            __m128 nearest = MulAdd(planes[0][0], x, MulAdd(planes[0][1], y, MulAdd(planes[0][2], z, planes[0][3])));
+            for (int p = 1; p < 6; p++)
+                nearest = _mm_min_ps(nearest, MulAdd(planes[p][0], x, MulAdd(planes[p][1], y, MulAdd(planes[p][2], z, planes[p][3]))));
+
+            __m128 inside = _mm_cmpge_ps(_mm_add_ps(nearest, radius), _mm_setzero_ps());
+            visibleBits |= (unsigned int)_mm_movemask_ps(inside) << half;
+        }
+
+        size_t lanes = (_count - i < 8) ? _count - i : 8;
+        written += AppendVisible(visibleBits, (uint32_t)i, lanes, _visible + written);
+    }
+    return written;
+#else
+    return CullSpheresScalar(_frustum, _spheres, _radiusScale, _count, _visible);
+#endif
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "VectorMath.h"
+
+/// <summary>
+/// View frustum as six world-space planes (left, right, bottom, top, near, far), normals pointing inside and
+/// of unit length: dot(plane.xyz, p) + plane.w is the signed distance of the point p to the plane
+/// </summary>
+struct Frustum
+{
+    Vec4 planes[6];
+};
+
+/// <summary>
+/// The frustum of the clip-space volume of _viewProjection (projection * view): a point is inside when it is
+/// on the inner side of the six planes (Gribb / Hartmann extraction, OpenGL clip z in [-w, w])
+/// </summary>
+/// <param name="_viewProjection"></param>
+/// <returns></returns>
+Frustum FrustumFromMatrix(const Mat4& _viewProjection);
+
+/// <summary>
+/// Bounding spheres stored as columns: sphere i is centered on (x[i], y[i], z[i]) with the radius radius[i]
+/// times the radius scale the kernels are given (an instance position and uniform scale, times the radius
+/// of its mesh). 32-byte aligned, like QuatColumns
+/// </summary>
+struct SphereColumns
+{
+    const float* x;
+    const float* y;
+    const float* z;
+    const float* radius;
+};
+
+/// <summary>
+/// Test _count spheres against _frustum and write the index of every sphere touching it, in order, to _visible
+/// (up to _count values). A sphere is rejected when it is entirely behind one of the planes; spheres crossing a
+/// corner outside the frustum are kept, which costs a few extra draws, never a missing object.
+/// 8 spheres per iteration (one AVX2 register or two SSE ones): the columns must be padded up to a multiple of 8
+/// </summary>
+/// <param name="_frustum"></param>
+/// <param name="_spheres"></param>
+/// <param name="_radiusScale"></param>
+/// <param name="_count"></param>
+/// <param name="_visible"></param>
+/// <returns>The number of visible spheres</returns>
+size_t CullSpheres(const Frustum& _frustum, const SphereColumns& _spheres, float _radiusScale, size_t _count, uint32_t* _visible);
+size_t CullSpheresScalar(const Frustum& _frustum, const SphereColumns& _spheres, float _radiusScale, size_t _count, uint32_t* _visible);
@@ -0,0 +1,214 @@
+#include "GpuCulling.h"
+
+#include <cstring>
+#include <vector>
+
+#include "MeshBatch.h"
+#include "Profiler.h"
+
+/// <summary>
+/// Work group sizes declared by the compute shaders
+/// </summary>
+static const GLuint s_cullGroupSize = 64;
+static const GLuint s_pyramidGroupSize = 8;
+
+/// <summary>
+/// Bindings of the storage blocks of Shaders/cullinstances.glsl
+/// </summary>
+enum CullStorageBinding
+{
+    kInstancesBinding = 0,
+    kRotationsBinding = 1,
+    kVisibleInstancesBinding = 2,
+    kVisibleRotationsBinding = 3,
+    kDrawCommandsBinding = 4,
+};
+
+bool GpuCulling::IsSupported()
+{
+    /* The shaders are GLSL 4.30, which has the storage blocks, and GL 4.3 has multi-draw indirect */
+    return GLEW_VERSION_4_3 != 0;
+}
+
+bool GpuCulling::Initialize(RenderStateCache& _glState, int _width, int _height, GLuint _cullProgram, GLuint _pyramidProgram)
+{
+    if (_cullProgram == 0 || _pyramidProgram == 0 || _width <= 0 || _height <= 0)
+        return false;
+
+    m_cullProgram = _cullProgram;
+    m_pyramidProgram = _pyramidProgram;
+    m_instanceCountLocation = glGetUniformLocation(m_cullProgram, "instanceCount");
+    m_frustumPlanesLocation = glGetUniformLocation(m_cullProgram, "frustumPlanes");
+    m_meshRadiiLocation = glGetUniformLocation(m_cullProgram, "meshRadii");
+    m_depthSizeLocation = glGetUniformLocation(m_cullProgram, "depthSize");
+    m_sourceLevelLocation = glGetUniformLocation(m_pyramidProgram, "sourceLevel");
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &m_storageAlignment);
+
+    /* The first level is half the depth buffer, each next one half the previous one (rounded down) down to 1x1 */
+    m_width = _width;
+    m_height = _height;
+    m_pyramidWidth = (_width > 1) ? _width / 2 : 1;
+    m_pyramidHeight = (_height > 1) ? _height / 2 : 1;
+    m_pyramidLevels = 1;
+    for (int size = (m_pyramidWidth > m_pyramidHeight) ? m_pyramidWidth : m_pyramidHeight; size > 1; size /= 2)
+        m_pyramidLevels++;
+
+    glGenTextures(1, &m_depthTexture);
+    _glState.BindTexture(0, GL_TEXTURE_2D, m_depthTexture);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT24, m_width, m_height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    glGenTextures(1, &m_pyramidTexture);
+    _glState.BindTexture(0, GL_TEXTURE_2D, m_pyramidTexture);
+    glTexStorage2D(GL_TEXTURE_2D, m_pyramidLevels, GL_R32F, m_pyramidWidth, m_pyramidHeight);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    _glState.BindTexture(0, GL_TEXTURE_2D, 0);
+
+    glGenBuffers(1, &m_instanceBuffer);
+    glGenBuffers(1, &m_visibleBuffer);
+    glGenBuffers(1, &m_commandBuffer);
+    m_hasPyramid = false;
+    return true;
+}
+
+void GpuCulling::Resize(size_t _instanceCount, size_t _meshCount)
+{
+    m_instanceCount = _instanceCount;
+    m_meshCount = _meshCount;
+
+    /* The visible rotations follow the visible attributes, where a storage block may start */
+    size_t instanceBytes = ((_instanceCount > 0) ? _instanceCount : 1) * sizeof(InstanceData);
+    m_visibleRotationOffset = (GLintptr)((instanceBytes + m_storageAlignment - 1) / m_storageAlignment * m_storageAlignment);
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_instanceBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, instanceBytes, NULL, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_visibleBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, m_visibleRotationOffset + instanceBytes / sizeof(InstanceData) * 4 * sizeof(GLfloat), NULL, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_commandBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, ((_meshCount > 0) ? _meshCount : 1) * sizeof(DrawElementsIndirectCommand), NULL, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void GpuCulling::UploadInstances(const InstanceData* _instances, size_t _count)
+{
+    PROFILE_ZONE("GpuCulling::UploadInstances");
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_instanceBuffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, 0, ((_count < m_instanceCount) ? _count : m_instanceCount) * sizeof(InstanceData), _instances);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void GpuCulling::Cull(RenderStateCache& _glState, const Mat4& _view, const Mat4& _projection, const float* _meshRadii,
+    GLuint _rotationBuffer, GLintptr _rotationOffset, GLuint _commandBuffer, GLintptr _commandOffset)
+{
+    PROFILE_ZONE("GpuCulling::Cull");
+
+    if (m_instanceCount == 0 || m_meshCount == 0)
+        return;
+
+    /* The commands start with no instance, the pass counts them */
+    GLsizeiptr commandBytes = (GLsizeiptr)(m_meshCount * sizeof(DrawElementsIndirectCommand));
+    glBindBuffer(GL_COPY_READ_BUFFER, _commandBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_commandBuffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, _commandOffset, 0, commandBytes);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    /* The pyramid holds what the previous frame drew, from where it was seen: only a still camera can use it */
+    m_viewProjection = Mat4Multiply(_projection, _view);
+    Frustum frustum = FrustumFromMatrix(m_viewProjection);
+    bool occlusion = m_hasPyramid && memcmp(m_viewProjection.m, m_pyramidViewProjection.m, sizeof(m_viewProjection.m)) == 0;
+    m_occlusionFrames += occlusion ? 1 : 0;
+
+    _glState.UseProgram(m_cullProgram);
+    _glState.Uniform1ui(m_instanceCountLocation, (GLuint)m_instanceCount);
+    _glState.Uniform4fv(m_frustumPlanesLocation, 6, &frustum.planes[0].x);
+    _glState.Uniform1fv(m_meshRadiiLocation, (GLsizei)m_meshCount, _meshRadii);
+    _glState.Uniform2i(m_depthSizeLocation, occlusion ? m_width : 0, occlusion ? m_height : 0);
+    _glState.BindTexture(0, GL_TEXTURE_2D, m_pyramidTexture);
+
+    GLsizeiptr instanceBytes = (GLsizeiptr)(m_instanceCount * sizeof(InstanceData));
+    GLsizeiptr rotationBytes = (GLsizeiptr)(m_instanceCount * 4 * sizeof(GLfloat));
+    _glState.BindBufferRange(GL_SHADER_STORAGE_BUFFER, kInstancesBinding, m_instanceBuffer, 0, instanceBytes);
+    _glState.BindBufferRange(GL_SHADER_STORAGE_BUFFER, kRotationsBinding, _rotationBuffer, _rotationOffset, rotationBytes);
+    _glState.BindBufferRange(GL_SHADER_STORAGE_BUFFER, kVisibleInstancesBinding, m_visibleBuffer, 0, instanceBytes);
+    _glState.BindBufferRange(GL_SHADER_STORAGE_BUFFER, kVisibleRotationsBinding, m_visibleBuffer, m_visibleRotationOffset, rotationBytes);
+    _glState.BindBufferRange(GL_SHADER_STORAGE_BUFFER, kDrawCommandsBinding, m_commandBuffer, 0, commandBytes);
+
+    glDispatchCompute((GLuint)((m_instanceCount + s_cullGroupSize - 1) / s_cullGroupSize), 1, 1);
+
+    /* The draw reads the commands and the attributes the pass wrote; the next frame's reset copy and
+       ReadVisibleCount's readback touch the commands through buffer updates */
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+}
+
+void GpuCulling::BuildDepthPyramid(RenderStateCache& _glState)
+{
+    PROFILE_ZONE("GpuCulling::BuildDepthPyramid");
+
+    if (m_pyramidTexture == 0)
+        return;
+
+    /* The depth of the frame just drawn, the first level is built from it */
+    _glState.BindTexture(0, GL_TEXTURE_2D, m_depthTexture);
+    glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, m_width, m_height);
+
+    _glState.UseProgram(m_pyramidProgram);
+    for (int level = 0; level < m_pyramidLevels; level++)
+    {
+        int width = (m_pyramidWidth >> level > 0) ? m_pyramidWidth >> level : 1;
+        int height = (m_pyramidHeight >> level > 0) ? m_pyramidHeight >> level : 1;
+
+        _glState.BindTexture(0, GL_TEXTURE_2D, (level == 0) ? m_depthTexture : m_pyramidTexture);
+        _glState.Uniform1i(m_sourceLevelLocation, (level == 0) ? 0 : level - 1);
+        glBindImageTexture(0, m_pyramidTexture, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+        glDispatchCompute((width + s_pyramidGroupSize - 1) / s_pyramidGroupSize, (height + s_pyramidGroupSize - 1) / s_pyramidGroupSize, 1);
+
+        /* The next level samples this one, and the last one the next frame's culling */
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+    }
+
+    m_pyramidViewProjection = m_viewProjection;
+    m_hasPyramid = true;
+}
+
+size_t GpuCulling::ReadVisibleCount()
+{
+    if (m_commandBuffer == 0 || m_meshCount == 0)
+        return 0;
+
+    std::vector<DrawElementsIndirectCommand> commands(m_meshCount);
+    glBindBuffer(GL_COPY_READ_BUFFER, m_commandBuffer);
+    glGetBufferSubData(GL_COPY_READ_BUFFER, 0, commands.size() * sizeof(DrawElementsIndirectCommand), commands.data());
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+    size_t count = 0;
+    for (const DrawElementsIndirectCommand& command : commands)
+        count += command.instanceCount;
+    return count;
+}
+
+void GpuCulling::Shutdown(RenderStateCache& _glState)
+{
+    if (m_depthTexture != 0)
+        glDeleteTextures(1, &m_depthTexture);
+    if (m_pyramidTexture != 0)
+        glDeleteTextures(1, &m_pyramidTexture);
+    if (m_instanceBuffer != 0)
+        _glState.DeleteBuffers(1, &m_instanceBuffer);
+    if (m_visibleBuffer != 0)
+        _glState.DeleteBuffers(1, &m_visibleBuffer);
+    if (m_commandBuffer != 0)
+        _glState.DeleteBuffers(1, &m_commandBuffer);
+
+    m_depthTexture = 0;
+    m_pyramidTexture = 0;
+    m_instanceBuffer = 0;
+    m_visibleBuffer = 0;
+    m_commandBuffer = 0;
+    m_instanceCount = 0;
+    m_meshCount = 0;
+    m_hasPyramid = false;
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <cstddef>
+
+#include <GL/glew.h>
+
+#include "FrustumCulling.h"
+#include "RenderStateCache.h"
+#include "SceneInstances.h"
+#include "VectorMath.h"
+
+/// <summary>
+/// GPU-driven culling (--culling gpu, needs GL 4.3). Every instance is on the GPU, its attributes uploaded only
+/// when they change: a compute pass tests the bounding spheres against the frustum and against a depth pyramid
+/// (hierarchical Z) of the previous frame, and writes the visible ones, compacted per mesh, with the instance
+/// counts of the indirect draw commands. The CPU cost doesn't depend on how many instances are visible, it never
+/// reads the result back.
+/// The pyramid is built by compute passes after the scene is drawn: the depth buffer copied to a texture, then
+/// each level the farthest depth of the level below (see Shaders/depthpyramid.glsl). It is only used by the next
+/// frame if the camera didn't move, instances showing up from behind an occluder that moved are drawn one frame late
+/// </summary>
+class GpuCulling
+{
+public:
+    /// <summary>
+    /// Whether the context can run it: compute shaders and multi-draw indirect
+    /// </summary>
+    /// <returns></returns>
+    static bool IsSupported();
+
+    /// <summary>
+    /// Create the depth pyramid for a _width x _height depth buffer, with the programs culling the instances
+    /// (Shaders/cullinstances.glsl) and building the pyramid (Shaders/depthpyramid.glsl)
+    /// </summary>
+    /// <param name="_glState"></param>
+    /// <param name="_width"></param>
+    /// <param name="_height"></param>
+    /// <param name="_cullProgram"></param>
+    /// <param name="_pyramidProgram"></param>
+    /// <returns></returns>
+    bool Initialize(RenderStateCache& _glState, int _width, int _height, GLuint _cullProgram, GLuint _pyramidProgram);
+
+    /// <summary>
+    /// Size the instance buffers for _instanceCount instances and _meshCount draw commands. Their attributes
+    /// must be uploaded again
+    /// </summary>
+    /// <param name="_instanceCount"></param>
+    /// <param name="_meshCount"></param>
+    void Resize(size_t _instanceCount, size_t _meshCount);
+
+    /// <summary>
+    /// Replace the attributes of every instance, grouped by mesh (InstanceData::mesh is the draw command)
+    /// </summary>
+    /// <param name="_instances"></param>
+    /// <param name="_count"></param>
+    void UploadInstances(const InstanceData* _instances, size_t _count);
+
+    /// <summary>
+    /// Cull the instances seen by _view and _projection (also in the Camera block) into the visible buffer and the
+    /// command buffer. Their rotations are 4 floats each at _rotationOffset in _rotationBuffer, the draw commands
+    /// (one per mesh, no instances) at _commandOffset in _commandBuffer
+    /// </summary>
+    /// <param name="_glState"></param>
+    /// <param name="_view"></param>
+    /// <param name="_projection"></param>
+    /// <param name="_meshRadii"></param>
+    /// <param name="_rotationBuffer"></param>
+    /// <param name="_rotationOffset"></param>
+    /// <param name="_commandBuffer"></param>
+    /// <param name="_commandOffset"></param>
+    void Cull(RenderStateCache& _glState, const Mat4& _view, const Mat4& _projection, const float* _meshRadii,
+        GLuint _rotationBuffer, GLintptr _rotationOffset, GLuint _commandBuffer, GLintptr _commandOffset);
+
+    /// <summary>
+    /// Build the depth pyramid from the depth buffer of the read framebuffer, for the next frame's Cull
+    /// </summary>
+    /// <param name="_glState"></param>
+    void BuildDepthPyramid(RenderStateCache& _glState);
+
+    /// <summary>
+    /// Release the textures and buffers. The buffers are deleted through _glState, which has them bound
+    /// </summary>
+    /// <param name="_glState"></param>
+    void Shutdown(RenderStateCache& _glState);
+
+    /// <summary>
+    /// The visible instances: the InstanceData of each, then from GetVisibleRotationOffset its rotation
+    /// </summary>
+    GLuint GetVisibleBuffer() const { return m_visibleBuffer; }
+    GLintptr GetVisibleRotationOffset() const { return m_visibleRotationOffset; }
+    GLuint GetCommandBuffer() const { return m_commandBuffer; }
+
+    int GetPyramidWidth() const { return m_pyramidWidth; }
+    int GetPyramidHeight() const { return m_pyramidHeight; }
+    int GetPyramidLevels() const { return m_pyramidLevels; }
+
+    /// <summary>
+    /// Frames whose culling used the depth pyramid, the others only tested the frustum
+    /// </summary>
+    /// <returns></returns>
+    unsigned int GetOcclusionFrames() const { return m_occlusionFrames; }
+
+    /// <summary>
+    /// Instances the last Cull kept, read back from the command buffer (waits for the GPU: for the report only)
+    /// </summary>
+    /// <returns></returns>
+    size_t ReadVisibleCount();
+
+private:
+    GLuint m_cullProgram = 0;
+    GLuint m_pyramidProgram = 0;
+    GLint m_instanceCountLocation = -1;
+    GLint m_frustumPlanesLocation = -1;
+    GLint m_meshRadiiLocation = -1;
+    GLint m_depthSizeLocation = -1;
+    GLint m_sourceLevelLocation = -1;
+
+    GLuint m_depthTexture = 0;
+    GLuint m_pyramidTexture = 0;
+    int m_width = 0;
+    int m_height = 0;
+    int m_pyramidWidth = 0;
+    int m_pyramidHeight = 0;
+    int m_pyramidLevels = 0;
+
+    /// <summary>
+    /// The camera the pyramid was built with: it is only valid for the same one
+    /// </summary>
+    Mat4 m_pyramidViewProjection = Mat4Identity();
+    bool m_hasPyramid = false;
+    Mat4 m_viewProjection = Mat4Identity();
+
+    GLuint m_instanceBuffer = 0;
+    GLuint m_visibleBuffer = 0;
+    GLuint m_commandBuffer = 0;
+    GLintptr m_visibleRotationOffset = 0;
+    GLint m_storageAlignment = 256;
+    size_t m_instanceCount = 0;
+    size_t m_meshCount = 0;
+    unsigned int m_occlusionFrames = 0;
+};
@@ -0,0 +1,137 @@
+#include "GpuTimer.h"
+
+#include "FrameStats.h"
+
+bool GpuTimer::Initialize(FrameStats& _stats)
+{
+    m_stats = &_stats;
+    m_enabled = (GLEW_VERSION_3_3 || GLEW_ARB_timer_query) ? true : false;
+    return m_enabled;
+}
+
+int GpuTimer::AddPass(const std::string& _name)
+{
+    m_passNames.push_back(_name);
+    m_passStages.push_back(m_enabled ? m_stats->AddStage("GPU " + _name) : -1);
+    return (int)m_passNames.size() - 1;
+}
+
+void GpuTimer::BeginFrame()
+{
+    if (!m_enabled || m_passNames.empty())
+        return;
+
+    if (m_queries.empty())
+    {
+        m_queries.resize(kFrameLatency * m_passNames.size() * 2);
+        glGenQueries((GLsizei)m_queries.size(), m_queries.data());
+        m_frameStage = m_stats->AddStage("GPU Frame");
+    }
+
+    Slot& slot = m_slots[m_currentSlot];
+
+    if (slot.pending)
+    {
+        /* Only the last query written needs checking: timestamps complete in order */
+        GLint available = 0;
+        for (int pass = (int)m_passNames.size() - 1; pass >= 0; pass--)
+        {
+            if (slot.passIssued[pass])
+            {
+                glGetQueryObjectiv(m_queries[GetQueryIndex(m_currentSlot, pass) + 1], GL_QUERY_RESULT_AVAILABLE, &available);
+                break;
+            }
+        }
+
+        if (available)
+            ReadSlot(m_currentSlot);
+        else
+            m_droppedFrames++;
+    }
+
+    slot.pending = false;
+    slot.passIssued.assign(m_passNames.size(), false);
+}
+
+void GpuTimer::EndFrame()
+{
+    if (!m_enabled || m_passNames.empty())
+        return;
+
+    Slot& slot = m_slots[m_currentSlot];
+    for (bool issued : slot.passIssued)
+        slot.pending = slot.pending || issued;
+
+    m_currentSlot = (m_currentSlot + 1) % kFrameLatency;
+}
+
+void GpuTimer::BeginPass(int _pass)
+{
+    if (m_enabled)
+        glQueryCounter(m_queries[GetQueryIndex(m_currentSlot, _pass)], GL_TIMESTAMP);
+}
+
+void GpuTimer::EndPass(int _pass)
+{
+    if (m_enabled)
+    {
+        glQueryCounter(m_queries[GetQueryIndex(m_currentSlot, _pass) + 1], GL_TIMESTAMP);
+        m_slots[m_currentSlot].passIssued[_pass] = true;
+    }
+}
+
+void GpuTimer::ReadSlot(int _slot)
+{
+    Slot& slot = m_slots[_slot];
+    GLuint64 frameBegin = 0;
+    GLuint64 frameEnd = 0;
+    bool first = true;
+
+    for (int pass = 0; pass < (int)m_passNames.size(); pass++)
+    {
+        if (!slot.passIssued[pass])
+            continue;
+
+        size_t index = GetQueryIndex(_slot, pass);
+        GLuint64 begin = 0;
+        GLuint64 end = 0;
+        glGetQueryObjectui64v(m_queries[index], GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(m_queries[index + 1], GL_QUERY_RESULT, &end);
+
+        m_stats->Record(m_passStages[pass], (end > begin) ? (uint64_t)(end - begin) : 0);
+
+        frameBegin = (first || begin < frameBegin) ? begin : frameBegin;
+        frameEnd = (end > frameEnd) ? end : frameEnd;
+        first = false;
+    }
+
+    if (!first)
+        m_stats->Record(m_frameStage, (frameEnd > frameBegin) ? (uint64_t)(frameEnd - frameBegin) : 0);
+
+    slot.pending = false;
+}
+
+void GpuTimer::Flush()
+{
+    if (!m_enabled)
+        return;
+
+    /* Oldest first, reading GL_QUERY_RESULT waits for each one */
+    for (int i = 0; i < kFrameLatency; i++)
+    {
+        int slot = (m_currentSlot + i) % kFrameLatency;
+        if (m_slots[slot].pending)
+            ReadSlot(slot);
+    }
+}
+
+void GpuTimer::Shutdown()
+{
+    if (!m_queries.empty())
+    {
+        glDeleteQueries((GLsizei)m_queries.size(), m_queries.data());
+        m_queries.clear();
+    }
+
+    m_enabled = false;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+
+class FrameStats;
+
+/// <summary>
+/// GPU time of each render pass, measured with GL_TIMESTAMP queries (glQueryCounter).
+/// The queries of a frame live in a ring of kFrameLatency slots and are read back when the slot comes
+/// around again, by then the GPU is long done so reading them never stalls the pipeline.
+/// Results go to the FrameStats stages "GPU <pass>" and "GPU Frame"
+/// </summary>
+class GpuTimer
+{
+public:
+    static const int kFrameLatency = 5;
+
+    /// <summary>
+    /// Create the query ring. Returns false (and every other call becomes a no-op) if the context has no timer queries
+    /// </summary>
+    /// <param name="_stats"></param>
+    /// <returns></returns>
+    bool Initialize(FrameStats& _stats);
+
+    /// <summary>
+    /// Register a pass, before the first BeginFrame. Returns the id for BeginPass/EndPass
+    /// </summary>
+    /// <param name="_name"></param>
+    /// <returns></returns>
+    int AddPass(const std::string& _name);
+
+    void BeginFrame();
+    void EndFrame();
+    void BeginPass(int _pass);
+    void EndPass(int _pass);
+
+    /// <summary>
+    /// Wait for the frames still in flight and record them (call once, when the loop is over)
+    /// </summary>
+    void Flush();
+
+    void Shutdown();
+
+    bool IsEnabled() const { return m_enabled; }
+
+    /// <summary>
+    /// Frames whose queries were still pending when their slot had to be reused
+    /// </summary>
+    /// <returns></returns>
+    unsigned int GetDroppedFrames() const { return m_droppedFrames; }
+
+private:
+    struct Slot
+    {
+        bool pending = false;
+        std::vector<bool> passIssued;
+    };
+
+    /// <summary>
+    /// Index in m_queries of the begin timestamp of _pass in _slot, the end timestamp follows it
+    /// </summary>
+    size_t GetQueryIndex(int _slot, int _pass) const { return ((size_t)_slot * m_passNames.size() + (size_t)_pass) * 2; }
+
+    void ReadSlot(int _slot);
+
+    bool m_enabled = false;
+    FrameStats* m_stats = nullptr;
+    std::vector<std::string> m_passNames;
+    std::vector<int> m_passStages;
+    int m_frameStage = -1;
+
+    std::vector<GLuint> m_queries;
+    Slot m_slots[kFrameLatency];
+    int m_currentSlot = 0;
+    unsigned int m_droppedFrames = 0;
+};
@@ -0,0 +1,164 @@
+#include "HeadlessContext.h"
+#include "Profiler.h"
+
+#include <iostream>
+
+#include <GLFW/glfw3.h>
+
+#ifdef MYOPENGL_HAS_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+/// <summary>
+/// Core profile versions we try, newest first
+/// </summary>
+static const int s_contextVersions[][2] = { { 4, 6 }, { 4, 5 }, { 4, 3 }, { 4, 1 }, { 3, 3 } };
+
+bool HeadlessContext::Create(int _width, int _height)
+{
+    PROFILE_ZONE("HeadlessContext::Create");
+
+    m_width = _width;
+    m_height = _height;
+
+#ifdef MYOPENGL_HAS_EGL
+    /* Prefer the surfaceless platform: it needs neither X11 nor a GPU */
+    EGLDisplay display = EGL_NO_DISPLAY;
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+
+    if (getPlatformDisplay != NULL)
+        display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    if (display == EGL_NO_DISPLAY)
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL))
+    {
+        std::cout << "Error: unable to initialize an EGL display" << std::endl;
+        return false;
+    }
+
+    if (!eglBindAPI(EGL_OPENGL_API))
+    {
+        std::cout << "Error: EGL display has no desktop OpenGL support" << std::endl;
+        eglTerminate(display);
+        return false;
+    }
+
+    EGLContext context = EGL_NO_CONTEXT;
+    for (const int* version : s_contextVersions)
+    {
+        const EGLint attributes[] =
+        {
+            EGL_CONTEXT_MAJOR_VERSION, version[0],
+            EGL_CONTEXT_MINOR_VERSION, version[1],
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_NONE
+        };
+
+        /* We never draw to an EGL surface, so no config is needed (EGL_KHR_no_config_context) */
+        context = eglCreateContext(display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, attributes);
+        if (context != EGL_NO_CONTEXT)
+            break;
+    }
+
+    if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+    {
+        std::cout << "Error: unable to create a surfaceless EGL context" << std::endl;
+        if (context != EGL_NO_CONTEXT)
+            eglDestroyContext(display, context);
+        eglTerminate(display);
+        return false;
+    }
+
+    m_display = display;
+    m_context = context;
+#else
+    /* No EGL: borrow GLFW and keep its window hidden, we only render to our own FBO */
+    if (!glfwInit())
+        return false;
+
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GLFW_TRUE);
+
+    for (const int* version : s_contextVersions)
+    {
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, version[0]);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, version[1]);
+        m_hiddenWindow = glfwCreateWindow(_width, _height, "Headless", NULL, NULL);
+        if (m_hiddenWindow != NULL)
+            break;
+    }
+
+    glfwDefaultWindowHints();
+
+    if (m_hiddenWindow == NULL)
+    {
+        std::cout << "Error: unable to create a hidden window for the headless context" << std::endl;
+        return false;
+    }
+
+    glfwMakeContextCurrent(m_hiddenWindow);
+#endif
+
+    return true;
+}
+
+bool HeadlessContext::CreateFramebuffer()
+{
+    PROFILE_ZONE("HeadlessContext::CreateFramebuffer");
+
+    glGenRenderbuffers(1, &m_colorRenderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_colorRenderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, m_width, m_height);
+
+    glGenRenderbuffers(1, &m_depthRenderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_depthRenderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, m_width, m_height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &m_framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_colorRenderbuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depthRenderbuffer);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cout << "Error: offscreen framebuffer is incomplete" << std::endl;
+        return false;
+    }
+
+    /* It stays bound for the whole run, so every draw goes offscreen */
+    glViewport(0, 0, m_width, m_height);
+    return true;
+}
+
+void HeadlessContext::Destroy()
+{
+    if (m_framebuffer != 0)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteFramebuffers(1, &m_framebuffer);
+        glDeleteRenderbuffers(1, &m_colorRenderbuffer);
+        glDeleteRenderbuffers(1, &m_depthRenderbuffer);
+        m_framebuffer = m_colorRenderbuffer = m_depthRenderbuffer = 0;
+    }
+
+#ifdef MYOPENGL_HAS_EGL
+    if (m_display != nullptr)
+    {
+        eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext(m_display, m_context);
+        eglTerminate(m_display);
+        m_display = m_context = nullptr;
+    }
+#else
+    if (m_hiddenWindow != NULL)
+    {
+        glfwDestroyWindow(m_hiddenWindow);
+        m_hiddenWindow = nullptr;
+    }
+#endif
+}
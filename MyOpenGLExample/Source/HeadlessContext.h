@@ -0,0 +1,59 @@
+#pragma once
+
+#include <GL/glew.h>
+
+struct GLFWwindow;
+
+/// <summary>
+/// Offscreen OpenGL context for running without a desktop session.
+/// With MYOPENGL_HAS_EGL it creates a surfaceless EGL context (works on Mesa llvmpipe with no display),
+/// otherwise it falls back to a hidden GLFW window. Either way the frames are rendered into an FBO.
+/// </summary>
+class HeadlessContext
+{
+public:
+    /// <summary>
+    /// Create the context and make it current. GLEW must be initialized after this call
+    /// </summary>
+    /// <param name="_width"></param>
+    /// <param name="_height"></param>
+    /// <returns></returns>
+    bool Create(int _width, int _height);
+
+    /// <summary>
+    /// Create and bind the offscreen framebuffer (color + depth). Needs GLEW to be initialized
+    /// </summary>
+    /// <returns></returns>
+    bool CreateFramebuffer();
+
+    /// <summary>
+    /// Free the framebuffer and the context
+    /// </summary>
+    void Destroy();
+
+    int GetWidth() const { return m_width; }
+    int GetHeight() const { return m_height; }
+
+    /// <summary>
+    /// Native handles, to create contexts sharing objects with this one (see WorkerContext)
+    /// </summary>
+    void* GetEGLDisplay() const { return m_display; }
+    void* GetEGLContext() const { return m_context; }
+    GLFWwindow* GetHiddenWindow() const { return m_hiddenWindow; }
+
+private:
+    int m_width = 0;
+    int m_height = 0;
+
+    //EGL handles (EGLDisplay, EGLContext), kept opaque so the EGL headers stay out of here
+    void* m_display = nullptr;
+    void* m_context = nullptr;
+
+    //Hidden window used when EGL is not available
+    GLFWwindow* m_hiddenWindow = nullptr;
+
+    //Offscreen render target
+    GLuint m_framebuffer = 0;
+    GLuint m_colorRenderbuffer = 0;
+    GLuint m_depthRenderbuffer = 0;
+};
@@ -0,0 +1,16 @@
+#include "MyApplication.h"
+
+/// <summary>
+/// Our main ;)))
+/// </summary>
+/// <param name="argc"></param>
+/// <param name="argv"></param>
+/// <returns></returns>
+int main(int argc, char** argv)
+{
+    ApplicationOptions options;
+    if (!ParseCommandLine(argc, argv, options))
+        return -1;
+
+    return RunApplication(options);
+}
@@ -0,0 +1,288 @@
+#include "MeshBatch.h"
+
+#include <cmath>
+
+/// <summary>
+/// Cube definition
+/// </summary>
+const GLfloat m_cubeVertices[] =
+{
+    -1.0f, -1.0f, 1.0f,
+    1.0f, -1.0f, 1.0f,
+    -1.0f, 1.0f, 1.0f,
+    1.0f, 1.0f, 1.0f,
+    -1.0f, -1.0f, -1.0f,
+    1.0f, -1.0f, -1.0f,
+    -1.0f, 1.0f, -1.0f,
+    1.0f, 1.0f, -1.0f,
+};
+
+const GLushort m_cubeStrips[] = { 7,6,3,2,1,0,5,4,0,2,4,6,5,7,1,3 };
+const GLuint m_numberOfCubeStrips = 8;
+
+/// <summary>
+/// Cube color per vertex
+/// </summary>
+const GLfloat m_cubeVertexColor[] =
+{
+    1.0f, 0.0f, 0.0f,
+    1.0f, 0.0f, 0.0f,
+    1.0f, 0.0f, 0.0f,
+    1.0f, 0.0f, 0.0f,
+    1.0f, 1.0f, 0.0f,
+    1.0f, 1.0f, 0.0f,
+    1.0f, 1.0f, 0.0f,
+    1.0f, 1.0f, 0.0f
+};
+
+/// <summary>
+/// Square pyramid: base corners then apex, one strip
+/// </summary>
+const GLfloat m_pyramidVertices[] =
+{
+    -1.0f, -1.0f, 1.0f,
+    1.0f, -1.0f, 1.0f,
+    -1.0f, -1.0f, -1.0f,
+    1.0f, -1.0f, -1.0f,
+    0.0f, 1.0f, 0.0f,
+};
+
+const GLfloat m_pyramidVertexColor[] =
+{
+    0.0f, 0.6f, 0.0f,
+    0.0f, 0.6f, 0.0f,
+    0.0f, 0.6f, 0.0f,
+    0.0f, 0.6f, 0.0f,
+    1.0f, 1.0f, 0.0f,
+};
+
+const GLushort m_pyramidStrip[] = { 1,2,3,4,1,0,2,4 };
+
+/// <summary>
+/// Octahedron: +X, -X, +Y, -Y, +Z, -Z, it needs three strips
+/// </summary>
+const GLfloat m_octahedronVertices[] =
+{
+    1.0f, 0.0f, 0.0f,
+    -1.0f, 0.0f, 0.0f,
+    0.0f, 1.0f, 0.0f,
+    0.0f, -1.0f, 0.0f,
+    0.0f, 0.0f, 1.0f,
+    0.0f, 0.0f, -1.0f,
+};
+
+const GLfloat m_octahedronVertexColor[] =
+{
+    0.2f, 0.4f, 1.0f,
+    0.2f, 0.4f, 1.0f,
+    1.0f, 1.0f, 1.0f,
+    0.0f, 0.0f, 0.5f,
+    0.2f, 0.4f, 1.0f,
+    0.2f, 0.4f, 1.0f,
+};
+
+const GLushort m_octahedronStrip0[] = { 0,2,4,1,3,5,0,2 };
+const GLushort m_octahedronStrip1[] = { 0,4,3 };
+const GLushort m_octahedronStrip2[] = { 1,2,5 };
+
+/// <summary>
+/// Tetrahedron on alternate cube corners, one strip
+/// </summary>
+const GLfloat m_tetrahedronVertices[] =
+{
+    1.0f, 1.0f, 1.0f,
+    1.0f, -1.0f, -1.0f,
+    -1.0f, 1.0f, -1.0f,
+    -1.0f, -1.0f, 1.0f,
+};
+
+const GLfloat m_tetrahedronVertexColor[] =
+{
+    1.0f, 0.5f, 0.0f,
+    0.6f, 0.0f, 0.6f,
+    0.6f, 0.0f, 0.6f,
+    0.6f, 0.0f, 0.6f,
+};
+
+const GLushort m_tetrahedronStrip[] = { 0,1,2,3,0,1 };
+
+/// <summary>
+/// Copy a C array into a vector
+/// </summary>
+template <typename T, size_t N>
+static std::vector<T> ToVector(const T (&_array)[N])
+{
+    return std::vector<T>(_array, _array + N);
+}
+
+/// <summary>
+/// Build a mesh from its arrays
+/// </summary>
+template <size_t V, size_t C>
+static MeshData MakeMesh(const char* _name, const GLfloat (&_vertices)[V], const GLfloat (&_colors)[C], const std::vector<std::vector<GLushort>>& _strips)
+{
+    MeshData mesh;
+    mesh.name = _name;
+    mesh.vertices = ToVector(_vertices);
+    mesh.colors = ToVector(_colors);
+    mesh.strips = _strips;
+    return mesh;
+}
+
+const std::vector<MeshData>& GetSceneMeshes()
+{
+    static const std::vector<MeshData> meshes =
+    {
+        MakeMesh("Cube", m_cubeVertices, m_cubeVertexColor,
+            { std::vector<GLushort>(m_cubeStrips, m_cubeStrips + m_numberOfCubeStrips),
+              std::vector<GLushort>(m_cubeStrips + m_numberOfCubeStrips, m_cubeStrips + 2 * m_numberOfCubeStrips) }),
+        MakeMesh("Pyramid", m_pyramidVertices, m_pyramidVertexColor, { ToVector(m_pyramidStrip) }),
+        MakeMesh("Octahedron", m_octahedronVertices, m_octahedronVertexColor,
+            { ToVector(m_octahedronStrip0), ToVector(m_octahedronStrip1), ToVector(m_octahedronStrip2) }),
+        MakeMesh("Tetrahedron", m_tetrahedronVertices, m_tetrahedronVertexColor, { ToVector(m_tetrahedronStrip) }),
+    };
+
+    return meshes;
+}
+
+/// <summary>
+/// Quantize the vertices of _mesh into _vertices, and return how to decode them. Each axis maps the
+/// mesh bounds to [-32767, 32767], so the quantization step is at most 1/65534 of the mesh size
+/// </summary>
+/// <param name="_mesh"></param>
+/// <param name="_vertices"></param>
+/// <returns></returns>
+static MeshQuantization PackMeshVertices(const MeshData& _mesh, std::vector<PackedVertex>& _vertices)
+{
+    MeshQuantization quantization = {};
+    size_t vertexCount = _mesh.vertices.size() / 3;
+
+    for (int axis = 0; axis < 3; axis++)
+    {
+        GLfloat minimum = _mesh.vertices[axis];
+        GLfloat maximum = _mesh.vertices[axis];
+        for (size_t v = 1; v < vertexCount; v++)
+        {
+            minimum = std::fmin(minimum, _mesh.vertices[v * 3 + axis]);
+            maximum = std::fmax(maximum, _mesh.vertices[v * 3 + axis]);
+        }
+
+        GLfloat halfExtent = (maximum - minimum) * 0.5f;
+        quantization.bias[axis] = (maximum + minimum) * 0.5f;
+        quantization.scale[axis] = ((halfExtent > 0.0f) ? halfExtent : 1.0f) / 32767.0f;
+    }
+
+    for (size_t v = 0; v < vertexCount; v++)
+    {
+        PackedVertex vertex = {};
+        for (int axis = 0; axis < 3; axis++)
+        {
+            GLfloat value = (_mesh.vertices[v * 3 + axis] - quantization.bias[axis]) / quantization.scale[axis];
+            vertex.position[axis] = (GLshort)std::lround(std::fmax(-32767.0f, std::fmin(32767.0f, value)));
+            vertex.color[axis] = (GLubyte)std::lround(_mesh.colors[v * 3 + axis] * 255.0f);
+        }
+        vertex.color[3] = 255;
+        _vertices.push_back(vertex);
+    }
+
+    return quantization;
+}
+
+/// <summary>
+/// Append every strip of _strips to _indices, separated by the restart index, so they draw as one
+/// </summary>
+/// <param name="_strips"></param>
+/// <param name="_indices"></param>
+/// <returns>The number of indices added</returns>
+static GLuint JoinStrips(const std::vector<std::vector<GLushort>>& _strips, std::vector<GLushort>& _indices)
+{
+    size_t first = _indices.size();
+
+    for (const std::vector<GLushort>& strip : _strips)
+    {
+        if (_indices.size() > first)
+            _indices.push_back(kStripRestartIndex);
+
+        _indices.insert(_indices.end(), strip.begin(), strip.end());
+    }
+
+    return (GLuint)(_indices.size() - first);
+}
+
+/// <summary>
+/// Radius of the sphere around the origin holding the vertices of a mesh, as the shader decodes them
+/// </summary>
+/// <param name="_vertices"></param>
+/// <param name="_quantization"></param>
+/// <returns></returns>
+static GLfloat GetBoundingRadius(const std::vector<PackedVertex>& _vertices, const MeshQuantization& _quantization)
+{
+    GLfloat radius = 0.0f;
+
+    for (const PackedVertex& vertex : _vertices)
+    {
+        GLfloat lengthSquared = 0.0f;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            GLfloat value = vertex.position[axis] * _quantization.scale[axis] + _quantization.bias[axis];
+            lengthSquared += value * value;
+        }
+        radius = std::fmax(radius, std::sqrt(lengthSquared));
+    }
+
+    return radius;
+}
+
+/// <summary>
+/// The vertices of a mesh as the shader decodes them, each position once
+/// </summary>
+/// <param name="_vertices"></param>
+/// <param name="_quantization"></param>
+/// <returns></returns>
+static std::vector<GLfloat> GetDistinctPositions(const std::vector<PackedVertex>& _vertices, const MeshQuantization& _quantization)
+{
+    std::vector<GLfloat> positions;
+
+    for (size_t v = 0; v < _vertices.size(); v++)
+    {
+        bool repeated = false;
+        for (size_t previous = 0; previous < v && !repeated; previous++)
+        {
+            repeated = _vertices[previous].position[0] == _vertices[v].position[0] && _vertices[previous].position[1] == _vertices[v].position[1]
+                && _vertices[previous].position[2] == _vertices[v].position[2];
+        }
+
+        for (int axis = 0; axis < 3 && !repeated; axis++)
+            positions.push_back(_vertices[v].position[axis] * _quantization.scale[axis] + _quantization.bias[axis]);
+    }
+
+    return positions;
+}
+
+void BuildMeshBatch(int _meshCount, MeshBatch& _batch)
+{
+    const std::vector<MeshData>& meshes = GetSceneMeshes();
+
+    _batch = MeshBatch();
+
+    for (size_t i = 0; i < (size_t)_meshCount && i < meshes.size() && i < (size_t)kMaxBatchMeshes; i++)
+    {
+        const MeshData& mesh = meshes[i];
+        GLint baseVertex = (GLint)_batch.vertices.size();
+
+        std::vector<PackedVertex> vertices;
+        _batch.quantization.push_back(PackMeshVertices(mesh, vertices));
+        _batch.boundingRadii.push_back(GetBoundingRadius(vertices, _batch.quantization.back()));
+        _batch.occluderPoints.push_back(GetDistinctPositions(vertices, _batch.quantization.back()));
+        _batch.vertices.insert(_batch.vertices.end(), vertices.begin(), vertices.end());
+
+        /* Indices stay local to the mesh, baseVertex moves them to its vertices (the restart test comes first) */
+        DrawElementsIndirectCommand command;
+        command.firstIndex = (GLuint)_batch.indices.size();
+        command.count = JoinStrips(mesh.strips, _batch.indices);
+        command.instanceCount = 0;
+        command.baseVertex = baseVertex;
+        command.baseInstance = 0;
+        _batch.commands.push_back(command);
+    }
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <vector>
+
+#include <GL/glew.h>
+
+/// <summary>
+/// Record of the draw-indirect buffer, as glMultiDrawElementsIndirect reads it
+/// </summary>
+struct DrawElementsIndirectCommand
+{
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+/// <summary>
+/// Most meshes a batch can hold, the size of the meshQuantization array in vshader.glsl
+/// </summary>
+const int kMaxBatchMeshes = 8;
+
+/// <summary>
+/// Index ending a strip and starting the next one in the same draw. It is the restart index of
+/// GL_PRIMITIVE_RESTART_FIXED_INDEX for GL_UNSIGNED_SHORT indices, so a mesh holds at most 65535 vertices
+/// </summary>
+const GLushort kStripRestartIndex = 0xFFFF;
+
+/// <summary>
+/// Interleaved GPU vertex, 12 bytes instead of the 24 of float position and color in two streams.
+/// The position is quantized to 16 bits over the bounding box of its mesh (see MeshQuantization) and
+/// read as plain integers; the color is RGBA8, read normalized. The two spare bytes keep the color
+/// 4-byte aligned and are where an octahedral-packed normal goes once meshes carry normals
+/// </summary>
+struct PackedVertex
+{
+    GLshort position[3];
+    GLshort padding;
+    GLubyte color[4];
+};
+
+/// <summary>
+/// Decoding of the PackedVertex positions of a mesh: position = quantized * scale + bias.
+/// Two vec4 of the meshQuantization uniform (w unused)
+/// </summary>
+struct MeshQuantization
+{
+    GLfloat scale[4];
+    GLfloat bias[4];
+};
+
+/// <summary>
+/// A mesh made of triangle strips, positions and colors per vertex
+/// </summary>
+struct MeshData
+{
+    const char* name;
+    std::vector<GLfloat> vertices;
+    std::vector<GLfloat> colors;
+    std::vector<std::vector<GLushort>> strips;
+};
+
+/// <summary>
+/// Every mesh the scene can use. Index 0 is the original cube
+/// </summary>
+/// <returns></returns>
+const std::vector<MeshData>& GetSceneMeshes();
+
+/// <summary>
+/// Several meshes packed into shared vertex / index arrays, plus one draw command per mesh: its strips joined
+/// with kStripRestartIndex (primitive restart must be enabled to draw them), baseVertex / firstIndex select the
+/// mesh. The instance range (instanceCount, baseInstance) is left to the renderer, which fills it every frame
+/// with what is visible. boundingRadii holds the radius of the sphere around each mesh's origin (its center of
+/// rotation) holding every decoded vertex, occluderPoints the distinct decoded vertices of each mesh (x, y, z): the
+/// scene meshes are convex, these are the corners of their hull, what occlusion culling draws them with
+/// </summary>
+struct MeshBatch
+{
+    std::vector<PackedVertex> vertices;
+    std::vector<MeshQuantization> quantization;
+    std::vector<GLushort> indices;
+    std::vector<DrawElementsIndirectCommand> commands;
+    std::vector<GLfloat> boundingRadii;
+    std::vector<std::vector<GLfloat>> occluderPoints;
+};
+
+/// <summary>
+/// Pack the first _meshCount scene meshes (at most kMaxBatchMeshes)
+/// </summary>
+/// <param name="_meshCount"></param>
+/// <param name="_batch"></param>
+void BuildMeshBatch(int _meshCount, MeshBatch& _batch);
@@ -1,100 +1,217 @@
 #include <iostream>
 #include <fstream>
 #include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 
+#include "MyApplication.h"
+#include "BoundingVolumeHierarchy.h"
+#include "HeadlessContext.h"
+#include "FrameStats.h"
+#include "FixedTimestep.h"
+#include "GpuCulling.h"
+#include "GpuTimer.h"
+#include "Profiler.h"
+#include "MeshBatch.h"
+#include "OcclusionBuffer.h"
+#include "SceneInstances.h"
+#include "EntityWorld.h"
+#include "SceneSystems.h"
+#include "StreamingRingBuffer.h"
+#include "UniformBlocks.h"
+#include "RenderStateCache.h"
+#include "ProgramBinaryCache.h"
+#include "ShaderCompiler.h"
+#include "ShaderPreprocessor.h"
+#include "ShaderVariantCache.h"
+#include "VectorMath.h"
+#include "WorkerPool.h"
+
 
 /// <summary>
-/// Cube definition
+/// Proyection Matrix
 /// </summary>
-const GLfloat m_cubeVertices[] = 
-{
-    -1.0f, -1.0f, 1.0f,
-    1.0f, -1.0f, 1.0f,
-    -1.0f, 1.0f, 1.0f,
-    1.0f, 1.0f, 1.0f,
-    -1.0f, -1.0f, -1.0f,
-    1.0f, -1.0f, -1.0f,
-    -1.0f, 1.0f, -1.0f,
-    1.0f, 1.0f, -1.0f,
-};
-
-const GLuint m_numberOfCubeVertices = 8;
-const GLushort m_cubeStrips[] = { 7,6,3,2,1,0,5,4,0,2,4,6,5,7,1,3 };
-const GLuint m_numberOfCubeStrips = 8;
+Mat4 m_proyectionMatrix = Mat4Identity();
 
 /// <summary>
-/// Cube color per vertex
+/// View matrix
 /// </summary>
-const GLfloat m_cubeVertexColor[] = 
-{
-    1.0f, 0.0f, 0.0f,
-    1.0f, 0.0f, 0.0f,
-    1.0f, 0.0f, 0.0f,
-    1.0f, 0.0f, 0.0f,
-    1.0f, 1.0f, 0.0f,
-    1.0f, 1.0f, 0.0f,
-    1.0f, 1.0f, 0.0f,
-    1.0f, 1.0f, 0.0f
-};
+Mat4 m_view = Mat4Translation({ 0.0f, 0.0f, -10.0f });
 
 /// <summary>
-/// Proyection Matrix
+/// The projection or the view changed since the Camera block was last uploaded
 /// </summary>
-GLfloat m_proyectionMatrix[] = 
-{ 
-    1.0f,0.0f,0.0f,0.0f,
-    0.0f,1.0f,0.0f,0.0f,
-    0.0f,0.0f,1.0f,0.0f,
-    0.0f,0.0f,0.0f,1.0f 
-};
+bool m_cameraDirty = true;
 
 /// <summary>
-/// View matrix
+/// Model rotation, as drawn this frame (interpolated between the last two simulation steps)
 /// </summary>
-GLfloat m_view[] =
-{ 
-    1.0f,0.0f,0.0f,0.0f,
-    0.0f,1.0f,0.0f,0.0f,
-    0.0f,0.0f,1.0f,0.0f,
-    0.0f,0.0f,-10.0f,1.0f 
-};
+Quat m_model = { 0.0f, 0.0f, 0.0f, 1.0f };
 
 /// <summary>
-/// Model vector
+/// Everything the simulation advances. It only changes in fixed steps; frames draw between the previous
+/// and the current step, so the motion is smooth and the same whatever the frame rate
 /// </summary>
-GLfloat m_model[] = { 1.0f,0.0f,0.0f,0.0f };
+struct SimulationState
+{
+    GLfloat angle;
+    Quat model;
+};
+
+SimulationState m_simPrevious = { 0.0f, { 0.0f, 0.0f, 0.0f, 1.0f } };
+SimulationState m_simCurrent = m_simPrevious;
+FixedTimestep m_simClock;
+
 /// <summary>
-/// Current angle
+/// Model rotation speed, radians per simulated second (0.003 per step at 60 Hz)
 /// </summary>
-GLfloat m_angle = 0.0f;
+static const float s_modelAngularSpeed = 0.18f;
 
 //Shaders
-GLuint m_vertexShaderID = 0;
-GLuint m_fragmentShaderID = 0;
 GLuint m_programID = 0;
+GLuint m_cullProgramID = 0;
+GLuint m_depthPyramidProgramID = 0;
+ProgramBinaryCache m_programCache;
+ShaderSourceCache m_shaderSources;
+ShaderPreprocessor m_shaderPreprocessor(m_shaderSources);
+ShaderVariantCache m_shaderVariants;
+
+/// <summary>
+/// Vertex attributes of the program, by location
+/// </summary>
+static const char* const s_attributeLocations[] =
+{
+    "inVertex", "inColor", "inInstanceRotation", "inInstancePosition", "inInstanceColor", "inInstanceMesh"
+};
 
-//Variables Uniform
-GLint m_uniformTransparencyID = -1;
-GLint m_uniformProyectionID = -1;
-GLint m_uniformViewID = -1;
-GLint m_uniformModelID = -1;
+//Uniform blocks: where this frame's Frame block is in the stream buffer
+GLintptr m_frameBlockOffset = 0;
+GLint m_uniformBufferAlignment = 256;
+GLint m_storageBufferAlignment = 256;
 
 //Attributes
 GLint m_inColorID = -1;
 GLint m_inVertexID = -1;
+GLint m_inInstanceRotationID = -1;
+GLint m_inInstancePositionID = -1;
+GLint m_inInstanceColorID = -1;
+GLint m_inInstanceMeshID = -1;
+
+//Bindings and state go through the cache, which drops redundant calls
+RenderStateCache m_glState;
 
 //Vertex Array Object
 GLuint m_vao;
 
 //Vertex Buffer Object
-GLuint m_vbo[3];
+GLuint m_vbo[4];
 
 #define vbuffer m_vbo[0]
-#define cbuffer m_vbo[1]
-#define pbuffer m_vbo[2]
+#define pbuffer m_vbo[1]
+#define camerabuffer m_vbo[2]
+#define scenebuffer m_vbo[3]
+
+/// <summary>
+/// One draw command per batch mesh (no instances), and this frame's: the meshes with visible instances, also kept
+/// on the CPU for drivers without multi-draw indirect
+/// </summary>
+std::vector<DrawElementsIndirectCommand> m_meshCommands;
+std::vector<DrawElementsIndirectCommand> m_drawCommands;
+std::vector<GLfloat> m_meshRadii;
+bool m_useMultiDrawIndirect = false;
+
+/// <summary>
+/// Scene entities, and the chunks the frame systems walk: queried again when the entities change
+/// </summary>
+EntityWorld m_scene;
+std::vector<ChunkView> m_renderChunks;
+std::vector<ChunkView> m_animatedChunks;
+uint64_t m_sceneVersion = 0;
+size_t m_renderInstanceCount = 0;
+int m_sceneMeshCount = 1;
+
+/// <summary>
+/// Render extraction, every frame: culling, then the visible instances (attributes, interpolated rotations) and the
+/// draw commands written to the stream buffer, compacted. The frame systems split their chunks across m_workers
+/// </summary>
+CullingMode m_cullingMode = kCullingFrustum;
+ChunkVisibility m_visibility;
+WorkerPool m_workers;
+StreamingRingBuffer m_streamBuffer;
+GLuint m_instanceBuffer = 0;
+GLintptr m_instanceDataOffset = 0;
+GLintptr m_instanceRotationOffset = 0;
+GLuint m_drawCommandBuffer = 0;
+GLintptr m_drawCommandOffset = 0;
+uint64_t m_visibleInstanceTotal = 0;
+uint64_t m_extractedFrames = 0;
+
+/// <summary>
+/// Bounding volume hierarchy of the render instances (in query order), for --culling bvh and picking: built when
+/// the entities change, refitted when their positions do, rebuilt when refitting has made it too costly
+/// </summary>
+BoundingVolumeHierarchy m_sceneBvh;
+std::vector<Aabb> m_sceneBounds;
+std::vector<uint32_t> m_bvhObjects;
+std::vector<uint8_t> m_visibleFlags;
+uint64_t m_bvhPositionVersion = 0;
+uint64_t m_bvhBuilds = 0;
+uint64_t m_bvhRefits = 0;
+bool m_wasMousePressed = false;
+
+/// <summary>
+/// Occlusion culling (--culling occlusion), after the frustum: the largest instances in view drawn into a coarse
+/// depth buffer of half the framebuffer size, then every instance in view tested against it
+/// </summary>
+OcclusionBuffer m_occlusionBuffer;
+std::vector<std::vector<Vec3>> m_meshOccluderPoints;
+std::vector<OccluderCandidate> m_occluderCandidates;
+uint64_t m_occluderTotal = 0;
+uint64_t m_inFrustumTotal = 0;
+
+/// <summary>
+/// Most occluders per frame, and the smallest one (bounding radius, in occlusion buffer pixels): past a few hundred,
+/// or below a couple of pixels, an occluder costs more to draw than it hides
+/// </summary>
+static const size_t s_maxOccluders = 512;
+static const float s_minOccluderPixels = 2.0f;
+
+/// <summary>
+/// Chunks per range of work handed to a thread: a few hundred entities each way is too fine to pay for the handoff
+/// </summary>
+static const size_t s_chunksPerTask = 4;
+
+/// <summary>
+/// Occlusion buffer tiles per range of work handed to a thread
+/// </summary>
+static const size_t s_tilesPerTask = 4;
+
+/// <summary>
+/// GPU culling (--culling gpu): the attributes of every instance, uploaded again when the positions or the colors
+/// change, and this frame's rotations of every instance and draw commands (one per mesh, no instances) in the stream
+/// buffer. The compute pass writes the visible instances and the commands drawn
+/// </summary>
+GpuCulling m_gpuCulling;
+std::vector<InstanceData> m_gpuInstances;
+bool m_gpuInstancesDirty = true;
+uint64_t m_gpuPositionVersion = 0;
+uint64_t m_gpuColorVersion = 0;
+GLintptr m_gpuRotationOffset = 0;
+GLintptr m_gpuCommandOffset = 0;
+
+//GPU timing of the render passes
+GpuTimer m_gpuTimer;
+int m_gpuPassClear = -1;
+int m_gpuPassScene = -1;
+int m_gpuPassCull = -1;
+int m_gpuPassDepthPyramid = -1;
 
 void DebugLog(const char* _log)
 {
@@ -120,13 +237,22 @@ int InitLibraries()
 }
 
 /// <summary>
-/// Initialize Extensions: GLEW library!
+/// Initialize Extensions: GLEW library! With _headless the context is EGL's, which a GLEW built for GLX (as the
+/// distributions ship it) loads the GL entry points for but then fails its GLX part for
 /// </summary>
+/// <param name="_headless"></param>
 /// <returns></returns>
-int InitGLEW()
+int InitGLEW(bool _headless)
 {
+    PROFILE_ZONE("InitGLEW");
+
     glewExperimental = GL_TRUE;
     GLenum err = glewInit();
+
+    /* glewInit only gets to the GLX display once the GL part (glewContextInit) succeeded, no GLX is used headless */
+    if (_headless && err == GLEW_ERROR_NO_GLX_DISPLAY)
+        err = GLEW_OK;
+
     if (GLEW_OK != err)
     {
         printf("Error: %s\n", glewGetErrorString(err));
@@ -146,6 +272,8 @@ int InitGLEW()
 
 GLFWwindow * InitWindowContext(const char * _title, int _width, int _height)
 {
+    PROFILE_ZONE("InitWindowContext");
+
     /* Create a windowed mode window and its OpenGL context */
     GLFWwindow * _window = glfwCreateWindow(_width, _height, _title, NULL, NULL);
     if (!_window)
@@ -168,14 +296,8 @@ GLFWwindow * InitWindowContext(const char * _title, int _width, int _height)
 /// <param name="farPlane"></param>
 void BuildProjectionMatrix(float fov, float ratio, float nearPlane, float farPlane)
 {
-    float f = 1.0f / tan(fov * (3.141599f / 360.0f));
-
-    m_proyectionMatrix[0] = f / ratio;
-    m_proyectionMatrix[1 * 4 + 1] = f;
-    m_proyectionMatrix[2 * 4 + 2] = (farPlane + nearPlane) / (nearPlane - farPlane);
-    m_proyectionMatrix[3 * 4 + 2] = (2.0f * farPlane * nearPlane) / (nearPlane - farPlane);
-    m_proyectionMatrix[2 * 4 + 3] = -1.0f;
-    m_proyectionMatrix[3 * 4 + 3] = 0.0f;
+    m_proyectionMatrix = Mat4Perspective(fov * (3.141599f / 180.0f), ratio, nearPlane, farPlane);
+    m_cameraDirty = true;
 }
 
 /// <summary>
@@ -191,16 +313,307 @@ void WindowRescaling(GLFWwindow* _window, GLsizei w, GLsizei h)
 }
 
 /// <summary>
-/// Let's add some rotation to our model
+/// Let's add some rotation to our model: one fixed simulation step of _dt seconds
 /// </summary>
-/// <param name="_window"></param>
-void IdleMovement()
+/// <param name="_dt"></param>
+void SimulationStep(float _dt)
+{
+    m_simPrevious = m_simCurrent;
+
+    m_simCurrent.angle += s_modelAngularSpeed * _dt;
+    if (m_simCurrent.angle >= 3.141599f * 2.0f)
+        m_simCurrent.angle -= 3.141599f * 2.0f;
+
+    m_simCurrent.model = QuatFromAxisAngle({ 1.0f / sqrt(2.0f), 1.0f / sqrt(2.0f), 0.0f }, m_simCurrent.angle);
+
+    m_workers.ParallelFor(m_animatedChunks.size(), s_chunksPerTask,
+        [_dt](size_t _first, size_t _last) { AnimateRotations(m_animatedChunks, _first, _last, _dt); });
+}
+
+/// <summary>
+/// Per-frame update: what is drawn is the simulation state _alpha (0..1) of the way from the previous step to the current one
+/// </summary>
+/// <param name="_alpha"></param>
+void IdleMovement(float _alpha)
+{
+    PROFILE_ZONE("IdleMovement");
+
+    m_model = QuatNlerp(m_simPrevious.model, m_simCurrent.model, _alpha);
+}
+
+/// <summary>
+/// Bring m_sceneBvh up to date with the render instances: nothing to do while their positions don't change
+/// </summary>
+void UpdateSceneBvh()
+{
+    uint64_t positionVersion = m_scene.GetComponentVersion(kComponentPosition);
+    bool build = m_sceneBvh.GetObjectCount() != m_renderInstanceCount;
+    if (!build && positionVersion == m_bvhPositionVersion)
+        return;
+
+    PROFILE_ZONE("UpdateSceneBvh");
+
+    m_sceneBounds.resize(m_renderInstanceCount);
+    m_workers.ParallelFor(m_renderChunks.size(), s_chunksPerTask,
+        [](size_t _first, size_t _last) { ComputeBounds(m_renderChunks, _first, _last, m_meshRadii.data(), m_sceneBounds.data()); });
+
+    if (!build)
+    {
+        m_sceneBvh.Refit(m_sceneBounds.data());
+        m_bvhRefits++;
+        build = m_sceneBvh.NeedsRebuild();
+    }
+
+    if (build)
+    {
+        m_sceneBvh.Build(m_sceneBounds.data(), m_sceneBounds.size());
+        m_bvhBuilds++;
+    }
+    m_bvhPositionVersion = positionVersion;
+}
+
+/// <summary>
+/// Occlusion culling of the instances the frustum left in m_visibility: the largest of them (their mesh placed as
+/// drawn _alpha of the way between the last two simulation steps) are drawn into m_occlusionBuffer, its tiles
+/// split across the worker threads, then the chunks drop the instances it hides
+/// </summary>
+/// <param name="_alpha"></param>
+void OccludeInstances(float _alpha)
+{
+    PROFILE_ZONE("OccludeInstances");
+
+    for (uint32_t count : m_visibility.counts)
+        m_inFrustumTotal += count;
+
+    /* Radius over depth of an occluder of s_minOccluderPixels: the buffer's half height is m[5] of it */
+    float minSize = s_minOccluderPixels / (m_proyectionMatrix.m[5] * 0.5f * (float)m_occlusionBuffer.GetHeight());
+    m_occluderCandidates.clear();
+    FindOccluders(m_renderChunks, 0, m_renderChunks.size(), m_visibility, m_view, m_meshRadii.data(), minSize, m_occluderCandidates);
+
+    size_t occluderCount = std::min(m_occluderCandidates.size(), s_maxOccluders);
+    std::nth_element(m_occluderCandidates.begin(), m_occluderCandidates.begin() + occluderCount, m_occluderCandidates.end(),
+        [](const OccluderCandidate& _a, const OccluderCandidate& _b) { return _a.size > _b.size; });
+
+    m_occlusionBuffer.BeginFrame(m_view, m_proyectionMatrix);
+    m_occluderTotal += AddOccluders(m_renderChunks, m_occluderCandidates.data(), occluderCount, m_meshOccluderPoints.data(),
+        _alpha, m_model, m_occlusionBuffer);
+    if (m_occlusionBuffer.GetOccluderCount() == 0)
+        return;
+
+    m_workers.ParallelFor(m_occlusionBuffer.GetTileCount(), s_tilesPerTask,
+        [](size_t _first, size_t _last) { m_occlusionBuffer.RasterizeTiles(_first, _last); });
+    m_workers.ParallelFor(m_renderChunks.size(), s_chunksPerTask,
+        [](size_t _first, size_t _last) { OccludeChunks(m_renderChunks, _first, _last, m_occlusionBuffer, m_meshRadii.data(), m_visibility); });
+}
+
+/// <summary>
+/// First stage of the render extraction: which instances of m_renderChunks are submitted this frame, into
+/// m_visibility (on the worker threads, a range of chunks each)
+/// </summary>
+/// <param name="_alpha">Of the way between the last two simulation steps, for the occluders</param>
+/// <returns>The number of visible instances</returns>
+size_t CullInstances(float _alpha)
+{
+    PROFILE_ZONE("CullInstances");
+
+    if (m_cullingMode == kCullingFrustum || m_cullingMode == kCullingOcclusion)
+    {
+        /* The instances spin around their own center: their bounding sphere only depends on position and scale */
+        Frustum frustum = FrustumFromMatrix(Mat4Multiply(m_proyectionMatrix, m_view));
+        m_workers.ParallelFor(m_renderChunks.size(), s_chunksPerTask,
+            [&frustum](size_t _first, size_t _last) { CullChunks(m_renderChunks, _first, _last, frustum, m_meshRadii.data(), m_visibility); });
+
+        if (m_cullingMode == kCullingOcclusion)
+            OccludeInstances(_alpha);
+    }
+    else if (m_cullingMode == kCullingBvh)
+    {
+        /* The tree skips the subtrees outside, then the chunks pick their visible rows from one flag per instance */
+        UpdateSceneBvh();
+        m_bvhObjects.clear();
+        m_sceneBvh.QueryFrustum(FrustumFromMatrix(Mat4Multiply(m_proyectionMatrix, m_view)), m_bvhObjects);
+
+        if (m_bvhObjects.size() < m_renderInstanceCount)
+        {
+            m_visibleFlags.assign(m_renderInstanceCount, 0);
+            for (uint32_t object : m_bvhObjects)
+                m_visibleFlags[object] = 1;
+            m_workers.ParallelFor(m_renderChunks.size(), s_chunksPerTask,
+                [](size_t _first, size_t _last) { SelectVisibleRows(m_renderChunks, _first, _last, m_visibleFlags.data(), m_visibility); });
+        }
+        else
+        {
+            /* Everything inside, as when the whole scene is in view: every chunk entirely visible */
+            for (size_t i = 0; i < m_renderChunks.size(); i++)
+                m_visibility.counts[i] = (uint32_t)m_renderChunks[i].count;
+        }
+    }
+    else
+    {
+        /* Every instance: none, or gpu, where the compute pass culls them */
+        for (size_t i = 0; i < m_renderChunks.size(); i++)
+            m_visibility.counts[i] = (uint32_t)m_renderChunks[i].count;
+    }
+
+    return CompactVisibility(m_visibility);
+}
+
+/// <summary>
+/// Visible instances of each batch mesh, as culling left them in m_visibility
+/// </summary>
+/// <returns></returns>
+std::vector<GLuint> CountMeshInstances()
+{
+    /* The chunks come grouped by mesh: each mesh's visible instances are one range */
+    std::vector<GLuint> meshInstanceCounts(m_meshCommands.size(), 0);
+    for (size_t i = 0; i < m_renderChunks.size(); i++)
+    {
+        if (m_renderChunks[i].group < meshInstanceCounts.size())
+            meshInstanceCounts[m_renderChunks[i].group] += m_visibility.counts[i];
+    }
+    return meshInstanceCounts;
+}
+
+/// <summary>
+/// Render extraction with GPU culling, _instanceCount instances: their attributes uploaded if they changed, then
+/// written to this frame's region of the stream buffer their rotations (_alpha of the way between the last two
+/// simulation steps) and one draw command per mesh, with no instances and baseInstance where the mesh's visible
+/// instances will start. What is drawn is what the compute pass writes from them
+/// </summary>
+/// <param name="_alpha"></param>
+/// <param name="_instanceCount"></param>
+void ExtractGpuCullingInputs(float _alpha, size_t _instanceCount)
+{
+    PROFILE_ZONE("ExtractGpuCullingInputs");
+
+    /* Positions and colors don't change every frame: the compute pass reads them from its own buffer */
+    uint64_t positionVersion = m_scene.GetComponentVersion(kComponentPosition);
+    uint64_t colorVersion = m_scene.GetComponentVersion(kComponentColor);
+    if (m_gpuInstancesDirty || positionVersion != m_gpuPositionVersion || colorVersion != m_gpuColorVersion)
+    {
+        m_gpuInstances.resize(_instanceCount);
+        InstanceData* instances = m_gpuInstances.data();
+        m_workers.ParallelFor(m_renderChunks.size(), s_chunksPerTask,
+            [instances](size_t _first, size_t _last) { ExtractVisibleInstanceData(m_renderChunks, _first, _last, m_visibility, instances); });
+        m_gpuCulling.UploadInstances(instances, _instanceCount);
+
+        m_gpuInstancesDirty = false;
+        m_gpuPositionVersion = positionVersion;
+        m_gpuColorVersion = colorVersion;
+    }
+
+    m_instanceBuffer = m_gpuCulling.GetVisibleBuffer();
+    m_instanceDataOffset = 0;
+    m_instanceRotationOffset = m_gpuCulling.GetVisibleRotationOffset();
+    m_drawCommandBuffer = m_gpuCulling.GetCommandBuffer();
+    m_drawCommandOffset = 0;
+
+    m_drawCommands.clear();
+    GLfloat* rotations = (GLfloat*)m_streamBuffer.Allocate(_instanceCount * 4 * sizeof(GLfloat), m_storageBufferAlignment, m_gpuRotationOffset);
+    if (rotations == NULL || _instanceCount == 0)
+        return;
+
+    m_workers.ParallelFor(m_renderChunks.size(), s_chunksPerTask,
+        [rotations, _alpha](size_t _first, size_t _last) { ExtractVisibleRotations(m_renderChunks, _first, _last, m_visibility, _alpha, rotations); });
+
+    /* Every mesh has its command, the compute pass finds them by mesh */
+    std::vector<GLuint> meshInstanceCounts = CountMeshInstances();
+    GLuint baseInstance = 0;
+    for (size_t mesh = 0; mesh < m_meshCommands.size(); mesh++)
+    {
+        DrawElementsIndirectCommand command = m_meshCommands[mesh];
+        command.instanceCount = 0;
+        command.baseInstance = baseInstance;
+        baseInstance += meshInstanceCounts[mesh];
+        m_drawCommands.push_back(command);
+    }
+
+    void* commands = m_streamBuffer.Allocate(m_drawCommands.size() * sizeof(DrawElementsIndirectCommand), 4, m_gpuCommandOffset);
+    if (commands != NULL)
+        memcpy(commands, m_drawCommands.data(), m_drawCommands.size() * sizeof(DrawElementsIndirectCommand));
+    else
+        m_drawCommands.clear();
+}
+
+/// <summary>
+/// Render extraction: cull, then write to this frame's region of the stream buffer the attributes and rotations
+/// (_alpha of the way between the last two simulation steps) of the visible instances, one draw command per mesh
+/// with visible instances (they are grouped by mesh, in query order) and the Frame block. With GPU culling every
+/// instance goes, see ExtractGpuCullingInputs
+/// </summary>
+/// <param name="_alpha"></param>
+void ExtractRenderFrame(float _alpha)
 {
-    m_angle = (m_angle < 3.141599f * 2.0f) ? m_angle + 0.003f : 0.0f;
-    m_model[0] = (GLfloat)((1.0f / sqrt(2.0f)) * sin((float)m_angle / 2.0f));
-    m_model[1] = (GLfloat)((1.0f / sqrt(2.0f)) * sin((float)m_angle / 2.0f));
-    m_model[2] = (GLfloat)0.0f;
-    m_model[3] = (GLfloat)cos((float)m_angle / 2.0f);
+    PROFILE_ZONE("ExtractRenderFrame");
+
+    if (m_streamBuffer.GetBuffer() == 0)
+        return;
+
+    size_t visibleCount = CullInstances(_alpha);
+    m_visibleInstanceTotal += visibleCount;
+    m_extractedFrames++;
+
+    m_streamBuffer.BeginFrame();
+
+    GLintptr offset = 0;
+    InstanceData* instances = NULL;
+    GLfloat* rotations = NULL;
+    if (m_cullingMode == kCullingGpu)
+    {
+        ExtractGpuCullingInputs(_alpha, visibleCount);
+    }
+    else
+    {
+        instances = (InstanceData*)m_streamBuffer.Allocate(visibleCount * sizeof(InstanceData), 16, offset);
+        m_instanceDataOffset = offset;
+        rotations = (GLfloat*)m_streamBuffer.Allocate(visibleCount * 4 * sizeof(GLfloat), 16, offset);
+        m_instanceRotationOffset = offset;
+        m_instanceBuffer = m_streamBuffer.GetBuffer();
+        m_drawCommandBuffer = m_streamBuffer.GetBuffer();
+        m_drawCommands.clear();
+    }
+
+    if (instances != NULL && rotations != NULL && visibleCount > 0)
+    {
+        m_workers.ParallelFor(m_renderChunks.size(), s_chunksPerTask,
+            [instances, rotations, _alpha](size_t _first, size_t _last)
+            {
+                ExtractVisibleInstanceData(m_renderChunks, _first, _last, m_visibility, instances);
+                ExtractVisibleRotations(m_renderChunks, _first, _last, m_visibility, _alpha, rotations);
+            });
+
+        std::vector<GLuint> meshInstanceCounts = CountMeshInstances();
+        GLuint baseInstance = 0;
+        for (size_t mesh = 0; mesh < m_meshCommands.size(); mesh++)
+        {
+            DrawElementsIndirectCommand command = m_meshCommands[mesh];
+            command.instanceCount = meshInstanceCounts[mesh];
+            command.baseInstance = baseInstance;
+            baseInstance += command.instanceCount;
+
+            if (command.instanceCount > 0)
+                m_drawCommands.push_back(command);
+        }
+
+        void* commands = m_useMultiDrawIndirect
+            ? m_streamBuffer.Allocate(m_drawCommands.size() * sizeof(DrawElementsIndirectCommand), 4, m_drawCommandOffset) : NULL;
+        if (commands != NULL)
+            memcpy(commands, m_drawCommands.data(), m_drawCommands.size() * sizeof(DrawElementsIndirectCommand));
+        else if (m_useMultiDrawIndirect)
+            m_drawCommands.clear();
+    }
+
+    FrameBlock* frame = (FrameBlock*)m_streamBuffer.Allocate(sizeof(FrameBlock), m_uniformBufferAlignment, offset);
+    if (frame != NULL)
+    {
+        memcpy(frame->rotation, &m_model, sizeof(frame->rotation));
+        frame->transparency = 1.0f;
+
+        /* The shaders' qtransform rotates by the conjugate, the matrix variant must do the same */
+        Mat4 model = Mat4FromQuat(QuatConjugate(m_model));
+        memcpy(frame->model, model.m, sizeof(frame->model));
+        m_frameBlockOffset = offset;
+    }
 }
 
 /// <summary>
@@ -214,32 +627,178 @@ bool IsKeyPressed(GLFWwindow* window, int key)
     return (glfwGetKey(window, key) == GLFW_PRESS);
 }
 
+/// <summary>
+/// Point an attribute advancing once per instance at the bound array buffer. Integer attributes keep their
+/// type (glVertexAttribIPointer). Attributes the program variant doesn't have (-1) are skipped
+/// </summary>
+/// <param name="_attribute"></param>
+/// <param name="_size"></param>
+/// <param name="_type"></param>
+/// <param name="_normalized"></param>
+/// <param name="_integer"></param>
+/// <param name="_stride"></param>
+/// <param name="_offset"></param>
+void SetInstanceAttribute(GLint _attribute, GLint _size, GLenum _type, GLboolean _normalized, bool _integer, GLsizei _stride, size_t _offset)
+{
+    if (_attribute < 0)
+        return;
+
+    if (_integer)
+        glVertexAttribIPointer(_attribute, _size, _type, _stride, (void*)_offset);
+    else
+        glVertexAttribPointer(_attribute, _size, _type, _normalized, _stride, (void*)_offset);
+    glVertexAttribDivisor(_attribute, 1);
+    glEnableVertexAttribArray(_attribute);
+}
+
+/// <summary>
+/// Point the rotation attribute at this frame's rotations (m_instanceBuffer), starting at _baseInstance
+/// </summary>
+/// <param name="_baseInstance"></param>
+void SetInstanceRotationAttribute(GLuint _baseInstance)
+{
+    if (m_inInstanceRotationID < 0)
+        return;
+
+    m_glState.BindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+    SetInstanceAttribute(m_inInstanceRotationID, 4, GL_FLOAT, GL_FALSE, false, 4 * sizeof(GLfloat),
+        (size_t)m_instanceRotationOffset + (size_t)_baseInstance * 4 * sizeof(GLfloat));
+}
+
+/// <summary>
+/// Point every instance attribute at this frame's visible instances (m_instanceBuffer: the stream buffer, or what
+/// the GPU culling wrote), starting at _baseInstance (the offset skips the instances of the meshes drawn before)
+/// </summary>
+/// <param name="_baseInstance"></param>
+void SetInstanceAttributes(GLuint _baseInstance)
+{
+    size_t baseOffset = (size_t)m_instanceDataOffset + (size_t)_baseInstance * sizeof(InstanceData);
+
+    m_glState.BindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+    SetInstanceAttribute(m_inInstancePositionID, 4, GL_FLOAT, GL_FALSE, false, sizeof(InstanceData),
+        baseOffset + offsetof(InstanceData, position));
+    SetInstanceAttribute(m_inInstanceColorID, 4, GL_UNSIGNED_BYTE, GL_TRUE, false, sizeof(InstanceData),
+        baseOffset + offsetof(InstanceData, color));
+    SetInstanceAttribute(m_inInstanceMeshID, 1, GL_UNSIGNED_INT, GL_FALSE, true, sizeof(InstanceData),
+        baseOffset + offsetof(InstanceData, mesh));
+    SetInstanceRotationAttribute(_baseInstance);
+}
+
+/// <summary>
+/// Draw every mesh of the batch with its visible instances. One glMultiDrawElementsIndirect call when the
+/// driver has it (GL 4.3), otherwise one draw per command: with base instance (GL 4.2), or by moving the
+/// instance attributes to the command's first instance (GL 3.3)
+/// </summary>
+void SubmitDrawCommands()
+{
+    if (m_drawCommands.empty())
+        return;
+
+    if (m_useMultiDrawIndirect)
+    {
+        m_glState.BindBuffer(GL_DRAW_INDIRECT_BUFFER, m_drawCommandBuffer);
+        glMultiDrawElementsIndirect(GL_TRIANGLE_STRIP, GL_UNSIGNED_SHORT, (void*)m_drawCommandOffset, (GLsizei)m_drawCommands.size(), 0);
+        return;
+    }
+
+    bool baseInstance = GLEW_VERSION_4_2 || GLEW_ARB_base_instance;
+
+    for (const DrawElementsIndirectCommand& command : m_drawCommands)
+    {
+        void* indices = (void*)(command.firstIndex * sizeof(GLushort));
+
+        if (baseInstance)
+        {
+            glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLE_STRIP, command.count, GL_UNSIGNED_SHORT, indices,
+                command.instanceCount, command.baseVertex, command.baseInstance);
+        }
+        else
+        {
+            SetInstanceAttributes(command.baseInstance);
+            glDrawElementsInstancedBaseVertex(GL_TRIANGLE_STRIP, command.count, GL_UNSIGNED_SHORT, indices,
+                command.instanceCount, command.baseVertex);
+        }
+    }
+
+    if (!baseInstance)
+        SetInstanceAttributes(0);
+}
+
 /// <summary>
 /// Repaint of our scene (only render the vertices if we are using the shaders to avoid crashes with the program)
 /// </summary>
-/// <param name="_window"></param>
 /// <param name="_loadedShaders"></param>
-void Repaint(GLFWwindow * _window, bool _loadedShaders)
+void Repaint(bool _loadedShaders)
 {
+    PROFILE_ZONE("Repaint");
+
     /* Clear last frame */
+    m_gpuTimer.BeginPass(m_gpuPassClear);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    m_gpuTimer.EndPass(m_gpuPassClear);
 
     if (_loadedShaders)
     {
-        glUseProgram(m_programID);
-        glUniform1f(m_uniformTransparencyID, 1.0f);
-        glUniform4fv(m_uniformModelID, 1, m_model);
-        glUniformMatrix4fv(m_uniformViewID, 1, GL_FALSE, m_view);
-        glUniformMatrix4fv(m_uniformProyectionID, 1, GL_FALSE, m_proyectionMatrix);
+        /* Uniform blocks: the camera only when it moved, the frame constants from the stream buffer */
+        if (m_cameraDirty)
+        {
+            CameraBlock camera;
+            memcpy(camera.projection, m_proyectionMatrix.m, sizeof(camera.projection));
+            memcpy(camera.view, m_view.m, sizeof(camera.view));
+            m_glState.BindBuffer(GL_UNIFORM_BUFFER, camerabuffer);
+            glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(CameraBlock), &camera);
+            m_cameraDirty = false;
+        }
+        m_streamBuffer.FlushWrites();
+
+        /* GPU culling writes the commands and the instances drawn */
+        if (m_cullingMode == kCullingGpu && !m_drawCommands.empty())
+        {
+            m_gpuTimer.BeginPass(m_gpuPassCull);
+            m_gpuCulling.Cull(m_glState, m_view, m_proyectionMatrix, m_meshRadii.data(), m_streamBuffer.GetBuffer(), m_gpuRotationOffset,
+                m_streamBuffer.GetBuffer(), m_gpuCommandOffset);
+            m_gpuTimer.EndPass(m_gpuPassCull);
+        }
+
+        m_gpuTimer.BeginPass(m_gpuPassScene);
+        m_glState.UseProgram(m_programID);
+        m_glState.BindBufferRange(GL_UNIFORM_BUFFER, kFrameBlockBinding, m_streamBuffer.GetBuffer(), m_frameBlockOffset, sizeof(FrameBlock));
 
         /*Paint the buffer */
-        glBindVertexArray(m_vao);
-        glDrawElements(GL_TRIANGLE_STRIP, m_numberOfCubeStrips, GL_UNSIGNED_SHORT, (void*)0);
-        glDrawElements(GL_TRIANGLE_STRIP, m_numberOfCubeStrips, GL_UNSIGNED_SHORT, (void*)(m_numberOfCubeStrips * sizeof(GLushort)));
+        m_glState.BindVertexArray(m_vao);
+        SetInstanceAttributes(0);
+        SubmitDrawCommands();
+        m_streamBuffer.EndFrame();
+        m_gpuTimer.EndPass(m_gpuPassScene);
+
+        /* The next frame culls against what this one drew */
+        if (m_cullingMode == kCullingGpu)
+        {
+            m_gpuTimer.BeginPass(m_gpuPassDepthPyramid);
+            m_gpuCulling.BuildDepthPyramid(m_glState);
+            m_gpuTimer.EndPass(m_gpuPassDepthPyramid);
+        }
     }
+}
+
+/// <summary>
+/// Show the frame. Headless runs have no window (NULL): we wait for the offscreen frame instead,
+/// so a frame costs the same as with a blocking swap and the GPU can't queue frames without bound
+/// </summary>
+/// <param name="_window"></param>
+void PresentFrame(GLFWwindow* _window)
+{
+    PROFILE_ZONE("PresentFrame");
 
-    /* Swap front and back buffers */
-    glfwSwapBuffers(_window);
+    if (_window != NULL)
+    {
+        /* Swap front and back buffers */
+        glfwSwapBuffers(_window);
+    }
+    else
+    {
+        glFinish();
+    }
 }
 
 /// <summary>
@@ -253,155 +812,260 @@ bool IsApplicationRunning(GLFWwindow* _window)
 }
 
 /// <summary>
-/// Manage key events
+/// Ray picking: print the instance under the cursor, the closest one whose bounding box the ray from the near
+/// plane to the far plane through the cursor enters
+/// </summary>
+/// <param name="_window"></param>
+void PickInstance(GLFWwindow* _window)
+{
+    PROFILE_ZONE("PickInstance");
+
+    double cursorX, cursorY;
+    int width, height;
+    glfwGetCursorPos(_window, &cursorX, &cursorY);
+    glfwGetWindowSize(_window, &width, &height);
+    if (width <= 0 || height <= 0)
+        return;
+
+    /* Back from normalized device coordinates (y up) to the world */
+    Mat4 inverse;
+    if (!Mat4Inverse(Mat4Multiply(m_proyectionMatrix, m_view), inverse))
+        return;
+    float x = (float)(2.0 * cursorX / width - 1.0);
+    float y = (float)(1.0 - 2.0 * cursorY / height);
+    Vec4 nearPoint = Mat4Transform(inverse, { x, y, -1.0f, 1.0f });
+    Vec4 farPoint = Mat4Transform(inverse, { x, y, 1.0f, 1.0f });
+    Vec3 origin = Vec3Scale({ nearPoint.x, nearPoint.y, nearPoint.z }, 1.0f / nearPoint.w);
+    Vec3 end = Vec3Scale({ farPoint.x, farPoint.y, farPoint.z }, 1.0f / farPoint.w);
+
+    UpdateSceneBvh();
+    RayHit hit;
+    if (!m_sceneBvh.Raycast(origin, Vec3Sub(end, origin), 1.0f, hit))
+    {
+        std::cout << "Picked nothing" << std::endl;
+        return;
+    }
+
+    /* The BVH objects are in query order: the chunk holding it is the last one starting at or before it */
+    std::vector<ChunkView>::const_iterator chunk = std::upper_bound(m_renderChunks.begin(), m_renderChunks.end(), (size_t)hit.object,
+        [](size_t _object, const ChunkView& _chunk) { return _object < _chunk.first; }) - 1;
+    std::cout << "Picked entity " << chunk->GetEntityIndices()[hit.object - chunk->first] << " (mesh " << chunk->group << ") at "
+        << hit.distance * Vec3Length(Vec3Sub(end, origin)) << " units" << std::endl;
+}
+
+/// <summary>
+/// Manage key and mouse events: a left click picks the instance under the cursor
 /// </summary>
 /// <param name="_window"></param>
 void ManageEvents(GLFWwindow* _window)
 {
+    PROFILE_ZONE("ManageEvents");
+
     if (IsKeyPressed(_window, GLFW_KEY_ESCAPE))
         glfwSetWindowShouldClose(_window, true);
 
+    bool mousePressed = (glfwGetMouseButton(_window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS);
+    if (mousePressed && !m_wasMousePressed && !m_renderChunks.empty())
+        PickInstance(_window);
+    m_wasMousePressed = mousePressed;
+
 
     /* Poll for and process events */
     glfwPollEvents();
 }
 
 /// <summary>
-/// Load the shader from file. We could add the string directly but w/e
+/// Initialization of the shaders. Every program variant is requested (and submitted to the compiler) before
+/// we wait for any; worker threads (if the driver can't compile in parallel itself) get contexts sharing
+/// with _window, or with _headless when there is no window. The variant drawn depends on _options:
+/// the single-object scene skips the instance inputs, --matrix-transform rotates with a matrix. GPU culling adds
+/// its compute programs. The sources are the ones embedded in the executable, unless _options points to a shader directory
 /// </summary>
-/// <param name="_fileName"></param>
-/// <param name="_type"></param>
+/// <param name="_window"></param>
+/// <param name="_headless"></param>
+/// <param name="_options"></param>
 /// <returns></returns>
-GLuint LoadShader(const char * _fileName, GLenum _type)
+bool InitializeShaders(GLFWwindow* _window, const HeadlessContext& _headless, const ApplicationOptions& _options)
 {
-    /* We load the shader */
-    std::ifstream file;
-    file.open(_fileName, std::ios::in);
-    
-    if (!file)
-    {
-        DebugLog("Shader file not found " + std::string(_fileName));
-        return 0;
-    }
+    PROFILE_ZONE("InitializeShaders");
 
-    file.seekg(0, std::ios::end);
-    unsigned int fileLen = file.tellg();
-    file.seekg(std::ios::beg);
-    
-    char * source = new char[fileLen + 1];
-    int i = 0;
-    
-    while (file.good())
-    {
-        source[i] = file.get();
-        if (!file.eof()) i++;
-        else fileLen = i;
-    }
-    source[fileLen] = '\0';
-    file.close();
+    StageClock clock;
+    unsigned int cores = std::thread::hardware_concurrency();
+
+    ShaderCompiler compiler;
+    compiler.Initialize(&m_programCache,
+        [_window, &_headless](WorkerContext& _context) { return _context.Create(_window, _headless); },
+        (cores > 1) ? (int)cores - 1 : 1);
+
+    std::string shaderDirectory = _options.shaderDirectory.empty() ? "Shaders" : _options.shaderDirectory;
+    if (shaderDirectory.back() != '/' && shaderDirectory.back() != '\\')
+        shaderDirectory += '/';
+    m_shaderSources.SetUseEmbedded(_options.shaderDirectory.empty());
 
-    // Creation and compilation of the shaders
-    GLuint shader;
-    shader = glCreateShader(_type);
-    glShaderSource(shader, 1, (const GLchar**) &source, (const GLint*)&fileLen);
-    glCompileShader(shader);
-    delete[] source;
+    ShaderVariantDescription scene;
+    scene.name = "scene";
+    scene.vertexPath = shaderDirectory + "vshader.glsl";
+    scene.fragmentPath = shaderDirectory + "fshader.glsl";
+    scene.attributeLocations.assign(s_attributeLocations, s_attributeLocations + sizeof(s_attributeLocations) / sizeof(s_attributeLocations[0]));
+    scene.defines.push_back({ "INSTANCED", (_options.instanceCount > 1) ? "1" : "0" });
+    scene.defines.push_back({ "TRANSFORM_MATRIX", _options.matrixTransform ? "1" : "0" });
 
-    GLint compiled;
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+    int sceneVariant = m_shaderVariants.Request(compiler, m_shaderPreprocessor, scene);
 
-    if (!compiled)
+    int cullVariant = -1, depthPyramidVariant = -1;
+    if (m_cullingMode == kCullingGpu)
     {
-        GLint logLen;
-        glGetShaderiv(shader, GL_INFO_LOG_LENGTH,&logLen);
-        char* logString = new char[logLen];
-        glGetShaderInfoLog(shader, logLen, NULL, logString);
-        std::cout << "Error: " << logString << std::endl;
-        delete[] logString;
-        glDeleteShader(shader);
-        return 0;
+        ShaderVariantDescription cull;
+        cull.name = "cull";
+        cull.computePath = shaderDirectory + "cullinstances.glsl";
+        cullVariant = m_shaderVariants.Request(compiler, m_shaderPreprocessor, cull);
+
+        ShaderVariantDescription depthPyramid;
+        depthPyramid.name = "depthpyramid";
+        depthPyramid.computePath = shaderDirectory + "depthpyramid.glsl";
+        depthPyramidVariant = m_shaderVariants.Request(compiler, m_shaderPreprocessor, depthPyramid);
     }
-    return shader;
-}
+    compiler.Submit();
 
-/// <summary>
-/// Initialization of the shaders 
-/// </summary>
-/// <returns></returns>
-bool InitializeShaders()
-{
-    //We compile our vertex and fragment shaders
-    m_vertexShaderID = LoadShader("Shaders/vshader.glsl", GL_VERTEX_SHADER);
-    m_fragmentShaderID = LoadShader("Shaders/fshader.glsl", GL_FRAGMENT_SHADER);
-    
-    if (m_vertexShaderID == 0 || m_fragmentShaderID == 0)
-        return false;
+    //Compile and link the variants, or take them from the binary cache
+    m_shaderVariants.Resolve(compiler);
+    compiler.Shutdown();
+    m_programID = m_shaderVariants.GetProgram(sceneVariant);
+    m_cullProgramID = m_shaderVariants.GetProgram(cullVariant);
+    m_depthPyramidProgramID = m_shaderVariants.GetProgram(depthPyramidVariant);
 
-    //Link then to our program
-    m_programID = glCreateProgram();
-    
-    glAttachShader(m_programID, m_vertexShaderID);
-    glAttachShader(m_programID, m_fragmentShaderID);
-    
-    glBindAttribLocation(m_programID, 0, "inVertex");
-    glBindAttribLocation(m_programID, 1, "inColor");
-    glLinkProgram(m_programID);
+    std::cout << "Shader programs ready in " << clock.Lap() / 1000000.0 << " ms: " << compiler.GetCachedCount()
+        << " from the binary cache, " << compiler.GetProgramCount() - compiler.GetCachedCount() << " built ("
+        << ShaderCompiler::GetModeName(compiler.GetMode()) << ")" << std::endl;
 
-    //Error debugging
-    int linked;
-    glGetProgramiv(m_programID, GL_LINK_STATUS, &linked);
-    
-    if (!linked)
-    {
-        // Error msg length
-        GLint logLen;
-        glGetProgramiv(m_programID, GL_INFO_LOG_LENGTH, &logLen);
-        char* logString = new char[logLen];
-        glGetProgramInfoLog(m_programID, logLen, NULL, logString);
-        std::cout << "Error: " << logString << std::endl;
-        delete[] logString;
-        glDeleteProgram(m_programID);
-        m_programID = 0;
+    if (m_programID == 0)
         return false;
-    }
 
-    //uniform variables
-    m_uniformTransparencyID = glGetUniformLocation(m_programID, "transparency");
-    m_uniformProyectionID = glGetUniformLocation(m_programID, "proy");
-    m_uniformViewID = glGetUniformLocation(m_programID, "view");
-    m_uniformModelID = glGetUniformLocation(m_programID, "rot");
+    //Uniform blocks
+    BindUniformBlocks(m_programID);
+    if (m_cullProgramID != 0)
+        BindUniformBlocks(m_cullProgramID);
     
     //Attributes
     m_inColorID = glGetAttribLocation(m_programID, "inColor");
     m_inVertexID = glGetAttribLocation(m_programID, "inVertex");
+    m_inInstanceRotationID = glGetAttribLocation(m_programID, "inInstanceRotation");
+    m_inInstancePositionID = glGetAttribLocation(m_programID, "inInstancePosition");
+    m_inInstanceColorID = glGetAttribLocation(m_programID, "inInstanceColor");
+    m_inInstanceMeshID = glGetAttribLocation(m_programID, "inInstanceMesh");
 
     return true;
 }
 
 /// <summary>
-/// Initialization of the cube VBO and VAO
+/// What only changes with the scene structure: query the chunks the frame systems walk, size the culling
+/// output for them, and make room in the stream buffer for every instance being visible
+/// </summary>
+void ExtractSceneInstances()
+{
+    PROFILE_ZONE("ExtractSceneInstances");
+
+    m_scene.Query(kAnimatedMask, m_animatedChunks);
+    size_t instanceCount = m_scene.Query(kRenderableMask, m_renderChunks);
+    m_sceneVersion = m_scene.GetStructureVersion();
+    ResizeVisibility(m_renderChunks, instanceCount, m_visibility);
+    m_sceneBvh.Clear();
+
+    /* One region per frame in flight: attributes and rotations of every instance, the draw commands and the Frame block */
+    if (m_streamBuffer.GetBuffer() == 0 || instanceCount > m_renderInstanceCount)
+    {
+        m_streamBuffer.Shutdown(m_glState);
+        m_streamBuffer.Initialize(instanceCount * (sizeof(InstanceData) + 4 * sizeof(GLfloat)) + 2 * 16 + m_storageBufferAlignment
+            + kMaxBatchMeshes * sizeof(DrawElementsIndirectCommand) + m_uniformBufferAlignment + sizeof(FrameBlock));
+    }
+    m_renderInstanceCount = instanceCount;
+
+    if (m_cullingMode == kCullingGpu)
+    {
+        m_gpuCulling.Resize(instanceCount, m_meshCommands.size());
+        m_gpuInstancesDirty = true;
+    }
+}
+
+/// <summary>
+/// Initialization of the mesh VBOs and VAO, the instance buffer with _instanceCount objects using
+/// _meshCount different meshes, and the draw commands
 /// </summary>
-void InitializeSceneObjects()
+/// <param name="_aspectRatio"></param>
+/// <param name="_instanceCount"></param>
+/// <param name="_meshCount"></param>
+void InitializeSceneObjects(float _aspectRatio, int _instanceCount, int _meshCount)
 {
-    glEnable(GL_DEPTH_TEST);
+    PROFILE_ZONE("InitializeSceneObjects");
+
+    float sceneRadius = 0.0f;
+    m_sceneMeshCount = (_meshCount < (int)GetSceneMeshes().size()) ? _meshCount : (int)GetSceneMeshes().size();
+    BuildInstanceGrid(_instanceCount, m_sceneMeshCount, m_scene, sceneRadius);
+
+    /* The geometry of every mesh the scene may use; the instance counts come with the instance data */
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &m_uniformBufferAlignment);
+    if (GLEW_VERSION_4_3)
+        glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &m_storageBufferAlignment);
+    MeshBatch batch;
+    BuildMeshBatch(m_sceneMeshCount, batch);
+    m_meshCommands = batch.commands;
+    m_meshRadii = batch.boundingRadii;
+    m_meshOccluderPoints.assign(batch.occluderPoints.size(), std::vector<Vec3>());
+    for (size_t mesh = 0; mesh < batch.occluderPoints.size(); mesh++)
+    {
+        for (size_t p = 0; p + 2 < batch.occluderPoints[mesh].size(); p += 3)
+            m_meshOccluderPoints[mesh].push_back({ batch.occluderPoints[mesh][p], batch.occluderPoints[mesh][p + 1], batch.occluderPoints[mesh][p + 2] });
+    }
+    m_useMultiDrawIndirect = GLEW_VERSION_4_3 || GLEW_ARB_multi_draw_indirect;
+
+    /* Back the camera off until the whole grid fits in the vertical field of view */
+    float cameraDistance = sceneRadius / sin(45.0f * (3.141599f / 360.0f));
+    cameraDistance = (cameraDistance > 10.0f) ? cameraDistance : 10.0f;
+    m_view = Mat4Translation({ 0.0f, 0.0f, -cameraDistance });
+    m_cameraDirty = true;
+
+    m_glState.SetEnabled(GL_DEPTH_TEST, true);
     glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
-    BuildProjectionMatrix(45.0f, 4.0f / 3.0f, 0.1f, 50.0f);
+    BuildProjectionMatrix(45.0f, _aspectRatio, 0.1f, (cameraDistance + sceneRadius > 50.0f) ? cameraDistance + sceneRadius : 50.0f);
     glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-    glEnable(GL_CULL_FACE);
+    m_glState.SetEnabled(GL_CULL_FACE, true);
+
+    /* Every mesh is a single draw: its strips are separated by the restart index */
+    if (GLEW_VERSION_4_3 || GLEW_ARB_ES3_compatibility)
+    {
+        m_glState.SetEnabled(GL_PRIMITIVE_RESTART_FIXED_INDEX, true);
+    }
+    else
+    {
+        m_glState.SetEnabled(GL_PRIMITIVE_RESTART, true);
+        glPrimitiveRestartIndex(kStripRestartIndex);
+    }
     
     glGenVertexArrays(1, &m_vao);
-    glBindVertexArray(m_vao);
-    glGenBuffers(3, m_vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, vbuffer);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(m_cubeVertices), m_cubeVertices, GL_STATIC_DRAW);
-    glVertexAttribPointer(m_inVertexID, 3, GL_FLOAT, GL_FALSE, 0, 0);
+    m_glState.BindVertexArray(m_vao);
+    glGenBuffers(4, m_vbo);
+    m_glState.BindBuffer(GL_ARRAY_BUFFER, vbuffer);
+    glBufferData(GL_ARRAY_BUFFER, batch.vertices.size() * sizeof(PackedVertex), batch.vertices.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(m_inVertexID, 3, GL_SHORT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, position));
     glEnableVertexAttribArray(m_inVertexID);
-    glBindBuffer(GL_ARRAY_BUFFER, cbuffer);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(m_cubeVertexColor), m_cubeVertexColor, GL_STATIC_DRAW);
-    glVertexAttribPointer(m_inColorID, 3, GL_FLOAT, GL_FALSE, 0, 0);
+    glVertexAttribPointer(m_inColorID, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, color));
     glEnableVertexAttribArray(m_inColorID);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, pbuffer);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(m_cubeStrips), m_cubeStrips,GL_STATIC_DRAW);
+    m_glState.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, pbuffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, batch.indices.size() * sizeof(GLushort), batch.indices.data(), GL_STATIC_DRAW);
+
+    ExtractSceneInstances();
+
+    /* The Camera and Scene blocks stay bound for every program */
+    SceneBlock scene = {};
+    std::copy(batch.quantization.begin(), batch.quantization.end(), scene.meshQuantization);
+    m_glState.BindBuffer(GL_UNIFORM_BUFFER, scenebuffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(SceneBlock), &scene, GL_STATIC_DRAW);
+    m_glState.BindBufferBase(GL_UNIFORM_BUFFER, kSceneBlockBinding, scenebuffer);
+
+    m_glState.BindBuffer(GL_UNIFORM_BUFFER, camerabuffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(CameraBlock), NULL, GL_DYNAMIC_DRAW);
+    m_glState.BindBufferBase(GL_UNIFORM_BUFFER, kCameraBlockBinding, camerabuffer);
+    m_glState.BindBuffer(GL_UNIFORM_BUFFER, 0);
 }
 
 /// <summary>
@@ -413,65 +1077,277 @@ void FreeLibraries()
 }
 
 /// <summary>
-/// Free buffers, shaders, program and ofc, OpenGL context
+/// Free buffers, shaders and program. The context goes away later with FreeLibraries
 /// </summary>
 /// <param name="_loadedShaders"></param>
 void FreeResources(bool _loadedShaders)
 {
     if (_loadedShaders)
     {
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-        glDeleteBuffers(3, m_vbo);
-        glBindVertexArray(0);
+        m_glState.BindBuffer(GL_ARRAY_BUFFER, 0);
+        m_glState.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        m_glState.BindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        m_glState.BindBuffer(GL_UNIFORM_BUFFER, 0);
+        m_glState.DeleteBuffers(4, m_vbo);
+        m_glState.BindVertexArray(0);
         glDeleteVertexArrays(1, &m_vao);
-        glDetachShader(m_programID, m_vertexShaderID);
-        glDetachShader(m_programID, m_fragmentShaderID);
-        glDeleteShader(m_vertexShaderID);
-        glDeleteShader(m_fragmentShaderID);
-        glDeleteProgram(m_programID);
     }
 
-    FreeLibraries();
+    m_shaderVariants.Release();
+    m_programID = 0;
+
+    m_shaderSources.Clear();
+    m_renderChunks.clear();
+    m_animatedChunks.clear();
+    m_scene.Clear();
+    m_sceneVersion = m_scene.GetStructureVersion();
+    m_renderInstanceCount = 0;
+    m_sceneBvh.Clear();
+    m_sceneBounds.clear();
+    m_meshOccluderPoints.clear();
+    m_gpuInstances.clear();
+    m_drawCommands.clear();
+    m_gpuCulling.Shutdown(m_glState);
+    m_streamBuffer.Shutdown(m_glState);
+    m_workers.Shutdown();
+    m_gpuTimer.Shutdown();
+    m_glState.Invalidate();
 }
 
 /// <summary>
-/// Our main ;)))
+/// Render loop. With a window it runs until the window is closed, headless (NULL window) it renders
+/// _frameCount frames. Every stage of every frame is timed into _stats.
+/// The simulation runs in fixed steps (m_simClock) for the time each frame stands for: the real time since
+/// the previous frame, or _frameNanoseconds if it isn't 0, which makes the run deterministic
 /// </summary>
-/// <param name=""></param>
-/// <returns></returns>
-int main(void)
+/// <param name="_window"></param>
+/// <param name="_frameCount"></param>
+/// <param name="_frameNanoseconds"></param>
+/// <param name="_loadedShaders"></param>
+/// <param name="_stats"></param>
+void RunFrameLoop(GLFWwindow* _window, int _frameCount, uint64_t _frameNanoseconds, bool _loadedShaders, FrameStats& _stats)
 {
-    /* Initialize GLFW (OpenGL library) */
-    if (InitLibraries() == -1)
-        return -1;
+    const int simulationStage = _stats.AddStage("Simulation");
+    const int idleStage = _stats.AddStage("IdleMovement");
+    const int extractionStage = _stats.AddStage("RenderExtraction");
+    const int repaintStage = _stats.AddStage("Repaint");
+    const int presentStage = _stats.AddStage(_window != NULL ? "glfwSwapBuffers" : "PresentFrame");
+    const int eventsStage = _stats.AddStage("ManageEvents");
+
+    m_gpuTimer.Initialize(_stats);
+    m_gpuPassClear = m_gpuTimer.AddPass("Clear");
+    m_gpuPassScene = m_gpuTimer.AddPass("Scene");
+    if (m_cullingMode == kCullingGpu)
+    {
+        m_gpuPassCull = m_gpuTimer.AddPass("Cull");
+        m_gpuPassDepthPyramid = m_gpuTimer.AddPass("DepthPyramid");
+    }
 
-    GLFWwindow * window = InitWindowContext("Hello World!", 640, 480);
+    int frame = 0;
+    StageClock realTime;
 
-    if (window == NULL)
+    while ((_window != NULL) ? IsApplicationRunning(_window) : (frame < _frameCount))
     {
-        glfwTerminate();
-        return -1;
+        PROFILE_ZONE("Frame");
+        StageClock clock;
+        uint64_t frameTime = 0;
+
+        m_gpuTimer.BeginFrame();
+
+        if (m_scene.GetStructureVersion() != m_sceneVersion)
+            ExtractSceneInstances();
+
+        uint64_t elapsed = realTime.Lap();
+        int steps = m_simClock.Advance((_frameNanoseconds > 0) ? _frameNanoseconds : elapsed);
+        for (int step = 0; step < steps; step++)
+            SimulationStep(m_simClock.GetStepSeconds());
+        uint64_t stageTime = clock.Lap();
+        _stats.Record(simulationStage, stageTime);
+        frameTime += stageTime;
+
+        IdleMovement(m_simClock.GetAlpha());
+        stageTime = clock.Lap();
+        _stats.Record(idleStage, stageTime);
+        frameTime += stageTime;
+
+        ExtractRenderFrame(m_simClock.GetAlpha());
+        stageTime = clock.Lap();
+        _stats.Record(extractionStage, stageTime);
+        frameTime += stageTime;
+
+        Repaint(_loadedShaders);
+        m_gpuTimer.EndFrame();
+        stageTime = clock.Lap();
+        _stats.Record(repaintStage, stageTime);
+        frameTime += stageTime;
+
+        PresentFrame(_window);
+        stageTime = clock.Lap();
+        _stats.Record(presentStage, stageTime);
+        frameTime += stageTime;
+
+        if (_window != NULL)
+        {
+            ManageEvents(_window);
+            stageTime = clock.Lap();
+            _stats.Record(eventsStage, stageTime);
+            frameTime += stageTime;
+        }
+
+        _stats.RecordFrame(frameTime);
+        frame++;
+    }
+
+    m_gpuTimer.Flush();
+}
+
+/// <summary>
+/// Print the frame-time stats and write the JSON report if it was requested
+/// </summary>
+/// <param name="_stats"></param>
+/// <param name="_options"></param>
+void ReportFrameStats(const FrameStats& _stats, const ApplicationOptions& _options)
+{
+    std::string renderer = std::string((const char*)glGetString(GL_RENDERER)) + " (" + (const char*)glGetString(GL_VERSION) + ")";
+
+    std::cout << "Renderer: " << renderer << std::endl;
+    _stats.PrintSummary();
+
+    std::cout << "Simulation: " << m_simClock.GetStepCount() << " steps at " << m_simClock.GetRate() << " Hz";
+    if (m_simClock.GetDroppedSteps() > 0)
+        std::cout << ", " << m_simClock.GetDroppedSteps() << " dropped to catch up";
+    std::cout << std::endl;
+
+    static const char* const cullingNames[] = { "none", "frustum", "bvh", "occlusion", "gpu" };
+    if (m_cullingMode == kCullingGpu && m_extractedFrames > 0)
+        std::cout << "Culling (gpu): " << m_gpuCulling.ReadVisibleCount() << " of " << m_renderInstanceCount
+            << " instances drawn in the last frame, " << m_gpuCulling.GetPyramidWidth() << "x" << m_gpuCulling.GetPyramidHeight()
+            << " depth pyramid (" << m_gpuCulling.GetPyramidLevels() << " levels) used by " << m_gpuCulling.GetOcclusionFrames()
+            << " of " << m_extractedFrames << " frames" << std::endl;
+    else if (m_extractedFrames > 0)
+        std::cout << "Culling (" << cullingNames[m_cullingMode] << "): "
+            << m_visibleInstanceTotal / m_extractedFrames << " of " << m_renderInstanceCount << " instances drawn per frame on average, "
+            << m_workers.GetThreadCount() << ((m_workers.GetThreadCount() > 1) ? " threads" : " thread") << std::endl;
+
+    if (m_bvhBuilds > 0)
+        std::cout << "BVH: " << m_sceneBvh.GetNodeCount() << " nodes, builds: " << m_bvhBuilds << ", refits: " << m_bvhRefits
+            << ", SAH cost " << m_sceneBvh.GetCost() << " (" << m_sceneBvh.GetBuiltCost() << " when built)" << std::endl;
+
+    if (m_cullingMode == kCullingOcclusion && m_extractedFrames > 0)
+        std::cout << "Occlusion: " << m_occlusionBuffer.GetWidth() << "x" << m_occlusionBuffer.GetHeight() << " depth buffer, "
+            << m_occluderTotal / m_extractedFrames << " occluders per frame, "
+            << (m_inFrustumTotal - m_visibleInstanceTotal) / m_extractedFrames << " of " << m_inFrustumTotal / m_extractedFrames
+            << " instances in the frustum hidden" << std::endl;
+
+    if (m_streamBuffer.GetBuffer() != 0)
+        std::cout << "Stream buffer: " << (m_streamBuffer.IsPersistent() ? "persistent mapping" : "unsynchronized mapping")
+            << ", " << m_streamBuffer.GetStallCount() << " frames waited for the GPU" << std::endl;
+
+    uint64_t stateCalls = m_glState.GetIssuedCount() + m_glState.GetFilteredCount();
+    if (stateCalls > 0)
+        std::cout << "GL state calls: " << m_glState.GetIssuedCount() << " issued, " << m_glState.GetFilteredCount()
+            << " filtered as redundant (" << (100.0 * m_glState.GetFilteredCount() / stateCalls) << "%)" << std::endl;
+
+    uint64_t uniformCalls = m_glState.GetUniformIssuedCount() + m_glState.GetUniformFilteredCount();
+    if (uniformCalls > 0)
+        std::cout << "GL uniform calls: " << m_glState.GetUniformIssuedCount() << " issued, " << m_glState.GetUniformFilteredCount()
+            << " filtered as redundant (" << (100.0 * m_glState.GetUniformFilteredCount() / uniformCalls) << "%)" << std::endl;
+
+    if (m_gpuTimer.GetDroppedFrames() > 0)
+        std::cout << "GPU timings dropped for " << m_gpuTimer.GetDroppedFrames() << " frames (queries not ready in time)" << std::endl;
+
+    if (!_options.statsOutPath.empty() && _stats.WriteJson(_options.statsOutPath.c_str(), renderer))
+        std::cout << "Stats written to " << _options.statsOutPath << std::endl;
+}
+
+int RunApplication(const ApplicationOptions& options)
+{
+    Profiler::SetEnabled(!options.traceOutPath.empty());
+    Profiler::SetThreadName("Main");
+
+    GLFWwindow * window = NULL;
+    HeadlessContext headless;
+
+    if (options.headless)
+    {
+        /* Offscreen context, no window and no events */
+        if (!headless.Create(options.width, options.height))
+        {
+            FreeLibraries();
+            return -1;
+        }
+    }
+    else
+    {
+        /* Initialize GLFW (OpenGL library) */
+        if (InitLibraries() == -1)
+            return -1;
+
+        window = InitWindowContext("Hello World!", options.width, options.height);
+
+        if (window == NULL)
+        {
+            glfwTerminate();
+            return -1;
+        }
     }
 
     // Remember to initialize the extensions AFTER we initialize OpenGL context!
-    if (InitGLEW() == -1)
+    if (InitGLEW(options.headless) == -1)
         return -1;
 
-    bool loadedShaders = InitializeShaders();
+    if (options.headless && !headless.CreateFramebuffer())
+    {
+        headless.Destroy();
+        FreeLibraries();
+        return -1;
+    }
 
-    if (loadedShaders)
-        InitializeSceneObjects();
+    m_programCache.Initialize(options.shaderCachePath);
+    m_workers.Initialize(options.threadCount);
+    m_cullingMode = options.culling;
+    if (m_cullingMode == kCullingOcclusion)
+        m_occlusionBuffer.Resize(options.width / 2, options.height / 2);
+    if (m_cullingMode == kCullingGpu && !GpuCulling::IsSupported())
+    {
+        std::cout << "GPU culling needs OpenGL 4.3, culling to the frustum instead" << std::endl;
+        m_cullingMode = kCullingFrustum;
+    }
+    bool loadedShaders = InitializeShaders(window, headless, options);
 
-    /* Loop until the user closes the window */
-    while (IsApplicationRunning(window))
+    if (loadedShaders && m_cullingMode == kCullingGpu)
     {
-        IdleMovement();
-        Repaint(window, loadedShaders);
-        ManageEvents(window);
+        /* The pyramid is built from the depth buffer drawn to: the offscreen one, or the window's */
+        int width = options.width, height = options.height;
+        if (window != NULL)
+            glfwGetFramebufferSize(window, &width, &height);
+
+        if (!m_gpuCulling.Initialize(m_glState, width, height, m_cullProgramID, m_depthPyramidProgramID))
+        {
+            std::cout << "GPU culling programs unavailable, culling to the frustum instead" << std::endl;
+            m_cullingMode = kCullingFrustum;
+        }
     }
 
+    if (loadedShaders)
+        InitializeSceneObjects((float)options.width / (float)options.height, options.instanceCount, options.meshCount);
+
+    /* Loop until the user closes the window (or the headless frame count is reached) */
+    FrameStats stats;
+    /* Headless runs are reproducible by default: every frame is one simulation step */
+    int renderRate = (options.renderRate == 0 && options.headless) ? options.simulationRate : options.renderRate;
+    uint64_t frameNanoseconds = (renderRate > 0) ? (1000000000ull + renderRate / 2) / renderRate : 0;
+    m_simClock.Initialize(options.simulationRate, 8);
+
+    RunFrameLoop(window, options.frameCount, frameNanoseconds, loadedShaders, stats);
+    ReportFrameStats(stats, options);
+
+    if (!options.traceOutPath.empty() && Profiler::WriteChromeTrace(options.traceOutPath.c_str()))
+        std::cout << "Trace written to " << options.traceOutPath << std::endl;
+
     FreeResources(loadedShaders);
+    headless.Destroy();
+    FreeLibraries();
 
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,11 @@
+#pragma once
+
+#include "ApplicationOptions.h"
+
+/// <summary>
+/// Create the context, load the scene and run the render loop until the window is closed
+/// (or until the frame count is reached in headless mode). Returns the process exit code
+/// </summary>
+/// <param name="options"></param>
+/// <returns></returns>
+int RunApplication(const ApplicationOptions& options);
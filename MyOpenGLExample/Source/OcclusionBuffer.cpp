@@ -0,0 +1,518 @@
+#include "OcclusionBuffer.h"
+
+#include <algorithm>
+#include <cmath>
+
+/// <summary>
+/// Screen-space point of an occluder, in pixels
+/// </summary>
+struct ScreenPoint
+{
+    float x;
+    float y;
+};
+
+static float Cross(const ScreenPoint& _o, const ScreenPoint& _a, const ScreenPoint& _b)
+{
+    return (_a.x - _o.x) * (_b.y - _o.y) - (_a.y - _o.y) * (_b.x - _o.x);
+}
+
+/// <summary>
+/// Convex hull of _points (monotone chain), counterclockwise into _hull without collinear points
+/// </summary>
+/// <returns>The number of hull points</returns>
+static size_t ConvexHull(ScreenPoint* _points, size_t _count, ScreenPoint* _hull)
+{
+    std::sort(_points, _points + _count,
+        [](const ScreenPoint& _a, const ScreenPoint& _b) { return (_a.x < _b.x) || (_a.x == _b.x && _a.y < _b.y); });
+
+    /* Lower chain left to right, then upper chain right to left: _hull needs room for 2 * _count points */
+    size_t size = 0;
+    for (size_t i = 0; i < _count; i++)
+    {
+        while (size >= 2 && Cross(_hull[size - 2], _hull[size - 1], _points[i]) <= 0.0f)
+            size--;
+        _hull[size++] = _points[i];
+    }
+    size_t lower = size + 1;
+    for (size_t i = _count - 1; i-- > 0;)
+    {
+        while (size >= lower && Cross(_hull[size - 2], _hull[size - 1], _points[i]) <= 0.0f)
+            size--;
+        _hull[size++] = _points[i];
+    }
+    return (size > 1) ? size - 1 : size;
+}
+
+/// <summary>
+/// How much further in than half a pixel the edges are moved, in pixels: more than the rounding of the spans
+/// ClipSpan computes, so that they never take in a pixel the silhouette doesn't cover entirely
+/// </summary>
+static const float s_edgeMargin = 1.0f / 256.0f;
+
+static int Clamp(int _value, int _low, int _high)
+{
+    return (_value < _low) ? _low : ((_value > _high) ? _high : _value);
+}
+
+void OcclusionBuffer::Resize(int _width, int _height)
+{
+    int tilesX = (_width + kTileWidth - 1) / kTileWidth;
+    int tilesY = (_height + kTileHeight - 1) / kTileHeight;
+    m_tilesX = (tilesX > 0) ? tilesX : 1;
+    m_width = m_tilesX * kTileWidth;
+    m_height = ((tilesY > 0) ? tilesY : 1) * kTileHeight;
+
+    m_depth.assign((size_t)m_width * m_height, 1.0f);
+    m_bins.assign((size_t)m_tilesX * (m_height / kTileHeight), std::vector<uint32_t>());
+    m_tileMaxDepth.assign(m_bins.size(), 1.0f);
+    m_occluders.clear();
+}
+
+void OcclusionBuffer::BeginFrame(const Mat4& _view, const Mat4& _projection)
+{
+    m_view = _view;
+    m_viewProjection = Mat4Multiply(_projection, _view);
+
+    /* The perspective terms: x and y scale, z_ndc = -m[10] + m[14] / d at a view depth d, near = m[14] / (m[10] - 1) */
+    m_projectionX = _projection.m[0];
+    m_projectionY = _projection.m[5];
+    m_depthOffset = -_projection.m[10];
+    m_depthScale = _projection.m[14];
+    m_nearPlane = _projection.m[14] / (_projection.m[10] - 1.0f);
+
+    m_occluders.clear();
+    for (std::vector<uint32_t>& bin : m_bins)
+        bin.clear();
+}
+
+bool OcclusionBuffer::AddOccluder(const Vec3* _points, size_t _count)
+{
+    if (_count < 3 || _count > kMaxOccluderPoints || m_bins.empty())
+        return false;
+
+    ScreenPoint points[kMaxOccluderPoints];
+    Occluder occluder;
+    occluder.depth = -1.0f;
+    for (size_t i = 0; i < _count; i++)
+    {
+        Vec4 clip = Mat4Transform(m_viewProjection, { _points[i].x, _points[i].y, _points[i].z, 1.0f });
+        if (clip.w < m_nearPlane)
+            return false;
+
+        float inverseW = 1.0f / clip.w;
+        points[i] = { (clip.x * inverseW * 0.5f + 0.5f) * m_width, (clip.y * inverseW * 0.5f + 0.5f) * m_height };
+        occluder.depth = std::max(occluder.depth, clip.z * inverseW);
+    }
+
+    ScreenPoint hull[kMaxOccluderPoints * 2];
+    size_t hullCount = ConvexHull(points, _count, hull);
+    if (hullCount < 3)
+        return false;
+
+    float minX = hull[0].x, maxX = hull[0].x, minY = hull[0].y, maxY = hull[0].y;
+    for (size_t i = 0; i < hullCount; i++)
+    {
+        const ScreenPoint& from = hull[i];
+        const ScreenPoint& to = hull[(i + 1) % hullCount];
+        float a = from.y - to.y;
+        float b = to.x - from.x;
+        occluder.a[i] = a;
+        occluder.b[i] = b;
+        occluder.c[i] = -(a * from.x + b * from.y) - (0.5f + s_edgeMargin) * (std::fabs(a) + std::fabs(b));
+        occluder.inverseA[i] = (a != 0.0f) ? 1.0f / a : 0.0f;
+
+        minX = std::min(minX, from.x);
+        maxX = std::max(maxX, from.x);
+        minY = std::min(minY, from.y);
+        maxY = std::max(maxY, from.y);
+    }
+    occluder.edgeCount = (int)((hullCount + 3) & ~(size_t)3);
+    for (size_t i = hullCount; i < (size_t)occluder.edgeCount; i++)
+    {
+        occluder.a[i] = 0.0f;
+        occluder.b[i] = 0.0f;
+        occluder.c[i] = 1.0f;
+        occluder.inverseA[i] = 0.0f;
+    }
+
+    /* Pixels whose square can be inside: those the bounding box touches */
+    occluder.minX = Clamp((int)std::floor(minX), 0, m_width);
+    occluder.maxX = Clamp((int)std::ceil(maxX), 0, m_width);
+    occluder.minY = Clamp((int)std::floor(minY), 0, m_height);
+    occluder.maxY = Clamp((int)std::ceil(maxY), 0, m_height);
+    if (occluder.maxX - occluder.minX < 1 || occluder.maxY - occluder.minY < 1)
+        return false;
+
+    uint32_t index = (uint32_t)m_occluders.size();
+    m_occluders.push_back(occluder);
+    for (int tileY = occluder.minY / kTileHeight; tileY <= (occluder.maxY - 1) / kTileHeight; tileY++)
+    {
+        for (int tileX = occluder.minX / kTileWidth; tileX <= (occluder.maxX - 1) / kTileWidth; tileX++)
+            m_bins[(size_t)tileY * m_tilesX + tileX].push_back(index);
+    }
+    return true;
+}
+
+void OcclusionBuffer::ClearTile(int _x, int _y)
+{
+    for (int y = _y; y < _y + kTileHeight; y++)
+        std::fill(m_depth.begin() + (size_t)y * m_width + _x, m_depth.begin() + (size_t)y * m_width + _x + kTileWidth, 1.0f);
+}
+
+bool OcclusionBuffer::ClipSpanScalar(const Occluder& _occluder, int _y, int& _x0, int& _x1)
+{
+    /* Each edge bounds the pixel centers x + 0.5 on one side: a * x + v >= 0, v its value at x = 0 on this row */
+    float left = (float)_x0 + 0.5f, right = (float)_x1 - 0.5f;
+    float centerY = (float)_y + 0.5f;
+    for (int e = 0; e < _occluder.edgeCount; e++)
+    {
+        float value = _occluder.b[e] * centerY + _occluder.c[e];
+        float bound = -value * _occluder.inverseA[e];
+        if (_occluder.a[e] > 0.0f)
+            left = std::max(left, bound);
+        else if (_occluder.a[e] < 0.0f)
+            right = std::min(right, bound);
+        else if (value < 0.0f)
+            return false;
+    }
+
+    _x0 = (int)std::ceil(left - 0.5f);
+    _x1 = (int)std::floor(right - 0.5f) + 1;
+    return _x0 < _x1;
+}
+
+bool OcclusionBuffer::ClipSpan(const Occluder& _occluder, int _y, int& _x0, int& _x1)
+{
+#if MYOPENGL_SIMD_SSE
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 centerY = _mm_set1_ps((float)_y + 0.5f);
+    __m128 left = _mm_set1_ps((float)_x0 + 0.5f);
+    __m128 right = _mm_set1_ps((float)_x1 - 0.5f);
+    __m128 outside = zero;
+    for (int e = 0; e < _occluder.edgeCount; e += 4)
+    {
+        __m128 a = _mm_load_ps(_occluder.a + e);
+        __m128 value = _mm_add_ps(_mm_mul_ps(_mm_load_ps(_occluder.b + e), centerY), _mm_load_ps(_occluder.c + e));
+        __m128 bound = _mm_mul_ps(_mm_sub_ps(zero, value), _mm_load_ps(_occluder.inverseA + e));
+
+        /* Edges facing right raise the left bound, edges facing left lower the right one, flat ones keep or drop the row */
+        __m128 facesRight = _mm_cmpgt_ps(a, zero);
+        __m128 facesLeft = _mm_cmplt_ps(a, zero);
+        left = _mm_max_ps(left, _mm_or_ps(_mm_and_ps(facesRight, bound), _mm_andnot_ps(facesRight, left)));
+        right = _mm_min_ps(right, _mm_or_ps(_mm_and_ps(facesLeft, bound), _mm_andnot_ps(facesLeft, right)));
+        outside = _mm_or_ps(outside, _mm_and_ps(_mm_cmpeq_ps(a, zero), _mm_cmplt_ps(value, zero)));
+    }
+    if (_mm_movemask_ps(outside) != 0)
+        return false;
+
+    left = _mm_max_ps(left, MYOPENGL_SWIZZLE(left, 2, 3, 0, 1));
+    left = _mm_max_ps(left, MYOPENGL_SWIZZLE(left, 1, 0, 3, 2));
+    right = _mm_min_ps(right, MYOPENGL_SWIZZLE(right, 2, 3, 0, 1));
+    right = _mm_min_ps(right, MYOPENGL_SWIZZLE(right, 1, 0, 3, 2));
+
+    _x0 = (int)std::ceil(_mm_cvtss_f32(left) - 0.5f);
+    _x1 = (int)std::floor(_mm_cvtss_f32(right) - 0.5f) + 1;
+    return _x0 < _x1;
+#else
+    return ClipSpanScalar(_occluder, _y, _x0, _x1);
+#endif
+}
+
+/// <summary>
+/// _row[x] = min(_row[x], _depth) for x in [_x0, _x1)
+/// </summary>
+static inline void FillSpanScalar(float* _row, int _x0, int _x1, float _depth)
+{
+    for (int x = _x0; x < _x1; x++)
+        _row[x] = (_depth < _row[x]) ? _depth : _row[x];
+}
+
+static inline void FillSpan(float* _row, int _x0, int _x1, float _depth)
+{
+    /* The last group ends on _x1, overlapping the one before it rather than going scalar: min doesn't mind twice */
+#if MYOPENGL_SIMD_AVX2
+    if (_x1 - _x0 < 8)
+        return FillSpanScalar(_row, _x0, _x1, _depth);
+
+    const __m256 depth = _mm256_set1_ps(_depth);
+    for (int x = _x0; x + 8 < _x1; x += 8)
+        _mm256_storeu_ps(_row + x, _mm256_min_ps(_mm256_loadu_ps(_row + x), depth));
+    _mm256_storeu_ps(_row + _x1 - 8, _mm256_min_ps(_mm256_loadu_ps(_row + _x1 - 8), depth));
+#elif MYOPENGL_SIMD_SSE
+    if (_x1 - _x0 < 4)
+        return FillSpanScalar(_row, _x0, _x1, _depth);
+
+    const __m128 depth = _mm_set1_ps(_depth);
+    for (int x = _x0; x + 4 < _x1; x += 4)
+        _mm_storeu_ps(_row + x, _mm_min_ps(_mm_loadu_ps(_row + x), depth));
+    _mm_storeu_ps(_row + _x1 - 4, _mm_min_ps(_mm_loadu_ps(_row + _x1 - 4), depth));
+#else
+    FillSpanScalar(_row, _x0, _x1, _depth);
+#endif
+}
+
+/// <summary>
+/// Farthest depth of the kTileWidth pixels from _row
+/// </summary>
+static inline float TileRowMaximumScalar(const float* _row)
+{
+    float maximum = _row[0];
+    for (int x = 1; x < OcclusionBuffer::kTileWidth; x++)
+        maximum = (_row[x] > maximum) ? _row[x] : maximum;
+    return maximum;
+}
+
+static inline float TileRowMaximum(const float* _row)
+{
+#if MYOPENGL_SIMD_SSE
+    __m128 maximum = _mm_loadu_ps(_row);
+    for (int x = 4; x < OcclusionBuffer::kTileWidth; x += 4)
+        maximum = _mm_max_ps(maximum, _mm_loadu_ps(_row + x));
+    maximum = _mm_max_ps(maximum, MYOPENGL_SWIZZLE(maximum, 2, 3, 0, 1));
+    maximum = _mm_max_ps(maximum, MYOPENGL_SWIZZLE(maximum, 1, 0, 3, 2));
+    return _mm_cvtss_f32(maximum);
+#else
+    return TileRowMaximumScalar(_row);
+#endif
+}
+
+template <bool kSimd>
+void OcclusionBuffer::RasterizeTile(size_t _tile)
+{
+    int tileX = (int)(_tile % m_tilesX) * kTileWidth;
+    int tileY = (int)(_tile / m_tilesX) * kTileHeight;
+    ClearTile(tileX, tileY);
+
+    for (uint32_t index : m_bins[_tile])
+    {
+        const Occluder& occluder = m_occluders[index];
+        int y0 = std::max(occluder.minY, tileY), y1 = std::min(occluder.maxY, tileY + kTileHeight);
+        for (int y = y0; y < y1; y++)
+        {
+            int x0 = std::max(occluder.minX, tileX), x1 = std::min(occluder.maxX, tileX + kTileWidth);
+            if (!(kSimd ? ClipSpan(occluder, y, x0, x1) : ClipSpanScalar(occluder, y, x0, x1)))
+                continue;
+
+            if (kSimd)
+                FillSpan(m_depth.data() + (size_t)y * m_width, x0, x1, occluder.depth);
+            else
+                FillSpanScalar(m_depth.data() + (size_t)y * m_width, x0, x1, occluder.depth);
+        }
+    }
+
+    float maximum = -1.0f;
+    for (int y = tileY; y < tileY + kTileHeight; y++)
+    {
+        const float* row = m_depth.data() + (size_t)y * m_width + tileX;
+        maximum = std::max(maximum, kSimd ? TileRowMaximum(row) : TileRowMaximumScalar(row));
+    }
+    m_tileMaxDepth[_tile] = maximum;
+}
+
+void OcclusionBuffer::RasterizeTilesScalar(size_t _first, size_t _last)
+{
+    for (size_t tile = _first; tile < _last; tile++)
+        RasterizeTile<false>(tile);
+}
+
+void OcclusionBuffer::RasterizeTiles(size_t _first, size_t _last)
+{
+    for (size_t tile = _first; tile < _last; tile++)
+        RasterizeTile<true>(tile);
+}
+
+bool OcclusionBuffer::GetSphereRect(const Vec3& _center, float _radius, int* _rect, float& _nearestDepth) const
+{
+    Vec4 center = Mat4Transform(m_view, { _center.x, _center.y, _center.z, 1.0f });
+    float nearDistance = -center.z - _radius;
+    float farDistance = -center.z + _radius;
+    if (nearDistance <= m_nearPlane)
+        return false;
+
+    /* The box around the sphere projects inside the extremes of its corners: x / d at the nearest and farthest d */
+    float inverseNear = 1.0f / nearDistance, inverseFar = 1.0f / farDistance;
+    float minX = std::min((center.x - _radius) * inverseNear, (center.x - _radius) * inverseFar) * m_projectionX;
+    float maxX = std::max((center.x + _radius) * inverseNear, (center.x + _radius) * inverseFar) * m_projectionX;
+    float minY = std::min((center.y - _radius) * inverseNear, (center.y - _radius) * inverseFar) * m_projectionY;
+    float maxY = std::max((center.y + _radius) * inverseNear, (center.y + _radius) * inverseFar) * m_projectionY;
+
+    GetPixelRect(minX, minY, maxX, maxY, _rect);
+    _nearestDepth = m_depthOffset + m_depthScale * inverseNear;
+    return true;
+}
+
+void OcclusionBuffer::GetPixelRect(float _minX, float _minY, float _maxX, float _maxY, int* _rect) const
+{
+    /* Clamped in float first: the bounds of a sphere next to the near plane can be far out of int range */
+    _rect[0] = Clamp((int)std::floor(std::max((_minX * 0.5f + 0.5f) * m_width, -1.0f)), 0, m_width);
+    _rect[1] = Clamp((int)std::floor(std::max((_minY * 0.5f + 0.5f) * m_height, -1.0f)), 0, m_height);
+    _rect[2] = Clamp((int)std::ceil(std::min((_maxX * 0.5f + 0.5f) * m_width, m_width + 1.0f)), 0, m_width);
+    _rect[3] = Clamp((int)std::ceil(std::min((_maxY * 0.5f + 0.5f) * m_height, m_height + 1.0f)), 0, m_height);
+}
+
+/// <summary>
+/// Whether one of the pixels [_x0, _x1) of _row is not in front of _depth
+/// </summary>
+static inline bool IsSpanVisibleScalar(const float* _row, int _x0, int _x1, float _depth)
+{
+    for (int x = _x0; x < _x1; x++)
+    {
+        if (_row[x] >= _depth)
+            return true;
+    }
+    return false;
+}
+
+static inline bool IsSpanVisible(const float* _row, int _x0, int _x1, float _depth)
+{
+    /* As FillSpan, the last group ends on _x1 */
+#if MYOPENGL_SIMD_AVX2
+    if (_x1 - _x0 < 8)
+        return IsSpanVisibleScalar(_row, _x0, _x1, _depth);
+
+    const __m256 depth = _mm256_set1_ps(_depth);
+    for (int x = _x0; x + 8 < _x1; x += 8)
+    {
+        if (_mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(_row + x), depth, _CMP_GE_OQ)) != 0)
+            return true;
+    }
+    return _mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(_row + _x1 - 8), depth, _CMP_GE_OQ)) != 0;
+#elif MYOPENGL_SIMD_SSE
+    if (_x1 - _x0 < 4)
+        return IsSpanVisibleScalar(_row, _x0, _x1, _depth);
+
+    const __m128 depth = _mm_set1_ps(_depth);
+    for (int x = _x0; x + 4 < _x1; x += 4)
+    {
+        if (_mm_movemask_ps(_mm_cmpge_ps(_mm_loadu_ps(_row + x), depth)) != 0)
+            return true;
+    }
+    return _mm_movemask_ps(_mm_cmpge_ps(_mm_loadu_ps(_row + _x1 - 4), depth)) != 0;
+#else
+    return IsSpanVisibleScalar(_row, _x0, _x1, _depth);
+#endif
+}
+
+template <bool kSimd>
+bool OcclusionBuffer::IsRectVisible(const int* _rect, float _nearestDepth) const
+{
+    if (_rect[0] >= _rect[2] || _rect[1] >= _rect[3])
+        return false;
+
+    for (int tileY = _rect[1] / kTileHeight; tileY * kTileHeight < _rect[3]; tileY++)
+    {
+        for (int tileX = _rect[0] / kTileWidth; tileX * kTileWidth < _rect[2]; tileX++)
+        {
+            /* A tile entirely in front of the sphere needs no pixel read */
+            if (m_tileMaxDepth[(size_t)tileY * m_tilesX + tileX] < _nearestDepth)
+                continue;
+
+            int x0 = std::max(_rect[0], tileX * kTileWidth), x1 = std::min(_rect[2], (tileX + 1) * kTileWidth);
+            int y0 = std::max(_rect[1], tileY * kTileHeight), y1 = std::min(_rect[3], (tileY + 1) * kTileHeight);
+            for (int y = y0; y < y1; y++)
+            {
+                const float* row = m_depth.data() + (size_t)y * m_width;
+                if (kSimd ? IsSpanVisible(row, x0, x1, _nearestDepth) : IsSpanVisibleScalar(row, x0, x1, _nearestDepth))
+                    return true;
+            }
+        }
+    }
+    return false;
+}
+
+size_t OcclusionBuffer::CullOccludedSpheresScalar(const SphereColumns& _spheres, float _radiusScale, const uint32_t* _rows, size_t _count,
+    uint32_t* _visible) const
+{
+    size_t written = 0;
+    for (size_t i = 0; i < _count; i++)
+    {
+        uint32_t row = _rows[i];
+        int rect[4];
+        float nearestDepth;
+        bool visible = !GetSphereRect({ _spheres.x[row], _spheres.y[row], _spheres.z[row] }, _spheres.radius[row] * _radiusScale, rect, nearestDepth)
+            || IsRectVisible<false>(rect, nearestDepth);
+
+        _visible[written] = row;
+        written += visible ? 1 : 0;
+    }
+    return written;
+}
+
+size_t OcclusionBuffer::CullOccludedSpheres(const SphereColumns& _spheres, float _radiusScale, const uint32_t* _rows, size_t _count,
+    uint32_t* _visible) const
+{
+#if MYOPENGL_SIMD_SSE
+    /* The view rows giving x, y and z in view space, and the projection terms GetSphereRect uses */
+    const float* m = m_view.m;
+    __m128 view[3][4];
+    for (int r = 0; r < 3; r++)
+    {
+        for (int c = 0; c < 4; c++)
+            view[r][c] = _mm_set1_ps(m[c * 4 + r]);
+    }
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 nearPlane = _mm_set1_ps(m_nearPlane);
+    const __m128 projectionX = _mm_set1_ps(m_projectionX);
+    const __m128 projectionY = _mm_set1_ps(m_projectionY);
+    const __m128 radiusScale = _mm_set1_ps(_radiusScale);
+
+    size_t written = 0;
+    for (size_t i = 0; i < _count; i += 4)
+    {
+        /* Gather 4 spheres (the last group repeats its last one) */
+        size_t lanes = (_count - i < 4) ? _count - i : 4;
+        alignas(16) float gathered[4][4];
+        for (size_t lane = 0; lane < 4; lane++)
+        {
+            uint32_t row = _rows[i + ((lane < lanes) ? lane : lanes - 1)];
+            gathered[0][lane] = _spheres.x[row];
+            gathered[1][lane] = _spheres.y[row];
+            gathered[2][lane] = _spheres.z[row];
+            gathered[3][lane] = _spheres.radius[row];
+        }
+        __m128 x = _mm_load_ps(gathered[0]);
+        __m128 y = _mm_load_ps(gathered[1]);
+        __m128 z = _mm_load_ps(gathered[2]);
+        __m128 radius = _mm_mul_ps(_mm_load_ps(gathered[3]), radiusScale);
+
+        /* In the order Mat4Transform adds the columns, so each lane rounds as GetSphereRect does */
+        __m128 centerView[3];
+        for (int r = 0; r < 3; r++)
+            centerView[r] = MulAdd(view[r][3], one, MulAdd(view[r][2], z, MulAdd(view[r][1], y, _mm_mul_ps(view[r][0], x))));
+
+        __m128 nearDistance = _mm_sub_ps(_mm_sub_ps(_mm_setzero_ps(), centerView[2]), radius);
+        __m128 farDistance = _mm_add_ps(_mm_sub_ps(_mm_setzero_ps(), centerView[2]), radius);
+        __m128 inverseNear = _mm_div_ps(one, nearDistance);
+        __m128 inverseFar = _mm_div_ps(one, farDistance);
+        __m128 lowX = _mm_sub_ps(centerView[0], radius), highX = _mm_add_ps(centerView[0], radius);
+        __m128 lowY = _mm_sub_ps(centerView[1], radius), highY = _mm_add_ps(centerView[1], radius);
+
+        alignas(16) float bounds[4][4];
+        _mm_store_ps(bounds[0], _mm_mul_ps(_mm_min_ps(_mm_mul_ps(lowX, inverseNear), _mm_mul_ps(lowX, inverseFar)), projectionX));
+        _mm_store_ps(bounds[1], _mm_mul_ps(_mm_min_ps(_mm_mul_ps(lowY, inverseNear), _mm_mul_ps(lowY, inverseFar)), projectionY));
+        _mm_store_ps(bounds[2], _mm_mul_ps(_mm_max_ps(_mm_mul_ps(highX, inverseNear), _mm_mul_ps(highX, inverseFar)), projectionX));
+        _mm_store_ps(bounds[3], _mm_mul_ps(_mm_max_ps(_mm_mul_ps(highY, inverseNear), _mm_mul_ps(highY, inverseFar)), projectionY));
+        alignas(16) float nearestDepth[4];
+        _mm_store_ps(nearestDepth, MulAdd(_mm_set1_ps(m_depthScale), inverseNear, _mm_set1_ps(m_depthOffset)));
+        int testable = _mm_movemask_ps(_mm_cmpgt_ps(nearDistance, nearPlane));
+
+        for (size_t lane = 0; lane < lanes; lane++)
+        {
+            bool visible = true;
+            if ((testable >> lane) & 1)
+            {
+                int rect[4];
+                GetPixelRect(bounds[0][lane], bounds[1][lane], bounds[2][lane], bounds[3][lane], rect);
+                visible = IsRectVisible<true>(rect, nearestDepth[lane]);
+            }
+
+            _visible[written] = _rows[i + lane];
+            written += visible ? 1 : 0;
+        }
+    }
+    return written;
+#else
+    return CullOccludedSpheresScalar(_spheres, _radiusScale, _rows, _count, _visible);
+#endif
+}
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "FrustumCulling.h"
+#include "VectorMath.h"
+
+/// <summary>
+/// Coarse depth buffer for occlusion culling on the CPU: a few large occluders are drawn into it, then the bounding
+/// spheres of the objects are tested against it before they are submitted.
+/// An occluder is a convex object given by its points (its vertices): it is drawn as the convex hull of their
+/// projections at one depth, the farthest of theirs, which the object is in front of everywhere inside its
+/// silhouette. Only the pixels entirely inside the silhouette are written. Both ways the buffer never holds a depth
+/// nearer than what the occluders actually hide, so a sphere it rejects is hidden at any resolution.
+/// The buffer is split in tiles of kTileWidth x kTileHeight pixels: AddOccluder bins an occluder in the tiles its
+/// silhouette overlaps, then RasterizeTiles clears and draws a range of tiles on its own, so the tiles can be
+/// split across threads. Depth is NDC z (-1 near, 1 far), rows from the bottom of the view up
+/// </summary>
+class OcclusionBuffer
+{
+public:
+    static const int kTileWidth = 32;
+    static const int kTileHeight = 16;
+
+    /// <summary>
+    /// Most points an occluder can have
+    /// </summary>
+    static const size_t kMaxOccluderPoints = 16;
+
+    /// <summary>
+    /// Size the buffer to _width x _height pixels, rounded up to whole tiles. Drops the occluders
+    /// </summary>
+    /// <param name="_width"></param>
+    /// <param name="_height"></param>
+    void Resize(int _width, int _height);
+
+    int GetWidth() const { return m_width; }
+    int GetHeight() const { return m_height; }
+    size_t GetTileCount() const { return m_bins.size(); }
+
+    /// <summary>
+    /// Start a frame seen through _view and _projection (a perspective projection, as Mat4Perspective builds
+    /// it): the occluders of the previous frame are dropped, every tile is cleared when it is rasterized
+    /// </summary>
+    /// <param name="_view"></param>
+    /// <param name="_projection"></param>
+    void BeginFrame(const Mat4& _view, const Mat4& _projection);
+
+    /// <summary>
+    /// Add the convex object whose world-space points are _points as an occluder
+    /// </summary>
+    /// <param name="_points"></param>
+    /// <param name="_count">At most kMaxOccluderPoints</param>
+    /// <returns>False if it was left out: it crosses the near plane, or its silhouette covers no pixel</returns>
+    bool AddOccluder(const Vec3* _points, size_t _count);
+
+    size_t GetOccluderCount() const { return m_occluders.size(); }
+
+    /// <summary>
+    /// Clear the tiles [_first, _last) (in rows of tiles from the bottom) and draw the occluders binned in them:
+    /// each row of a silhouette is the span of pixels its edges leave, filled a register at a time
+    /// </summary>
+    /// <param name="_first"></param>
+    /// <param name="_last"></param>
+    void RasterizeTiles(size_t _first, size_t _last);
+    void RasterizeTilesScalar(size_t _first, size_t _last);
+
+    /// <summary>
+    /// Keep the spheres that may be visible past the occluders: a sphere is dropped only when every pixel of its
+    /// screen rectangle holds a depth in front of its nearest point, or the rectangle is outside the view.
+    /// The spheres are _spheres' entries _rows[0.._count) (radius times _radiusScale); the rows of those kept are
+    /// written in order to _visible, which may be _rows. The rectangles are projected 4 spheres at a time, then the
+    /// tiles whose farthest depth is in front of the sphere are skipped whole and the others compared a register
+    /// at a time. RasterizeTiles must have drawn every tile
+    /// </summary>
+    /// <param name="_spheres"></param>
+    /// <param name="_radiusScale"></param>
+    /// <param name="_rows"></param>
+    /// <param name="_count"></param>
+    /// <param name="_visible"></param>
+    /// <returns>The number of spheres kept</returns>
+    size_t CullOccludedSpheres(const SphereColumns& _spheres, float _radiusScale, const uint32_t* _rows, size_t _count, uint32_t* _visible) const;
+    size_t CullOccludedSpheresScalar(const SphereColumns& _spheres, float _radiusScale, const uint32_t* _rows, size_t _count, uint32_t* _visible) const;
+
+    const float* GetDepth() const { return m_depth.data(); }
+
+private:
+    /// <summary>
+    /// A silhouette ready to rasterize: a pixel (center x, y) is inside when a * x + b * y + c >= 0 for every
+    /// edge, the edges moved in by a bit more than half a pixel so that it means the whole pixel is. The edges are
+    /// columns, edgeCount of them padded to a multiple of 4 with edges every pixel is inside (a = b = 0, c = 1).
+    /// Drawn at depth over the pixels [minX, maxX) x [minY, maxY)
+    /// </summary>
+    struct alignas(16) Occluder
+    {
+        float a[kMaxOccluderPoints];
+        float b[kMaxOccluderPoints];
+        float c[kMaxOccluderPoints];
+        float inverseA[kMaxOccluderPoints];
+        int edgeCount;
+        float depth;
+        int minX;
+        int minY;
+        int maxX;
+        int maxY;
+    };
+
+    /// <summary>
+    /// The pixels [_rect[0], _rect[2]) x [_rect[1], _rect[3]) the sphere may cover and the depth of its nearest point
+    /// </summary>
+    /// <returns>False if the sphere reaches the near plane: it can't be tested</returns>
+    bool GetSphereRect(const Vec3& _center, float _radius, int* _rect, float& _nearestDepth) const;
+
+    /// <summary>
+    /// The pixel rectangle of GetSphereRect from its bounds in NDC
+    /// </summary>
+    void GetPixelRect(float _minX, float _minY, float _maxX, float _maxY, int* _rect) const;
+
+    /// <summary>
+    /// Narrow the pixels [_x0, _x1) of row _y to those inside _occluder, 4 edges at a time
+    /// </summary>
+    /// <returns>False if none is</returns>
+    static bool ClipSpan(const Occluder& _occluder, int _y, int& _x0, int& _x1);
+    static bool ClipSpanScalar(const Occluder& _occluder, int _y, int& _x0, int& _x1);
+
+    void ClearTile(int _x, int _y);
+
+    /// <summary>
+    /// RasterizeTiles for one tile, then its farthest depth. kSimd selects the SIMD or the scalar kernels
+    /// </summary>
+    template <bool kSimd>
+    void RasterizeTile(size_t _tile);
+
+    template <bool kSimd>
+    bool IsRectVisible(const int* _rect, float _nearestDepth) const;
+
+    std::vector<float> m_depth;
+    std::vector<Occluder> m_occluders;
+    std::vector<std::vector<uint32_t>> m_bins;
+    std::vector<float> m_tileMaxDepth;
+    int m_width = 0;
+    int m_height = 0;
+    int m_tilesX = 0;
+
+    Mat4 m_view = Mat4Identity();
+    Mat4 m_viewProjection = Mat4Identity();
+    float m_projectionX = 1.0f;
+    float m_projectionY = 1.0f;
+    float m_depthScale = 0.0f;
+    float m_depthOffset = 0.0f;
+    float m_nearPlane = 0.0f;
+};
@@ -0,0 +1,152 @@
+#include "Profiler.h"
+
+#include <atomic>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+bool Profiler::s_enabled = false;
+
+/// <summary>
+/// One finished zone
+/// </summary>
+struct ProfileEvent
+{
+    const char* name;
+    uint64_t begin;
+    uint64_t end;
+};
+
+/// <summary>
+/// Events of one thread. Only its thread writes to it; the count is published with release
+/// semantics so the exporter can read the buffer of a thread that is still alive
+/// </summary>
+struct ProfileThreadBuffer
+{
+    std::unique_ptr<ProfileEvent[]> events;
+    std::atomic<uint32_t> count;
+    uint32_t dropped;
+    uint32_t threadId;
+    std::string threadName;
+};
+
+/// <summary>
+/// Every buffer ever created. Buffers are never freed before exit so a trace can still be written
+/// after its threads are gone
+/// </summary>
+static std::mutex s_buffersMutex;
+static std::vector<std::unique_ptr<ProfileThreadBuffer>> s_buffers;
+static thread_local ProfileThreadBuffer* s_threadBuffer = nullptr;
+
+/// <summary>
+/// Buffer of the calling thread, allocated on first use (the only allocation a thread ever does)
+/// </summary>
+/// <returns></returns>
+static ProfileThreadBuffer* GetThreadBuffer()
+{
+    if (s_threadBuffer == nullptr)
+    {
+        std::unique_ptr<ProfileThreadBuffer> buffer(new ProfileThreadBuffer());
+        buffer->events.reset(new ProfileEvent[Profiler::kEventsPerThread]);
+        buffer->count.store(0, std::memory_order_relaxed);
+        buffer->dropped = 0;
+
+        std::lock_guard<std::mutex> lock(s_buffersMutex);
+        buffer->threadId = (uint32_t)s_buffers.size() + 1;
+        buffer->threadName = "Thread " + std::to_string(buffer->threadId);
+        s_threadBuffer = buffer.get();
+        s_buffers.push_back(std::move(buffer));
+    }
+
+    return s_threadBuffer;
+}
+
+void Profiler::SetEnabled(bool _enabled)
+{
+    s_enabled = _enabled;
+}
+
+void Profiler::SetThreadName(const char* _name)
+{
+    ProfileThreadBuffer* buffer = GetThreadBuffer();
+
+    std::lock_guard<std::mutex> lock(s_buffersMutex);
+    buffer->threadName = _name;
+}
+
+void Profiler::Record(const char* _name, uint64_t _begin, uint64_t _end)
+{
+    ProfileThreadBuffer* buffer = GetThreadBuffer();
+    uint32_t index = buffer->count.load(std::memory_order_relaxed);
+
+    if (index >= kEventsPerThread)
+    {
+        buffer->dropped++;
+        return;
+    }
+
+    ProfileEvent& event = buffer->events[index];
+    event.name = _name;
+    event.begin = _begin;
+    event.end = _end;
+    buffer->count.store(index + 1, std::memory_order_release);
+}
+
+bool Profiler::WriteChromeTrace(const char* _fileName)
+{
+    FILE* file = fopen(_fileName, "w");
+
+    if (file == NULL)
+    {
+        std::cout << "Unable to write the trace " << _fileName << std::endl;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(s_buffersMutex);
+
+    /* Timestamps are written relative to the first event to keep them short */
+    uint64_t origin = UINT64_MAX;
+    for (const std::unique_ptr<ProfileThreadBuffer>& buffer : s_buffers)
+    {
+        uint32_t count = buffer->count.load(std::memory_order_acquire);
+        for (uint32_t i = 0; i < count; i++)
+            origin = (buffer->events[i].begin < origin) ? buffer->events[i].begin : origin;
+    }
+    origin = (origin == UINT64_MAX) ? 0 : origin;
+
+    fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+
+    bool first = true;
+    uint32_t dropped = 0;
+
+    for (const std::unique_ptr<ProfileThreadBuffer>& buffer : s_buffers)
+    {
+        fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+            first ? "" : ",\n", buffer->threadId, buffer->threadName.c_str());
+        first = false;
+
+        uint32_t count = buffer->count.load(std::memory_order_acquire);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            const ProfileEvent& event = buffer->events[i];
+            fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                event.name, buffer->threadId,
+                (double)(event.begin - origin) / 1000.0,
+                (double)(event.end - event.begin) / 1000.0);
+        }
+
+        dropped += buffer->dropped;
+    }
+
+    fprintf(file, "\n]}\n");
+    bool written = (ferror(file) == 0);
+    fclose(file);
+
+    if (dropped > 0)
+        std::cout << "Profiler buffers were full, " << dropped << " zones are missing from the trace" << std::endl;
+
+    return written;
+}
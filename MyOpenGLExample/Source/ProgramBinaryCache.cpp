@@ -0,0 +1,168 @@
+#include "ProgramBinaryCache.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <fstream>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#include "Profiler.h"
+
+/// <summary>
+/// Header of a cache file, followed by the binary itself
+/// </summary>
+struct ProgramBinaryHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    uint32_t format;
+    uint32_t length;
+};
+
+static const uint32_t s_binaryMagic = 0x42504C47u; // "GLPB"
+static const uint32_t s_binaryVersion = 1;
+
+/// <summary>
+/// 64-bit FNV-1a of _size bytes, continuing from _hash
+/// </summary>
+static uint64_t HashBytes(uint64_t _hash, const void* _data, size_t _size)
+{
+    const unsigned char* bytes = (const unsigned char*)_data;
+    for (size_t i = 0; i < _size; i++)
+    {
+        _hash ^= bytes[i];
+        _hash *= 1099511628211ull;
+    }
+    return _hash;
+}
+
+/// <summary>
+/// Hash a string and its length, so "ab" + "c" and "a" + "bc" differ
+/// </summary>
+static uint64_t HashString(uint64_t _hash, const char* _string)
+{
+    std::string value = (_string != NULL) ? _string : "";
+    uint64_t length = value.size();
+    _hash = HashBytes(_hash, &length, sizeof(length));
+    return HashBytes(_hash, value.data(), value.size());
+}
+
+static bool CreateDirectory(const std::string& _directory)
+{
+#ifdef _WIN32
+    return _mkdir(_directory.c_str()) == 0 || errno == EEXIST;
+#else
+    return mkdir(_directory.c_str(), 0755) == 0 || errno == EEXIST;
+#endif
+}
+
+void ProgramBinaryCache::Initialize(const std::string& _directory)
+{
+    m_directory = _directory;
+    m_enabled = false;
+
+    if (m_directory.empty() || !(GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary))
+        return;
+
+    GLint formatCount = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+
+    m_enabled = formatCount > 0 && CreateDirectory(m_directory);
+}
+
+uint64_t ProgramBinaryCache::ComputeKey(const std::vector<ShaderSourceSpan>& _sources, const std::string& _defines)
+{
+    uint64_t hash = 14695981039346656037ull;
+
+    /* A binary only loads on the driver that made it */
+    hash = HashString(hash, (const char*)glGetString(GL_VENDOR));
+    hash = HashString(hash, (const char*)glGetString(GL_RENDERER));
+    hash = HashString(hash, (const char*)glGetString(GL_VERSION));
+    hash = HashString(hash, _defines.c_str());
+
+    for (const ShaderSourceSpan& source : _sources)
+    {
+        uint64_t length = (uint64_t)source.length;
+        hash = HashBytes(hash, &length, sizeof(length));
+        hash = HashBytes(hash, source.data, (size_t)source.length);
+    }
+
+    return hash;
+}
+
+std::string ProgramBinaryCache::GetFileName(uint64_t _key) const
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)_key);
+    return m_directory + "/" + name;
+}
+
+bool ProgramBinaryCache::Load(GLuint _program, uint64_t _key) const
+{
+    PROFILE_ZONE("ProgramBinaryCache::Load");
+
+    if (!m_enabled)
+        return false;
+
+    std::ifstream file(GetFileName(_key), std::ios::in | std::ios::binary);
+    if (!file)
+        return false;
+
+    ProgramBinaryHeader header;
+    if (!file.read((char*)&header, sizeof(header)) || header.magic != s_binaryMagic || header.version != s_binaryVersion
+        || header.key != _key || header.length == 0)
+        return false;
+
+    std::vector<char> binary(header.length);
+    if (!file.read(binary.data(), binary.size()))
+        return false;
+
+    /* The driver may still refuse it (other build, other settings): the program is then just not linked */
+    glProgramBinary(_program, header.format, binary.data(), (GLsizei)binary.size());
+
+    GLint linked = 0;
+    glGetProgramiv(_program, GL_LINK_STATUS, &linked);
+    return linked != 0;
+}
+
+void ProgramBinaryCache::Save(GLuint _program, uint64_t _key) const
+{
+    PROFILE_ZONE("ProgramBinaryCache::Save");
+
+    if (!m_enabled)
+        return;
+
+    GLint length = 0;
+    glGetProgramiv(_program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    glGetProgramBinary(_program, length, &length, &format, binary.data());
+
+    ProgramBinaryHeader header = { s_binaryMagic, s_binaryVersion, _key, format, (uint32_t)length };
+
+    /* Write aside and rename, so a crash never leaves a truncated entry under the real name */
+    std::string fileName = GetFileName(_key);
+    std::string tempName = fileName + ".tmp";
+    {
+        std::ofstream file(tempName, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!file.write((const char*)&header, sizeof(header)) || !file.write(binary.data(), length))
+            return;
+    }
+
+    std::remove(fileName.c_str());
+    std::rename(tempName.c_str(), fileName.c_str());
+}
+
+void ProgramBinaryCache::PrepareForLink(GLuint _program) const
+{
+    if (m_enabled)
+        glProgramParameteri(_program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
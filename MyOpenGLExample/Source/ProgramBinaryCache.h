@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "ShaderSourceCache.h"
+
+/// <summary>
+/// On-disk cache of linked programs (glGetProgramBinary / glProgramBinary, GL 4.1 or ARB_get_program_binary).
+/// Entries are keyed by a hash of the shader sources, their defines and the driver strings, so editing a
+/// shader or updating the driver just misses. A binary the driver refuses also misses: the caller then
+/// compiles from source and saves the result
+/// </summary>
+class ProgramBinaryCache
+{
+public:
+    /// <summary>
+    /// Use _directory for the cache files (created if needed). Empty, or a driver without binary formats,
+    /// leaves the cache disabled: every lookup misses and nothing is saved
+    /// </summary>
+    /// <param name="_directory"></param>
+    void Initialize(const std::string& _directory);
+
+    bool IsEnabled() const { return m_enabled; }
+
+    /// <summary>
+    /// Key of the program built from the source pieces _sources (in attach order) with _defines, for this driver
+    /// </summary>
+    /// <param name="_sources"></param>
+    /// <param name="_defines"></param>
+    /// <returns></returns>
+    static uint64_t ComputeKey(const std::vector<ShaderSourceSpan>& _sources, const std::string& _defines);
+
+    /// <summary>
+    /// Load the binary cached for _key into _program. True if _program is now linked
+    /// </summary>
+    /// <param name="_program"></param>
+    /// <param name="_key"></param>
+    /// <returns></returns>
+    bool Load(GLuint _program, uint64_t _key) const;
+
+    /// <summary>
+    /// Store the binary of the linked _program under _key. Set GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+    /// (see PrepareForLink) before linking it
+    /// </summary>
+    /// <param name="_program"></param>
+    /// <param name="_key"></param>
+    void Save(GLuint _program, uint64_t _key) const;
+
+    /// <summary>
+    /// Ask the driver to keep the binary of _program around for Save. Call before glLinkProgram
+    /// </summary>
+    /// <param name="_program"></param>
+    void PrepareForLink(GLuint _program) const;
+
+private:
+    std::string GetFileName(uint64_t _key) const;
+
+    std::string m_directory;
+    bool m_enabled = false;
+};
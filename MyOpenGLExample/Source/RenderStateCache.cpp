@@ -0,0 +1,306 @@
+#include "RenderStateCache.h"
+
+#include <cstring>
+
+/// <summary>
+/// Cached value meaning "unknown", no GL object or enum has it
+/// </summary>
+static const GLuint s_unknown = 0xFFFFFFFFu;
+
+/// <summary>
+/// Generic buffer targets the cache tracks, by slot
+/// </summary>
+static const GLenum s_bufferTargets[] =
+{
+    GL_ARRAY_BUFFER, GL_ELEMENT_ARRAY_BUFFER, GL_DRAW_INDIRECT_BUFFER, GL_DISPATCH_INDIRECT_BUFFER,
+    GL_UNIFORM_BUFFER, GL_SHADER_STORAGE_BUFFER, GL_PIXEL_PACK_BUFFER,
+};
+
+/// <summary>
+/// Capabilities the cache tracks, by slot
+/// </summary>
+static const GLenum s_capabilities[] =
+{
+    GL_DEPTH_TEST, GL_CULL_FACE, GL_BLEND, GL_SCISSOR_TEST, GL_STENCIL_TEST,
+    GL_PRIMITIVE_RESTART, GL_PRIMITIVE_RESTART_FIXED_INDEX, GL_RASTERIZER_DISCARD,
+};
+
+/// <summary>
+/// Slot of _value in _values, -1 when untracked
+/// </summary>
+template <size_t N>
+static int FindSlot(const GLenum (&_values)[N], GLenum _value)
+{
+    for (size_t i = 0; i < N; i++)
+    {
+        if (_values[i] == _value)
+            return (int)i;
+    }
+
+    return -1;
+}
+
+RenderStateCache::RenderStateCache()
+{
+    static_assert(sizeof(s_bufferTargets) / sizeof(s_bufferTargets[0]) == kBufferTargetCount, "One slot per buffer target");
+    static_assert(sizeof(s_capabilities) / sizeof(s_capabilities[0]) == kCapabilityCount, "One slot per capability");
+
+    Invalidate();
+}
+
+bool RenderStateCache::IsRedundant(bool _redundant)
+{
+    if (_redundant)
+        m_filtered++;
+    else
+        m_issued++;
+
+    return _redundant;
+}
+
+void RenderStateCache::UseProgram(GLuint _program)
+{
+    if (IsRedundant(m_program == _program))
+        return;
+
+    glUseProgram(_program);
+    m_program = _program;
+}
+
+void RenderStateCache::BindVertexArray(GLuint _vao)
+{
+    if (IsRedundant(m_vao == _vao))
+        return;
+
+    glBindVertexArray(_vao);
+    m_vao = _vao;
+    m_buffers[FindSlot(s_bufferTargets, GL_ELEMENT_ARRAY_BUFFER)] = s_unknown;
+}
+
+void RenderStateCache::BindBuffer(GLenum _target, GLuint _buffer)
+{
+    int slot = FindSlot(s_bufferTargets, _target);
+
+    if (IsRedundant(slot >= 0 && m_buffers[slot] == _buffer))
+        return;
+
+    glBindBuffer(_target, _buffer);
+    if (slot >= 0)
+        m_buffers[slot] = _buffer;
+}
+
+RenderStateCache::IndexedBinding* RenderStateCache::GetIndexedBinding(GLenum _target, GLuint _index)
+{
+    if (_index >= (GLuint)kIndexedBindingCount)
+        return nullptr;
+
+    if (_target == GL_UNIFORM_BUFFER)
+        return &m_uniformBindings[_index];
+    if (_target == GL_SHADER_STORAGE_BUFFER)
+        return &m_storageBindings[_index];
+
+    return nullptr;
+}
+
+void RenderStateCache::BindBufferBase(GLenum _target, GLuint _index, GLuint _buffer)
+{
+    /* A whole-buffer binding, the size of the range is unknown and can't match a real range */
+    BindBufferRange(_target, _index, _buffer, 0, -1);
+}
+
+void RenderStateCache::BindBufferRange(GLenum _target, GLuint _index, GLuint _buffer, GLintptr _offset, GLsizeiptr _size)
+{
+    IndexedBinding* binding = GetIndexedBinding(_target, _index);
+    int slot = FindSlot(s_bufferTargets, _target);
+
+    if (IsRedundant(binding != nullptr && binding->buffer == _buffer && binding->offset == _offset && binding->size == _size))
+        return;
+
+    if (_size < 0)
+        glBindBufferBase(_target, _index, _buffer);
+    else
+        glBindBufferRange(_target, _index, _buffer, _offset, _size);
+
+    if (binding != nullptr)
+        *binding = { _buffer, _offset, _size };
+    if (slot >= 0)
+        m_buffers[slot] = _buffer;
+}
+
+void RenderStateCache::BindTexture(GLuint _unit, GLenum _target, GLuint _texture)
+{
+    TextureBinding* binding = (_unit < (GLuint)kTextureUnitCount) ? &m_textures[_unit] : nullptr;
+
+    if (IsRedundant(binding != nullptr && binding->target == _target && binding->texture == _texture))
+        return;
+
+    if (m_activeTextureUnit != _unit)
+    {
+        glActiveTexture(GL_TEXTURE0 + _unit);
+        m_activeTextureUnit = _unit;
+    }
+
+    glBindTexture(_target, _texture);
+    if (binding != nullptr)
+        *binding = { _target, _texture };
+}
+
+void RenderStateCache::DeleteBuffers(GLsizei _count, const GLuint* _buffers)
+{
+    for (GLsizei i = 0; i < _count; i++)
+    {
+        if (_buffers[i] == 0)
+            continue;
+
+        for (GLuint& buffer : m_buffers)
+        {
+            if (buffer == _buffers[i])
+                buffer = s_unknown;
+        }
+        for (IndexedBinding& binding : m_uniformBindings)
+        {
+            if (binding.buffer == _buffers[i])
+                binding = { s_unknown, 0, 0 };
+        }
+        for (IndexedBinding& binding : m_storageBindings)
+        {
+            if (binding.buffer == _buffers[i])
+                binding = { s_unknown, 0, 0 };
+        }
+    }
+
+    glDeleteBuffers(_count, _buffers);
+}
+
+void RenderStateCache::SetEnabled(GLenum _capability, bool _enabled)
+{
+    int slot = FindSlot(s_capabilities, _capability);
+
+    if (IsRedundant(slot >= 0 && m_capabilities[slot] == (_enabled ? 1 : 0)))
+        return;
+
+    if (_enabled)
+        glEnable(_capability);
+    else
+        glDisable(_capability);
+
+    if (slot >= 0)
+        m_capabilities[slot] = _enabled ? 1 : 0;
+}
+
+void RenderStateCache::BlendFunc(GLenum _source, GLenum _destination)
+{
+    if (IsRedundant(m_blendSource == _source && m_blendDestination == _destination))
+        return;
+
+    glBlendFunc(_source, _destination);
+    m_blendSource = _source;
+    m_blendDestination = _destination;
+}
+
+void RenderStateCache::DepthFunc(GLenum _function)
+{
+    if (IsRedundant(m_depthFunction == _function))
+        return;
+
+    glDepthFunc(_function);
+    m_depthFunction = _function;
+}
+
+void RenderStateCache::CullFace(GLenum _face)
+{
+    if (IsRedundant(m_cullFace == _face))
+        return;
+
+    glCullFace(_face);
+    m_cullFace = _face;
+}
+
+bool RenderStateCache::IsUniformRedundant(GLint _location, const void* _value, size_t _size)
+{
+    /* Uniforms belong to a program: with none known there is nothing to compare with (and GL ignores location -1) */
+    if (m_program == s_unknown || m_program == 0 || _location < 0)
+    {
+        m_uniformIssued++;
+        return false;
+    }
+
+    std::vector<unsigned char>& cached = m_uniformValues[((uint64_t)m_program << 32) | (uint32_t)_location];
+    if (cached.size() == _size && std::memcmp(cached.data(), _value, _size) == 0)
+    {
+        m_uniformFiltered++;
+        return true;
+    }
+
+    m_uniformIssued++;
+    cached.assign((const unsigned char*)_value, (const unsigned char*)_value + _size);
+    return false;
+}
+
+void RenderStateCache::Uniform1i(GLint _location, GLint _value)
+{
+    if (IsUniformRedundant(_location, &_value, sizeof(_value)))
+        return;
+
+    glUniform1i(_location, _value);
+}
+
+void RenderStateCache::Uniform1ui(GLint _location, GLuint _value)
+{
+    if (IsUniformRedundant(_location, &_value, sizeof(_value)))
+        return;
+
+    glUniform1ui(_location, _value);
+}
+
+void RenderStateCache::Uniform2i(GLint _location, GLint _x, GLint _y)
+{
+    const GLint value[2] = { _x, _y };
+    if (IsUniformRedundant(_location, value, sizeof(value)))
+        return;
+
+    glUniform2i(_location, _x, _y);
+}
+
+void RenderStateCache::Uniform1fv(GLint _location, GLsizei _count, const GLfloat* _values)
+{
+    if (IsUniformRedundant(_location, _values, (size_t)_count * sizeof(GLfloat)))
+        return;
+
+    glUniform1fv(_location, _count, _values);
+}
+
+void RenderStateCache::Uniform4fv(GLint _location, GLsizei _count, const GLfloat* _values)
+{
+    if (IsUniformRedundant(_location, _values, (size_t)_count * 4 * sizeof(GLfloat)))
+        return;
+
+    glUniform4fv(_location, _count, _values);
+}
+
+void RenderStateCache::Invalidate()
+{
+    m_program = s_unknown;
+    m_vao = s_unknown;
+
+    for (GLuint& buffer : m_buffers)
+        buffer = s_unknown;
+    for (IndexedBinding& binding : m_uniformBindings)
+        binding = { s_unknown, 0, 0 };
+    for (IndexedBinding& binding : m_storageBindings)
+        binding = { s_unknown, 0, 0 };
+
+    m_activeTextureUnit = s_unknown;
+    for (TextureBinding& binding : m_textures)
+        binding = { s_unknown, s_unknown };
+
+    for (signed char& capability : m_capabilities)
+        capability = -1;
+
+    m_blendSource = s_unknown;
+    m_blendDestination = s_unknown;
+    m_depthFunction = s_unknown;
+    m_cullFace = s_unknown;
+
+    m_uniformValues.clear();
+}
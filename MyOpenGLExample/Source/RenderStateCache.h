@@ -0,0 +1,146 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <GL/glew.h>
+
+/// <summary>
+/// Shadow copy of the GL bindings and fixed-function state the renderer touches. Each setter compares
+/// against the last value it set and skips the GL call when nothing would change, counting both cases.
+/// Values start unknown, so the first call always reaches GL. The cache only knows what went through it:
+/// code binding a tracked target behind its back must call Invalidate afterwards. GL_COPY_READ_BUFFER and
+/// GL_COPY_WRITE_BUFFER are left untracked for that reason, they are the scratch targets for uploads.
+/// Uniform values are cached per program, as GL keeps them; a deleted program's name can come back for a new
+/// program, so deleting one whose uniforms went through the cache also calls for Invalidate
+/// </summary>
+class RenderStateCache
+{
+public:
+    RenderStateCache();
+
+    void UseProgram(GLuint _program);
+
+    /// <summary>
+    /// Bind a VAO. The element array buffer is VAO state, its cached binding is forgotten
+    /// </summary>
+    /// <param name="_vao"></param>
+    void BindVertexArray(GLuint _vao);
+
+    void BindBuffer(GLenum _target, GLuint _buffer);
+
+    /// <summary>
+    /// Indexed binding (uniform or shader storage block). Like GL, it also binds the generic target
+    /// </summary>
+    /// <param name="_target"></param>
+    /// <param name="_index"></param>
+    /// <param name="_buffer"></param>
+    void BindBufferBase(GLenum _target, GLuint _index, GLuint _buffer);
+    void BindBufferRange(GLenum _target, GLuint _index, GLuint _buffer, GLintptr _offset, GLsizeiptr _size);
+
+    void BindTexture(GLuint _unit, GLenum _target, GLuint _texture);
+
+    /// <summary>
+    /// glDeleteBuffers, forgetting every binding of the deleted names (generic and indexed): GL unbinds them,
+    /// and the next buffer created can get the same name
+    /// </summary>
+    /// <param name="_count"></param>
+    /// <param name="_buffers"></param>
+    void DeleteBuffers(GLsizei _count, const GLuint* _buffers);
+
+    /// <summary>
+    /// glEnable / glDisable of _capability
+    /// </summary>
+    /// <param name="_capability"></param>
+    /// <param name="_enabled"></param>
+    void SetEnabled(GLenum _capability, bool _enabled);
+
+    void BlendFunc(GLenum _source, GLenum _destination);
+    void DepthFunc(GLenum _function);
+    void CullFace(GLenum _face);
+
+    /// <summary>
+    /// glUniform* on the program in use, filtered per program and location. The program must have been set
+    /// through UseProgram, otherwise the value goes to GL unfiltered
+    /// </summary>
+    /// <param name="_location"></param>
+    /// <param name="_value"></param>
+    void Uniform1i(GLint _location, GLint _value);
+    void Uniform1ui(GLint _location, GLuint _value);
+    void Uniform2i(GLint _location, GLint _x, GLint _y);
+    void Uniform1fv(GLint _location, GLsizei _count, const GLfloat* _values);
+    void Uniform4fv(GLint _location, GLsizei _count, const GLfloat* _values);
+
+    /// <summary>
+    /// Forget every cached value, the next call of each kind reaches GL
+    /// </summary>
+    void Invalidate();
+
+    uint64_t GetIssuedCount() const { return m_issued; }
+    uint64_t GetFilteredCount() const { return m_filtered; }
+    uint64_t GetUniformIssuedCount() const { return m_uniformIssued; }
+    uint64_t GetUniformFilteredCount() const { return m_uniformFiltered; }
+
+private:
+    static const int kBufferTargetCount = 7;
+    static const int kIndexedBindingCount = 16;
+    static const int kTextureUnitCount = 16;
+    static const int kCapabilityCount = 8;
+
+    struct IndexedBinding
+    {
+        GLuint buffer;
+        GLintptr offset;
+        GLsizeiptr size;
+    };
+
+    struct TextureBinding
+    {
+        GLenum target;
+        GLuint texture;
+    };
+
+    /// <summary>
+    /// Count the call, true if it is redundant and must be dropped
+    /// </summary>
+    /// <param name="_redundant"></param>
+    /// <returns></returns>
+    bool IsRedundant(bool _redundant);
+
+    /// <summary>
+    /// Count the uniform call, true if _location of the program in use already holds the _size bytes at _value.
+    /// Otherwise they are what it holds from now on
+    /// </summary>
+    /// <param name="_location"></param>
+    /// <param name="_value"></param>
+    /// <param name="_size"></param>
+    /// <returns></returns>
+    bool IsUniformRedundant(GLint _location, const void* _value, size_t _size);
+
+    IndexedBinding* GetIndexedBinding(GLenum _target, GLuint _index);
+
+    GLuint m_program;
+    GLuint m_vao;
+    GLuint m_buffers[kBufferTargetCount];
+    IndexedBinding m_uniformBindings[kIndexedBindingCount];
+    IndexedBinding m_storageBindings[kIndexedBindingCount];
+    GLuint m_activeTextureUnit;
+    TextureBinding m_textures[kTextureUnitCount];
+    signed char m_capabilities[kCapabilityCount];
+    GLenum m_blendSource;
+    GLenum m_blendDestination;
+    GLenum m_depthFunction;
+    GLenum m_cullFace;
+
+    /// <summary>
+    /// Last value set, by program (high 32 bits) and location
+    /// </summary>
+    std::unordered_map<uint64_t, std::vector<unsigned char>> m_uniformValues;
+
+    uint64_t m_issued = 0;
+    uint64_t m_filtered = 0;
+    uint64_t m_uniformIssued = 0;
+    uint64_t m_uniformFiltered = 0;
+};
@@ -0,0 +1,103 @@
+#include "SceneInstances.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+/// <summary>
+/// Distance between the centers of two neighbour cubes (the cube is 2 units wide)
+/// </summary>
+static const float s_gridSpacing = 3.0f;
+
+/// <summary>
+/// Radians per second of a unit spin speed
+/// </summary>
+static const float s_spinScale = 0.18f;
+
+/// <summary>
+/// Small deterministic generator, so every run (and every benchmark) sees the same scene
+/// </summary>
+/// <param name="_state"></param>
+/// <returns>A value in [0, 1)</returns>
+static float NextRandom(uint32_t& _state)
+{
+    _state = _state * 1664525u + 1013904223u;
+    return (float)(_state >> 8) / 16777216.0f;
+}
+
+void BuildInstanceGrid(int _count, int _meshCount, EntityWorld& _world, float& _radius)
+{
+    if (_count == 1)
+    {
+        /* The default components: at the origin, identity rotation, not spinning, white */
+        _world.Create(kRenderableMask, 0);
+        _radius = std::sqrt(3.0f);
+        return;
+    }
+
+    int side = (int)std::ceil(std::cbrt((double)_count));
+    float offset = (side - 1) * s_gridSpacing * 0.5f;
+    uint32_t seed = 12345u;
+
+    for (int i = 0; i < _count; i++)
+    {
+        Entity entity = _world.Create(kRenderableMask | ComponentBit(kComponentAngularVelocity), (uint32_t)(i % _meshCount));
+
+        Vec4 position = { (i % side) * s_gridSpacing - offset, ((i / side) % side) * s_gridSpacing - offset,
+            (i / (side * side)) * s_gridSpacing - offset, 1.0f };
+        _world.Set(entity, kComponentPosition, &position);
+
+        /* Random unit quaternion (uniform over rotations, Shoemake) */
+        float u1 = NextRandom(seed);
+        float u2 = NextRandom(seed) * 6.283185f;
+        float u3 = NextRandom(seed) * 6.283185f;
+        float a = std::sqrt(1.0f - u1);
+        float b = std::sqrt(u1);
+        Quat orientation = { a * std::sin(u2), a * std::cos(u2), b * std::sin(u3), b * std::cos(u3) };
+        _world.Set(entity, kComponentRotation, &orientation);
+        _world.Set(entity, kComponentPreviousRotation, &orientation);
+
+        /* Random spin axis (uniform on the sphere) and speed in +-[0.5, 4] */
+        float z = 2.0f * NextRandom(seed) - 1.0f;
+        float phi = NextRandom(seed) * 6.283185f;
+        float r = std::sqrt(1.0f - z * z);
+        float speed = (0.5f + 3.5f * NextRandom(seed)) * ((NextRandom(seed) < 0.5f) ? -1.0f : 1.0f) * s_spinScale;
+        Vec3 angularVelocity = { r * std::cos(phi) * speed, r * std::sin(phi) * speed, z * speed };
+        _world.Set(entity, kComponentAngularVelocity, &angularVelocity);
+
+        GLubyte color[4];
+        color[0] = (GLubyte)(255.0f * (0.3f + 0.7f * NextRandom(seed)));
+        color[1] = (GLubyte)(255.0f * (0.3f + 0.7f * NextRandom(seed)));
+        color[2] = (GLubyte)(255.0f * (0.3f + 0.7f * NextRandom(seed)));
+        color[3] = 255;
+        _world.Set(entity, kComponentColor, color);
+    }
+
+    /* Corner of the grid plus the cube's own half diagonal */
+    _radius = offset * std::sqrt(3.0f) + std::sqrt(3.0f);
+}
+
+void ExtractVisibleInstanceData(const std::vector<ChunkView>& _chunks, size_t _first, size_t _last, const ChunkVisibility& _visibility,
+    InstanceData* _instances)
+{
+    for (size_t i = _first; i < _last; i++)
+    {
+        const ChunkView& chunk = _chunks[i];
+        const float* position[4] = { chunk.GetColumn(kComponentPosition, 0), chunk.GetColumn(kComponentPosition, 1),
+            chunk.GetColumn(kComponentPosition, 2), chunk.GetColumn(kComponentPosition, 3) };
+        const uint32_t* color = chunk.GetBits(kComponentColor, 0);
+        const uint32_t* rows = _visibility.rows.data() + chunk.first;
+        bool allVisible = (_visibility.counts[i] == chunk.count);
+        InstanceData* out = _instances + _visibility.offsets[i];
+
+        for (size_t v = 0; v < _visibility.counts[i]; v++)
+        {
+            size_t row = allVisible ? v : rows[v];
+            InstanceData& instance = out[v];
+            for (int c = 0; c < 4; c++)
+                instance.position[c] = position[c][row];
+            memcpy(instance.color, &color[row], sizeof(instance.color));
+            instance.mesh = chunk.group;
+        }
+    }
+}
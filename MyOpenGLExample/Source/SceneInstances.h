@@ -0,0 +1,45 @@
+#pragma once
+
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "EntityWorld.h"
+#include "SceneSystems.h"
+
+/// <summary>
+/// Per-instance vertex attributes (attribute divisor 1) that only change with the scene entities, extracted every
+/// frame for the visible instances. The layout matches vshader.glsl: inInstancePosition (xyz + uniform scale in w),
+/// inInstanceColor (RGBA8) and inInstanceMesh, the batch mesh the instance draws (it selects the mesh's
+/// position decoding). The rotation (inInstanceRotation) is interpolated and streamed separately, see ExtractVisibleRotations
+/// </summary>
+struct InstanceData
+{
+    GLfloat position[4];
+    GLubyte color[4];
+    GLuint mesh;
+};
+
+/// <summary>
+/// Create the scene entities in _world: _count renderable objects. One is the classic scene (a single cube at
+/// the origin, no extra rotation, original colors); more are laid out on a cubic grid with a random orientation,
+/// spin and tint. Grid cells cycle through the first _meshCount scene meshes, the mesh is the entity group.
+/// _radius receives the radius of the sphere holding the whole layout, to place the camera
+/// </summary>
+/// <param name="_count"></param>
+/// <param name="_meshCount"></param>
+/// <param name="_world"></param>
+/// <param name="_radius"></param>
+void BuildInstanceGrid(int _count, int _meshCount, EntityWorld& _world, float& _radius);
+
+/// <summary>
+/// Render extraction of the instance attributes: one InstanceData per visible entity of the chunks [_first, _last)
+/// of _chunks (a kRenderableMask query, so grouped by mesh), at its position in the compacted output _instances
+/// </summary>
+/// <param name="_chunks"></param>
+/// <param name="_first"></param>
+/// <param name="_last"></param>
+/// <param name="_visibility"></param>
+/// <param name="_instances"></param>
+void ExtractVisibleInstanceData(const std::vector<ChunkView>& _chunks, size_t _first, size_t _last, const ChunkVisibility& _visibility,
+    InstanceData* _instances);
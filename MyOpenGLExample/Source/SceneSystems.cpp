@@ -0,0 +1,201 @@
+#include "SceneSystems.h"
+
+QuatColumns GetQuatColumns(const ChunkView& _chunk, ComponentId _component)
+{
+    return { _chunk.GetColumn(_component, 0), _chunk.GetColumn(_component, 1), _chunk.GetColumn(_component, 2), _chunk.GetColumn(_component, 3) };
+}
+
+Vec3Columns GetVec3Columns(const ChunkView& _chunk, ComponentId _component)
+{
+    return { _chunk.GetColumn(_component, 0), _chunk.GetColumn(_component, 1), _chunk.GetColumn(_component, 2) };
+}
+
+void AnimateRotations(const std::vector<ChunkView>& _chunks, size_t _first, size_t _last, float _dt)
+{
+    for (size_t i = _first; i < _last; i++)
+    {
+        const ChunkView& chunk = _chunks[i];
+        IntegrateRotations(GetQuatColumns(chunk, kComponentRotation), GetQuatColumns(chunk, kComponentPreviousRotation),
+            GetVec3Columns(chunk, kComponentAngularVelocity), _dt, chunk.count);
+    }
+}
+
+void ExtractRotations(const std::vector<ChunkView>& _chunks, size_t _first, size_t _last, float _alpha, float* _rotations)
+{
+    for (size_t i = _first; i < _last; i++)
+    {
+        const ChunkView& chunk = _chunks[i];
+        WriteInterpolatedRotations(GetQuatColumns(chunk, kComponentPreviousRotation), GetQuatColumns(chunk, kComponentRotation),
+            _alpha, chunk.count, _rotations + chunk.first * 4);
+    }
+}
+
+void CullChunks(const std::vector<ChunkView>& _chunks, size_t _first, size_t _last, const Frustum& _frustum,
+    const float* _groupRadii, ChunkVisibility& _visibility)
+{
+    for (size_t i = _first; i < _last; i++)
+    {
+        const ChunkView& chunk = _chunks[i];
+        SphereColumns spheres = { chunk.GetColumn(kComponentPosition, 0), chunk.GetColumn(kComponentPosition, 1),
+            chunk.GetColumn(kComponentPosition, 2), chunk.GetColumn(kComponentPosition, 3) };
+        _visibility.counts[i] = (uint32_t)CullSpheres(_frustum, spheres, _groupRadii[chunk.group], chunk.count,
+            _visibility.rows.data() + chunk.first);
+    }
+}
+
+void ResizeVisibility(const std::vector<ChunkView>& _chunks, size_t _entityCount, ChunkVisibility& _visibility)
+{
+    _visibility.rows.resize(_entityCount);
+    _visibility.counts.resize(_chunks.size());
+    _visibility.offsets.resize(_chunks.size());
+
+    for (size_t i = 0; i < _chunks.size(); i++)
+        _visibility.counts[i] = (uint32_t)_chunks[i].count;
+}
+
+size_t CompactVisibility(ChunkVisibility& _visibility)
+{
+    uint32_t offset = 0;
+    for (size_t i = 0; i < _visibility.counts.size(); i++)
+    {
+        _visibility.offsets[i] = offset;
+        offset += _visibility.counts[i];
+    }
+    return offset;
+}
+
+void ExtractVisibleRotations(const std::vector<ChunkView>& _chunks, size_t _first, size_t _last, const ChunkVisibility& _visibility,
+    float _alpha, float* _rotations)
+{
+    for (size_t i = _first; i < _last; i++)
+    {
+        const ChunkView& chunk = _chunks[i];
+        float* out = _rotations + (size_t)_visibility.offsets[i] * 4;
+        QuatColumns previous = GetQuatColumns(chunk, kComponentPreviousRotation);
+        QuatColumns rotation = GetQuatColumns(chunk, kComponentRotation);
+
+        if (_visibility.counts[i] == chunk.count)
+            WriteInterpolatedRotations(previous, rotation, _alpha, chunk.count, out);
+        else
+            WriteInterpolatedRotationsIndexed(previous, rotation, _alpha, _visibility.rows.data() + chunk.first, _visibility.counts[i], out);
+    }
+}
+
+void ComputeBounds(const std::vector<ChunkView>& _chunks, size_t _first, size_t _last, const float* _groupRadii, Aabb* _bounds)
+{
+    for (size_t i = _first; i < _last; i++)
+    {
+        const ChunkView& chunk = _chunks[i];
+        const float* x = chunk.GetColumn(kComponentPosition, 0);
+        const float* y = chunk.GetColumn(kComponentPosition, 1);
+        const float* z = chunk.GetColumn(kComponentPosition, 2);
+        const float* scale = chunk.GetColumn(kComponentPosition, 3);
+        float radius = _groupRadii[chunk.group];
+
+        for (size_t row = 0; row < chunk.count; row++)
+            _bounds[chunk.first + row] = AabbFromSphere({ x[row], y[row], z[row] }, scale[row] * radius);
+    }
+}
+
+void SelectVisibleRows(const std::vector<ChunkView>& _chunks, size_t _first, size_t _last, const uint8_t* _flags,
+    ChunkVisibility& _visibility)
+{
+    for (size_t i = _first; i < _last; i++)
+    {
+        const ChunkView& chunk = _chunks[i];
+        const uint8_t* flags = _flags + chunk.first;
+        uint32_t* rows = _visibility.rows.data() + chunk.first;
+
+        /* Branchless, as AppendVisible: the row is always written, kept only if visible */
+        uint32_t count = 0;
+        for (uint32_t row = 0; row < (uint32_t)chunk.count; row++)
+        {
+            rows[count] = row;
+            count += (flags[row] != 0) ? 1u : 0u;
+        }
+        _visibility.counts[i] = count;
+    }
+}
+
+/// <summary>
+/// Row of the v-th entity _visibility keeps of a chunk: its rows are left unwritten when it is entirely visible
+/// </summary>
+static inline uint32_t GetVisibleRow(const ChunkView& _chunk, size_t _chunkIndex, const ChunkVisibility& _visibility, uint32_t _v)
+{
+    return (_visibility.counts[_chunkIndex] == _chunk.count) ? _v : _visibility.rows[_chunk.first + _v];
+}
+
+void FindOccluders(const std::vector<ChunkView>& _chunks, size_t _first, size_t _last, const ChunkVisibility& _visibility,
+    const Mat4& _view, const float* _groupRadii, float _minSize, std::vector<OccluderCandidate>& _candidates)
+{
+    /* Only the view depth is needed: the third row of the view matrix */
+    const float* m = _view.m;
+    for (size_t i = _first; i < _last; i++)
+    {
+        const ChunkView& chunk = _chunks[i];
+        const float* x = chunk.GetColumn(kComponentPosition, 0);
+        const float* y = chunk.GetColumn(kComponentPosition, 1);
+        const float* z = chunk.GetColumn(kComponentPosition, 2);
+        const float* scale = chunk.GetColumn(kComponentPosition, 3);
+        float radius = _groupRadii[chunk.group];
+
+        for (uint32_t v = 0; v < _visibility.counts[i]; v++)
+        {
+            uint32_t row = GetVisibleRow(chunk, i, _visibility, v);
+            float depth = -(m[2] * x[row] + m[6] * y[row] + m[10] * z[row] + m[14]);
+            float size = scale[row] * radius;
+            if (depth > size && size >= _minSize * depth)
+                _candidates.push_back({ size / depth, (uint32_t)i, row });
+        }
+    }
+}
+
+size_t AddOccluders(const std::vector<ChunkView>& _chunks, const OccluderCandidate* _candidates, size_t _count,
+    const std::vector<Vec3>* _meshPoints, float _alpha, const Quat& _frameRotation, OcclusionBuffer& _buffer)
+{
+    size_t added = 0;
+    Vec3 points[OcclusionBuffer::kMaxOccluderPoints];
+    for (size_t c = 0; c < _count; c++)
+    {
+        const ChunkView& chunk = _chunks[_candidates[c].chunk];
+        uint32_t row = _candidates[c].row;
+        const std::vector<Vec3>& meshPoints = _meshPoints[chunk.group];
+        if (meshPoints.size() > OcclusionBuffer::kMaxOccluderPoints)
+            continue;
+
+        QuatColumns previous = GetQuatColumns(chunk, kComponentPreviousRotation);
+        QuatColumns current = GetQuatColumns(chunk, kComponentRotation);
+        Quat rotation = QuatNlerp({ previous.x[row], previous.y[row], previous.z[row], previous.w[row] },
+            { current.x[row], current.y[row], current.z[row], current.w[row] }, _alpha);
+        rotation = QuatConjugate(QuatMultiply(rotation, _frameRotation));
+
+        Vec3 position = { chunk.GetColumn(kComponentPosition, 0)[row], chunk.GetColumn(kComponentPosition, 1)[row],
+            chunk.GetColumn(kComponentPosition, 2)[row] };
+        float scale = chunk.GetColumn(kComponentPosition, 3)[row];
+        for (size_t p = 0; p < meshPoints.size(); p++)
+            points[p] = Vec3Add(Vec3Scale(QuatRotate(rotation, meshPoints[p]), scale), position);
+
+        added += _buffer.AddOccluder(points, meshPoints.size()) ? 1 : 0;
+    }
+    return added;
+}
+
+void OccludeChunks(const std::vector<ChunkView>& _chunks, size_t _first, size_t _last, const OcclusionBuffer& _buffer,
+    const float* _groupRadii, ChunkVisibility& _visibility)
+{
+    for (size_t i = _first; i < _last; i++)
+    {
+        const ChunkView& chunk = _chunks[i];
+        SphereColumns spheres = { chunk.GetColumn(kComponentPosition, 0), chunk.GetColumn(kComponentPosition, 1),
+            chunk.GetColumn(kComponentPosition, 2), chunk.GetColumn(kComponentPosition, 3) };
+        uint32_t* rows = _visibility.rows.data() + chunk.first;
+
+        /* An entirely visible chunk has its rows left unwritten: all of them */
+        if (_visibility.counts[i] == chunk.count)
+        {
+            for (uint32_t row = 0; row < (uint32_t)chunk.count; row++)
+                rows[row] = row;
+        }
+        _visibility.counts[i] = (uint32_t)_buffer.CullOccludedSpheres(spheres, _groupRadii[chunk.group], rows, _visibility.counts[i], rows);
+    }
+}
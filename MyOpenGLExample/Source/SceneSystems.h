@@ -0,0 +1,178 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "BoundingVolumeHierarchy.h"
+#include "EntityWorld.h"
+#include "FrustumCulling.h"
+#include "OcclusionBuffer.h"
+#include "TransformKernels.h"
+
+/// <summary>
+/// Components of an entity the renderer draws, and of one the animation spins
+/// </summary>
+const ComponentMask kRenderableMask = ComponentBit(kComponentPosition) | ComponentBit(kComponentRotation)
+    | ComponentBit(kComponentPreviousRotation) | ComponentBit(kComponentColor);
+const ComponentMask kAnimatedMask = ComponentBit(kComponentRotation) | ComponentBit(kComponentPreviousRotation)
+    | ComponentBit(kComponentAngularVelocity);
+
+/// <summary>
+/// What culling kept of a query, chunk by chunk: the rows of chunk i that are visible (counts[i] of them, stored
+/// from rows[chunk.first]), and offsets[i], where chunk i's visible entities start in the compacted output.
+/// A chunk whose count is its entity count is entirely visible, its rows may be left unwritten
+/// </summary>
+struct ChunkVisibility
+{
+    std::vector<uint32_t> rows;
+    std::vector<uint32_t> counts;
+    std::vector<uint32_t> offsets;
+};
+
+/// <summary>
+/// A visible entity worth drawing into the occlusion buffer: its chunk and row in the query, and how large it looks
+/// (bounding radius over view depth)
+/// </summary>
+struct OccluderCandidate
+{
+    float size;
+    uint32_t chunk;
+    uint32_t row;
+};
+
+QuatColumns GetQuatColumns(const ChunkView& _chunk, ComponentId _component);
+Vec3Columns GetVec3Columns(const ChunkView& _chunk, ComponentId _component);
+
+/*
+ * Systems. Each one works on the chunks [_first, _last) of a query result, independent of the other chunks,
+ * so a frame can give each thread its own range
+ */
+
+/// <summary>
+/// Animation: one simulation step of _dt seconds for the entities of kAnimatedMask chunks
+/// </summary>
+/// <param name="_chunks"></param>
+/// <param name="_first"></param>
+/// <param name="_last"></param>
+/// <param name="_dt"></param>
+void AnimateRotations(const std::vector<ChunkView>& _chunks, size_t _first, size_t _last, float _dt);
+
+/// <summary>
+/// Render extraction: the rotations of the entities of kRenderableMask chunks, _alpha (0..1) of the way from the
+/// previous simulation step to the current one, 4 floats each at the entity's position in the query
+/// </summary>
+/// <param name="_chunks"></param>
+/// <param name="_first"></param>
+/// <param name="_last"></param>
+/// <param name="_alpha"></param>
+/// <param name="_rotations"></param>
+void ExtractRotations(const std::vector<ChunkView>& _chunks, size_t _first, size_t _last, float _alpha, float* _rotations);
+
+/// <summary>
+/// Frustum culling: the bounding spheres of the entities of kRenderableMask chunks (centered on their position,
+/// of radius their scale times _groupRadii[chunk.group]) against _frustum, into _visibility's rows and counts.
+/// Resize _visibility with ResizeVisibility first
+/// </summary>
+/// <param name="_chunks"></param>
+/// <param name="_first"></param>
+/// <param name="_last"></param>
+/// <param name="_frustum"></param>
+/// <param name="_groupRadii"></param>
+/// <param name="_visibility"></param>
+void CullChunks(const std::vector<ChunkView>& _chunks, size_t _first, size_t _last, const Frustum& _frustum,
+    const float* _groupRadii, ChunkVisibility& _visibility);
+
+/// <summary>
+/// Size _visibility for _chunks, every chunk entirely visible
+/// </summary>
+/// <param name="_chunks"></param>
+/// <param name="_entityCount">Entities in _chunks, as returned by the query</param>
+/// <param name="_visibility"></param>
+void ResizeVisibility(const std::vector<ChunkView>& _chunks, size_t _entityCount, ChunkVisibility& _visibility);
+
+/// <summary>
+/// Compact the culling result: the offset of each chunk's visible entities, one chunk after the other (on one
+/// thread, it is one addition per chunk)
+/// </summary>
+/// <param name="_visibility"></param>
+/// <returns>The number of visible entities</returns>
+size_t CompactVisibility(ChunkVisibility& _visibility);
+
+/// <summary>
+/// ExtractRotations for the visible entities only, 4 floats each at their position in the compacted output
+/// </summary>
+/// <param name="_chunks"></param>
+/// <param name="_first"></param>
+/// <param name="_last"></param>
+/// <param name="_visibility"></param>
+/// <param name="_alpha"></param>
+/// <param name="_rotations"></param>
+void ExtractVisibleRotations(const std::vector<ChunkView>& _chunks, size_t _first, size_t _last, const ChunkVisibility& _visibility,
+    float _alpha, float* _rotations);
+
+/// <summary>
+/// Bounding box of each entity of the chunks [_first, _last) (its sphere: position, scale times
+/// _groupRadii[chunk.group]), at chunk.first + row in _bounds: the order the BVH knows the objects in
+/// </summary>
+/// <param name="_chunks"></param>
+/// <param name="_first"></param>
+/// <param name="_last"></param>
+/// <param name="_groupRadii"></param>
+/// <param name="_bounds">One per entity of the query</param>
+void ComputeBounds(const std::vector<ChunkView>& _chunks, size_t _first, size_t _last, const float* _groupRadii, Aabb* _bounds);
+
+/// <summary>
+/// The rows and counts of _visibility for the chunks [_first, _last) from one flag per entity of the query (at
+/// chunk.first + row, nonzero if visible), as a BVH query leaves them
+/// </summary>
+/// <param name="_chunks"></param>
+/// <param name="_first"></param>
+/// <param name="_last"></param>
+/// <param name="_flags"></param>
+/// <param name="_visibility"></param>
+void SelectVisibleRows(const std::vector<ChunkView>& _chunks, size_t _first, size_t _last, const uint8_t* _flags,
+    ChunkVisibility& _visibility);
+
+/// <summary>
+/// Occluder selection: append to _candidates the entities _visibility keeps of the chunks [_first, _last) whose
+/// bounding sphere, seen through _view, looks at least _minSize large (radius over depth, 1 is 45 degrees)
+/// </summary>
+/// <param name="_chunks"></param>
+/// <param name="_first"></param>
+/// <param name="_last"></param>
+/// <param name="_visibility"></param>
+/// <param name="_view"></param>
+/// <param name="_groupRadii"></param>
+/// <param name="_minSize"></param>
+/// <param name="_candidates"></param>
+void FindOccluders(const std::vector<ChunkView>& _chunks, size_t _first, size_t _last, const ChunkVisibility& _visibility,
+    const Mat4& _view, const float* _groupRadii, float _minSize, std::vector<OccluderCandidate>& _candidates);
+
+/// <summary>
+/// Draw _count candidates into _buffer: the points of their mesh (_meshPoints[chunk.group], convex) placed as the
+/// vertex shader places the vertices, rotated by the conjugate of the rotation _alpha of the way from the previous
+/// to the current one times _frameRotation, scaled, then moved to the position
+/// </summary>
+/// <param name="_chunks"></param>
+/// <param name="_candidates"></param>
+/// <param name="_count"></param>
+/// <param name="_meshPoints"></param>
+/// <param name="_alpha"></param>
+/// <param name="_frameRotation"></param>
+/// <param name="_buffer">Between BeginFrame and RasterizeTiles</param>
+/// <returns>The number of occluders _buffer took</returns>
+size_t AddOccluders(const std::vector<ChunkView>& _chunks, const OccluderCandidate* _candidates, size_t _count,
+    const std::vector<Vec3>* _meshPoints, float _alpha, const Quat& _frameRotation, OcclusionBuffer& _buffer);
+
+/// <summary>
+/// Occlusion culling: drop from _visibility's rows and counts of the chunks [_first, _last) the entities whose
+/// bounding sphere (as in CullChunks) _buffer hides
+/// </summary>
+/// <param name="_chunks"></param>
+/// <param name="_first"></param>
+/// <param name="_last"></param>
+/// <param name="_buffer">Rasterized</param>
+/// <param name="_groupRadii"></param>
+/// <param name="_visibility"></param>
+void OccludeChunks(const std::vector<ChunkView>& _chunks, size_t _first, size_t _last, const OcclusionBuffer& _buffer,
+    const float* _groupRadii, ChunkVisibility& _visibility);
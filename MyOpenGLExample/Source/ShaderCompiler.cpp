@@ -0,0 +1,294 @@
+#include "ShaderCompiler.h"
+
+#include <iostream>
+
+#include "ProgramBinaryCache.h"
+#include "Profiler.h"
+
+/// <summary>
+/// Print the info log of a shader or program
+/// </summary>
+static void PrintLog(const std::string& _name, GLuint _object, bool _isProgram)
+{
+    GLint logLen = 0;
+    if (_isProgram)
+        glGetProgramiv(_object, GL_INFO_LOG_LENGTH, &logLen);
+    else
+        glGetShaderiv(_object, GL_INFO_LOG_LENGTH, &logLen);
+
+    std::vector<char> logString(logLen > 0 ? logLen : 1, '\0');
+    if (_isProgram)
+        glGetProgramInfoLog(_object, (GLsizei)logString.size(), NULL, logString.data());
+    else
+        glGetShaderInfoLog(_object, (GLsizei)logString.size(), NULL, logString.data());
+
+    std::cout << "Error (" << _name << "): " << logString.data() << std::endl;
+}
+
+const char* ShaderCompiler::GetModeName(Mode _mode)
+{
+    switch (_mode)
+    {
+    case kParallelExtension: return "driver parallel compile";
+    case kWorkerThreads: return "worker threads";
+    default: return "synchronous";
+    }
+}
+
+void ShaderCompiler::Initialize(ProgramBinaryCache* _cache, const WorkerContextFactory& _createWorkerContext, int _maxWorkers)
+{
+    m_cache = _cache;
+    m_createWorkerContext = _createWorkerContext;
+    m_maxWorkers = _maxWorkers;
+
+    if (GLEW_KHR_parallel_shader_compile)
+    {
+        m_mode = kParallelExtension;
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFFu);
+    }
+    else if (GLEW_ARB_parallel_shader_compile)
+    {
+        m_mode = kParallelExtension;
+        glMaxShaderCompilerThreadsARB(0xFFFFFFFFu);
+    }
+    else
+    {
+        m_mode = (m_createWorkerContext && m_maxWorkers > 0) ? kWorkerThreads : kSynchronous;
+    }
+}
+
+int ShaderCompiler::Add(const ProgramSource& _source)
+{
+    std::unique_ptr<Program> program(new Program());
+    program->source = _source;
+    m_programs.push_back(std::move(program));
+    return (int)m_programs.size() - 1;
+}
+
+void ShaderCompiler::StartBuild(Program& _program) const
+{
+    PROFILE_ZONE("ShaderCompiler::StartBuild");
+
+    for (const ShaderStageSource& stage : _program.source.stages)
+    {
+        std::vector<const GLchar*> pieces;
+        std::vector<GLint> lengths;
+        for (const ShaderSourceSpan& piece : stage.pieces)
+        {
+            pieces.push_back(piece.data);
+            lengths.push_back(piece.length);
+        }
+
+        GLuint shader = glCreateShader(stage.type);
+        glShaderSource(shader, (GLsizei)pieces.size(), pieces.data(), lengths.data());
+        glCompileShader(shader);
+        glAttachShader(_program.program, shader);
+        _program.shaders.push_back(shader);
+    }
+
+    for (GLuint location = 0; location < _program.source.attributeLocations.size(); location++)
+        glBindAttribLocation(_program.program, location, _program.source.attributeLocations[location].c_str());
+
+    if (m_cache != nullptr)
+        m_cache->PrepareForLink(_program.program);
+
+    glLinkProgram(_program.program);
+}
+
+void ShaderCompiler::Submit()
+{
+    PROFILE_ZONE("ShaderCompiler::Submit");
+
+    std::vector<Program*> misses;
+
+    for (std::unique_ptr<Program>& program : m_programs)
+    {
+        std::vector<ShaderSourceSpan> sources;
+        for (const ShaderStageSource& stage : program->source.stages)
+            sources.insert(sources.end(), stage.pieces.begin(), stage.pieces.end());
+
+        /* Attribute locations are part of the linked binary, they go in the key with the sources */
+        std::string linkState = program->source.defines + "\nattributes:";
+        for (const std::string& name : program->source.attributeLocations)
+            linkState += " " + name;
+
+        program->key = ProgramBinaryCache::ComputeKey(sources, linkState);
+        program->program = glCreateProgram();
+
+        if (m_cache != nullptr && m_cache->Load(program->program, program->key))
+        {
+            program->fromCache = true;
+            program->built = true;
+            m_cachedCount++;
+        }
+        else
+        {
+            misses.push_back(program.get());
+        }
+    }
+
+    if (m_mode == kWorkerThreads)
+    {
+        /* Contexts are created here, on the main thread, and only as many as there is work for */
+        size_t workerCount = (misses.size() < (size_t)m_maxWorkers) ? misses.size() : (size_t)m_maxWorkers;
+        m_workerContexts.resize(workerCount);
+
+        for (size_t i = 0; i < workerCount; i++)
+        {
+            if (!m_createWorkerContext(m_workerContexts[i]))
+            {
+                m_workerContexts.resize(i);
+                break;
+            }
+        }
+
+        if (m_workerContexts.empty())
+            m_mode = kSynchronous;
+    }
+
+    if (m_mode == kWorkerThreads)
+    {
+        m_jobs = misses;
+        for (size_t i = 0; i < m_workerContexts.size(); i++)
+            m_workers.push_back(std::thread(&ShaderCompiler::WorkerLoop, this, (int)i));
+        return;
+    }
+
+    /* Every compile and link is issued before any status query */
+    for (Program* program : misses)
+    {
+        StartBuild(*program);
+
+        if (m_mode == kSynchronous)
+            program->built = true;
+    }
+}
+
+void ShaderCompiler::WorkerLoop(int _worker)
+{
+    Profiler::SetThreadName(("Shader compiler " + std::to_string(_worker + 1)).c_str());
+
+    WorkerContext& context = m_workerContexts[_worker];
+    bool current = context.MakeCurrent();
+
+    for (;;)
+    {
+        Program* program = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_nextJob < m_jobs.size())
+                program = m_jobs[m_nextJob++];
+        }
+
+        if (program == nullptr)
+            break;
+
+        /* Without a context the program is left unlinked, Finish reports it */
+        if (current)
+        {
+            StartBuild(*program);
+
+            /* The link is complete and visible to the main context once this returns */
+            glFinish();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            program->built = true;
+        }
+        m_builtCondition.notify_all();
+    }
+
+    if (current)
+        context.ReleaseCurrent();
+}
+
+bool ShaderCompiler::IsReady(int _index)
+{
+    Program& program = *m_programs[_index];
+
+    if (program.built)
+        return true;
+
+    if (m_mode == kParallelExtension)
+    {
+        GLint completed = GL_FALSE;
+        glGetProgramiv(program.program, GL_COMPLETION_STATUS_KHR, &completed);
+        return completed == GL_TRUE;
+    }
+
+    return false;
+}
+
+GLuint ShaderCompiler::Finish(int _index)
+{
+    PROFILE_ZONE("ShaderCompiler::Finish");
+
+    Program& program = *m_programs[_index];
+
+    if (m_mode == kWorkerThreads)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_builtCondition.wait(lock, [&program] { return program.built.load(); });
+    }
+
+    /* This is where a driver still compiling makes us wait */
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program.program, GL_LINK_STATUS, &linked);
+
+    if (!linked)
+    {
+        for (size_t i = 0; i < program.shaders.size(); i++)
+        {
+            GLint compiled = GL_FALSE;
+            glGetShaderiv(program.shaders[i], GL_COMPILE_STATUS, &compiled);
+            if (compiled)
+                continue;
+
+            PrintLog(program.source.name, program.shaders[i], false);
+
+            /* Errors read "source number:line" */
+            const std::vector<std::string>& names = program.source.stages[i].sourceNames;
+            for (size_t number = 0; number < names.size() && names.size() > 1; number++)
+                std::cout << "  " << number << ": " << names[number] << std::endl;
+        }
+        PrintLog(program.source.name, program.program, true);
+    }
+    else if (!program.fromCache && m_cache != nullptr)
+    {
+        m_cache->Save(program.program, program.key);
+    }
+
+    /* The linked program doesn't need its shader objects anymore */
+    for (GLuint shader : program.shaders)
+    {
+        glDetachShader(program.program, shader);
+        glDeleteShader(shader);
+    }
+    program.shaders.clear();
+
+    GLuint result = program.program;
+    program.program = 0;
+
+    if (!linked)
+    {
+        glDeleteProgram(result);
+        return 0;
+    }
+
+    return result;
+}
+
+void ShaderCompiler::Shutdown()
+{
+    for (std::thread& worker : m_workers)
+        worker.join();
+    m_workers.clear();
+
+    for (WorkerContext& context : m_workerContexts)
+        context.Destroy();
+    m_workerContexts.clear();
+
+    m_jobs.clear();
+    m_nextJob = 0;
+}
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "ShaderSourceCache.h"
+#include "WorkerContext.h"
+
+class ProgramBinaryCache;
+
+/// <summary>
+/// Source of one stage of a program: pieces handed as they are to glShaderSource, which concatenates
+/// them. They point into loaded files (no copy) or generated text, storage keeps both alive until the
+/// stage is compiled. sourceNames names the source string numbers used by #line, for the error logs
+/// </summary>
+struct ShaderStageSource
+{
+    GLenum type;
+    std::vector<ShaderSourceSpan> pieces;
+    std::vector<std::shared_ptr<const void>> storage;
+    std::vector<std::string> sourceNames;
+};
+
+/// <summary>
+/// Everything needed to build a program: its stages, the attribute bound to each location, and
+/// the defines it was preprocessed with (they only feed the binary cache key)
+/// </summary>
+struct ProgramSource
+{
+    std::string name;
+    std::vector<ShaderStageSource> stages;
+    std::vector<std::string> attributeLocations;
+    std::string defines;
+};
+
+/// <summary>
+/// Builds a batch of programs without serializing on each compile. Add every program, Submit them all,
+/// then Finish each one when it is needed: the status queries (which block until the driver is done) only
+/// happen there. Programs found in the binary cache are linked right away in Submit.
+/// The rest is compiled:
+/// - with GL_KHR_parallel_shader_compile (or ARB), by the driver's own threads, IsReady polls them;
+/// - otherwise on worker threads, each with its own context sharing objects with the main one;
+/// - otherwise (no worker context) on the calling thread, still submitted back to back
+/// </summary>
+class ShaderCompiler
+{
+public:
+    enum Mode
+    {
+        kSynchronous,
+        kParallelExtension,
+        kWorkerThreads,
+    };
+
+    /// <summary>
+    /// Creates a worker context, on the main thread. False if it can't
+    /// </summary>
+    typedef std::function<bool(WorkerContext&)> WorkerContextFactory;
+
+    /// <summary>
+    /// Pick the mode. _cache may be NULL. Without the parallel compile extension, up to _maxWorkers threads
+    /// (at most one per program to compile) get a context from _createWorkerContext
+    /// </summary>
+    /// <param name="_cache"></param>
+    /// <param name="_createWorkerContext"></param>
+    /// <param name="_maxWorkers"></param>
+    void Initialize(ProgramBinaryCache* _cache, const WorkerContextFactory& _createWorkerContext, int _maxWorkers);
+
+    /// <summary>
+    /// Queue a program, before Submit. Returns its index for IsReady / Finish
+    /// </summary>
+    /// <param name="_source"></param>
+    /// <returns></returns>
+    int Add(const ProgramSource& _source);
+
+    /// <summary>
+    /// Start building every queued program
+    /// </summary>
+    void Submit();
+
+    /// <summary>
+    /// True when program _index is built, so Finish won't wait. Never blocks
+    /// </summary>
+    /// <param name="_index"></param>
+    /// <returns></returns>
+    bool IsReady(int _index);
+
+    /// <summary>
+    /// Wait for program _index and return it, or 0 if it failed (the logs are printed).
+    /// A program built from source is saved to the binary cache. The caller owns the program
+    /// </summary>
+    /// <param name="_index"></param>
+    /// <returns></returns>
+    GLuint Finish(int _index);
+
+    /// <summary>
+    /// Stop the workers and free their contexts. Call after the last Finish
+    /// </summary>
+    void Shutdown();
+
+    Mode GetMode() const { return m_mode; }
+    static const char* GetModeName(Mode _mode);
+
+    /// <summary>
+    /// Programs of the batch that were loaded from the binary cache
+    /// </summary>
+    /// <returns></returns>
+    int GetCachedCount() const { return m_cachedCount; }
+    int GetProgramCount() const { return (int)m_programs.size(); }
+
+private:
+    struct Program
+    {
+        ProgramSource source;
+        uint64_t key = 0;
+        GLuint program = 0;
+        std::vector<GLuint> shaders;
+        bool fromCache = false;
+        std::atomic<bool> built{ false };
+    };
+
+    /// <summary>
+    /// Compile the stages of _program and link it, without querying anything
+    /// </summary>
+    /// <param name="_program"></param>
+    void StartBuild(Program& _program) const;
+
+    void WorkerLoop(int _worker);
+
+    ProgramBinaryCache* m_cache = nullptr;
+    WorkerContextFactory m_createWorkerContext;
+    int m_maxWorkers = 0;
+    Mode m_mode = kSynchronous;
+    int m_cachedCount = 0;
+
+    std::vector<std::unique_ptr<Program>> m_programs;
+
+    //Worker threads: programs still to compile, taken in order
+    std::vector<WorkerContext> m_workerContexts;
+    std::vector<std::thread> m_workers;
+    std::vector<Program*> m_jobs;
+    size_t m_nextJob = 0;
+    std::mutex m_mutex;
+    std::condition_variable m_builtCondition;
+};
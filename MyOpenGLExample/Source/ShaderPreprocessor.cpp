@@ -0,0 +1,155 @@
+#include "ShaderPreprocessor.h"
+
+#include <cstring>
+#include <iostream>
+#include <memory>
+
+#include "Profiler.h"
+
+/// <summary>
+/// Add generated text to _stage, owned by the stage
+/// </summary>
+static void AppendGenerated(const std::string& _text, ShaderStageSource& _stage)
+{
+    std::shared_ptr<std::string> text = std::make_shared<std::string>(_text);
+    _stage.pieces.push_back({ text->data(), (GLint)text->size() });
+    _stage.storage.push_back(text);
+}
+
+/// <summary>
+/// Add [_begin, _end) of a loaded file to _stage, if not empty
+/// </summary>
+static void AppendSpan(const char* _begin, const char* _end, ShaderStageSource& _stage)
+{
+    if (_end > _begin)
+        _stage.pieces.push_back({ _begin, (GLint)(_end - _begin) });
+}
+
+/// <summary>
+/// If the line [_begin, _end) is the directive #_keyword, return where its argument starts, else NULL
+/// </summary>
+static const char* MatchDirective(const char* _begin, const char* _end, const char* _keyword)
+{
+    const char* c = _begin;
+    while (c < _end && (*c == ' ' || *c == '\t'))
+        c++;
+    if (c == _end || *c != '#')
+        return nullptr;
+    c++;
+    while (c < _end && (*c == ' ' || *c == '\t'))
+        c++;
+
+    size_t length = std::strlen(_keyword);
+    if ((size_t)(_end - c) < length || std::strncmp(c, _keyword, length) != 0)
+        return nullptr;
+    c += length;
+
+    /* The keyword must end there: #includes is not #include */
+    if (c < _end && *c != ' ' && *c != '\t' && *c != '"' && *c != '<' && *c != '\r')
+        return nullptr;
+
+    while (c < _end && (*c == ' ' || *c == '\t'))
+        c++;
+    return c;
+}
+
+bool ShaderPreprocessor::Process(const std::string& _path, const ShaderDefines& _defines, ShaderStageSource& _stage)
+{
+    PROFILE_ZONE("ShaderPreprocessor::Process");
+
+    std::set<std::string> onceFiles;
+    return Expand(_path, &_defines, 0, onceFiles, _stage);
+}
+
+bool ShaderPreprocessor::Expand(const std::string& _path, const ShaderDefines* _defines, int _depth, std::set<std::string>& _onceFiles,
+    ShaderStageSource& _stage)
+{
+    if (_depth > kMaxIncludeDepth)
+    {
+        std::cout << "Error: includes nested too deep in " << _path << std::endl;
+        return false;
+    }
+
+    if (_onceFiles.count(_path) != 0)
+        return true;
+
+    std::shared_ptr<const ShaderFile> file = m_sources.Load(_path);
+    if (file == nullptr)
+    {
+        std::cout << "Error: shader file not found " << _path << std::endl;
+        return false;
+    }
+
+    _stage.storage.push_back(file);
+    const int sourceNumber = (int)_stage.sourceNames.size();
+    _stage.sourceNames.push_back(_path);
+
+    if (_depth > 0)
+        AppendGenerated("#line 1 " + std::to_string(sourceNumber) + "\n", _stage);
+
+    std::string directory = _path.substr(0, _path.find_last_of("/\\") + 1);
+    const char* data = file->GetData();
+    const char* end = data + file->GetSize();
+    const char* segment = data;
+    int line = 1;
+
+    for (const char* lineBegin = data; lineBegin < end; line++)
+    {
+        const char* lineEnd = (const char*)std::memchr(lineBegin, '\n', end - lineBegin);
+        lineEnd = (lineEnd != nullptr) ? lineEnd : end;
+        const char* next = (lineEnd < end) ? lineEnd + 1 : end;
+        const char* argument = nullptr;
+
+        if (_defines != nullptr && MatchDirective(lineBegin, lineEnd, "version") != nullptr)
+        {
+            /* #version must come first, the defines go right after it */
+            AppendSpan(segment, next, _stage);
+            std::string text = (next == end) ? "\n" : "";
+            for (const std::pair<std::string, std::string>& define : *_defines)
+                text += "#define " + define.first + " " + define.second + "\n";
+            text += "#line " + std::to_string(line + 1) + " " + std::to_string(sourceNumber) + "\n";
+            AppendGenerated(text, _stage);
+            segment = next;
+            _defines = nullptr;
+        }
+        else if ((argument = MatchDirective(lineBegin, lineEnd, "include")) != nullptr)
+        {
+            const char close = (*argument == '<') ? '>' : '"';
+            const char* nameEnd = (argument < lineEnd) ? (const char*)std::memchr(argument + 1, close, lineEnd - argument - 1) : nullptr;
+
+            if ((*argument != '"' && *argument != '<') || nameEnd == nullptr)
+            {
+                std::cout << "Error: " << _path << ":" << line << ": malformed #include" << std::endl;
+                return false;
+            }
+
+            AppendSpan(segment, lineBegin, _stage);
+            std::string includePath = directory + std::string(argument + 1, nameEnd);
+            if (!Expand(includePath, nullptr, _depth + 1, _onceFiles, _stage))
+                return false;
+
+            AppendGenerated("\n#line " + std::to_string(line + 1) + " " + std::to_string(sourceNumber) + "\n", _stage);
+            segment = next;
+        }
+        else if ((argument = MatchDirective(lineBegin, lineEnd, "pragma")) != nullptr && std::strncmp(argument, "once", 4) == 0)
+        {
+            /* Handled here, the driver never sees it */
+            _onceFiles.insert(_path);
+            AppendSpan(segment, lineBegin, _stage);
+            AppendGenerated("\n", _stage);
+            segment = next;
+        }
+
+        lineBegin = next;
+    }
+
+    AppendSpan(segment, end, _stage);
+
+    if (_defines != nullptr)
+    {
+        std::cout << "Error: " << _path << " has no #version, the defines can't be inserted" << std::endl;
+        return false;
+    }
+
+    return true;
+}
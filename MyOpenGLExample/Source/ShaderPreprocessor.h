@@ -0,0 +1,46 @@
+#pragma once
+
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ShaderCompiler.h"
+#include "ShaderSourceCache.h"
+
+/// <summary>
+/// Defines injected in a shader, name and value, e.g. { "INSTANCED", "1" }
+/// </summary>
+typedef std::vector<std::pair<std::string, std::string>> ShaderDefines;
+
+/// <summary>
+/// GLSL preprocessing done before the driver sees the source:
+/// - #include "file" (relative to the including file) is replaced by the file, #pragma once is honoured;
+/// - the defines are inserted right after #version, so #if on them strips whole branches at compile time.
+/// The output is a list of pieces pointing into the loaded files, only the directives in between are
+/// generated. Every file gets its own source string number in the #line directives, the compile
+/// errors read "number:line" and ShaderStageSource::sourceNames maps the numbers back to files
+/// </summary>
+class ShaderPreprocessor
+{
+public:
+    explicit ShaderPreprocessor(ShaderSourceCache& _sources) : m_sources(_sources) {}
+
+    /// <summary>
+    /// Expand _path with _defines into _stage (its type is left alone). False if a file is missing
+    /// or the includes nest too deep
+    /// </summary>
+    /// <param name="_path"></param>
+    /// <param name="_defines"></param>
+    /// <param name="_stage"></param>
+    /// <returns></returns>
+    bool Process(const std::string& _path, const ShaderDefines& _defines, ShaderStageSource& _stage);
+
+private:
+    static const int kMaxIncludeDepth = 16;
+
+    bool Expand(const std::string& _path, const ShaderDefines* _defines, int _depth, std::set<std::string>& _onceFiles,
+        ShaderStageSource& _stage);
+
+    ShaderSourceCache& m_sources;
+};
@@ -0,0 +1,166 @@
+#include "ShaderSourceCache.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "EmbeddedShaders.h"
+#include "Profiler.h"
+
+ShaderFile::~ShaderFile()
+{
+#ifdef _WIN32
+    if (m_mapping != nullptr)
+        UnmapViewOfFile(m_mapping);
+    if (m_mappingHandle != nullptr)
+        CloseHandle((HANDLE)m_mappingHandle);
+#else
+    if (m_mapping != nullptr)
+        munmap(m_mapping, m_size);
+#endif
+
+    std::free(m_buffer);
+}
+
+bool ShaderFile::Open(const std::string& _path)
+{
+#ifdef _WIN32
+    HANDLE file = CreateFileA(_path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    bool ok = GetFileSizeEx(file, &size) != 0;
+
+    /* An empty file can't be mapped, it is just an empty source */
+    if (ok && size.QuadPart > 0)
+    {
+        HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        void* view = (mapping != NULL) ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+
+        if (view != NULL)
+        {
+            m_mapping = view;
+            m_mappingHandle = mapping;
+            m_data = (const char*)view;
+            m_size = (size_t)size.QuadPart;
+        }
+        else
+        {
+            ok = false;
+            if (mapping != NULL)
+                CloseHandle(mapping);
+        }
+    }
+
+    CloseHandle(file);
+    return ok;
+#else
+    int file = open(_path.c_str(), O_RDONLY);
+    if (file < 0)
+        return false;
+
+    struct stat info;
+    if (fstat(file, &info) != 0)
+    {
+        close(file);
+        return false;
+    }
+
+    m_size = (size_t)info.st_size;
+    bool ok = true;
+
+    if (m_size > 0)
+    {
+        void* view = mmap(NULL, m_size, PROT_READ, MAP_PRIVATE, file, 0);
+
+        if (view != MAP_FAILED)
+        {
+            m_mapping = view;
+            m_data = (const char*)view;
+        }
+        else
+        {
+            /* Not mappable (pipe, special file system...): one read of the whole file */
+            m_buffer = (char*)std::malloc(m_size);
+            ssize_t bytesRead = (m_buffer != nullptr) ? read(file, m_buffer, m_size) : -1;
+            ok = bytesRead == (ssize_t)m_size;
+            m_data = (m_buffer != nullptr) ? m_buffer : "";
+        }
+    }
+
+    close(file);
+    return ok;
+#endif
+}
+
+void ShaderFile::Wrap(const char* _data, size_t _size)
+{
+    m_data = _data;
+    m_size = _size;
+}
+
+std::shared_ptr<const ShaderFile> ShaderSourceCache::LoadEmbedded(const std::string& _path)
+{
+    std::map<std::string, std::shared_ptr<const ShaderFile>>::iterator cached = m_embeddedFiles.find(_path);
+    if (cached != m_embeddedFiles.end())
+        return cached->second;
+
+    for (size_t i = 0; i < m_embeddedShaderCount; i++)
+    {
+        if (_path == m_embeddedShaders[i].path)
+        {
+            std::shared_ptr<ShaderFile> file = std::make_shared<ShaderFile>();
+            file->Wrap(m_embeddedShaders[i].data, m_embeddedShaders[i].size);
+            m_embeddedFiles[_path] = file;
+            return file;
+        }
+    }
+
+    return nullptr;
+}
+
+std::shared_ptr<const ShaderFile> ShaderSourceCache::Load(const std::string& _path)
+{
+    PROFILE_ZONE("ShaderSourceCache::Load");
+
+    if (m_useEmbedded)
+    {
+        std::shared_ptr<const ShaderFile> embedded = LoadEmbedded(_path);
+        if (embedded != nullptr)
+            return embedded;
+    }
+
+#ifdef _WIN32
+    struct _stat64 info;
+    if (_stat64(_path.c_str(), &info) != 0)
+        return nullptr;
+#else
+    struct stat info;
+    if (stat(_path.c_str(), &info) != 0)
+        return nullptr;
+#endif
+
+    std::map<std::string, Entry>::iterator cached = m_files.find(_path);
+    if (cached != m_files.end() && cached->second.modificationTime == (int64_t)info.st_mtime && cached->second.size == (int64_t)info.st_size)
+        return cached->second.file;
+
+    std::shared_ptr<ShaderFile> file = std::make_shared<ShaderFile>();
+    if (!file->Open(_path))
+        return nullptr;
+
+    m_files[_path] = { (int64_t)info.st_mtime, (int64_t)info.st_size, file };
+    return file;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+
+#include <GL/glew.h>
+
+/// <summary>
+/// A piece of shader source, as glShaderSource takes it: not NUL-terminated, explicit length
+/// </summary>
+struct ShaderSourceSpan
+{
+    const char* data;
+    GLint length;
+};
+
+/// <summary>
+/// Contents of a shader file, memory-mapped read-only (read in one call where mapping is not possible).
+/// The bytes stay valid as long as the object lives, hold it through a shared_ptr while pointing into it
+/// </summary>
+class ShaderFile
+{
+public:
+    ShaderFile() = default;
+    ~ShaderFile();
+
+    ShaderFile(const ShaderFile&) = delete;
+    ShaderFile& operator=(const ShaderFile&) = delete;
+
+    /// <summary>
+    /// Map _path. False if it can't be opened
+    /// </summary>
+    /// <param name="_path"></param>
+    /// <returns></returns>
+    bool Open(const std::string& _path);
+
+    /// <summary>
+    /// Point at _size bytes that outlive the object (a shader embedded in the executable): no mapping, no copy
+    /// </summary>
+    /// <param name="_data"></param>
+    /// <param name="_size"></param>
+    void Wrap(const char* _data, size_t _size);
+
+    const char* GetData() const { return m_data; }
+    size_t GetSize() const { return m_size; }
+    ShaderSourceSpan GetSpan() const { return { m_data, (GLint)m_size }; }
+
+private:
+    const char* m_data = "";
+    size_t m_size = 0;
+
+    //Mapping to release (the view, plus the mapping handle on Windows), or a heap copy when it was read
+    void* m_mapping = nullptr;
+    void* m_mappingHandle = nullptr;
+    char* m_buffer = nullptr;
+};
+
+/// <summary>
+/// Shader files loaded so far, keyed by path. A file is mapped again only when its modification time or
+/// size changed, so a program built twice (or several programs sharing a file) costs one stat.
+/// With the embedded shaders enabled, a path compiled into the executable (see EmbeddedShaders.h) is
+/// served from there without touching the file system; other paths are still read from disk
+/// </summary>
+class ShaderSourceCache
+{
+public:
+    /// <summary>
+    /// The contents of _path, or NULL if it can't be read
+    /// </summary>
+    /// <param name="_path"></param>
+    /// <returns></returns>
+    std::shared_ptr<const ShaderFile> Load(const std::string& _path);
+
+    void Clear()
+    {
+        m_files.clear();
+        m_embeddedFiles.clear();
+    }
+
+    void SetUseEmbedded(bool _enabled) { m_useEmbedded = _enabled; }
+
+private:
+    /// <summary>
+    /// The embedded copy of _path, or NULL if it isn't embedded
+    /// </summary>
+    /// <param name="_path"></param>
+    /// <returns></returns>
+    std::shared_ptr<const ShaderFile> LoadEmbedded(const std::string& _path);
+
+    struct Entry
+    {
+        int64_t modificationTime;
+        int64_t size;
+        std::shared_ptr<const ShaderFile> file;
+    };
+
+    std::map<std::string, Entry> m_files;
+    std::map<std::string, std::shared_ptr<const ShaderFile>> m_embeddedFiles;
+    bool m_useEmbedded = true;
+};
@@ -0,0 +1,85 @@
+#include "ShaderVariantCache.h"
+
+#include <algorithm>
+
+std::string ShaderVariantCache::GetDefinesKey(const ShaderDefines& _defines)
+{
+    ShaderDefines sorted = _defines;
+    std::sort(sorted.begin(), sorted.end());
+
+    std::string key;
+    for (const std::pair<std::string, std::string>& define : sorted)
+        key += define.first + "=" + define.second + ";";
+    return key;
+}
+
+int ShaderVariantCache::Request(ShaderCompiler& _compiler, ShaderPreprocessor& _preprocessor, const ShaderVariantDescription& _variant)
+{
+    std::string defines = GetDefinesKey(_variant.defines);
+    std::string key = _variant.vertexPath + "|" + _variant.fragmentPath + "|" + _variant.computePath + "|" + defines;
+
+    std::map<std::string, int>::iterator found = m_handles.find(key);
+    if (found != m_handles.end())
+        return found->second;
+
+    /* Sorted, so the generated text (and the binary cache key) doesn't depend on the request order */
+    ShaderDefines sortedDefines = _variant.defines;
+    std::sort(sortedDefines.begin(), sortedDefines.end());
+
+    ProgramSource program;
+    program.name = _variant.name + " [" + defines + "]";
+    program.attributeLocations = _variant.attributeLocations;
+    program.defines = defines;
+    if (!_variant.computePath.empty())
+    {
+        program.stages.resize(1);
+        program.stages[0].type = GL_COMPUTE_SHADER;
+
+        if (!_preprocessor.Process(_variant.computePath, sortedDefines, program.stages[0]))
+            return -1;
+    }
+    else
+    {
+        program.stages.resize(2);
+        program.stages[0].type = GL_VERTEX_SHADER;
+        program.stages[1].type = GL_FRAGMENT_SHADER;
+
+        if (!_preprocessor.Process(_variant.vertexPath, sortedDefines, program.stages[0])
+            || !_preprocessor.Process(_variant.fragmentPath, sortedDefines, program.stages[1]))
+            return -1;
+    }
+
+    Variant variant = { 0, &_compiler, _compiler.Add(program) };
+    m_variants.push_back(variant);
+    m_handles[key] = (int)m_variants.size() - 1;
+    return (int)m_variants.size() - 1;
+}
+
+void ShaderVariantCache::Resolve(ShaderCompiler& _compiler)
+{
+    for (Variant& variant : m_variants)
+    {
+        if (variant.compiler == &_compiler)
+        {
+            variant.program = _compiler.Finish(variant.compilerIndex);
+            variant.compiler = nullptr;
+        }
+    }
+}
+
+GLuint ShaderVariantCache::GetProgram(int _handle) const
+{
+    return (_handle >= 0 && _handle < (int)m_variants.size()) ? m_variants[_handle].program : 0;
+}
+
+void ShaderVariantCache::Release()
+{
+    for (Variant& variant : m_variants)
+    {
+        if (variant.program != 0)
+            glDeleteProgram(variant.program);
+    }
+
+    m_variants.clear();
+    m_handles.clear();
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "ShaderCompiler.h"
+#include "ShaderPreprocessor.h"
+
+/// <summary>
+/// One permutation of a program: its stage files and the defines they are specialized with.
+/// A compute program has only computePath, the others only vertexPath and fragmentPath
+/// </summary>
+struct ShaderVariantDescription
+{
+    std::string name;
+    std::string vertexPath;
+    std::string fragmentPath;
+    std::string computePath;
+    ShaderDefines defines;
+    std::vector<std::string> attributeLocations;
+};
+
+/// <summary>
+/// Programs by permutation. Requesting a variant already built or queued returns the same handle,
+/// so each permutation is preprocessed and compiled once per run (and, through the binary cache,
+/// once per driver). The cache owns the programs
+/// </summary>
+class ShaderVariantCache
+{
+public:
+    /// <summary>
+    /// Handle of the variant, queued on _compiler (before its Submit) if it is new. -1 if its sources
+    /// can't be preprocessed
+    /// </summary>
+    /// <param name="_compiler"></param>
+    /// <param name="_preprocessor"></param>
+    /// <param name="_variant"></param>
+    /// <returns></returns>
+    int Request(ShaderCompiler& _compiler, ShaderPreprocessor& _preprocessor, const ShaderVariantDescription& _variant);
+
+    /// <summary>
+    /// Wait for every variant queued on _compiler (after its Submit)
+    /// </summary>
+    /// <param name="_compiler"></param>
+    void Resolve(ShaderCompiler& _compiler);
+
+    /// <summary>
+    /// The program of a variant, 0 if it failed or is not resolved yet
+    /// </summary>
+    /// <param name="_handle"></param>
+    /// <returns></returns>
+    GLuint GetProgram(int _handle) const;
+
+    int GetVariantCount() const { return (int)m_variants.size(); }
+
+    /// <summary>
+    /// Delete every program
+    /// </summary>
+    void Release();
+
+    /// <summary>
+    /// Defines sorted by name, as one string: the same set in any order is the same variant
+    /// </summary>
+    /// <param name="_defines"></param>
+    /// <returns></returns>
+    static std::string GetDefinesKey(const ShaderDefines& _defines);
+
+private:
+    struct Variant
+    {
+        GLuint program;
+        ShaderCompiler* compiler;
+        int compilerIndex;
+    };
+
+    std::vector<Variant> m_variants;
+    std::map<std::string, int> m_handles;
+};
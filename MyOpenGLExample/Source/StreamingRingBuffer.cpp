@@ -0,0 +1,124 @@
+#include "StreamingRingBuffer.h"
+
+#include "Profiler.h"
+
+bool StreamingRingBuffer::Initialize(size_t _regionSize)
+{
+    m_regionSize = _regionSize;
+    m_persistent = GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+
+    /* GL_COPY_WRITE_BUFFER is never used for drawing, binding there leaves the draw state alone */
+    glGenBuffers(1, &m_buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+
+    if (m_persistent)
+    {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_COPY_WRITE_BUFFER, m_regionSize * kRegionCount, NULL, flags);
+        m_persistentPointer = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, m_regionSize * kRegionCount, flags);
+    }
+    else
+    {
+        glBufferData(GL_COPY_WRITE_BUFFER, m_regionSize * kRegionCount, NULL, GL_STREAM_DRAW);
+    }
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    return !m_persistent || m_persistentPointer != nullptr;
+}
+
+void StreamingRingBuffer::BeginFrame()
+{
+    PROFILE_ZONE("StreamingRingBuffer::BeginFrame");
+
+    m_region = (m_region + 1) % kRegionCount;
+    m_used = 0;
+
+    GLsync fence = m_fences[m_region];
+    if (fence != NULL)
+    {
+        /* Poll first: with three regions the GPU is normally done long ago */
+        GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        if (result == GL_TIMEOUT_EXPIRED)
+        {
+            m_stallCount++;
+            do
+            {
+                result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+            } while (result == GL_TIMEOUT_EXPIRED);
+        }
+
+        glDeleteSync(fence);
+        m_fences[m_region] = NULL;
+    }
+
+    if (m_persistent)
+    {
+        m_regionPointer = m_persistentPointer + m_region * m_regionSize;
+    }
+    else
+    {
+        /* The fence already guarantees the GPU is done with the region, no need for the driver to sync */
+        glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+        m_regionPointer = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, m_region * m_regionSize, m_regionSize,
+            GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+}
+
+void* StreamingRingBuffer::Allocate(size_t _size, size_t _alignment, GLintptr& _offset)
+{
+    size_t start = (m_used + _alignment - 1) / _alignment * _alignment;
+
+    if (m_regionPointer == nullptr || start + _size > m_regionSize)
+        return NULL;
+
+    m_used = start + _size;
+    _offset = (GLintptr)(m_region * m_regionSize + start);
+    return m_regionPointer + start;
+}
+
+void StreamingRingBuffer::FlushWrites()
+{
+    /* Coherent persistent mapping: the writes are already visible */
+    if (!m_persistent && m_regionPointer != nullptr)
+    {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        m_regionPointer = nullptr;
+    }
+}
+
+void StreamingRingBuffer::EndFrame()
+{
+    FlushWrites();
+    m_fences[m_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void StreamingRingBuffer::Shutdown(RenderStateCache& _glState)
+{
+    for (GLsync& fence : m_fences)
+    {
+        if (fence != NULL)
+        {
+            glDeleteSync(fence);
+            fence = NULL;
+        }
+    }
+
+    if (m_buffer != 0)
+    {
+        if (m_persistentPointer != nullptr)
+        {
+            glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+            glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        }
+
+        _glState.DeleteBuffers(1, &m_buffer);
+        m_buffer = 0;
+    }
+
+    m_persistentPointer = nullptr;
+    m_regionPointer = nullptr;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+
+#include <GL/glew.h>
+
+#include "RenderStateCache.h"
+
+/// <summary>
+/// Buffer for data rewritten every frame, split in kRegionCount regions used round-robin.
+/// With GL 4.4 / ARB_buffer_storage it is allocated once and mapped persistently and coherently, so
+/// writing is a plain memcpy into GPU-visible memory: no glBufferData / glBufferSubData, no driver
+/// allocation and no implicit sync. Each region is protected by a fence placed after the frame that used
+/// it, so the CPU writing frame N + 2 only waits if the GPU is still reading frame N (it is counted).
+/// Without buffer storage the region is mapped unsynchronized every frame instead (same fences)
+/// </summary>
+class StreamingRingBuffer
+{
+public:
+    static const int kRegionCount = 3;
+
+    /// <summary>
+    /// Create the buffer with _regionSize bytes per frame
+    /// </summary>
+    /// <param name="_regionSize"></param>
+    /// <returns></returns>
+    bool Initialize(size_t _regionSize);
+
+    /// <summary>
+    /// Move to the next region, waiting for the GPU to be done with it if needed
+    /// </summary>
+    void BeginFrame();
+
+    /// <summary>
+    /// Reserve _size bytes in the current region. Returns the CPU pointer to write to and, in _offset,
+    /// the offset of the data in the buffer. Returns NULL if the region is full
+    /// </summary>
+    /// <param name="_size"></param>
+    /// <param name="_alignment"></param>
+    /// <param name="_offset"></param>
+    /// <returns></returns>
+    void* Allocate(size_t _size, size_t _alignment, GLintptr& _offset);
+
+    /// <summary>
+    /// Make the writes of this frame visible to the GPU. Call before the draws reading them
+    /// </summary>
+    void FlushWrites();
+
+    /// <summary>
+    /// Fence the current region, after the last draw reading it
+    /// </summary>
+    void EndFrame();
+
+    /// <summary>
+    /// Release the buffer. Its name goes through _glState, which may have it bound
+    /// </summary>
+    /// <param name="_glState"></param>
+    void Shutdown(RenderStateCache& _glState);
+
+    GLuint GetBuffer() const { return m_buffer; }
+    bool IsPersistent() const { return m_persistent; }
+
+    /// <summary>
+    /// Frames that had to wait for the GPU before writing
+    /// </summary>
+    /// <returns></returns>
+    unsigned int GetStallCount() const { return m_stallCount; }
+
+private:
+    GLuint m_buffer = 0;
+    bool m_persistent = false;
+    size_t m_regionSize = 0;
+
+    unsigned char* m_persistentPointer = nullptr;
+    unsigned char* m_regionPointer = nullptr;
+
+    GLsync m_fences[kRegionCount] = {};
+    int m_region = kRegionCount - 1;
+    size_t m_used = 0;
+    unsigned int m_stallCount = 0;
+};
@@ -0,0 +1,282 @@
+#include "TransformKernels.h"
+
+#include <cmath>
+
+/// <summary>
+/// The kernels always run over whole groups of 8 objects
+/// </summary>
+static inline size_t PaddedCount(size_t _count)
+{
+    return (_count + 7) & ~(size_t)7;
+}
+
+// ---------------------------------------------------------------------------
+// Integration. First order: the rotation angle of a step comes out as 2 atan(w dt / 2) instead of w dt,
+// 1e-5 too slow for our speeds at 60 Hz, and the renormalization keeps the quaternions unit
+// ---------------------------------------------------------------------------
+void IntegrateRotationsScalar(const QuatColumns& _rotation, const QuatColumns& _previous, const Vec3Columns& _angularVelocity, float _dt, size_t _count)
+{
+    const float h = 0.5f * _dt;
+    const size_t count = PaddedCount(_count);
+    for (size_t i = 0; i < count; i++)
+    {
+        float x = _rotation.x[i], y = _rotation.y[i], z = _rotation.z[i], w = _rotation.w[i];
+        float wx = _angularVelocity.x[i], wy = _angularVelocity.y[i], wz = _angularVelocity.z[i];
+        _previous.x[i] = x;
+        _previous.y[i] = y;
+        _previous.z[i] = z;
+        _previous.w[i] = w;
+
+        /* (w, 0) * q = (q.w * w + w x q.xyz, -w . q.xyz) */
+        float nx = x + h * (w * wx + wy * z - wz * y);
+        float ny = y + h * (w * wy + wz * x - wx * z);
+        float nz = z + h * (w * wz + wx * y - wy * x);
+        float nw = w - h * (wx * x + wy * y + wz * z);
+
+        float inverse = 1.0f / std::sqrt(nx * nx + ny * ny + nz * nz + nw * nw);
+        _rotation.x[i] = nx * inverse;
+        _rotation.y[i] = ny * inverse;
+        _rotation.z[i] = nz * inverse;
+        _rotation.w[i] = nw * inverse;
+    }
+}
+
+#if MYOPENGL_SIMD_AVX2
+/// <summary>
+/// 1 / sqrt(_n): the hardware estimate (12 bits) plus one Newton step (22 bits)
+/// </summary>
+static inline __m256 InverseSqrt(__m256 _n)
+{
+    __m256 r = _mm256_rsqrt_ps(_n);
+    __m256 rr = _mm256_mul_ps(_mm256_mul_ps(_n, r), r);
+    return _mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(0.5f), r), _mm256_sub_ps(_mm256_set1_ps(3.0f), rr));
+}
+#elif MYOPENGL_SIMD_SSE
+static inline __m128 InverseSqrt(__m128 _n)
+{
+    __m128 r = _mm_rsqrt_ps(_n);
+    __m128 rr = _mm_mul_ps(_mm_mul_ps(_n, r), r);
+    return _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), r), _mm_sub_ps(_mm_set1_ps(3.0f), rr));
+}
+#endif
+
+void IntegrateRotations(const QuatColumns& _rotation, const QuatColumns& _previous, const Vec3Columns& _angularVelocity, float _dt, size_t _count)
+{
+#if MYOPENGL_SIMD_AVX2
+    const size_t count = PaddedCount(_count);
+    const __m256 h = _mm256_set1_ps(0.5f * _dt);
+    for (size_t i = 0; i < count; i += 8)
+    {
+        __m256 x = _mm256_load_ps(_rotation.x + i);
+        __m256 y = _mm256_load_ps(_rotation.y + i);
+        __m256 z = _mm256_load_ps(_rotation.z + i);
+        __m256 w = _mm256_load_ps(_rotation.w + i);
+        _mm256_store_ps(_previous.x + i, x);
+        _mm256_store_ps(_previous.y + i, y);
+        _mm256_store_ps(_previous.z + i, z);
+        _mm256_store_ps(_previous.w + i, w);
+        __m256 wx = _mm256_mul_ps(h, _mm256_load_ps(_angularVelocity.x + i));
+        __m256 wy = _mm256_mul_ps(h, _mm256_load_ps(_angularVelocity.y + i));
+        __m256 wz = _mm256_mul_ps(h, _mm256_load_ps(_angularVelocity.z + i));
+
+        __m256 nx = MulAdd(w, wx, MulAdd(wy, z, MulAdd(_mm256_sub_ps(_mm256_setzero_ps(), wz), y, x)));
+        __m256 ny = MulAdd(w, wy, MulAdd(wz, x, MulAdd(_mm256_sub_ps(_mm256_setzero_ps(), wx), z, y)));
+        __m256 nz = MulAdd(w, wz, MulAdd(wx, y, MulAdd(_mm256_sub_ps(_mm256_setzero_ps(), wy), x, z)));
+        __m256 nw = _mm256_sub_ps(w, MulAdd(wx, x, MulAdd(wy, y, _mm256_mul_ps(wz, z))));
+
+        __m256 inverse = InverseSqrt(MulAdd(nx, nx, MulAdd(ny, ny, MulAdd(nz, nz, _mm256_mul_ps(nw, nw)))));
+        _mm256_store_ps(_rotation.x + i, _mm256_mul_ps(nx, inverse));
+        _mm256_store_ps(_rotation.y + i, _mm256_mul_ps(ny, inverse));
+        _mm256_store_ps(_rotation.z + i, _mm256_mul_ps(nz, inverse));
+        _mm256_store_ps(_rotation.w + i, _mm256_mul_ps(nw, inverse));
+    }
+#elif MYOPENGL_SIMD_SSE
+    const size_t count = PaddedCount(_count);
+    const __m128 h = _mm_set1_ps(0.5f * _dt);
+    for (size_t i = 0; i < count; i += 4)
+    {
+        __m128 x = _mm_load_ps(_rotation.x + i);
+        __m128 y = _mm_load_ps(_rotation.y + i);
+        __m128 z = _mm_load_ps(_rotation.z + i);
+        __m128 w = _mm_load_ps(_rotation.w + i);
+        _mm_store_ps(_previous.x + i, x);
+        _mm_store_ps(_previous.y + i, y);
+        _mm_store_ps(_previous.z + i, z);
+        _mm_store_ps(_previous.w + i, w);
+        __m128 wx = _mm_mul_ps(h, _mm_load_ps(_angularVelocity.x + i));
+        __m128 wy = _mm_mul_ps(h, _mm_load_ps(_angularVelocity.y + i));
+        __m128 wz = _mm_mul_ps(h, _mm_load_ps(_angularVelocity.z + i));
+
+        __m128 nx = MulAdd(w, wx, MulAdd(wy, z, MulAdd(_mm_sub_ps(_mm_setzero_ps(), wz), y, x)));
+        __m128 ny = MulAdd(w, wy, MulAdd(wz, x, MulAdd(_mm_sub_ps(_mm_setzero_ps(), wx), z, y)));
+        __m128 nz = MulAdd(w, wz, MulAdd(wx, y, MulAdd(_mm_sub_ps(_mm_setzero_ps(), wy), x, z)));
+        __m128 nw = _mm_sub_ps(w, MulAdd(wx, x, MulAdd(wy, y, _mm_mul_ps(wz, z))));
+
+        __m128 inverse = InverseSqrt(MulAdd(nx, nx, MulAdd(ny, ny, MulAdd(nz, nz, _mm_mul_ps(nw, nw)))));
+        _mm_store_ps(_rotation.x + i, _mm_mul_ps(nx, inverse));
+        _mm_store_ps(_rotation.y + i, _mm_mul_ps(ny, inverse));
+        _mm_store_ps(_rotation.z + i, _mm_mul_ps(nz, inverse));
+        _mm_store_ps(_rotation.w + i, _mm_mul_ps(nw, inverse));
+    }
+#else
+    IntegrateRotationsScalar(_rotation, _previous, _angularVelocity, _dt, _count);
+#endif
+}
+
+// ---------------------------------------------------------------------------
+// Interpolated output. Two consecutive steps are always in the same hemisphere, a plain nlerp is enough
+// ---------------------------------------------------------------------------
+static inline void WriteInterpolatedRotation(const float* const* _previous, const float* const* _rotation, size_t _index, float _alpha, float* _out)
+{
+    float q[4];
+    for (int c = 0; c < 4; c++)
+        q[c] = _previous[c][_index] + (_rotation[c][_index] - _previous[c][_index]) * _alpha;
+
+    float inverse = 1.0f / std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+    for (int c = 0; c < 4; c++)
+        _out[c] = q[c] * inverse;
+}
+
+void WriteInterpolatedRotationsScalar(const QuatColumns& _previous, const QuatColumns& _rotation, float _alpha, size_t _count, float* _out)
+{
+    const float* previous[4] = { _previous.x, _previous.y, _previous.z, _previous.w };
+    const float* rotation[4] = { _rotation.x, _rotation.y, _rotation.z, _rotation.w };
+
+    for (size_t i = 0; i < _count; i++)
+        WriteInterpolatedRotation(previous, rotation, i, _alpha, _out + i * 4);
+}
+
+#if MYOPENGL_SIMD_AVX2
+/// <summary>
+/// Normalize the 8 quaternions of _q (columns) and store them interleaved to _out
+/// </summary>
+static inline void StoreNormalizedRotations(__m256 _q[4], float* _out)
+{
+    __m256 inverse = InverseSqrt(MulAdd(_q[0], _q[0], MulAdd(_q[1], _q[1], MulAdd(_q[2], _q[2], _mm256_mul_ps(_q[3], _q[3])))));
+    for (int c = 0; c < 4; c++)
+        _q[c] = _mm256_mul_ps(_q[c], inverse);
+
+    /* SoA to AoS: 4x4 transposes inside each 128-bit half (objects 0-3 and 4-7), then regroup the halves */
+    __m256 t0 = _mm256_unpacklo_ps(_q[0], _q[1]);
+    __m256 t1 = _mm256_unpackhi_ps(_q[0], _q[1]);
+    __m256 t2 = _mm256_unpacklo_ps(_q[2], _q[3]);
+    __m256 t3 = _mm256_unpackhi_ps(_q[2], _q[3]);
+    __m256 r0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+    __m256 r1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+    __m256 r2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+    __m256 r3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+
+    _mm256_storeu_ps(_out, _mm256_permute2f128_ps(r0, r1, 0x20));
+    _mm256_storeu_ps(_out + 8, _mm256_permute2f128_ps(r2, r3, 0x20));
+    _mm256_storeu_ps(_out + 16, _mm256_permute2f128_ps(r0, r1, 0x31));
+    _mm256_storeu_ps(_out + 24, _mm256_permute2f128_ps(r2, r3, 0x31));
+}
+#elif MYOPENGL_SIMD_SSE
+/// <summary>
+/// Normalize the 4 quaternions of _q (columns) and store them interleaved to _out
+/// </summary>
+static inline void StoreNormalizedRotations(__m128 _q[4], float* _out)
+{
+    __m128 inverse = InverseSqrt(MulAdd(_q[0], _q[0], MulAdd(_q[1], _q[1], MulAdd(_q[2], _q[2], _mm_mul_ps(_q[3], _q[3])))));
+    for (int c = 0; c < 4; c++)
+        _q[c] = _mm_mul_ps(_q[c], inverse);
+
+    _MM_TRANSPOSE4_PS(_q[0], _q[1], _q[2], _q[3]);
+
+    for (int c = 0; c < 4; c++)
+        _mm_storeu_ps(_out + c * 4, _q[c]);
+}
+#endif
+
+void WriteInterpolatedRotations(const QuatColumns& _previous, const QuatColumns& _rotation, float _alpha, size_t _count, float* _out)
+{
+    const float* previous[4] = { _previous.x, _previous.y, _previous.z, _previous.w };
+    const float* rotation[4] = { _rotation.x, _rotation.y, _rotation.z, _rotation.w };
+
+#if MYOPENGL_SIMD_AVX2
+    const __m256 alpha = _mm256_set1_ps(_alpha);
+    size_t i = 0;
+    for (; i + 8 <= _count; i += 8)
+    {
+        __m256 q[4];
+        for (int c = 0; c < 4; c++)
+        {
+            __m256 from = _mm256_load_ps(previous[c] + i);
+            q[c] = MulAdd(_mm256_sub_ps(_mm256_load_ps(rotation[c] + i), from), alpha, from);
+        }
+        StoreNormalizedRotations(q, _out + i * 4);
+    }
+#elif MYOPENGL_SIMD_SSE
+    const __m128 alpha = _mm_set1_ps(_alpha);
+    size_t i = 0;
+    for (; i + 4 <= _count; i += 4)
+    {
+        __m128 q[4];
+        for (int c = 0; c < 4; c++)
+        {
+            __m128 from = _mm_load_ps(previous[c] + i);
+            q[c] = MulAdd(_mm_sub_ps(_mm_load_ps(rotation[c] + i), from), alpha, from);
+        }
+        StoreNormalizedRotations(q, _out + i * 4);
+    }
+#else
+    size_t i = 0;
+#endif
+
+    /* The output is not padded: the last objects one at a time */
+    for (; i < _count; i++)
+        WriteInterpolatedRotation(previous, rotation, i, _alpha, _out + i * 4);
+}
+
+void WriteInterpolatedRotationsIndexedScalar(const QuatColumns& _previous, const QuatColumns& _rotation, float _alpha,
+    const uint32_t* _indices, size_t _count, float* _out)
+{
+    const float* previous[4] = { _previous.x, _previous.y, _previous.z, _previous.w };
+    const float* rotation[4] = { _rotation.x, _rotation.y, _rotation.z, _rotation.w };
+
+    for (size_t i = 0; i < _count; i++)
+        WriteInterpolatedRotation(previous, rotation, _indices[i], _alpha, _out + i * 4);
+}
+
+void WriteInterpolatedRotationsIndexed(const QuatColumns& _previous, const QuatColumns& _rotation, float _alpha,
+    const uint32_t* _indices, size_t _count, float* _out)
+{
+    const float* previous[4] = { _previous.x, _previous.y, _previous.z, _previous.w };
+    const float* rotation[4] = { _rotation.x, _rotation.y, _rotation.z, _rotation.w };
+
+#if MYOPENGL_SIMD_AVX2
+    const __m256 alpha = _mm256_set1_ps(_alpha);
+    size_t i = 0;
+    for (; i + 8 <= _count; i += 8)
+    {
+        __m256i indices = _mm256_loadu_si256((const __m256i*)(_indices + i));
+        __m256 q[4];
+        for (int c = 0; c < 4; c++)
+        {
+            __m256 from = _mm256_i32gather_ps(previous[c], indices, 4);
+            q[c] = MulAdd(_mm256_sub_ps(_mm256_i32gather_ps(rotation[c], indices, 4), from), alpha, from);
+        }
+        StoreNormalizedRotations(q, _out + i * 4);
+    }
+#elif MYOPENGL_SIMD_SSE
+    const __m128 alpha = _mm_set1_ps(_alpha);
+    size_t i = 0;
+    for (; i + 4 <= _count; i += 4)
+    {
+        const uint32_t* index = _indices + i;
+        __m128 q[4];
+        for (int c = 0; c < 4; c++)
+        {
+            __m128 from = _mm_setr_ps(previous[c][index[0]], previous[c][index[1]], previous[c][index[2]], previous[c][index[3]]);
+            __m128 to = _mm_setr_ps(rotation[c][index[0]], rotation[c][index[1]], rotation[c][index[2]], rotation[c][index[3]]);
+            q[c] = MulAdd(_mm_sub_ps(to, from), alpha, from);
+        }
+        StoreNormalizedRotations(q, _out + i * 4);
+    }
+#else
+    size_t i = 0;
+#endif
+
+    for (; i < _count; i++)
+        WriteInterpolatedRotation(previous, rotation, _indices[i], _alpha, _out + i * 4);
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "VectorMath.h"
+
+/// <summary>
+/// Quaternions stored as four columns (structure of arrays): element i is (x[i], y[i], z[i], w[i]).
+/// The kernels load 8 (AVX2) or 4 (SSE) objects per register, the columns must be 32-byte aligned
+/// </summary>
+struct QuatColumns
+{
+    float* x;
+    float* y;
+    float* z;
+    float* w;
+};
+
+struct Vec3Columns
+{
+    float* x;
+    float* y;
+    float* z;
+};
+
+/// <summary>
+/// One simulation step of _dt seconds for _count objects: the current rotation is saved in _previous, then
+/// integrates the angular velocity, q += dt / 2 * (w, 0) * q, and is renormalized.
+/// The columns are processed in whole groups of 8: they must be padded up to that with valid values
+/// </summary>
+/// <param name="_rotation"></param>
+/// <param name="_previous"></param>
+/// <param name="_angularVelocity"></param>
+/// <param name="_dt"></param>
+/// <param name="_count"></param>
+void IntegrateRotations(const QuatColumns& _rotation, const QuatColumns& _previous, const Vec3Columns& _angularVelocity, float _dt, size_t _count);
+void IntegrateRotationsScalar(const QuatColumns& _rotation, const QuatColumns& _previous, const Vec3Columns& _angularVelocity, float _dt, size_t _count);
+
+/// <summary>
+/// Write the rotations _alpha (0..1) of the way from _previous to _rotation, interleaved (x, y, z, w per object,
+/// the instance attribute layout) to _out: typically mapped GPU memory, written once, in order, with no
+/// intermediate copy. Exactly _count objects are written
+/// </summary>
+/// <param name="_previous"></param>
+/// <param name="_rotation"></param>
+/// <param name="_alpha"></param>
+/// <param name="_count"></param>
+/// <param name="_out"></param>
+void WriteInterpolatedRotations(const QuatColumns& _previous, const QuatColumns& _rotation, float _alpha, size_t _count, float* _out);
+void WriteInterpolatedRotationsScalar(const QuatColumns& _previous, const QuatColumns& _rotation, float _alpha, size_t _count, float* _out);
+
+/// <summary>
+/// WriteInterpolatedRotations for a subset of the objects: the _count objects _indices lists (the visible ones),
+/// written one after the other to _out
+/// </summary>
+/// <param name="_previous"></param>
+/// <param name="_rotation"></param>
+/// <param name="_alpha"></param>
+/// <param name="_indices"></param>
+/// <param name="_count"></param>
+/// <param name="_out"></param>
+void WriteInterpolatedRotationsIndexed(const QuatColumns& _previous, const QuatColumns& _rotation, float _alpha,
+    const uint32_t* _indices, size_t _count, float* _out);
+void WriteInterpolatedRotationsIndexedScalar(const QuatColumns& _previous, const QuatColumns& _rotation, float _alpha,
+    const uint32_t* _indices, size_t _count, float* _out);
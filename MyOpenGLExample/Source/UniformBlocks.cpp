@@ -0,0 +1,17 @@
+#include "UniformBlocks.h"
+
+/// <summary>
+/// Block names as declared in the shaders, by binding point
+/// </summary>
+static const char* const s_blockNames[] = { "Camera", "Frame", "Scene" };
+
+void BindUniformBlocks(GLuint _program)
+{
+    for (GLuint binding = 0; binding < sizeof(s_blockNames) / sizeof(s_blockNames[0]); binding++)
+    {
+        GLuint index = glGetUniformBlockIndex(_program, s_blockNames[binding]);
+
+        if (index != GL_INVALID_INDEX)
+            glUniformBlockBinding(_program, index, binding);
+    }
+}
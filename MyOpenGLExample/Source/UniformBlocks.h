@@ -0,0 +1,52 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include "MeshBatch.h"
+
+/// <summary>
+/// Binding points of the uniform blocks, the same for every program: a buffer bound there once feeds
+/// all of them. GLSL 3.30 can't set the binding in the shader, BindUniformBlocks does it after linking
+/// </summary>
+enum UniformBlockBinding
+{
+    kCameraBlockBinding = 0,
+    kFrameBlockBinding = 1,
+    kSceneBlockBinding = 2,
+};
+
+/// <summary>
+/// std140 mirror of the Camera block: rarely changes, uploaded only when dirty
+/// </summary>
+struct CameraBlock
+{
+    GLfloat projection[16];
+    GLfloat view[16];
+};
+
+/// <summary>
+/// std140 mirror of the Frame block: rewritten every frame, streamed through the ring buffer.
+/// model is the rotation as a matrix, for the TRANSFORM_MATRIX shader variant
+/// </summary>
+struct FrameBlock
+{
+    GLfloat rotation[4];
+    GLfloat transparency;
+    GLfloat padding[3];
+    GLfloat model[16];
+};
+
+/// <summary>
+/// std140 mirror of the Scene block: the position decoding of every batch mesh, uploaded once
+/// (a MeshQuantization is two vec4, so the array has the std140 stride)
+/// </summary>
+struct SceneBlock
+{
+    MeshQuantization meshQuantization[kMaxBatchMeshes];
+};
+
+/// <summary>
+/// Attach the uniform blocks _program declares to their binding point. Blocks it doesn't use are skipped
+/// </summary>
+/// <param name="_program"></param>
+void BindUniformBlocks(GLuint _program);
@@ -0,0 +1,327 @@
+#include "VectorMath.h"
+
+const char* GetSimdLevelName()
+{
+#if MYOPENGL_SIMD_AVX2
+    return "AVX2";
+#elif MYOPENGL_SIMD_SSE
+    return "SSE";
+#else
+    return "scalar";
+#endif
+}
+
+// ---------------------------------------------------------------------------
+// Scalar reference kernels
+// ---------------------------------------------------------------------------
+Mat4 Mat4MultiplyScalar(const Mat4& _a, const Mat4& _b)
+{
+    Mat4 result;
+    for (int column = 0; column < 4; column++)
+    {
+        for (int row = 0; row < 4; row++)
+        {
+            result.m[column * 4 + row] = _a.m[row] * _b.m[column * 4] + _a.m[4 + row] * _b.m[column * 4 + 1]
+                + _a.m[8 + row] * _b.m[column * 4 + 2] + _a.m[12 + row] * _b.m[column * 4 + 3];
+        }
+    }
+    return result;
+}
+
+Vec4 Mat4TransformScalar(const Mat4& _m, const Vec4& _v)
+{
+    return
+    {
+        _m.m[0] * _v.x + _m.m[4] * _v.y + _m.m[8] * _v.z + _m.m[12] * _v.w,
+        _m.m[1] * _v.x + _m.m[5] * _v.y + _m.m[9] * _v.z + _m.m[13] * _v.w,
+        _m.m[2] * _v.x + _m.m[6] * _v.y + _m.m[10] * _v.z + _m.m[14] * _v.w,
+        _m.m[3] * _v.x + _m.m[7] * _v.y + _m.m[11] * _v.z + _m.m[15] * _v.w,
+    };
+}
+
+bool Mat4InverseScalar(const Mat4& _m, Mat4& _inverse)
+{
+    /* Cofactor expansion */
+    const float* m = _m.m;
+    float inv[16];
+
+    inv[0] = m[5] * m[10] * m[15] - m[5] * m[11] * m[14] - m[9] * m[6] * m[15] + m[9] * m[7] * m[14] + m[13] * m[6] * m[11] - m[13] * m[7] * m[10];
+    inv[4] = -m[4] * m[10] * m[15] + m[4] * m[11] * m[14] + m[8] * m[6] * m[15] - m[8] * m[7] * m[14] - m[12] * m[6] * m[11] + m[12] * m[7] * m[10];
+    inv[8] = m[4] * m[9] * m[15] - m[4] * m[11] * m[13] - m[8] * m[5] * m[15] + m[8] * m[7] * m[13] + m[12] * m[5] * m[11] - m[12] * m[7] * m[9];
+    inv[12] = -m[4] * m[9] * m[14] + m[4] * m[10] * m[13] + m[8] * m[5] * m[14] - m[8] * m[6] * m[13] - m[12] * m[5] * m[10] + m[12] * m[6] * m[9];
+    inv[1] = -m[1] * m[10] * m[15] + m[1] * m[11] * m[14] + m[9] * m[2] * m[15] - m[9] * m[3] * m[14] - m[13] * m[2] * m[11] + m[13] * m[3] * m[10];
+    inv[5] = m[0] * m[10] * m[15] - m[0] * m[11] * m[14] - m[8] * m[2] * m[15] + m[8] * m[3] * m[14] + m[12] * m[2] * m[11] - m[12] * m[3] * m[10];
+    inv[9] = -m[0] * m[9] * m[15] + m[0] * m[11] * m[13] + m[8] * m[1] * m[15] - m[8] * m[3] * m[13] - m[12] * m[1] * m[11] + m[12] * m[3] * m[9];
+    inv[13] = m[0] * m[9] * m[14] - m[0] * m[10] * m[13] - m[8] * m[1] * m[14] + m[8] * m[2] * m[13] + m[12] * m[1] * m[10] - m[12] * m[2] * m[9];
+    inv[2] = m[1] * m[6] * m[15] - m[1] * m[7] * m[14] - m[5] * m[2] * m[15] + m[5] * m[3] * m[14] + m[13] * m[2] * m[7] - m[13] * m[3] * m[6];
+    inv[6] = -m[0] * m[6] * m[15] + m[0] * m[7] * m[14] + m[4] * m[2] * m[15] - m[4] * m[3] * m[14] - m[12] * m[2] * m[7] + m[12] * m[3] * m[6];
+    inv[10] = m[0] * m[5] * m[15] - m[0] * m[7] * m[13] - m[4] * m[1] * m[15] + m[4] * m[3] * m[13] + m[12] * m[1] * m[7] - m[12] * m[3] * m[5];
+    inv[14] = -m[0] * m[5] * m[14] + m[0] * m[6] * m[13] + m[4] * m[1] * m[14] - m[4] * m[2] * m[13] - m[12] * m[1] * m[6] + m[12] * m[2] * m[5];
+    inv[3] = -m[1] * m[6] * m[11] + m[1] * m[7] * m[10] + m[5] * m[2] * m[11] - m[5] * m[3] * m[10] - m[9] * m[2] * m[7] + m[9] * m[3] * m[6];
+    inv[7] = m[0] * m[6] * m[11] - m[0] * m[7] * m[10] - m[4] * m[2] * m[11] + m[4] * m[3] * m[10] + m[8] * m[2] * m[7] - m[8] * m[3] * m[6];
+    inv[11] = -m[0] * m[5] * m[11] + m[0] * m[7] * m[9] + m[4] * m[1] * m[11] - m[4] * m[3] * m[9] - m[8] * m[1] * m[7] + m[8] * m[3] * m[5];
+    inv[15] = m[0] * m[5] * m[10] - m[0] * m[6] * m[9] - m[4] * m[1] * m[10] + m[4] * m[2] * m[9] + m[8] * m[1] * m[6] - m[8] * m[2] * m[5];
+
+    float determinant = m[0] * inv[0] + m[1] * inv[4] + m[2] * inv[8] + m[3] * inv[12];
+    if (determinant == 0.0f)
+        return false;
+
+    float inverseDeterminant = 1.0f / determinant;
+    for (int i = 0; i < 16; i++)
+        _inverse.m[i] = inv[i] * inverseDeterminant;
+    return true;
+}
+
+Quat QuatMultiplyScalar(const Quat& _a, const Quat& _b)
+{
+    return
+    {
+        _a.w * _b.x + _a.x * _b.w + _a.y * _b.z - _a.z * _b.y,
+        _a.w * _b.y - _a.x * _b.z + _a.y * _b.w + _a.z * _b.x,
+        _a.w * _b.z + _a.x * _b.y - _a.y * _b.x + _a.z * _b.w,
+        _a.w * _b.w - _a.x * _b.x - _a.y * _b.y - _a.z * _b.z,
+    };
+}
+
+void TransformPointsScalar(const Mat4& _m, const Vec4* _points, Vec4* _out, size_t _count)
+{
+    for (size_t i = 0; i < _count; i++)
+        _out[i] = Mat4TransformScalar(_m, _points[i]);
+}
+
+void ComposeQuatsScalar(const Quat* _a, const Quat* _b, Quat* _out, size_t _count)
+{
+    for (size_t i = 0; i < _count; i++)
+        _out[i] = QuatMultiplyScalar(_a[i], _b[i]);
+}
+
+// ---------------------------------------------------------------------------
+// Mat4
+// ---------------------------------------------------------------------------
+Mat4 Mat4Transpose(const Mat4& _m)
+{
+#if MYOPENGL_SIMD_SSE
+    __m128 c0 = _mm_load_ps(_m.m);
+    __m128 c1 = _mm_load_ps(_m.m + 4);
+    __m128 c2 = _mm_load_ps(_m.m + 8);
+    __m128 c3 = _mm_load_ps(_m.m + 12);
+    _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+
+    Mat4 result;
+    _mm_store_ps(result.m, c0);
+    _mm_store_ps(result.m + 4, c1);
+    _mm_store_ps(result.m + 8, c2);
+    _mm_store_ps(result.m + 12, c3);
+    return result;
+#else
+    Mat4 result;
+    for (int column = 0; column < 4; column++)
+    {
+        for (int row = 0; row < 4; row++)
+            result.m[column * 4 + row] = _m.m[row * 4 + column];
+    }
+    return result;
+#endif
+}
+
+#if MYOPENGL_SIMD_SSE
+/*
+ * 2x2 blocks held in one register as (m00, m01, m10, m11). The layout of the blocks doesn't matter
+ * for the inverse: (M^T)^-1 = (M^-1)^T, so treating the columns as rows gives the right answer
+ */
+
+/// <summary>
+/// 2x2 _a * _b
+/// </summary>
+static inline __m128 Mat2Multiply(__m128 _a, __m128 _b)
+{
+    return _mm_add_ps(_mm_mul_ps(_a, MYOPENGL_SWIZZLE(_b, 0, 3, 0, 3)),
+        _mm_mul_ps(MYOPENGL_SWIZZLE(_a, 1, 0, 3, 2), MYOPENGL_SWIZZLE(_b, 2, 1, 2, 1)));
+}
+
+/// <summary>
+/// 2x2 adjugate(_a) * _b
+/// </summary>
+static inline __m128 Mat2AdjugateMultiply(__m128 _a, __m128 _b)
+{
+    return _mm_sub_ps(_mm_mul_ps(MYOPENGL_SWIZZLE(_a, 3, 3, 0, 0), _b),
+        _mm_mul_ps(MYOPENGL_SWIZZLE(_a, 1, 1, 2, 2), MYOPENGL_SWIZZLE(_b, 2, 3, 0, 1)));
+}
+
+/// <summary>
+/// 2x2 _a * adjugate(_b)
+/// </summary>
+static inline __m128 Mat2MultiplyAdjugate(__m128 _a, __m128 _b)
+{
+    return _mm_sub_ps(_mm_mul_ps(_a, MYOPENGL_SWIZZLE(_b, 3, 0, 3, 0)),
+        _mm_mul_ps(MYOPENGL_SWIZZLE(_a, 1, 0, 3, 2), MYOPENGL_SWIZZLE(_b, 2, 1, 2, 1)));
+}
+#endif
+
+bool Mat4Inverse(const Mat4& _m, Mat4& _inverse)
+{
+#if MYOPENGL_SIMD_SSE
+    __m128 c0 = _mm_load_ps(_m.m);
+    __m128 c1 = _mm_load_ps(_m.m + 4);
+    __m128 c2 = _mm_load_ps(_m.m + 8);
+    __m128 c3 = _mm_load_ps(_m.m + 12);
+
+    /* M = | A B |, inverse = 1/|M| | X Y | with X, Y, Z, W from the adjugates of the blocks */
+    /*     | C D |                  | Z W |                                                   */
+    __m128 a = _mm_movelh_ps(c0, c1);
+    __m128 b = _mm_movehl_ps(c1, c0);
+    __m128 c = _mm_movelh_ps(c2, c3);
+    __m128 d = _mm_movehl_ps(c3, c2);
+
+    /* (|A|, |B|, |C|, |D|) */
+    __m128 blockDeterminants = _mm_sub_ps(
+        _mm_mul_ps(_mm_shuffle_ps(c0, c2, _MM_SHUFFLE(2, 0, 2, 0)), _mm_shuffle_ps(c1, c3, _MM_SHUFFLE(3, 1, 3, 1))),
+        _mm_mul_ps(_mm_shuffle_ps(c0, c2, _MM_SHUFFLE(3, 1, 3, 1)), _mm_shuffle_ps(c1, c3, _MM_SHUFFLE(2, 0, 2, 0))));
+    __m128 detA = MYOPENGL_SWIZZLE(blockDeterminants, 0, 0, 0, 0);
+    __m128 detB = MYOPENGL_SWIZZLE(blockDeterminants, 1, 1, 1, 1);
+    __m128 detC = MYOPENGL_SWIZZLE(blockDeterminants, 2, 2, 2, 2);
+    __m128 detD = MYOPENGL_SWIZZLE(blockDeterminants, 3, 3, 3, 3);
+
+    __m128 dc = Mat2AdjugateMultiply(d, c);
+    __m128 ab = Mat2AdjugateMultiply(a, b);
+    __m128 x = _mm_sub_ps(_mm_mul_ps(detD, a), Mat2Multiply(b, dc));
+    __m128 w = _mm_sub_ps(_mm_mul_ps(detA, d), Mat2Multiply(c, ab));
+    __m128 y = _mm_sub_ps(_mm_mul_ps(detB, c), Mat2MultiplyAdjugate(d, ab));
+    __m128 z = _mm_sub_ps(_mm_mul_ps(detC, b), Mat2MultiplyAdjugate(a, dc));
+
+    /* |M| = |A||D| + |B||C| - tr(adj(A)B adj(D)C) */
+    __m128 trace = _mm_mul_ps(ab, MYOPENGL_SWIZZLE(dc, 0, 2, 1, 3));
+    trace = _mm_add_ps(trace, MYOPENGL_SWIZZLE(trace, 1, 0, 3, 2));
+    trace = _mm_add_ps(trace, MYOPENGL_SWIZZLE(trace, 2, 3, 0, 1));
+    __m128 determinant = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(detA, detD), _mm_mul_ps(detB, detC)), trace);
+
+    if (_mm_cvtss_f32(determinant) == 0.0f)
+        return false;
+
+    /* The adjugate signs come with the reciprocal */
+    __m128 scale = _mm_div_ps(_mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f), determinant);
+    x = _mm_mul_ps(x, scale);
+    y = _mm_mul_ps(y, scale);
+    z = _mm_mul_ps(z, scale);
+    w = _mm_mul_ps(w, scale);
+
+    /* Adjugate of each block and back to columns in one shuffle */
+    _mm_store_ps(_inverse.m, _mm_shuffle_ps(x, y, _MM_SHUFFLE(1, 3, 1, 3)));
+    _mm_store_ps(_inverse.m + 4, _mm_shuffle_ps(x, y, _MM_SHUFFLE(0, 2, 0, 2)));
+    _mm_store_ps(_inverse.m + 8, _mm_shuffle_ps(z, w, _MM_SHUFFLE(1, 3, 1, 3)));
+    _mm_store_ps(_inverse.m + 12, _mm_shuffle_ps(z, w, _MM_SHUFFLE(0, 2, 0, 2)));
+    return true;
+#else
+    return Mat4InverseScalar(_m, _inverse);
+#endif
+}
+
+Mat4 Mat4Perspective(float _fovY, float _aspectRatio, float _nearPlane, float _farPlane)
+{
+    float f = 1.0f / std::tan(_fovY * 0.5f);
+
+    Mat4 result = {};
+    result.m[0] = f / _aspectRatio;
+    result.m[1 * 4 + 1] = f;
+    result.m[2 * 4 + 2] = (_farPlane + _nearPlane) / (_nearPlane - _farPlane);
+    result.m[3 * 4 + 2] = (2.0f * _farPlane * _nearPlane) / (_nearPlane - _farPlane);
+    result.m[2 * 4 + 3] = -1.0f;
+    return result;
+}
+
+Mat4 Mat4Translation(const Vec3& _translation)
+{
+    Mat4 result = Mat4Identity();
+    result.m[12] = _translation.x;
+    result.m[13] = _translation.y;
+    result.m[14] = _translation.z;
+    return result;
+}
+
+Mat4 Mat4FromQuat(const Quat& _q)
+{
+    float xx = _q.x * _q.x, yy = _q.y * _q.y, zz = _q.z * _q.z;
+    float xy = _q.x * _q.y, xz = _q.x * _q.z, yz = _q.y * _q.z;
+    float wx = _q.w * _q.x, wy = _q.w * _q.y, wz = _q.w * _q.z;
+
+    return
+    { {
+        1.0f - 2.0f * (yy + zz), 2.0f * (xy + wz), 2.0f * (xz - wy), 0.0f,
+        2.0f * (xy - wz), 1.0f - 2.0f * (xx + zz), 2.0f * (yz + wx), 0.0f,
+        2.0f * (xz + wy), 2.0f * (yz - wx), 1.0f - 2.0f * (xx + yy), 0.0f,
+        0.0f, 0.0f, 0.0f, 1.0f,
+    } };
+}
+
+// ---------------------------------------------------------------------------
+// Batch kernels
+// ---------------------------------------------------------------------------
+void TransformPoints(const Mat4& _m, const Vec4* _points, Vec4* _out, size_t _count)
+{
+#if MYOPENGL_SIMD_AVX2
+    /* Two points per iteration, every column broadcast to both 128-bit lanes */
+    __m256 c0 = _mm256_broadcast_ps((const __m128*)_m.m);
+    __m256 c1 = _mm256_broadcast_ps((const __m128*)(_m.m + 4));
+    __m256 c2 = _mm256_broadcast_ps((const __m128*)(_m.m + 8));
+    __m256 c3 = _mm256_broadcast_ps((const __m128*)(_m.m + 12));
+
+    size_t i = 0;
+    for (; i + 2 <= _count; i += 2)
+    {
+        __m256 p = _mm256_loadu_ps(&_points[i].x);
+        __m256 r = _mm256_mul_ps(c0, _mm256_permute_ps(p, _MM_SHUFFLE(0, 0, 0, 0)));
+        r = MulAdd(c1, _mm256_permute_ps(p, _MM_SHUFFLE(1, 1, 1, 1)), r);
+        r = MulAdd(c2, _mm256_permute_ps(p, _MM_SHUFFLE(2, 2, 2, 2)), r);
+        r = MulAdd(c3, _mm256_permute_ps(p, _MM_SHUFFLE(3, 3, 3, 3)), r);
+        _mm256_storeu_ps(&_out[i].x, r);
+    }
+    for (; i < _count; i++)
+        _out[i] = Mat4Transform(_m, _points[i]);
+#elif MYOPENGL_SIMD_SSE
+    __m128 c0 = _mm_load_ps(_m.m);
+    __m128 c1 = _mm_load_ps(_m.m + 4);
+    __m128 c2 = _mm_load_ps(_m.m + 8);
+    __m128 c3 = _mm_load_ps(_m.m + 12);
+
+    for (size_t i = 0; i < _count; i++)
+    {
+        __m128 p = _mm_load_ps(&_points[i].x);
+        __m128 r = _mm_mul_ps(c0, MYOPENGL_SWIZZLE(p, 0, 0, 0, 0));
+        r = MulAdd(c1, MYOPENGL_SWIZZLE(p, 1, 1, 1, 1), r);
+        r = MulAdd(c2, MYOPENGL_SWIZZLE(p, 2, 2, 2, 2), r);
+        r = MulAdd(c3, MYOPENGL_SWIZZLE(p, 3, 3, 3, 3), r);
+        _mm_store_ps(&_out[i].x, r);
+    }
+#else
+    TransformPointsScalar(_m, _points, _out, _count);
+#endif
+}
+
+void ComposeQuats(const Quat* _a, const Quat* _b, Quat* _out, size_t _count)
+{
+#if MYOPENGL_SIMD_AVX2
+    /* QuatMultiply on two quaternions per iteration, the shuffles stay inside each 128-bit lane */
+    const __m256 sign1 = _mm256_setr_ps(1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f);
+    const __m256 sign2 = _mm256_setr_ps(1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, -1.0f, -1.0f);
+    const __m256 sign3 = _mm256_setr_ps(-1.0f, 1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, -1.0f);
+
+    size_t i = 0;
+    for (; i + 2 <= _count; i += 2)
+    {
+        __m256 a = _mm256_loadu_ps(&_a[i].x);
+        __m256 b = _mm256_loadu_ps(&_b[i].x);
+        __m256 r = _mm256_mul_ps(_mm256_permute_ps(a, _MM_SHUFFLE(3, 3, 3, 3)), b);
+        r = MulAdd(_mm256_permute_ps(a, _MM_SHUFFLE(0, 0, 0, 0)), _mm256_mul_ps(_mm256_permute_ps(b, _MM_SHUFFLE(0, 1, 2, 3)), sign1), r);
+        r = MulAdd(_mm256_permute_ps(a, _MM_SHUFFLE(1, 1, 1, 1)), _mm256_mul_ps(_mm256_permute_ps(b, _MM_SHUFFLE(1, 0, 3, 2)), sign2), r);
+        r = MulAdd(_mm256_permute_ps(a, _MM_SHUFFLE(2, 2, 2, 2)), _mm256_mul_ps(_mm256_permute_ps(b, _MM_SHUFFLE(2, 3, 0, 1)), sign3), r);
+        _mm256_storeu_ps(&_out[i].x, r);
+    }
+    for (; i < _count; i++)
+        _out[i] = QuatMultiply(_a[i], _b[i]);
+#elif MYOPENGL_SIMD_SSE
+    for (size_t i = 0; i < _count; i++)
+        _out[i] = QuatMultiply(_a[i], _b[i]);
+#else
+    ComposeQuatsScalar(_a, _b, _out, _count);
+#endif
+}
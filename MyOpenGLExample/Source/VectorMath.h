@@ -0,0 +1,340 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+
+/*
+ * SIMD level, fixed at compile time (MYOPENGL_SIMD in CMake):
+ * - AVX2: 256-bit batch kernels (two vec4 / quaternions per instruction), FMA when available;
+ * - SSE: 128-bit kernels, the x86-64 baseline;
+ * - scalar: plain C++, for other CPUs or to compare (MYOPENGL_SIMD_SCALAR).
+ * The scalar kernels (the *Scalar functions) are always compiled, they are the reference the benchmarks
+ * time the SIMD paths against and the unit tests check them against
+ */
+#if !defined(MYOPENGL_SIMD_SCALAR) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define MYOPENGL_SIMD_SSE 1
+#include <immintrin.h>
+#if defined(__AVX2__)
+#define MYOPENGL_SIMD_AVX2 1
+#endif
+#endif
+
+/// <summary>
+/// 3D vector, plain floats: too small to gain from SIMD on its own, batch the work instead
+/// </summary>
+struct Vec3
+{
+    float x, y, z;
+};
+
+/// <summary>
+/// 4D vector / homogeneous point, one SSE register
+/// </summary>
+struct alignas(16) Vec4
+{
+    float x, y, z, w;
+};
+
+/// <summary>
+/// Rotation quaternion, vector part in xyz and scalar part in w (the layout of the shaders' vec4)
+/// </summary>
+struct alignas(16) Quat
+{
+    float x, y, z, w;
+};
+
+/// <summary>
+/// 4x4 matrix, column-major (m[column * 4 + row]) as OpenGL and GLSL expect it: a column is one register
+/// </summary>
+struct alignas(16) Mat4
+{
+    float m[16];
+};
+
+/// <summary>
+/// Name of the SIMD level compiled in ("AVX2", "SSE" or "scalar")
+/// </summary>
+/// <returns></returns>
+const char* GetSimdLevelName();
+
+// ---------------------------------------------------------------------------
+// Vec3
+// ---------------------------------------------------------------------------
+inline Vec3 Vec3Add(const Vec3& _a, const Vec3& _b) { return { _a.x + _b.x, _a.y + _b.y, _a.z + _b.z }; }
+inline Vec3 Vec3Sub(const Vec3& _a, const Vec3& _b) { return { _a.x - _b.x, _a.y - _b.y, _a.z - _b.z }; }
+inline Vec3 Vec3Scale(const Vec3& _a, float _s) { return { _a.x * _s, _a.y * _s, _a.z * _s }; }
+inline float Vec3Dot(const Vec3& _a, const Vec3& _b) { return _a.x * _b.x + _a.y * _b.y + _a.z * _b.z; }
+
+inline Vec3 Vec3Cross(const Vec3& _a, const Vec3& _b)
+{
+    return { _a.y * _b.z - _a.z * _b.y, _a.z * _b.x - _a.x * _b.z, _a.x * _b.y - _a.y * _b.x };
+}
+
+inline float Vec3Length(const Vec3& _a) { return std::sqrt(Vec3Dot(_a, _a)); }
+
+inline Vec3 Vec3Normalize(const Vec3& _a)
+{
+    float length = Vec3Length(_a);
+    return (length > 0.0f) ? Vec3Scale(_a, 1.0f / length) : _a;
+}
+
+// ---------------------------------------------------------------------------
+// Vec4
+// ---------------------------------------------------------------------------
+#if MYOPENGL_SIMD_SSE
+inline __m128 LoadVec4(const Vec4& _a) { return _mm_load_ps(&_a.x); }
+inline Vec4 StoreVec4(__m128 _a)
+{
+    Vec4 result;
+    _mm_store_ps(&result.x, _a);
+    return result;
+}
+
+/// <summary>
+/// _a * _b + _c, fused when the CPU has FMA
+/// </summary>
+inline __m128 MulAdd(__m128 _a, __m128 _b, __m128 _c)
+{
+#if defined(__FMA__)
+    return _mm_fmadd_ps(_a, _b, _c);
+#else
+    return _mm_add_ps(_mm_mul_ps(_a, _b), _c);
+#endif
+}
+
+#if MYOPENGL_SIMD_AVX2
+/// <summary>
+/// _a * _b + _c on both 128-bit lanes, fused when the CPU has FMA
+/// </summary>
+inline __m256 MulAdd(__m256 _a, __m256 _b, __m256 _c)
+{
+#if defined(__FMA__)
+    return _mm256_fmadd_ps(_a, _b, _c);
+#else
+    return _mm256_add_ps(_mm256_mul_ps(_a, _b), _c);
+#endif
+}
+#endif
+
+#define MYOPENGL_SWIZZLE(_v, _x, _y, _z, _w) _mm_shuffle_ps((_v), (_v), _MM_SHUFFLE(_w, _z, _y, _x))
+
+inline Vec4 Vec4Add(const Vec4& _a, const Vec4& _b) { return StoreVec4(_mm_add_ps(LoadVec4(_a), LoadVec4(_b))); }
+inline Vec4 Vec4Sub(const Vec4& _a, const Vec4& _b) { return StoreVec4(_mm_sub_ps(LoadVec4(_a), LoadVec4(_b))); }
+inline Vec4 Vec4Mul(const Vec4& _a, const Vec4& _b) { return StoreVec4(_mm_mul_ps(LoadVec4(_a), LoadVec4(_b))); }
+inline Vec4 Vec4Scale(const Vec4& _a, float _s) { return StoreVec4(_mm_mul_ps(LoadVec4(_a), _mm_set1_ps(_s))); }
+
+inline float Vec4Dot(const Vec4& _a, const Vec4& _b)
+{
+    __m128 product = _mm_mul_ps(LoadVec4(_a), LoadVec4(_b));
+    __m128 sum = _mm_add_ps(product, MYOPENGL_SWIZZLE(product, 1, 0, 3, 2));
+    sum = _mm_add_ps(sum, MYOPENGL_SWIZZLE(sum, 2, 3, 0, 1));
+    return _mm_cvtss_f32(sum);
+}
+#else
+inline Vec4 Vec4Add(const Vec4& _a, const Vec4& _b) { return { _a.x + _b.x, _a.y + _b.y, _a.z + _b.z, _a.w + _b.w }; }
+inline Vec4 Vec4Sub(const Vec4& _a, const Vec4& _b) { return { _a.x - _b.x, _a.y - _b.y, _a.z - _b.z, _a.w - _b.w }; }
+inline Vec4 Vec4Mul(const Vec4& _a, const Vec4& _b) { return { _a.x * _b.x, _a.y * _b.y, _a.z * _b.z, _a.w * _b.w }; }
+inline Vec4 Vec4Scale(const Vec4& _a, float _s) { return { _a.x * _s, _a.y * _s, _a.z * _s, _a.w * _s }; }
+inline float Vec4Dot(const Vec4& _a, const Vec4& _b) { return _a.x * _b.x + _a.y * _b.y + _a.z * _b.z + _a.w * _b.w; }
+#endif
+
+// ---------------------------------------------------------------------------
+// Scalar reference kernels (always available)
+// ---------------------------------------------------------------------------
+Mat4 Mat4MultiplyScalar(const Mat4& _a, const Mat4& _b);
+Vec4 Mat4TransformScalar(const Mat4& _m, const Vec4& _v);
+bool Mat4InverseScalar(const Mat4& _m, Mat4& _inverse);
+Quat QuatMultiplyScalar(const Quat& _a, const Quat& _b);
+void TransformPointsScalar(const Mat4& _m, const Vec4* _points, Vec4* _out, size_t _count);
+void ComposeQuatsScalar(const Quat* _a, const Quat* _b, Quat* _out, size_t _count);
+
+// ---------------------------------------------------------------------------
+// Mat4
+// ---------------------------------------------------------------------------
+inline Mat4 Mat4Identity()
+{
+    return { { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f } };
+}
+
+/// <summary>
+/// _a * _b (apply _b first)
+/// </summary>
+/// <param name="_a"></param>
+/// <param name="_b"></param>
+/// <returns></returns>
+inline Mat4 Mat4Multiply(const Mat4& _a, const Mat4& _b)
+{
+#if MYOPENGL_SIMD_SSE
+    /* Column j of the result is the columns of _a weighted by column j of _b */
+    __m128 a0 = _mm_load_ps(_a.m);
+    __m128 a1 = _mm_load_ps(_a.m + 4);
+    __m128 a2 = _mm_load_ps(_a.m + 8);
+    __m128 a3 = _mm_load_ps(_a.m + 12);
+
+    Mat4 result;
+    for (int column = 0; column < 4; column++)
+    {
+        __m128 b = _mm_load_ps(_b.m + column * 4);
+        __m128 r = _mm_mul_ps(a0, MYOPENGL_SWIZZLE(b, 0, 0, 0, 0));
+        r = MulAdd(a1, MYOPENGL_SWIZZLE(b, 1, 1, 1, 1), r);
+        r = MulAdd(a2, MYOPENGL_SWIZZLE(b, 2, 2, 2, 2), r);
+        r = MulAdd(a3, MYOPENGL_SWIZZLE(b, 3, 3, 3, 3), r);
+        _mm_store_ps(result.m + column * 4, r);
+    }
+    return result;
+#else
+    return Mat4MultiplyScalar(_a, _b);
+#endif
+}
+
+/// <summary>
+/// _m * _v
+/// </summary>
+/// <param name="_m"></param>
+/// <param name="_v"></param>
+/// <returns></returns>
+inline Vec4 Mat4Transform(const Mat4& _m, const Vec4& _v)
+{
+#if MYOPENGL_SIMD_SSE
+    __m128 v = LoadVec4(_v);
+    __m128 r = _mm_mul_ps(_mm_load_ps(_m.m), MYOPENGL_SWIZZLE(v, 0, 0, 0, 0));
+    r = MulAdd(_mm_load_ps(_m.m + 4), MYOPENGL_SWIZZLE(v, 1, 1, 1, 1), r);
+    r = MulAdd(_mm_load_ps(_m.m + 8), MYOPENGL_SWIZZLE(v, 2, 2, 2, 2), r);
+    r = MulAdd(_mm_load_ps(_m.m + 12), MYOPENGL_SWIZZLE(v, 3, 3, 3, 3), r);
+    return StoreVec4(r);
+#else
+    return Mat4TransformScalar(_m, _v);
+#endif
+}
+
+Mat4 Mat4Transpose(const Mat4& _m);
+
+/// <summary>
+/// General inverse (block-wise 2x2 adjugates with SSE). False, and _inverse untouched, if _m is singular
+/// </summary>
+/// <param name="_m"></param>
+/// <param name="_inverse"></param>
+/// <returns></returns>
+bool Mat4Inverse(const Mat4& _m, Mat4& _inverse);
+
+/// <summary>
+/// OpenGL perspective projection (clip z in [-w, w]), vertical field of view in radians
+/// </summary>
+/// <param name="_fovY"></param>
+/// <param name="_aspectRatio"></param>
+/// <param name="_nearPlane"></param>
+/// <param name="_farPlane"></param>
+/// <returns></returns>
+Mat4 Mat4Perspective(float _fovY, float _aspectRatio, float _nearPlane, float _farPlane);
+
+Mat4 Mat4Translation(const Vec3& _translation);
+
+/// <summary>
+/// Rotation matrix of the unit quaternion _q (the same rotation as QuatRotate)
+/// </summary>
+/// <param name="_q"></param>
+/// <returns></returns>
+Mat4 Mat4FromQuat(const Quat& _q);
+
+// ---------------------------------------------------------------------------
+// Quat
+// ---------------------------------------------------------------------------
+inline Quat QuatIdentity() { return { 0.0f, 0.0f, 0.0f, 1.0f }; }
+inline Quat QuatConjugate(const Quat& _q) { return { -_q.x, -_q.y, -_q.z, _q.w }; }
+
+/// <summary>
+/// Rotation of _angle radians around the unit vector _axis
+/// </summary>
+/// <param name="_axis"></param>
+/// <param name="_angle"></param>
+/// <returns></returns>
+inline Quat QuatFromAxisAngle(const Vec3& _axis, float _angle)
+{
+    float s = std::sin(_angle * 0.5f);
+    return { _axis.x * s, _axis.y * s, _axis.z * s, std::cos(_angle * 0.5f) };
+}
+
+/// <summary>
+/// Hamilton product _a * _b: the rotation _b followed by _a
+/// </summary>
+/// <param name="_a"></param>
+/// <param name="_b"></param>
+/// <returns></returns>
+inline Quat QuatMultiply(const Quat& _a, const Quat& _b)
+{
+#if MYOPENGL_SIMD_SSE
+    /* a.w * b + a.x * (bw, -bz, by, -bx) + a.y * (bz, bw, -bx, -by) + a.z * (-by, bx, bw, -bz) */
+    __m128 a = _mm_load_ps(&_a.x);
+    __m128 b = _mm_load_ps(&_b.x);
+    __m128 r = _mm_mul_ps(MYOPENGL_SWIZZLE(a, 3, 3, 3, 3), b);
+    r = MulAdd(MYOPENGL_SWIZZLE(a, 0, 0, 0, 0), _mm_mul_ps(MYOPENGL_SWIZZLE(b, 3, 2, 1, 0), _mm_setr_ps(1.0f, -1.0f, 1.0f, -1.0f)), r);
+    r = MulAdd(MYOPENGL_SWIZZLE(a, 1, 1, 1, 1), _mm_mul_ps(MYOPENGL_SWIZZLE(b, 2, 3, 0, 1), _mm_setr_ps(1.0f, 1.0f, -1.0f, -1.0f)), r);
+    r = MulAdd(MYOPENGL_SWIZZLE(a, 2, 2, 2, 2), _mm_mul_ps(MYOPENGL_SWIZZLE(b, 1, 0, 3, 2), _mm_setr_ps(-1.0f, 1.0f, 1.0f, -1.0f)), r);
+
+    Quat result;
+    _mm_store_ps(&result.x, r);
+    return result;
+#else
+    return QuatMultiplyScalar(_a, _b);
+#endif
+}
+
+inline Quat QuatNormalize(const Quat& _q)
+{
+    float length = std::sqrt(_q.x * _q.x + _q.y * _q.y + _q.z * _q.z + _q.w * _q.w);
+    float inverse = (length > 0.0f) ? 1.0f / length : 0.0f;
+    return { _q.x * inverse, _q.y * inverse, _q.z * inverse, _q.w * inverse };
+}
+
+/// <summary>
+/// Normalized linear interpolation from _a (_t = 0) to _b (_t = 1) along the shortest arc. Close enough
+/// to slerp for the small steps it is used for (between two simulation steps), and much cheaper
+/// </summary>
+/// <param name="_a"></param>
+/// <param name="_b"></param>
+/// <param name="_t"></param>
+/// <returns></returns>
+inline Quat QuatNlerp(const Quat& _a, const Quat& _b, float _t)
+{
+    /* q and -q are the same rotation: flip _b to the hemisphere of _a */
+    float dot = _a.x * _b.x + _a.y * _b.y + _a.z * _b.z + _a.w * _b.w;
+    float tb = (dot < 0.0f) ? -_t : _t;
+    float ta = 1.0f - _t;
+    return QuatNormalize({ _a.x * ta + _b.x * tb, _a.y * ta + _b.y * tb, _a.z * ta + _b.z * tb, _a.w * ta + _b.w * tb });
+}
+
+/// <summary>
+/// Rotate _v by the unit quaternion _q (q v q*). Note the shaders' qtransform rotates by the conjugate
+/// </summary>
+/// <param name="_q"></param>
+/// <param name="_v"></param>
+/// <returns></returns>
+inline Vec3 QuatRotate(const Quat& _q, const Vec3& _v)
+{
+    /* v + 2 * cross(q.xyz, cross(q.xyz, v) + q.w * v) */
+    Vec3 u = { _q.x, _q.y, _q.z };
+    Vec3 t = Vec3Add(Vec3Cross(u, _v), Vec3Scale(_v, _q.w));
+    return Vec3Add(_v, Vec3Scale(Vec3Cross(u, t), 2.0f));
+}
+
+// ---------------------------------------------------------------------------
+// Batch kernels: the loops CPU-side systems scale with
+// ---------------------------------------------------------------------------
+
+/// <summary>
+/// _out[i] = _m * _points[i]. _out may be _points
+/// </summary>
+/// <param name="_m"></param>
+/// <param name="_points"></param>
+/// <param name="_out"></param>
+/// <param name="_count"></param>
+void TransformPoints(const Mat4& _m, const Vec4* _points, Vec4* _out, size_t _count);
+
+/// <summary>
+/// _out[i] = _a[i] * _b[i]. _out may be one of the inputs
+/// </summary>
+/// <param name="_a"></param>
+/// <param name="_b"></param>
+/// <param name="_out"></param>
+/// <param name="_count"></param>
+void ComposeQuats(const Quat* _a, const Quat* _b, Quat* _out, size_t _count);
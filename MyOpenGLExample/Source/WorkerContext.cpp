@@ -0,0 +1,106 @@
+#include "WorkerContext.h"
+#include "HeadlessContext.h"
+
+#include <GLFW/glfw3.h>
+
+#ifdef MYOPENGL_HAS_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+bool WorkerContext::Create(GLFWwindow* _window, const HeadlessContext& _headless)
+{
+    GLFWwindow* shareWindow = (_window != NULL) ? _window : _headless.GetHiddenWindow();
+
+#ifdef MYOPENGL_HAS_EGL
+    if (shareWindow == NULL && _headless.GetEGLContext() != nullptr)
+    {
+        EGLDisplay display = (EGLDisplay)_headless.GetEGLDisplay();
+        EGLContext shareContext = (EGLContext)_headless.GetEGLContext();
+
+        /* Same version and profile as the main context, whatever it ended up being */
+        EGLint majorVersion = 0;
+        EGLint minorVersion = 0;
+        glGetIntegerv(GL_MAJOR_VERSION, &majorVersion);
+        glGetIntegerv(GL_MINOR_VERSION, &minorVersion);
+
+        const EGLint attributes[] =
+        {
+            EGL_CONTEXT_MAJOR_VERSION, majorVersion,
+            EGL_CONTEXT_MINOR_VERSION, minorVersion,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_NONE
+        };
+
+        EGLContext context = eglCreateContext(display, EGL_NO_CONFIG_KHR, shareContext, attributes);
+        if (context == EGL_NO_CONTEXT)
+            return false;
+
+        m_display = display;
+        m_context = context;
+        return true;
+    }
+#endif
+
+    if (shareWindow == NULL)
+        return false;
+
+    /* Shared contexts must match the main one: same version and profile hints */
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, glfwGetWindowAttrib(shareWindow, GLFW_CONTEXT_VERSION_MAJOR));
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, glfwGetWindowAttrib(shareWindow, GLFW_CONTEXT_VERSION_MINOR));
+    glfwWindowHint(GLFW_OPENGL_PROFILE, glfwGetWindowAttrib(shareWindow, GLFW_OPENGL_PROFILE));
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, glfwGetWindowAttrib(shareWindow, GLFW_OPENGL_FORWARD_COMPAT));
+    m_hiddenWindow = glfwCreateWindow(1, 1, "Worker", NULL, shareWindow);
+    glfwDefaultWindowHints();
+
+    return m_hiddenWindow != NULL;
+}
+
+bool WorkerContext::MakeCurrent()
+{
+#ifdef MYOPENGL_HAS_EGL
+    if (m_context != nullptr)
+    {
+        /* The bound API is per thread, and defaults to OpenGL ES */
+        return eglBindAPI(EGL_OPENGL_API) && eglMakeCurrent((EGLDisplay)m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, (EGLContext)m_context);
+    }
+#endif
+
+    if (m_hiddenWindow == NULL)
+        return false;
+
+    glfwMakeContextCurrent(m_hiddenWindow);
+    return true;
+}
+
+void WorkerContext::ReleaseCurrent()
+{
+#ifdef MYOPENGL_HAS_EGL
+    if (m_context != nullptr)
+    {
+        eglMakeCurrent((EGLDisplay)m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglReleaseThread();
+        return;
+    }
+#endif
+
+    glfwMakeContextCurrent(NULL);
+}
+
+void WorkerContext::Destroy()
+{
+#ifdef MYOPENGL_HAS_EGL
+    if (m_context != nullptr)
+    {
+        eglDestroyContext((EGLDisplay)m_display, (EGLContext)m_context);
+        m_display = m_context = nullptr;
+    }
+#endif
+
+    if (m_hiddenWindow != NULL)
+    {
+        glfwDestroyWindow(m_hiddenWindow);
+        m_hiddenWindow = nullptr;
+    }
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+class HeadlessContext;
+struct GLFWwindow;
+
+/// <summary>
+/// Extra OpenGL context sharing objects (shaders, programs, buffers...) with the main one, for a worker
+/// thread. It is created and destroyed on the main thread, and made current on the worker.
+/// Objects the worker creates are usable by the main context once the worker called glFinish
+/// </summary>
+class WorkerContext
+{
+public:
+    /// <summary>
+    /// Create a context sharing with _window, or with _headless when _window is NULL
+    /// </summary>
+    /// <param name="_window"></param>
+    /// <param name="_headless"></param>
+    /// <returns></returns>
+    bool Create(GLFWwindow* _window, const HeadlessContext& _headless);
+
+    /// <summary>
+    /// Make the context current on the calling thread
+    /// </summary>
+    /// <returns></returns>
+    bool MakeCurrent();
+
+    /// <summary>
+    /// Release the context from the calling thread, before it exits
+    /// </summary>
+    void ReleaseCurrent();
+
+    void Destroy();
+
+private:
+    //EGL handles (EGLDisplay, EGLContext) when sharing with a surfaceless EGL context
+    void* m_display = nullptr;
+    void* m_context = nullptr;
+
+    //Hidden window otherwise
+    GLFWwindow* m_hiddenWindow = nullptr;
+};
@@ -0,0 +1,108 @@
+#include "WorkerPool.h"
+
+#include <string>
+
+#include "Profiler.h"
+
+WorkerPool::~WorkerPool()
+{
+    Shutdown();
+}
+
+void WorkerPool::Initialize(int _threadCount)
+{
+    Shutdown();
+
+    if (_threadCount <= 0)
+    {
+        unsigned int cores = std::thread::hardware_concurrency();
+        _threadCount = (cores > 0) ? (int)cores : 1;
+    }
+
+    m_stop = false;
+    for (int worker = 0; worker < _threadCount - 1; worker++)
+        m_threads.emplace_back(&WorkerPool::WorkerLoop, this, worker, m_generation);
+}
+
+void WorkerPool::Shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+
+    for (std::thread& thread : m_threads)
+        thread.join();
+    m_threads.clear();
+}
+
+void WorkerPool::RunRanges()
+{
+    for (;;)
+    {
+        size_t first = m_next.fetch_add(m_grain);
+        if (first >= m_count)
+            return;
+
+        size_t last = (m_count - first < m_grain) ? m_count : first + m_grain;
+        (*m_function)(first, last);
+    }
+}
+
+void WorkerPool::ParallelFor(size_t _count, size_t _grain, const RangeFunction& _function)
+{
+    if (_grain == 0)
+        _grain = 1;
+
+    /* Not worth waking anyone for a single range */
+    if (m_threads.empty() || _count <= _grain)
+    {
+        if (_count > 0)
+            _function(0, _count);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_function = &_function;
+        m_count = _count;
+        m_grain = _grain;
+        m_next.store(0);
+        m_busyWorkers = (int)m_threads.size();
+        m_generation++;
+    }
+    m_wake.notify_all();
+
+    RunRanges();
+
+    /* The job (and _function) must outlive every worker still inside it */
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this]() { return m_busyWorkers == 0; });
+    m_function = nullptr;
+}
+
+void WorkerPool::WorkerLoop(int _worker, uint64_t _generation)
+{
+    Profiler::SetThreadName(("Worker " + std::to_string(_worker + 1)).c_str());
+
+    uint64_t generation = _generation;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this, generation]() { return m_stop || m_generation != generation; });
+            if (m_stop)
+                return;
+            generation = m_generation;
+        }
+
+        RunRanges();
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_busyWorkers--;
+        }
+        m_done.notify_one();
+    }
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// <summary>
+/// Persistent threads running the frame systems in parallel: ParallelFor splits [0, count) in ranges the
+/// workers and the calling thread take in turn until none is left, and returns when all of them are done.
+/// The threads sleep between calls; nothing is allocated per call
+/// </summary>
+class WorkerPool
+{
+public:
+    /// <summary>
+    /// Processes the items [_first, _last)
+    /// </summary>
+    typedef std::function<void(size_t _first, size_t _last)> RangeFunction;
+
+    WorkerPool() = default;
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    /// <summary>
+    /// Start _threadCount - 1 workers: the thread calling ParallelFor is the last one. 1 runs everything
+    /// on the calling thread, 0 uses one thread per core
+    /// </summary>
+    /// <param name="_threadCount"></param>
+    void Initialize(int _threadCount);
+
+    /// <summary>
+    /// Stop and join the workers
+    /// </summary>
+    void Shutdown();
+
+    /// <summary>
+    /// Run _function over [0, _count) in ranges of _grain items (the last one shorter), on every thread
+    /// </summary>
+    /// <param name="_count"></param>
+    /// <param name="_grain"></param>
+    /// <param name="_function"></param>
+    void ParallelFor(size_t _count, size_t _grain, const RangeFunction& _function);
+
+    /// <summary>
+    /// Threads ParallelFor runs on, the calling one included
+    /// </summary>
+    /// <returns></returns>
+    int GetThreadCount() const { return (int)m_threads.size() + 1; }
+
+private:
+    /// <summary>
+    /// Wait for jobs newer than _generation (the last one when the worker started) and run them
+    /// </summary>
+    void WorkerLoop(int _worker, uint64_t _generation);
+
+    /// <summary>
+    /// Take ranges of the current job until there is none left
+    /// </summary>
+    void RunRanges();
+
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+
+    /* Current job: written under the mutex before the generation changes, read by the workers after */
+    const RangeFunction* m_function = nullptr;
+    size_t m_count = 0;
+    size_t m_grain = 1;
+    std::atomic<size_t> m_next{ 0 };
+    uint64_t m_generation = 0;
+    int m_busyWorkers = 0;
+    bool m_stop = false;
+};
@@ -0,0 +1,90 @@
+#include <string>
+#include <vector>
+
+#include "ApplicationOptions.h"
+#include "UnitTest.h"
+
+/// <summary>
+/// Run ParseCommandLine on _arguments, the program name put in front
+/// </summary>
+/// <param name="_arguments"></param>
+/// <param name="_options"></param>
+/// <returns></returns>
+static bool Parse(const std::vector<std::string>& _arguments, ApplicationOptions& _options)
+{
+    std::vector<std::string> storage(1, "MyOpenGLExample");
+    storage.insert(storage.end(), _arguments.begin(), _arguments.end());
+
+    std::vector<char*> argv;
+    for (std::string& argument : storage)
+        argv.push_back(&argument[0]);
+    argv.push_back(nullptr);
+
+    return ParseCommandLine((int)storage.size(), argv.data(), _options);
+}
+
+void RunApplicationOptionsTests(UnitTestRunner& _runner)
+{
+    _runner.Run("options/no argument keeps the defaults", [&]()
+    {
+        ApplicationOptions options;
+        TEST_CHECK(_runner, Parse({}, options));
+        TEST_CHECK(_runner, !options.headless && options.frameCount == 1000);
+        TEST_CHECK(_runner, options.width == 640 && options.height == 480);
+        TEST_CHECK(_runner, options.instanceCount == 1 && options.meshCount == 1);
+        TEST_CHECK(_runner, options.statsOutPath.empty() && options.traceOutPath.empty());
+        TEST_CHECK(_runner, options.shaderCachePath == "ShaderCache" && options.shaderDirectory.empty());
+        TEST_CHECK(_runner, !options.matrixTransform);
+        TEST_CHECK(_runner, options.simulationRate == 60 && options.renderRate == 0);
+        TEST_CHECK(_runner, options.culling == kCullingFrustum && options.threadCount == 0);
+    });
+
+    _runner.Run("options/every option", [&]()
+    {
+        ApplicationOptions options;
+        TEST_CHECK(_runner, Parse({ "--headless", "--frames", "120", "--width", "1280", "--height", "720", "--instances", "20000",
+            "--meshes", "4", "--stats-out", "stats.json", "--trace-out", "trace.json", "--shader-cache", "Cache",
+            "--matrix-transform", "--shader-dir", "Shaders", "--sim-rate", "120", "--render-rate", "30", "--culling", "bvh",
+            "--threads", "3" }, options));
+        TEST_CHECK(_runner, options.headless && options.frameCount == 120);
+        TEST_CHECK(_runner, options.width == 1280 && options.height == 720);
+        TEST_CHECK(_runner, options.instanceCount == 20000 && options.meshCount == 4);
+        TEST_CHECK(_runner, options.statsOutPath == "stats.json" && options.traceOutPath == "trace.json");
+        TEST_CHECK(_runner, options.shaderCachePath == "Cache" && options.shaderDirectory == "Shaders");
+        TEST_CHECK(_runner, options.matrixTransform);
+        TEST_CHECK(_runner, options.simulationRate == 120 && options.renderRate == 30);
+        TEST_CHECK(_runner, options.culling == kCullingBvh && options.threadCount == 3);
+    });
+
+    _runner.Run("options/culling modes", [&]()
+    {
+        const char* names[] = { "none", "frustum", "bvh", "occlusion", "gpu" };
+        const CullingMode modes[] = { kCullingNone, kCullingFrustum, kCullingBvh, kCullingOcclusion, kCullingGpu };
+        for (int i = 0; i < 5; i++)
+        {
+            ApplicationOptions options;
+            TEST_CHECK(_runner, Parse({ "--culling", names[i] }, options) && options.culling == modes[i]);
+        }
+    });
+
+    _runner.Run("options/no shader cache", [&]()
+    {
+        ApplicationOptions options;
+        TEST_CHECK(_runner, Parse({ "--no-shader-cache" }, options));
+        TEST_CHECK(_runner, options.shaderCachePath.empty());
+    });
+
+    _runner.Run("options/invalid arguments are rejected", [&]()
+    {
+        /* Unknown option, missing value, values not entirely a strictly positive number, unknown mode */
+        const std::vector<std::vector<std::string>> invalid = {
+            { "--fullscreen" }, { "--frames" }, { "--frames", "0" }, { "--frames", "-5" }, { "--frames", "12x" },
+            { "--width", "" }, { "--threads", "two" }, { "--culling", "portal" }, { "--culling" }, { "headless" }
+        };
+        for (const std::vector<std::string>& arguments : invalid)
+        {
+            ApplicationOptions options;
+            TEST_CHECK(_runner, !Parse(arguments, options));
+        }
+    });
+}
@@ -0,0 +1,142 @@
+#include <cstdint>
+#include <vector>
+
+#include "EntityWorld.h"
+#include "FrustumCulling.h"
+#include "SceneSystems.h"
+#include "UnitTest.h"
+#include "VectorMath.h"
+
+/// <summary>
+/// Objects scattered around the camera: about a sixth of them end up in the frustum
+/// </summary>
+static const size_t s_objectCount = 16384;
+
+static float NextSigned(uint32_t& _state)
+{
+    _state = _state * 1664525u + 1013904223u;
+    return (float)(_state >> 8) / 8388608.0f - 1.0f;
+}
+
+/// <summary>
+/// Renderable entities in two groups (meshes) of different radius, at random positions and scales
+/// </summary>
+static void BuildObjects(EntityWorld& _world)
+{
+    uint32_t seed = 777u;
+    for (size_t i = 0; i < s_objectCount; i++)
+    {
+        Entity entity = _world.Create(kRenderableMask, (uint32_t)(i & 1));
+        Vec4 position = { NextSigned(seed) * 100.0f, NextSigned(seed) * 100.0f, NextSigned(seed) * 100.0f, 1.5f + NextSigned(seed) };
+        _world.Set(entity, kComponentPosition, &position);
+    }
+}
+
+/// <summary>
+/// Every chunk through the scalar kernel, as CullChunks does with the SIMD one
+/// </summary>
+static void CullChunksScalar(const std::vector<ChunkView>& _chunks, const Frustum& _frustum, const float* _groupRadii,
+    ChunkVisibility& _visibility)
+{
+    for (size_t i = 0; i < _chunks.size(); i++)
+    {
+        const ChunkView& chunk = _chunks[i];
+        SphereColumns spheres = { chunk.GetColumn(kComponentPosition, 0), chunk.GetColumn(kComponentPosition, 1),
+            chunk.GetColumn(kComponentPosition, 2), chunk.GetColumn(kComponentPosition, 3) };
+        _visibility.counts[i] = (uint32_t)CullSpheresScalar(_frustum, spheres, _groupRadii[chunk.group], chunk.count,
+            _visibility.rows.data() + chunk.first);
+    }
+}
+
+/// <summary>
+/// Each sphere against each plane, straight from the definition: what the kernels must keep, in order
+/// </summary>
+static std::vector<uint32_t> CullChunkDirect(const ChunkView& _chunk, const Frustum& _frustum, float _radius)
+{
+    std::vector<uint32_t> rows;
+    for (uint32_t row = 0; row < _chunk.count; row++)
+    {
+        float x = _chunk.GetColumn(kComponentPosition, 0)[row];
+        float y = _chunk.GetColumn(kComponentPosition, 1)[row];
+        float z = _chunk.GetColumn(kComponentPosition, 2)[row];
+        float radius = _chunk.GetColumn(kComponentPosition, 3)[row] * _radius;
+
+        bool inside = true;
+        for (int p = 0; p < 6 && inside; p++)
+        {
+            const Vec4& plane = _frustum.planes[p];
+            inside = plane.x * x + plane.y * y + plane.z * z + plane.w >= -radius;
+        }
+        if (inside)
+            rows.push_back(row);
+    }
+    return rows;
+}
+
+void RunCullingTests(UnitTestRunner& _runner)
+{
+    EntityWorld world;
+    BuildObjects(world);
+    std::vector<ChunkView> chunks;
+    size_t count = world.Query(kRenderableMask, chunks);
+
+    const float groupRadii[2] = { 1.7320508f, 1.0f };
+    Mat4 projection = Mat4Perspective(45.0f * (3.141593f / 180.0f), 4.0f / 3.0f, 0.1f, 120.0f);
+    Mat4 view = Mat4Multiply(Mat4FromQuat(QuatFromAxisAngle({ 0.0f, 1.0f, 0.0f }, 0.4f)), Mat4Translation({ 0.0f, 0.0f, -20.0f }));
+    Frustum frustum = FrustumFromMatrix(Mat4Multiply(projection, view));
+
+    ChunkVisibility scalar, simd;
+    ResizeVisibility(chunks, count, scalar);
+    ResizeVisibility(chunks, count, simd);
+    CullChunksScalar(chunks, frustum, groupRadii, scalar);
+    CullChunks(chunks, 0, chunks.size(), frustum, groupRadii, simd);
+
+    _runner.Run("culling/scalar keeps the spheres touching the frustum", [&]()
+    {
+        size_t mismatches = 0;
+        for (size_t i = 0; i < chunks.size(); i++)
+        {
+            std::vector<uint32_t> expected = CullChunkDirect(chunks[i], frustum, groupRadii[chunks[i].group]);
+            std::vector<uint32_t> rows(scalar.rows.begin() + chunks[i].first, scalar.rows.begin() + chunks[i].first + scalar.counts[i]);
+            mismatches += (rows == expected) ? 0 : 1;
+        }
+        TEST_CHECK(_runner, mismatches == 0);
+    });
+
+    _runner.Run("culling/simd matches scalar", [&]()
+    {
+        /* The kernels must keep the same objects, in the same order */
+        size_t mismatches = 0;
+        for (size_t i = 0; i < chunks.size(); i++)
+        {
+            if (scalar.counts[i] != simd.counts[i])
+            {
+                mismatches++;
+                continue;
+            }
+            for (uint32_t v = 0; v < scalar.counts[i]; v++)
+                mismatches += (scalar.rows[chunks[i].first + v] != simd.rows[chunks[i].first + v]) ? 1 : 0;
+        }
+        TEST_CHECK(_runner, mismatches == 0);
+    });
+
+    _runner.Run("culling/compaction gives each chunk its offset", [&]()
+    {
+        /* The rows stay where the chunks wrote them, the offsets place them one chunk after the other */
+        ChunkVisibility compacted = simd;
+        size_t visibleCount = CompactVisibility(compacted);
+
+        size_t expectedCount = 0;
+        bool placed = true;
+        for (size_t i = 0; i < chunks.size(); i++)
+        {
+            placed = placed && compacted.offsets[i] == expectedCount && compacted.counts[i] == simd.counts[i];
+            expectedCount += simd.counts[i];
+        }
+        TEST_CHECK(_runner, visibleCount == expectedCount);
+        TEST_CHECK(_runner, placed);
+        TEST_CHECK(_runner, compacted.rows == simd.rows);
+        /* The scene is built so that the frustum keeps some of it, not all */
+        TEST_CHECK(_runner, visibleCount > 0 && visibleCount < s_objectCount);
+    });
+}
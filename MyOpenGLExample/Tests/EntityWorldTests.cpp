@@ -0,0 +1,242 @@
+#include <cstdint>
+#include <vector>
+
+#include "EntityWorld.h"
+#include "SceneSystems.h"
+#include "UnitTest.h"
+#include "VectorMath.h"
+
+/// <summary>
+/// Enough entities for several chunks of each archetype
+/// </summary>
+static const size_t s_entityCount = 2000;
+
+/// <summary>
+/// Every entity a query returns is alive, sits where the world says and holds its own data (its id is the x of
+/// its position); chunks are full except the last of each archetype. _ids[e] is the id of _entities[e], -1 once
+/// destroyed
+/// </summary>
+static bool IsConsistent(const EntityWorld& _world, const std::vector<Entity>& _entities, const std::vector<float>& _ids,
+    ComponentMask _mask)
+{
+    std::vector<ChunkView> chunks;
+    size_t count = _world.Query(_mask, chunks);
+
+    size_t aliveCount = 0;
+    for (size_t e = 0; e < _entities.size(); e++)
+        aliveCount += (_ids[e] >= 0.0f && (_world.GetMask(_entities[e]) & _mask) == _mask) ? 1 : 0;
+    if (count != aliveCount)
+        return false;
+
+    /* Entity index -> position in _entities, for the rows */
+    std::vector<int> byIndex;
+    for (size_t e = 0; e < _entities.size(); e++)
+    {
+        if (_ids[e] < 0.0f)
+            continue;
+        if (byIndex.size() <= _entities[e].index)
+            byIndex.resize(_entities[e].index + 1, -1);
+        byIndex[_entities[e].index] = (int)e;
+    }
+
+    for (size_t i = 0; i < chunks.size(); i++)
+    {
+        const ChunkView& chunk = chunks[i];
+        bool lastOfArchetype = (i + 1 == chunks.size()) || chunks[i + 1].columnOffsets != chunk.columnOffsets
+            || chunks[i + 1].group != chunk.group;
+        if (chunk.count == 0 || (!lastOfArchetype && chunk.count != chunk.GetCapacity()))
+            return false;
+
+        for (size_t row = 0; row < chunk.count; row++)
+        {
+            uint32_t index = chunk.GetEntityIndices()[row];
+            if (index >= byIndex.size() || byIndex[index] < 0)
+                return false;
+
+            const Entity& entity = _entities[byIndex[index]];
+            if (!_world.IsAlive(entity) || _world.GetGroup(entity) != chunk.group)
+                return false;
+            if (chunk.GetColumn(kComponentPosition, 0)[row] != _ids[byIndex[index]])
+                return false;
+        }
+    }
+    return true;
+}
+
+void RunEntityWorldTests(UnitTestRunner& _runner)
+{
+    _runner.Run("entities/create gives default components", [&]()
+    {
+        EntityWorld world;
+        Entity entity = world.Create(kRenderableMask | kAnimatedMask, 3);
+        TEST_CHECK(_runner, world.IsAlive(entity));
+        TEST_CHECK(_runner, world.GetMask(entity) == (kRenderableMask | kAnimatedMask));
+        TEST_CHECK(_runner, world.GetGroup(entity) == 3);
+        TEST_CHECK(_runner, world.GetEntityCount() == 1);
+
+        Vec4 position;
+        Quat rotation;
+        Vec3 angularVelocity;
+        uint32_t color;
+        world.Get(entity, kComponentPosition, &position);
+        world.Get(entity, kComponentRotation, &rotation);
+        world.Get(entity, kComponentAngularVelocity, &angularVelocity);
+        world.Get(entity, kComponentColor, &color);
+        TEST_CHECK(_runner, position.x == 0.0f && position.y == 0.0f && position.z == 0.0f && position.w == 1.0f);
+        TEST_CHECK(_runner, rotation.x == 0.0f && rotation.y == 0.0f && rotation.z == 0.0f && rotation.w == 1.0f);
+        TEST_CHECK(_runner, angularVelocity.x == 0.0f && angularVelocity.y == 0.0f && angularVelocity.z == 0.0f);
+        TEST_CHECK(_runner, color == 0xFFFFFFFFu);
+    });
+
+    _runner.Run("entities/destroy invalidates the handle", [&]()
+    {
+        EntityWorld world;
+        Entity first = world.Create(kRenderableMask, 0);
+        world.Destroy(first);
+        TEST_CHECK(_runner, !world.IsAlive(first));
+        TEST_CHECK(_runner, world.GetEntityCount() == 0);
+
+        /* The index is reused, under a new generation: the old handle stays dead */
+        Entity second = world.Create(kRenderableMask, 0);
+        TEST_CHECK(_runner, second.index == first.index && second.generation != first.generation);
+        TEST_CHECK(_runner, world.IsAlive(second) && !world.IsAlive(first));
+
+        /* Destroying a dead handle again does nothing */
+        world.Destroy(first);
+        TEST_CHECK(_runner, world.IsAlive(second) && world.GetEntityCount() == 1);
+    });
+
+    _runner.Run("entities/destroy swap-removes", [&]()
+    {
+        EntityWorld world;
+        std::vector<Entity> entities(s_entityCount);
+        std::vector<float> ids(s_entityCount);
+        for (size_t e = 0; e < s_entityCount; e++)
+        {
+            entities[e] = world.Create(kRenderableMask, 0);
+            ids[e] = (float)e;
+            Vec4 position = { ids[e], 0.0f, 0.0f, 1.0f };
+            world.Set(entities[e], kComponentPosition, &position);
+        }
+        TEST_CHECK(_runner, IsConsistent(world, entities, ids, kRenderableMask));
+
+        /* Holes in the first chunks, the last entity, then enough to free the last chunk */
+        uint64_t version = world.GetStructureVersion();
+        size_t destroyed = 0;
+        for (size_t e = 0; e < s_entityCount; e += 7)
+        {
+            world.Destroy(entities[e]);
+            ids[e] = -1.0f;
+            destroyed++;
+        }
+        if (ids[s_entityCount - 1] >= 0.0f)
+        {
+            world.Destroy(entities[s_entityCount - 1]);
+            ids[s_entityCount - 1] = -1.0f;
+            destroyed++;
+        }
+        TEST_CHECK(_runner, world.GetStructureVersion() != version);
+        TEST_CHECK(_runner, world.GetEntityCount() == s_entityCount - destroyed);
+        TEST_CHECK(_runner, IsConsistent(world, entities, ids, kRenderableMask));
+
+        for (size_t e = 0; e < s_entityCount / 2; e++)
+        {
+            world.Destroy(entities[e]);
+            ids[e] = -1.0f;
+        }
+        TEST_CHECK(_runner, IsConsistent(world, entities, ids, kRenderableMask));
+
+        /* Every remaining entity still reads its own data */
+        bool kept = true;
+        for (size_t e = 0; e < s_entityCount; e++)
+        {
+            if (ids[e] < 0.0f)
+                continue;
+            Vec4 position;
+            world.Get(entities[e], kComponentPosition, &position);
+            kept = kept && position.x == ids[e];
+        }
+        TEST_CHECK(_runner, kept);
+    });
+
+    _runner.Run("entities/set archetype moves and keeps components", [&]()
+    {
+        EntityWorld world;
+        std::vector<Entity> entities(s_entityCount);
+        std::vector<float> ids(s_entityCount);
+        for (size_t e = 0; e < s_entityCount; e++)
+        {
+            entities[e] = world.Create(kRenderableMask | kAnimatedMask, 0);
+            ids[e] = (float)e;
+            Vec4 position = { ids[e], 0.0f, 0.0f, 1.0f };
+            Vec3 angularVelocity = { 1.0f, 2.0f, ids[e] };
+            uint32_t color = 0x11223344u;
+            world.Set(entities[e], kComponentPosition, &position);
+            world.Set(entities[e], kComponentAngularVelocity, &angularVelocity);
+            world.Set(entities[e], kComponentColor, &color);
+        }
+
+        /* Every third one stops spinning, every fifth changes group (the moves leave holes in both ways) */
+        for (size_t e = 0; e < s_entityCount; e++)
+        {
+            if (e % 3 == 0)
+                world.SetArchetype(entities[e], kRenderableMask, world.GetGroup(entities[e]));
+            if (e % 5 == 0)
+                world.SetArchetype(entities[e], world.GetMask(entities[e]), 1);
+        }
+        TEST_CHECK(_runner, world.GetEntityCount() == s_entityCount);
+        TEST_CHECK(_runner, IsConsistent(world, entities, ids, kRenderableMask));
+        TEST_CHECK(_runner, IsConsistent(world, entities, ids, kAnimatedMask));
+
+        bool kept = true;
+        for (size_t e = 0; e < s_entityCount; e++)
+        {
+            uint32_t color;
+            world.Get(entities[e], kComponentColor, &color);
+            kept = kept && world.IsAlive(entities[e]) && color == 0x11223344u;
+            kept = kept && world.GetGroup(entities[e]) == ((e % 5 == 0) ? 1u : 0u);
+            kept = kept && ((world.GetMask(entities[e]) & kAnimatedMask) == kAnimatedMask) == (e % 3 != 0);
+        }
+        TEST_CHECK(_runner, kept);
+
+        /* Spinning again: the angular velocity starts from its default, not from what it was */
+        world.SetArchetype(entities[0], kRenderableMask | kAnimatedMask, 1);
+        Vec3 angularVelocity;
+        world.Get(entities[0], kComponentAngularVelocity, &angularVelocity);
+        TEST_CHECK(_runner, angularVelocity.x == 0.0f && angularVelocity.y == 0.0f && angularVelocity.z == 0.0f);
+        TEST_CHECK(_runner, IsConsistent(world, entities, ids, kAnimatedMask));
+    });
+
+    _runner.Run("entities/query orders chunks by group", [&]()
+    {
+        EntityWorld world;
+        world.Create(kRenderableMask, 2);
+        world.Create(kRenderableMask | kAnimatedMask, 0);
+        world.Create(kRenderableMask, 1);
+        world.Create(kRenderableMask, 0);
+        world.Create(ComponentBit(kComponentColor), 0);
+
+        std::vector<ChunkView> chunks;
+        TEST_CHECK(_runner, world.Query(kRenderableMask, chunks) == 4);
+        bool ordered = chunks.size() == 4;
+        for (size_t i = 1; i < chunks.size(); i++)
+            ordered = ordered && chunks[i - 1].group <= chunks[i].group && chunks[i].first == chunks[i - 1].first + chunks[i - 1].count;
+        TEST_CHECK(_runner, ordered);
+        TEST_CHECK(_runner, world.Query(kAnimatedMask, chunks) == 1);
+    });
+
+    _runner.Run("entities/set bumps the component version", [&]()
+    {
+        EntityWorld world;
+        Entity entity = world.Create(kRenderableMask, 0);
+        uint64_t positionVersion = world.GetComponentVersion(kComponentPosition);
+        uint64_t colorVersion = world.GetComponentVersion(kComponentColor);
+        uint64_t structureVersion = world.GetStructureVersion();
+
+        Vec4 position = { 1.0f, 2.0f, 3.0f, 1.0f };
+        world.Set(entity, kComponentPosition, &position);
+        TEST_CHECK(_runner, world.GetComponentVersion(kComponentPosition) != positionVersion);
+        TEST_CHECK(_runner, world.GetComponentVersion(kComponentColor) == colorVersion);
+        TEST_CHECK(_runner, world.GetStructureVersion() == structureVersion);
+    });
+}
@@ -0,0 +1,83 @@
+#include <cstdint>
+
+#include "FixedTimestep.h"
+#include "UnitTest.h"
+
+void RunFixedTimestepTests(UnitTestRunner& _runner)
+{
+    _runner.Run("timestep/frames at the step rate run one step each", [&]()
+    {
+        FixedTimestep timestep;
+        timestep.Initialize(60, 8);
+        /* 1e9 / 60 rounded to the nearest nanosecond */
+        const uint64_t step = 16666667;
+
+        bool oneEach = true;
+        for (int frame = 0; frame < 600; frame++)
+            oneEach = oneEach && timestep.Advance(step) == 1;
+        TEST_CHECK(_runner, oneEach);
+        TEST_CHECK(_runner, timestep.GetStepCount() == 600);
+        TEST_CHECK(_runner, timestep.GetAlpha() == 0.0f);
+        TEST_CHECK_NEAR(_runner, timestep.GetStepSeconds() - 1.0f / 60.0f, 0.0);
+    });
+
+    _runner.Run("timestep/fast frames accumulate", [&]()
+    {
+        /* 144 Hz frames on a 60 Hz simulation: 60 steps a second, whatever the split */
+        FixedTimestep timestep;
+        timestep.Initialize(60, 8);
+        const uint64_t frame = 1000000000ull / 144;
+
+        int steps = 0;
+        bool fractional = true;
+        for (int i = 0; i < 144; i++)
+        {
+            int advanced = timestep.Advance(frame);
+            steps += advanced;
+            fractional = fractional && advanced <= 1 && timestep.GetAlpha() >= 0.0f && timestep.GetAlpha() < 1.0f;
+        }
+        TEST_CHECK(_runner, fractional);
+        TEST_CHECK(_runner, steps == 59 || steps == 60);
+        TEST_CHECK(_runner, timestep.GetStepCount() == (uint64_t)steps);
+        TEST_CHECK(_runner, timestep.GetDroppedSteps() == 0);
+    });
+
+    _runner.Run("timestep/alpha is the fraction of a step left", [&]()
+    {
+        FixedTimestep timestep;
+        timestep.Initialize(100, 8);
+        TEST_CHECK(_runner, timestep.Advance(25000000) == 2);
+        TEST_CHECK_NEAR(_runner, timestep.GetAlpha() - 0.5f, 1e-6);
+        TEST_CHECK(_runner, timestep.Advance(5000000) == 1);
+        TEST_CHECK(_runner, timestep.GetAlpha() == 0.0f);
+    });
+
+    _runner.Run("timestep/stall drops the steps past the limit", [&]()
+    {
+        FixedTimestep timestep;
+        timestep.Initialize(100, 8);
+        /* 1.005 s: 100 steps due, 8 run, 92 dropped, the half step kept */
+        TEST_CHECK(_runner, timestep.Advance(1005000000) == 8);
+        TEST_CHECK(_runner, timestep.GetStepCount() == 8);
+        TEST_CHECK(_runner, timestep.GetDroppedSteps() == 92);
+        TEST_CHECK_NEAR(_runner, timestep.GetAlpha() - 0.5f, 1e-6);
+
+        /* Back to normal frames: no catching up */
+        TEST_CHECK(_runner, timestep.Advance(5000000) == 1);
+        TEST_CHECK(_runner, timestep.GetDroppedSteps() == 92);
+    });
+
+    _runner.Run("timestep/initialize resets the counts", [&]()
+    {
+        FixedTimestep timestep;
+        timestep.Initialize(100, 2);
+        timestep.Advance(1000000000);
+        timestep.Initialize(30, 4);
+        TEST_CHECK(_runner, timestep.GetRate() == 30);
+        TEST_CHECK(_runner, timestep.GetStepCount() == 0 && timestep.GetDroppedSteps() == 0);
+        TEST_CHECK(_runner, timestep.GetAlpha() == 0.0f);
+        /* 1e9 / 30 rounds to 33333333 ns: 3 steps take 99999999 ns */
+        TEST_CHECK(_runner, timestep.Advance(99999998) == 2);
+        TEST_CHECK(_runner, timestep.Advance(1) == 1);
+    });
+}
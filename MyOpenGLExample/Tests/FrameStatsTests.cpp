@@ -0,0 +1,92 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "FrameStats.h"
+#include "UnitTest.h"
+
+/// <summary>
+/// The sample of rank ceil(_percentile% of the count) in _sorted, as GetPercentile defines it
+/// </summary>
+static uint64_t ExactPercentile(const std::vector<uint64_t>& _sorted, double _percentile)
+{
+    size_t rank = (size_t)std::ceil((_percentile / 100.0) * (double)_sorted.size());
+    rank = (rank < 1) ? 1 : rank;
+    return _sorted[rank - 1];
+}
+
+void RunFrameStatsTests(UnitTestRunner& _runner)
+{
+    _runner.Run("histogram/empty", [&]()
+    {
+        LatencyHistogram histogram;
+        TEST_CHECK(_runner, histogram.GetCount() == 0);
+        TEST_CHECK(_runner, histogram.GetPercentile(50.0) == 0);
+        TEST_CHECK(_runner, histogram.GetMin() == 0 && histogram.GetMax() == 0);
+        TEST_CHECK(_runner, histogram.GetMean() == 0.0);
+    });
+
+    _runner.Run("histogram/small values are exact", [&]()
+    {
+        LatencyHistogram histogram;
+        for (uint64_t value = 100; value >= 1; value--)
+            histogram.Record(value);
+
+        TEST_CHECK(_runner, histogram.GetPercentile(0.0) == 1);
+        TEST_CHECK(_runner, histogram.GetPercentile(50.0) == 50);
+        TEST_CHECK(_runner, histogram.GetPercentile(90.0) == 90);
+        TEST_CHECK(_runner, histogram.GetPercentile(99.0) == 99);
+        TEST_CHECK(_runner, histogram.GetPercentile(99.5) == 100);
+        TEST_CHECK(_runner, histogram.GetPercentile(100.0) == 100);
+        TEST_CHECK(_runner, histogram.GetMin() == 1 && histogram.GetMax() == 100);
+        TEST_CHECK_NEAR(_runner, std::fabs(histogram.GetMean() - 50.5), 1e-9);
+    });
+
+    _runner.Run("histogram/percentiles within a bucket", [&]()
+    {
+        /* Frame-like times, 0.1 to 40 ms, spread over many octaves */
+        LatencyHistogram histogram;
+        std::vector<uint64_t> samples;
+        uint32_t seed = 2024u;
+        for (int i = 0; i < 10000; i++)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            double unit = (double)(seed >> 8) / 16777216.0;
+            uint64_t value = (uint64_t)(100000.0 * std::pow(400.0, unit));
+            samples.push_back(value);
+            histogram.Record(value);
+        }
+        std::sort(samples.begin(), samples.end());
+
+        /* A bucket spans 1/64 of its octave: the answer is at or above the real one, by less than that */
+        double error = 0.0;
+        bool above = true;
+        for (double percentile : { 1.0, 10.0, 50.0, 90.0, 99.0, 99.9 })
+        {
+            uint64_t exact = ExactPercentile(samples, percentile);
+            uint64_t value = histogram.GetPercentile(percentile);
+            above = above && value >= exact;
+            error = std::max(error, ((double)value - (double)exact) / (double)exact);
+        }
+        TEST_CHECK(_runner, above);
+        TEST_CHECK_NEAR(_runner, error, 1.0 / 64.0);
+
+        /* The top is clamped to the real maximum, the bottom is the first bucket's bound */
+        TEST_CHECK(_runner, histogram.GetPercentile(100.0) == samples.back());
+        TEST_CHECK(_runner, histogram.GetPercentile(0.0) >= samples.front());
+        TEST_CHECK_NEAR(_runner, ((double)histogram.GetPercentile(0.0) - (double)samples.front()) / (double)samples.front(), 1.0 / 64.0);
+        TEST_CHECK(_runner, histogram.GetMin() == samples.front() && histogram.GetMax() == samples.back());
+    });
+
+    _runner.Run("histogram/reset", [&]()
+    {
+        LatencyHistogram histogram;
+        histogram.Record(5000000);
+        histogram.Reset();
+        histogram.Record(7);
+        TEST_CHECK(_runner, histogram.GetCount() == 1);
+        TEST_CHECK(_runner, histogram.GetPercentile(99.0) == 7);
+        TEST_CHECK(_runner, histogram.GetMin() == 7 && histogram.GetMax() == 7);
+    });
+}
@@ -0,0 +1,159 @@
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "UnitTest.h"
+#include "VectorMath.h"
+
+static const size_t s_matrixCount = 1024;
+static const size_t s_pointCount = 4096;
+
+/// <summary>
+/// Same generator as the scene and the benchmarks, every run sees the same data
+/// </summary>
+/// <param name="_state"></param>
+/// <returns>A value in [-1, 1)</returns>
+static float NextSigned(uint32_t& _state)
+{
+    _state = _state * 1664525u + 1013904223u;
+    return (float)(_state >> 8) / 8388608.0f - 1.0f;
+}
+
+static Quat RandomRotation(uint32_t& _state)
+{
+    Quat q = { NextSigned(_state), NextSigned(_state), NextSigned(_state), NextSigned(_state) + 2.0f };
+    return QuatNormalize(q);
+}
+
+/// <summary>
+/// Rotation, scale and translation: the kind of matrix we invert (well conditioned)
+/// </summary>
+static Mat4 RandomTransform(uint32_t& _state)
+{
+    Mat4 m = Mat4FromQuat(RandomRotation(_state));
+    float scale = 1.5f + NextSigned(_state);
+    for (int i = 0; i < 12; i++)
+        m.m[i] *= scale;
+    m.m[12] = NextSigned(_state) * 10.0f;
+    m.m[13] = NextSigned(_state) * 10.0f;
+    m.m[14] = NextSigned(_state) * 10.0f;
+    return m;
+}
+
+static double MaxDifference(const float* _a, const float* _b, size_t _count)
+{
+    double difference = 0.0;
+    for (size_t i = 0; i < _count; i++)
+        difference = std::fmax(difference, std::fabs((double)_a[i] - (double)_b[i]));
+    return difference;
+}
+
+void RunMathTests(UnitTestRunner& _runner)
+{
+    uint32_t seed = 12345u;
+
+    std::vector<Mat4> a(s_matrixCount), b(s_matrixCount);
+    std::vector<Quat> qa(s_pointCount), qb(s_pointCount);
+    std::vector<Vec4> points(s_pointCount);
+
+    for (size_t i = 0; i < s_matrixCount; i++)
+    {
+        a[i] = RandomTransform(seed);
+        b[i] = RandomTransform(seed);
+    }
+    for (size_t i = 0; i < s_pointCount; i++)
+    {
+        qa[i] = RandomRotation(seed);
+        qb[i] = RandomRotation(seed);
+        points[i] = { NextSigned(seed) * 100.0f, NextSigned(seed) * 100.0f, NextSigned(seed) * 100.0f, 1.0f };
+    }
+
+    /* The SIMD build of each kernel against its scalar reference (the same code in a scalar build) */
+    _runner.Run("math/mat4 multiply matches scalar", [&]()
+    {
+        std::vector<Mat4> scalar(s_matrixCount), simd(s_matrixCount);
+        for (size_t i = 0; i < s_matrixCount; i++)
+        {
+            scalar[i] = Mat4MultiplyScalar(a[i], b[i]);
+            simd[i] = Mat4Multiply(a[i], b[i]);
+        }
+        TEST_CHECK_NEAR(_runner, MaxDifference(scalar[0].m, simd[0].m, s_matrixCount * 16), 1e-3);
+    });
+
+    _runner.Run("math/mat4 transform matches scalar", [&]()
+    {
+        double difference = 0.0;
+        for (size_t i = 0; i < s_pointCount; i++)
+        {
+            Vec4 scalar = Mat4TransformScalar(a[i % s_matrixCount], points[i]);
+            Vec4 simd = Mat4Transform(a[i % s_matrixCount], points[i]);
+            difference = std::fmax(difference, MaxDifference(&scalar.x, &simd.x, 4));
+        }
+        TEST_CHECK_NEAR(_runner, difference, 1e-2);
+    });
+
+    _runner.Run("math/mat4 inverse matches scalar", [&]()
+    {
+        std::vector<Mat4> scalar(s_matrixCount), simd(s_matrixCount);
+        bool inverted = true;
+        for (size_t i = 0; i < s_matrixCount; i++)
+        {
+            inverted = Mat4InverseScalar(a[i], scalar[i]) && inverted;
+            inverted = Mat4Inverse(a[i], simd[i]) && inverted;
+        }
+        TEST_CHECK(_runner, inverted);
+        TEST_CHECK_NEAR(_runner, MaxDifference(scalar[0].m, simd[0].m, s_matrixCount * 16), 1e-4);
+    });
+
+    _runner.Run("math/mat4 inverse times matrix is identity", [&]()
+    {
+        Mat4 identity = Mat4Identity();
+        double difference = 0.0;
+        for (size_t i = 0; i < s_matrixCount; i++)
+        {
+            Mat4 inverse;
+            Mat4Inverse(a[i], inverse);
+            Mat4 product = Mat4Multiply(inverse, a[i]);
+            difference = std::fmax(difference, MaxDifference(product.m, identity.m, 16));
+        }
+        TEST_CHECK_NEAR(_runner, difference, 1e-4);
+    });
+
+    _runner.Run("math/mat4 inverse rejects singular", [&]()
+    {
+        /* A scale flattening z: exactly 0 as determinant, whatever the rounding */
+        Mat4 singular = Mat4Identity();
+        singular.m[10] = 0.0f;
+        Mat4 inverse;
+        TEST_CHECK(_runner, !Mat4InverseScalar(singular, inverse));
+        TEST_CHECK(_runner, !Mat4Inverse(singular, inverse));
+    });
+
+    _runner.Run("math/quat multiply matches scalar", [&]()
+    {
+        double difference = 0.0;
+        for (size_t i = 0; i < s_pointCount; i++)
+        {
+            Quat scalar = QuatMultiplyScalar(qa[i], qb[i]);
+            Quat simd = QuatMultiply(qa[i], qb[i]);
+            difference = std::fmax(difference, MaxDifference(&scalar.x, &simd.x, 4));
+        }
+        TEST_CHECK_NEAR(_runner, difference, 1e-5);
+    });
+
+    _runner.Run("math/compose quats matches scalar", [&]()
+    {
+        std::vector<Quat> scalar(s_pointCount), simd(s_pointCount);
+        ComposeQuatsScalar(qa.data(), qb.data(), scalar.data(), s_pointCount);
+        ComposeQuats(qa.data(), qb.data(), simd.data(), s_pointCount);
+        TEST_CHECK_NEAR(_runner, MaxDifference(&scalar[0].x, &simd[0].x, s_pointCount * 4), 1e-5);
+    });
+
+    _runner.Run("math/transform points matches scalar", [&]()
+    {
+        std::vector<Vec4> scalar(s_pointCount), simd(s_pointCount);
+        TransformPointsScalar(a[0], points.data(), scalar.data(), s_pointCount);
+        TransformPoints(a[0], points.data(), simd.data(), s_pointCount);
+        TEST_CHECK_NEAR(_runner, MaxDifference(&scalar[0].x, &simd[0].x, s_pointCount * 4), 1e-2);
+    });
+}
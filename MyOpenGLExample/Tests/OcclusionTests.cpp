@@ -0,0 +1,158 @@
+#include <cstdint>
+#include <vector>
+
+#include "FrustumCulling.h"
+#include "OcclusionBuffer.h"
+#include "UnitTest.h"
+#include "VectorMath.h"
+
+/// <summary>
+/// Cubes drawn as occluders, and spheres tested against them. Fewer occluders than the benchmarks draw: these
+/// leave gaps in the view, so some spheres are kept and some hidden
+/// </summary>
+static const size_t s_occluderCount = 24;
+static const size_t s_sphereCount = 16384;
+
+/// <summary>
+/// The buffer the application uses for a 640x480 window
+/// </summary>
+static const int s_bufferWidth = 320;
+static const int s_bufferHeight = 240;
+
+static float NextSigned(uint32_t& _state)
+{
+    _state = _state * 1664525u + 1013904223u;
+    return (float)(_state >> 8) / 8388608.0f - 1.0f;
+}
+
+/// <summary>
+/// The 8 corners of a cube of half-side _halfSide, turned by _rotation
+/// </summary>
+static void AddCube(const Vec3& _center, float _halfSide, const Quat& _rotation, std::vector<Vec3>& _points)
+{
+    for (int corner = 0; corner < 8; corner++)
+    {
+        Vec3 offset = { (corner & 1) ? _halfSide : -_halfSide, (corner & 2) ? _halfSide : -_halfSide, (corner & 4) ? _halfSide : -_halfSide };
+        _points.push_back(Vec3Add(_center, QuatRotate(_rotation, offset)));
+    }
+}
+
+/// <summary>
+/// Randomly turned cubes of half-side 1 to 3, spread over the view between 10 and 40 units away (the camera
+/// looks down -z from the origin)
+/// </summary>
+static void BuildOccluders(std::vector<Vec3>& _points)
+{
+    uint32_t seed = 31337u;
+    for (size_t i = 0; i < s_occluderCount; i++)
+    {
+        float depth = 25.0f + NextSigned(seed) * 15.0f;
+        Vec3 center = { NextSigned(seed) * depth * 0.5f, NextSigned(seed) * depth * 0.4f, -depth };
+        float halfSide = 2.0f + NextSigned(seed);
+        Quat rotation = QuatFromAxisAngle(Vec3Normalize({ NextSigned(seed), NextSigned(seed), NextSigned(seed) + 1.5f }), NextSigned(seed) * 3.0f);
+        AddCube(center, halfSide, rotation, _points);
+    }
+}
+
+/// <summary>
+/// Spheres behind and among the occluders, 20 to 80 units away, as columns (_columns[0..3]: x, y, z, radius)
+/// </summary>
+static void BuildSpheres(std::vector<float> (&_columns)[4])
+{
+    uint32_t seed = 4711u;
+    for (size_t i = 0; i < s_sphereCount; i++)
+    {
+        float depth = 50.0f + NextSigned(seed) * 30.0f;
+        _columns[0].push_back(NextSigned(seed) * depth * 0.5f);
+        _columns[1].push_back(NextSigned(seed) * depth * 0.4f);
+        _columns[2].push_back(-depth);
+        _columns[3].push_back(1.0f + 0.5f * NextSigned(seed));
+    }
+}
+
+void RunOcclusionTests(UnitTestRunner& _runner)
+{
+    Mat4 projection = Mat4Perspective(45.0f * (3.141593f / 180.0f), 4.0f / 3.0f, 0.1f, 120.0f);
+    Mat4 view = Mat4Identity();
+
+    _runner.Run("occlusion/wall hides what is behind it only", [&]()
+    {
+        /* A cube filling the middle of the view 10 units away: a sphere behind it is hidden, one in front of
+           it or beside it is not */
+        std::vector<Vec3> points;
+        AddCube({ 0.0f, 0.0f, -10.0f }, 2.0f, Quat{ 0.0f, 0.0f, 0.0f, 1.0f }, points);
+
+        OcclusionBuffer buffer;
+        buffer.Resize(s_bufferWidth, s_bufferHeight);
+        buffer.BeginFrame(view, projection);
+        TEST_CHECK(_runner, buffer.AddOccluder(points.data(), points.size()));
+        buffer.RasterizeTiles(0, buffer.GetTileCount());
+
+        const float x[3] = { 0.0f, 0.0f, 6.0f };
+        const float y[3] = { 0.0f, 0.0f, 0.0f };
+        const float z[3] = { -20.0f, -5.0f, -20.0f };
+        const float radius[3] = { 0.5f, 0.5f, 0.5f };
+        SphereColumns spheres = { x, y, z, radius };
+        const uint32_t rows[3] = { 0, 1, 2 };
+        uint32_t visible[3] = {};
+
+        size_t visibleCount = buffer.CullOccludedSpheresScalar(spheres, 1.0f, rows, 3, visible);
+        TEST_CHECK(_runner, visibleCount == 2 && visible[0] == 1 && visible[1] == 2);
+        visibleCount = buffer.CullOccludedSpheres(spheres, 1.0f, rows, 3, visible);
+        TEST_CHECK(_runner, visibleCount == 2 && visible[0] == 1 && visible[1] == 2);
+    });
+
+    _runner.Run("occlusion/occluder crossing the near plane is left out", [&]()
+    {
+        std::vector<Vec3> points;
+        AddCube({ 0.0f, 0.0f, 0.0f }, 1.0f, Quat{ 0.0f, 0.0f, 0.0f, 1.0f }, points);
+
+        OcclusionBuffer buffer;
+        buffer.Resize(s_bufferWidth, s_bufferHeight);
+        buffer.BeginFrame(view, projection);
+        TEST_CHECK(_runner, !buffer.AddOccluder(points.data(), points.size()));
+        TEST_CHECK(_runner, buffer.GetOccluderCount() == 0);
+    });
+
+    std::vector<Vec3> points;
+    std::vector<float> sphereColumns[4];
+    BuildOccluders(points);
+    BuildSpheres(sphereColumns);
+    SphereColumns spheres = { sphereColumns[0].data(), sphereColumns[1].data(), sphereColumns[2].data(), sphereColumns[3].data() };
+    std::vector<uint32_t> rows(s_sphereCount);
+    for (size_t i = 0; i < s_sphereCount; i++)
+        rows[i] = (uint32_t)i;
+
+    OcclusionBuffer scalar, simd;
+    scalar.Resize(s_bufferWidth, s_bufferHeight);
+    simd.Resize(s_bufferWidth, s_bufferHeight);
+    scalar.BeginFrame(view, projection);
+    simd.BeginFrame(view, projection);
+    for (size_t i = 0; i < s_occluderCount; i++)
+    {
+        scalar.AddOccluder(points.data() + i * 8, 8);
+        simd.AddOccluder(points.data() + i * 8, 8);
+    }
+    scalar.RasterizeTilesScalar(0, scalar.GetTileCount());
+    simd.RasterizeTiles(0, simd.GetTileCount());
+
+    /* Both rasterizers fill the same spans and both tests compare the same depths, they must agree exactly */
+    _runner.Run("occlusion/raster matches scalar", [&]()
+    {
+        size_t pixelCount = (size_t)scalar.GetWidth() * scalar.GetHeight();
+        size_t differentPixels = 0;
+        for (size_t i = 0; i < pixelCount; i++)
+            differentPixels += (scalar.GetDepth()[i] != simd.GetDepth()[i]) ? 1 : 0;
+        TEST_CHECK(_runner, differentPixels == 0);
+    });
+
+    _runner.Run("occlusion/sphere test matches scalar", [&]()
+    {
+        std::vector<uint32_t> scalarVisible(s_sphereCount), simdVisible(s_sphereCount);
+        scalarVisible.resize(scalar.CullOccludedSpheresScalar(spheres, 1.0f, rows.data(), s_sphereCount, scalarVisible.data()));
+        simdVisible.resize(scalar.CullOccludedSpheres(spheres, 1.0f, rows.data(), s_sphereCount, simdVisible.data()));
+        TEST_CHECK(_runner, scalarVisible == simdVisible);
+        /* The occluders hide some of the spheres, not all */
+        TEST_CHECK(_runner, !scalarVisible.empty() && scalarVisible.size() < s_sphereCount);
+    });
+}
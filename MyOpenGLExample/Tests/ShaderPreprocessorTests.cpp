@@ -0,0 +1,95 @@
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "ShaderPreprocessor.h"
+#include "ShaderSourceCache.h"
+#include "UnitTest.h"
+
+/// <summary>
+/// What the driver would compile: the pieces of _stage one after the other
+/// </summary>
+static std::string Concatenate(const ShaderStageSource& _stage)
+{
+    std::string text;
+    for (const ShaderSourceSpan& piece : _stage.pieces)
+        text.append(piece.data, (size_t)piece.length);
+    return text;
+}
+
+static void WriteFile(const std::string& _path, const char* _text)
+{
+    std::ofstream file(_path, std::ios::binary | std::ios::trunc);
+    file << _text;
+}
+
+void RunShaderPreprocessorTests(UnitTestRunner& _runner)
+{
+    /* Shaders written for the tests, read from disk: the embedded copies are only the application's */
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "MyOpenGLExampleTests";
+    std::filesystem::create_directories(directory / "Include");
+    const std::string root = directory.generic_string();
+
+    WriteFile(root + "/main.glsl", "#version 330 core\n#include \"Include/a.glsl\"\n#include \"Include/b.glsl\"\nvoid main() {}\n");
+    WriteFile(root + "/Include/a.glsl", "#pragma once\nfloat a;\n");
+    WriteFile(root + "/Include/b.glsl", "#include \"a.glsl\"\nfloat b;\n");
+    WriteFile(root + "/self.glsl", "#version 330 core\n#include \"self.glsl\"\n");
+    WriteFile(root + "/noversion.glsl", "void main() {}\n");
+
+    ShaderSourceCache sources;
+    sources.SetUseEmbedded(false);
+    ShaderPreprocessor preprocessor(sources);
+
+    _runner.Run("preprocessor/include and pragma once", [&]()
+    {
+        ShaderStageSource stage;
+        TEST_CHECK(_runner, preprocessor.Process(root + "/main.glsl", { { "VARIANT", "2" } }, stage));
+
+        /* a.glsl comes once, its #pragma once blanked; every file is numbered, #line goes back to the includer */
+        const std::string expected =
+            "#version 330 core\n#define VARIANT 2\n#line 2 0\n"
+            "#line 1 1\n\nfloat a;\n\n#line 3 0\n"
+            "#line 1 2\n\n#line 2 2\nfloat b;\n\n#line 4 0\n"
+            "void main() {}\n";
+        TEST_CHECK(_runner, Concatenate(stage) == expected);
+
+        const std::vector<std::string> names = { root + "/main.glsl", root + "/Include/a.glsl", root + "/Include/b.glsl" };
+        TEST_CHECK(_runner, stage.sourceNames == names);
+    });
+
+    _runner.Run("preprocessor/missing file", [&]()
+    {
+        ShaderStageSource stage;
+        TEST_CHECK(_runner, !preprocessor.Process(root + "/missing.glsl", {}, stage));
+    });
+
+    _runner.Run("preprocessor/include cycle", [&]()
+    {
+        /* No #pragma once: the file includes itself until the depth limit */
+        ShaderStageSource stage;
+        TEST_CHECK(_runner, !preprocessor.Process(root + "/self.glsl", {}, stage));
+    });
+
+    _runner.Run("preprocessor/defines need a version", [&]()
+    {
+        ShaderStageSource stage;
+        TEST_CHECK(_runner, !preprocessor.Process(root + "/noversion.glsl", { { "VARIANT", "2" } }, stage));
+    });
+
+    _runner.Run("preprocessor/embedded shader", [&]()
+    {
+        ShaderSourceCache embedded;
+        ShaderPreprocessor embeddedPreprocessor(embedded);
+        ShaderStageSource stage;
+        TEST_CHECK(_runner, embeddedPreprocessor.Process("Shaders/vshader.glsl", { { "INSTANCED", "1" } }, stage));
+
+        std::string text = Concatenate(stage);
+        TEST_CHECK(_runner, text.compare(0, 9, "#version ") == 0);
+        TEST_CHECK(_runner, text.find("#define INSTANCED 1\n") != std::string::npos);
+        TEST_CHECK(_runner, text.find("#include") == std::string::npos && text.find("#pragma once") == std::string::npos);
+        TEST_CHECK(_runner, stage.sourceNames.size() > 1);
+    });
+
+    std::filesystem::remove_all(directory);
+}
@@ -0,0 +1,208 @@
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "EntityWorld.h"
+#include "SceneSystems.h"
+#include "UnitTest.h"
+#include "VectorMath.h"
+
+/// <summary>
+/// Animated objects: several chunks, the last one partly filled
+/// </summary>
+static const size_t s_objectCount = 3000;
+
+static const ComponentMask s_objectMask = kRenderableMask | kAnimatedMask;
+static const float s_step = 1.0f / 60.0f;
+
+/// <summary>
+/// Per-object animation in closed form: resting orientation and a spin (world axis, rad/s)
+/// </summary>
+struct SpinningObject
+{
+    Quat orientation;
+    Vec3 axis;
+    float speed;
+};
+
+static float NextSigned(uint32_t& _state)
+{
+    _state = _state * 1664525u + 1013904223u;
+    return (float)(_state >> 8) / 8388608.0f - 1.0f;
+}
+
+/// <summary>
+/// The objects, and the same objects as entities of one archetype: with no entity destroyed, queries return
+/// them in creation order
+/// </summary>
+static void BuildObjects(std::vector<SpinningObject>& _objects, EntityWorld& _world)
+{
+    uint32_t seed = 4242u;
+    _objects.resize(s_objectCount);
+    _world.Clear();
+
+    for (size_t i = 0; i < s_objectCount; i++)
+    {
+        SpinningObject& object = _objects[i];
+        object.orientation = QuatNormalize({ NextSigned(seed), NextSigned(seed), NextSigned(seed), NextSigned(seed) + 2.0f });
+        object.axis = Vec3Normalize({ NextSigned(seed), NextSigned(seed), NextSigned(seed) + 0.1f });
+        object.speed = 0.72f * NextSigned(seed);
+
+        Vec4 position = { NextSigned(seed) * 100.0f, NextSigned(seed) * 100.0f, NextSigned(seed) * 100.0f, 1.0f };
+        Vec3 angularVelocity = Vec3Scale(object.axis, object.speed);
+
+        Entity entity = _world.Create(s_objectMask, 0);
+        _world.Set(entity, kComponentPosition, &position);
+        _world.Set(entity, kComponentRotation, &object.orientation);
+        _world.Set(entity, kComponentPreviousRotation, &object.orientation);
+        _world.Set(entity, kComponentAngularVelocity, &angularVelocity);
+    }
+}
+
+static void AnimateRotationsScalar(const std::vector<ChunkView>& _chunks, float _dt)
+{
+    for (const ChunkView& chunk : _chunks)
+    {
+        IntegrateRotationsScalar(GetQuatColumns(chunk, kComponentRotation), GetQuatColumns(chunk, kComponentPreviousRotation),
+            GetVec3Columns(chunk, kComponentAngularVelocity), _dt, chunk.count);
+    }
+}
+
+static void ExtractRotationsScalar(const std::vector<ChunkView>& _chunks, float _alpha, float* _rotations)
+{
+    for (const ChunkView& chunk : _chunks)
+    {
+        WriteInterpolatedRotationsScalar(GetQuatColumns(chunk, kComponentPreviousRotation), GetQuatColumns(chunk, kComponentRotation),
+            _alpha, chunk.count, _rotations + chunk.first * 4);
+    }
+}
+
+static void WriteAnalyticRotations(const std::vector<SpinningObject>& _objects, float _time, float* _rotations)
+{
+    for (size_t i = 0; i < _objects.size(); i++)
+    {
+        const SpinningObject& object = _objects[i];
+        Quat spin = QuatFromAxisAngle(object.axis, std::fmod(object.speed * _time, 6.283185f));
+        Quat rotation = QuatMultiply(spin, object.orientation);
+        _rotations[i * 4 + 0] = rotation.x;
+        _rotations[i * 4 + 1] = rotation.y;
+        _rotations[i * 4 + 2] = rotation.z;
+        _rotations[i * 4 + 3] = rotation.w;
+    }
+}
+
+/// <summary>
+/// Largest component difference between two rotation streams, q and -q being equal
+/// </summary>
+static double RotationDifference(const std::vector<float>& _a, const std::vector<float>& _b)
+{
+    double difference = 0.0;
+    for (size_t i = 0; i + 4 <= _a.size(); i += 4)
+    {
+        double dot = 0.0;
+        for (int c = 0; c < 4; c++)
+            dot += (double)_a[i + c] * (double)_b[i + c];
+
+        double sign = (dot < 0.0) ? -1.0 : 1.0;
+        for (int c = 0; c < 4; c++)
+            difference = std::fmax(difference, std::fabs((double)_a[i + c] - sign * (double)_b[i + c]));
+    }
+    return difference;
+}
+
+void RunTransformTests(UnitTestRunner& _runner)
+{
+    std::vector<SpinningObject> objects;
+    EntityWorld scalarWorld, simdWorld;
+    std::vector<ChunkView> scalarChunks, simdChunks;
+    BuildObjects(objects, scalarWorld);
+    BuildObjects(objects, simdWorld);
+    scalarWorld.Query(s_objectMask, scalarChunks);
+    simdWorld.Query(s_objectMask, simdChunks);
+
+    /* One simulated second: the integration must follow the closed form, the SIMD kernel the scalar one */
+    const int stepCount = 60;
+    for (int step = 0; step < stepCount; step++)
+    {
+        AnimateRotationsScalar(scalarChunks, s_step);
+        AnimateRotations(simdChunks, 0, simdChunks.size(), s_step);
+    }
+
+    std::vector<float> analytic(s_objectCount * 4), scalar(s_objectCount * 4), simd(s_objectCount * 4);
+    WriteAnalyticRotations(objects, stepCount * s_step, analytic.data());
+
+    _runner.Run("transform/integration follows the analytic rotation", [&]()
+    {
+        ExtractRotationsScalar(scalarChunks, 1.0f, scalar.data());
+        TEST_CHECK_NEAR(_runner, RotationDifference(analytic, scalar), 1e-3);
+    });
+
+    _runner.Run("transform/integration matches scalar", [&]()
+    {
+        ExtractRotationsScalar(scalarChunks, 1.0f, scalar.data());
+        ExtractRotations(simdChunks, 0, simdChunks.size(), 1.0f, simd.data());
+        TEST_CHECK_NEAR(_runner, RotationDifference(scalar, simd), 1e-4);
+    });
+
+    _runner.Run("transform/interpolation matches scalar", [&]()
+    {
+        for (float alpha : { 0.0f, 0.3f, 1.0f })
+        {
+            ExtractRotationsScalar(scalarChunks, alpha, scalar.data());
+            ExtractRotations(scalarChunks, 0, scalarChunks.size(), alpha, simd.data());
+            TEST_CHECK_NEAR(_runner, RotationDifference(scalar, simd), 1e-5);
+        }
+    });
+
+    _runner.Run("transform/interpolation ends on the rotations", [&]()
+    {
+        /* alpha 0 is the previous rotation, 1 the current one: one step apart, not equal */
+        std::vector<float> previous(s_objectCount * 4), current(s_objectCount * 4);
+        ExtractRotations(scalarChunks, 0, scalarChunks.size(), 0.0f, previous.data());
+        ExtractRotations(scalarChunks, 0, scalarChunks.size(), 1.0f, current.data());
+
+        std::vector<float> expectedPrevious(s_objectCount * 4), expectedCurrent(s_objectCount * 4);
+        for (const ChunkView& chunk : scalarChunks)
+        {
+            for (size_t row = 0; row < chunk.count; row++)
+            {
+                for (int c = 0; c < 4; c++)
+                {
+                    expectedPrevious[(chunk.first + row) * 4 + c] = chunk.GetColumn(kComponentPreviousRotation, c)[row];
+                    expectedCurrent[(chunk.first + row) * 4 + c] = chunk.GetColumn(kComponentRotation, c)[row];
+                }
+            }
+        }
+        TEST_CHECK_NEAR(_runner, RotationDifference(previous, expectedPrevious), 1e-6);
+        TEST_CHECK_NEAR(_runner, RotationDifference(current, expectedCurrent), 1e-6);
+    });
+
+    _runner.Run("transform/indexed interpolation matches scalar", [&]()
+    {
+        /* Every third row of each chunk, and the last one */
+        for (const ChunkView& chunk : scalarChunks)
+        {
+            std::vector<uint32_t> rows;
+            for (uint32_t row = 0; row < chunk.count; row += 3)
+                rows.push_back(row);
+            rows.push_back((uint32_t)chunk.count - 1);
+
+            std::vector<float> indexedScalar(rows.size() * 4), indexedSimd(rows.size() * 4), expected(rows.size() * 4);
+            QuatColumns previous = GetQuatColumns(chunk, kComponentPreviousRotation);
+            QuatColumns rotation = GetQuatColumns(chunk, kComponentRotation);
+            WriteInterpolatedRotationsIndexedScalar(previous, rotation, 0.6f, rows.data(), rows.size(), indexedScalar.data());
+            WriteInterpolatedRotationsIndexed(previous, rotation, 0.6f, rows.data(), rows.size(), indexedSimd.data());
+
+            std::vector<float> all(chunk.count * 4);
+            WriteInterpolatedRotationsScalar(previous, rotation, 0.6f, chunk.count, all.data());
+            for (size_t i = 0; i < rows.size(); i++)
+            {
+                for (int c = 0; c < 4; c++)
+                    expected[i * 4 + c] = all[rows[i] * 4 + c];
+            }
+
+            TEST_CHECK_NEAR(_runner, RotationDifference(indexedScalar, expected), 0.0);
+            TEST_CHECK_NEAR(_runner, RotationDifference(indexedSimd, indexedScalar), 1e-5);
+        }
+    });
+}
@@ -0,0 +1,53 @@
+#include "UnitTest.h"
+
+#include <iostream>
+
+UnitTestRunner::UnitTestRunner(const std::string& _filter)
+    : m_filter(_filter)
+{
+}
+
+bool UnitTestRunner::IsSelected(const std::string& _name) const
+{
+    return m_filter.empty() || _name.find(m_filter) != std::string::npos;
+}
+
+void UnitTestRunner::Run(const std::string& _name, const std::function<void()>& _body)
+{
+    if (!IsSelected(_name))
+        return;
+
+    m_currentTest = _name;
+    m_currentFailed = false;
+    _body();
+
+    m_testCount++;
+    m_failedTestCount += m_currentFailed ? 1 : 0;
+    std::cout << (m_currentFailed ? "FAILED " : "ok     ") << _name << std::endl;
+    m_currentTest.clear();
+}
+
+void UnitTestRunner::Check(bool _passed, const char* _expression, const char* _file, int _line)
+{
+    if (_passed)
+        return;
+
+    m_currentFailed = true;
+    std::cout << "Error: " << _file << ":" << _line << ": " << m_currentTest << ": " << _expression << std::endl;
+}
+
+void UnitTestRunner::CheckNear(double _error, double _tolerance, const char* _expression, const char* _file, int _line)
+{
+    /* Written so that a NaN error fails too */
+    if (_error <= _tolerance)
+        return;
+
+    m_currentFailed = true;
+    std::cout << "Error: " << _file << ":" << _line << ": " << m_currentTest << ": " << _expression << " is " << _error
+        << " (tolerance " << _tolerance << ")" << std::endl;
+}
+
+void UnitTestRunner::PrintSummary() const
+{
+    std::cout << m_testCount << " tests, " << m_failedTestCount << " failed" << std::endl;
+}
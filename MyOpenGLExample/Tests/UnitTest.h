@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+
+/// <summary>
+/// Runs and reports the unit tests. A test is a body making checks; a failed check is reported with its file and
+/// line and the test goes on, so one run shows every failure. Names are "suite/test", the suite being what ctest
+/// runs as one test (--filter "suite/")
+/// </summary>
+class UnitTestRunner
+{
+public:
+    /// <summary>
+    /// Only tests whose name contains _filter run (all if empty)
+    /// </summary>
+    /// <param name="_filter"></param>
+    explicit UnitTestRunner(const std::string& _filter);
+
+    bool IsSelected(const std::string& _name) const;
+
+    void Run(const std::string& _name, const std::function<void()>& _body);
+
+    /// <summary>
+    /// Record the result of a check of the running test, see TEST_CHECK
+    /// </summary>
+    /// <param name="_passed"></param>
+    /// <param name="_expression"></param>
+    /// <param name="_file"></param>
+    /// <param name="_line"></param>
+    void Check(bool _passed, const char* _expression, const char* _file, int _line);
+
+    /// <summary>
+    /// Check that a difference between two results is within _tolerance, see TEST_CHECK_NEAR
+    /// </summary>
+    /// <param name="_error"></param>
+    /// <param name="_tolerance"></param>
+    /// <param name="_expression"></param>
+    /// <param name="_file"></param>
+    /// <param name="_line"></param>
+    void CheckNear(double _error, double _tolerance, const char* _expression, const char* _file, int _line);
+
+    /// <summary>
+    /// Print the number of tests run and failed
+    /// </summary>
+    void PrintSummary() const;
+
+    int GetTestCount() const { return m_testCount; }
+    int GetFailedTestCount() const { return m_failedTestCount; }
+
+private:
+    std::string m_filter;
+    std::string m_currentTest;
+    bool m_currentFailed = false;
+    int m_testCount = 0;
+    int m_failedTestCount = 0;
+};
+
+#define TEST_CHECK(runner, condition) (runner).Check((condition), #condition, __FILE__, __LINE__)
+#define TEST_CHECK_NEAR(runner, error, tolerance) (runner).CheckNear((error), (tolerance), #error, __FILE__, __LINE__)
+
+/// <summary>
+/// Test suites, one per file
+/// </summary>
+/// <param name="_runner"></param>
+void RunApplicationOptionsTests(UnitTestRunner& _runner);
+void RunBvhTests(UnitTestRunner& _runner);
+void RunCullingTests(UnitTestRunner& _runner);
+void RunEntityWorldTests(UnitTestRunner& _runner);
+void RunFixedTimestepTests(UnitTestRunner& _runner);
+void RunFrameStatsTests(UnitTestRunner& _runner);
+void RunMathTests(UnitTestRunner& _runner);
+void RunOcclusionTests(UnitTestRunner& _runner);
+void RunShaderPreprocessorTests(UnitTestRunner& _runner);
+void RunTransformTests(UnitTestRunner& _runner);
@@ -0,0 +1,49 @@
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "UnitTest.h"
+#include "VectorMath.h"
+
+/// <summary>
+/// Unit test entry point: CPU only, no window or GL context
+/// </summary>
+/// <param name="argc"></param>
+/// <param name="argv"></param>
+/// <returns></returns>
+int main(int argc, char** argv)
+{
+    std::string filter;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+        {
+            filter = argv[++i];
+        }
+        else
+        {
+            std::cout << "Usage: " << argv[0] << " [options]" << std::endl
+                << "  --filter <text>     Run only the tests whose name contains <text>" << std::endl;
+            return -1;
+        }
+    }
+
+    std::cout << "SIMD level: " << GetSimdLevelName() << std::endl;
+
+    UnitTestRunner runner(filter);
+    RunMathTests(runner);
+    RunTransformTests(runner);
+    RunCullingTests(runner);
+    RunBvhTests(runner);
+    RunOcclusionTests(runner);
+    RunEntityWorldTests(runner);
+    RunFixedTimestepTests(runner);
+    RunFrameStatsTests(runner);
+    RunApplicationOptionsTests(runner);
+    RunShaderPreprocessorTests(runner);
+    runner.PrintSummary();
+
+    /* A filter matching nothing is a mistake too (a suite renamed under ctest) */
+    return (runner.GetTestCount() > 0 && runner.GetFailedTestCount() == 0) ? 0 : 1;
+}
@@ -0,0 +1,48 @@
+# Generate a C++ source embedding every file of a shader directory, so the executable doesn't need the
+# files at run time. Run as a script:
+#   cmake -DSHADER_DIR=<dir> -DSHADER_PREFIX=Shaders -DOUTPUT=<file.cpp> -P EmbedShaders.cmake
+# Each file is stored as a constexpr byte array (no string literal length limits, any content) under its
+# path relative to SHADER_DIR, prefixed with SHADER_PREFIX: the path the application asks for
+
+if(NOT SHADER_DIR OR NOT OUTPUT)
+    message(FATAL_ERROR "EmbedShaders.cmake needs SHADER_DIR and OUTPUT")
+endif()
+if(NOT DEFINED SHADER_PREFIX)
+    set(SHADER_PREFIX "Shaders")
+endif()
+
+get_filename_component(SHADER_DIR ${SHADER_DIR} ABSOLUTE)
+file(GLOB_RECURSE shader_files RELATIVE ${SHADER_DIR} ${SHADER_DIR}/*.glsl)
+list(SORT shader_files)
+
+set(arrays "")
+set(table "")
+set(index 0)
+foreach(shader_file IN LISTS shader_files)
+    file(READ ${SHADER_DIR}/${shader_file} bytes HEX)
+    string(LENGTH "${bytes}" hex_length)
+    math(EXPR size "${hex_length} / 2")
+
+    # 16 bytes per line, then a NUL so the data can also be used as a C string
+    set(lines "")
+    set(offset 0)
+    while(offset LESS hex_length)
+        string(SUBSTRING "${bytes}" ${offset} 32 line)
+        string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," line "${line}")
+        string(APPEND lines "    ${line}\n")
+        math(EXPR offset "${offset} + 32")
+    endwhile()
+
+    string(APPEND arrays "// ${SHADER_PREFIX}/${shader_file}\nstatic constexpr unsigned char s_shader${index}[] =\n{\n${lines}    0x00\n};\n\n")
+    string(APPEND table "    { \"${SHADER_PREFIX}/${shader_file}\", reinterpret_cast<const char*>(s_shader${index}), ${size} },\n")
+    math(EXPR index "${index} + 1")
+endforeach()
+
+if(index EQUAL 0)
+    # Keep the table valid C++ (no empty array)
+    set(table "    { \"\", \"\", 0 },\n")
+endif()
+
+set(content "// Generated by cmake/EmbedShaders.cmake from the Shaders directory, do not edit\n\n#include \"EmbeddedShaders.h\"\n\n${arrays}const EmbeddedShader m_embeddedShaders[] =\n{\n${table}};\n\nconst size_t m_embeddedShaderCount = ${index};\n")
+
+file(WRITE ${OUTPUT} "${content}")